@@ -0,0 +1,184 @@
+// BPActivation.h: interface for the BPActivation class.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+
+#ifndef _BPACTIVATION_H
+#define _BPACTIVATION_H
+
+#include <cmath>
+#include <cstddef>
+#include "BPKernels.h"
+
+
+//////////////////////////////////////////////////////////////////////
+// BPActivation - transfer functions of a layer.
+//
+// Each activation is a policy class template with two static inline
+// functions:
+//	forward(x, n, width, mode)	x[i] = f(x[i]) for n values stored in
+//								rows of width values (one per sample)
+//	derivative(y)				f'(x) expressed by the node value y = f(x)
+//
+// BPLayer selects the policy once per call and runs its loops with
+// the policy inlined, there is no dispatch per node.
+//
+// TANH uses the sigmoid kernel (tanh(x) = 2 * sigmoid(2x) - 1) when
+// a fast sigmoid mode is selected, and the C library tanh otherwise.
+//
+// SOFTMAX normalizes each row and is only valid for the output layer.
+// Its error is (desired - value), the gradient of the cross-entropy
+// loss of a softmax output, so its derivative() is 1.
+//////////////////////////////////////////////////////////////////////
+class BPActivation
+{
+// Types
+public:
+	enum Type
+	{
+		SIGMOID = 0,	// 1 / (1 + exp(-x))
+		TANH,			// tanh(x)
+		RELU,			// max(0, x)
+		LINEAR,			// x
+		SOFTMAX,		// exp(x) / sum(exp(x)) over the nodes of the layer
+		NUM_TYPES
+	};
+
+	// logistic sigmoid
+	template <class T>
+	struct SigmoidAct
+	{
+		static inline void	forward(T* x, size_t n, int, BPKernels::Sigmoid mode)
+		{
+			BPKernels::sigmoid( x, (int)n, mode );
+		}
+
+		static inline T		derivative(T y)		{ return (y * ( T(1.0) - y )); }
+	};
+
+	// hyperbolic tangent
+	template <class T>
+	struct TanhAct
+	{
+		static inline void	forward(T* x, size_t n, int, BPKernels::Sigmoid mode)
+		{
+			if ( mode == BPKernels::SIGMOID_EXACT )
+			{
+				for (size_t i = 0; i != n; ++i)
+					x[i] = std::tanh(x[i]);
+				return;
+			}
+
+			for (size_t i = 0; i != n; ++i)
+				x[i] = x[i] + x[i];
+
+			BPKernels::sigmoid( x, (int)n, mode );
+
+			for (size_t i = 0; i != n; ++i)
+				x[i] = x[i] + x[i] - T(1.0);
+		}
+
+		static inline T		derivative(T y)		{ return ( T(1.0) - y * y ); }
+	};
+
+	// rectified linear unit
+	template <class T>
+	struct ReluAct
+	{
+		static inline void	forward(T* x, size_t n, int, BPKernels::Sigmoid)
+		{
+			for (size_t i = 0; i != n; ++i)
+				x[i] = (x[i] > 0) ? x[i] : T(0);
+		}
+
+		static inline T		derivative(T y)		{ return (y > 0) ? T(1.0) : T(0); }
+	};
+
+	// identity
+	template <class T>
+	struct LinearAct
+	{
+		static inline void	forward(T*, size_t, int, BPKernels::Sigmoid)	{ }
+
+		static inline T		derivative(T)		{ return T(1.0); }
+	};
+
+	// normalized exponential of each row
+	template <class T>
+	struct SoftmaxAct
+	{
+		static inline void	forward(T* x, size_t n, int width, BPKernels::Sigmoid)
+		{
+			for (size_t first = 0; first < n; first += width)
+			{
+				T* row = x + first;
+
+				// subtract largest value to avoid overflow
+				T largest = row[0];
+				for (int j = 1; j < width; ++j)
+					largest = (row[j] > largest) ? row[j] : largest;
+
+				T sum = 0;
+				for (int j = 0; j != width; ++j)
+				{
+					row[j] = std::exp(row[j] - largest);
+					sum += row[j];
+				}
+
+				T scale = T(1.0) / sum;
+				for (int j = 0; j != width; ++j)
+					row[j] *= scale;
+			}
+		}
+
+		static inline T		derivative(T)		{ return T(1.0); }
+	};
+
+// Methods
+public:
+
+	// apply an activation to n values (rows of width values)
+	template <class T>
+	static void		forward(Type type, T* x, size_t n, int width, BPKernels::Sigmoid mode)
+	{
+		switch (type)
+		{
+		case TANH:		TanhAct<T>::forward(x, n, width, mode);		break;
+		case RELU:		ReluAct<T>::forward(x, n, width, mode);		break;
+		case LINEAR:	LinearAct<T>::forward(x, n, width, mode);	break;
+		case SOFTMAX:	SoftmaxAct<T>::forward(x, n, width, mode);	break;
+		default:		SigmoidAct<T>::forward(x, n, width, mode);	break;
+		}
+	}
+
+	// is value a valid activation type
+	static bool		isValid(int type)			{ return type >= SIGMOID && type < NUM_TYPES; }
+
+	// is the activation applied to each node independently
+	static bool		elementwise(Type type)		{ return type != SOFTMAX; }
+
+	// get activation name
+	static const char*	name(Type type)
+	{
+		switch (type)
+		{
+		case SIGMOID:	return "sigmoid";
+		case TANH:		return "tanh";
+		case RELU:		return "relu";
+		case LINEAR:	return "linear";
+		case SOFTMAX:	return "softmax";
+		default:		break;
+		}
+
+		return "unknown";
+	}
+};
+
+
+#endif // _BPACTIVATION_H
@@ -0,0 +1,216 @@
+// BPBuffer.h: interface for the BPBuffer class.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+
+#ifndef _BPBUFFER_H
+#define _BPBUFFER_H
+
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
+
+// alignment (in bytes) of all buffer allocations.
+// 64 bytes covers a cache line and the widest SIMD register.
+#define BPBUFFER_ALIGNMENT 64
+
+
+//////////////////////////////////////////////////////////////////////
+// BPBuffer - fixed size, zero initialized, aligned array
+//////////////////////////////////////////////////////////////////////
+template <class T>
+class BPBuffer
+{
+// Methods
+public:
+	BPBuffer() : _data(NULL), _size(0), _owned(true)	{}
+	explicit BPBuffer(size_t size) : _data(NULL), _size(0), _owned(true)	{ resize(size); }
+	BPBuffer(const BPBuffer& other) : _data(NULL), _size(0), _owned(true)	{ *this = other; }
+	virtual ~BPBuffer()														{ release(); }
+
+	// assignment always makes an owned copy (also of attached memory)
+	BPBuffer& operator=(const BPBuffer& other);
+
+	// reallocate buffer (contents are zeroed)
+	void	resize(size_t size);
+
+	// use external memory (e.g. a mapped file) without copying.
+	// the memory is not freed by the buffer and must outlive it
+	void	attach(T* data, size_t size);
+
+	// is memory owned by the buffer
+	bool	owned() const	{ return _owned; }
+
+	// free buffer
+	void	release();
+
+	// exchange storage with another buffer
+	void	swap(BPBuffer& other);
+
+	// set all elements to zero
+	void	zero()	{ if (_size != 0) memset(_data, 0, _size * sizeof(T)); }
+
+	size_t		size()	const	{ return _size; }
+	bool		empty()	const	{ return _size == 0; }
+
+	T*			data()			{ return _data; }
+	const T*	data()	const	{ return _data; }
+
+	T&			operator[](size_t i)		{ assert(i < _size); return _data[i]; }
+	const T&	operator[](size_t i) const	{ assert(i < _size); return _data[i]; }
+
+protected:
+	static T*	allocate(size_t size);
+	static void	deallocate(T* p);
+
+// Members
+protected:
+	T*		_data;	// aligned storage
+	size_t	_size;	// number of elements
+	bool	_owned;	// storage was allocated by buffer
+};
+
+
+//////////////////////////////////////////////////////////////////////
+// BPBuffer inline functions
+//////////////////////////////////////////////////////////////////////
+
+
+//====================================================================
+// Assignment - deep copy
+//====================================================================
+template <class T>
+BPBuffer<T>& BPBuffer<T>::operator=(const BPBuffer<T>& other)
+{
+	if (this != &other)
+	{
+		resize(other._size);
+		if (_size != 0)
+			memcpy(_data, other._data, _size * sizeof(T));
+	}
+
+	return *this;
+}
+
+
+//====================================================================
+// Reallocate buffer, new contents are zeroed
+//====================================================================
+template <class T>
+void BPBuffer<T>::resize(size_t size)
+{
+	if (size != _size || !_owned)
+	{
+		release();
+
+		if (size != 0)
+		{
+			_data = allocate(size);
+			_size = size;
+		}
+	}
+
+	zero();
+}
+
+
+//====================================================================
+// Free buffer
+//====================================================================
+template <class T>
+void BPBuffer<T>::release()
+{
+	if (_owned)
+		deallocate(_data);
+
+	_data	= NULL;
+	_size	= 0;
+	_owned	= true;
+}
+
+
+//====================================================================
+// Use external memory
+//====================================================================
+template <class T>
+void BPBuffer<T>::attach(T* data, size_t size)
+{
+	assert( data != NULL || size == 0 );
+
+	release();
+
+	_data	= data;
+	_size	= size;
+	_owned	= false;
+}
+
+
+//====================================================================
+// Exchange storage
+//====================================================================
+template <class T>
+void BPBuffer<T>::swap(BPBuffer<T>& other)
+{
+	T*		data	= _data;
+	size_t	size	= _size;
+	bool	owned	= _owned;
+
+	_data	= other._data;
+	_size	= other._size;
+	_owned	= other._owned;
+
+	other._data		= data;
+	other._size		= size;
+	other._owned	= owned;
+}
+
+
+//====================================================================
+// Allocate aligned memory
+//====================================================================
+template <class T>
+T* BPBuffer<T>::allocate(size_t size)
+{
+	// round up so the allocation size is a multiple of the alignment
+	size_t bytes = size * sizeof(T);
+	bytes = (bytes + BPBUFFER_ALIGNMENT - 1) & ~(size_t)(BPBUFFER_ALIGNMENT - 1);
+
+	void* p = NULL;
+#ifdef _MSC_VER
+	p = _aligned_malloc(bytes, BPBUFFER_ALIGNMENT);
+#else
+	if ( posix_memalign(&p, BPBUFFER_ALIGNMENT, bytes) != 0 )
+		p = NULL;
+#endif
+
+	assert( p != NULL );
+
+	return (T*)p;
+}
+
+
+//====================================================================
+// Free aligned memory
+//====================================================================
+template <class T>
+void BPBuffer<T>::deallocate(T* p)
+{
+#ifdef _MSC_VER
+	_aligned_free(p);
+#else
+	free(p);
+#endif
+}
+
+
+#endif // _BPBUFFER_H
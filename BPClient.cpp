@@ -0,0 +1,146 @@
+// BPClient.cpp: implementation of the BPClient class.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <cassert>
+#include <cstring>
+#include "BPClient.h"
+
+
+//////////////////////////////////////////////////////////////////////
+// Construction/Destruction
+//////////////////////////////////////////////////////////////////////
+
+template <class T>
+BPClientT<T>::~BPClientT()
+{
+	close();
+}
+
+
+template <class T>
+BPClientT<T>::BPClientT() :	_numInputs(0),
+							_numOutputs(0),
+							_maxSamples(0)
+{
+
+}
+
+
+//====================================================================
+// Connect to a server on a Unix domain socket
+//====================================================================
+template <class T>
+bool BPClientT<T>::connectUnix(const char* path)
+{
+	close();
+
+	return _socket.connectUnix(path) && handshake();
+}
+
+
+//====================================================================
+// Connect to a server on a loopback TCP port
+//====================================================================
+template <class T>
+bool BPClientT<T>::connectTcp(int port)
+{
+	close();
+
+	return _socket.connectTcp(port) && handshake();
+}
+
+
+//====================================================================
+// Read and check the server's hello
+//====================================================================
+template <class T>
+bool BPClientT<T>::handshake()
+{
+	BPServerHello hello;
+	if ( !_socket.read( &hello, sizeof(hello) ) ||
+		 memcmp( hello.magic, "BPNETSRV", 8 ) != 0 ||
+		 hello.version != BPSERVER_VERSION ||
+		 hello.scalarSize != sizeof(T) )
+	{
+		_socket.close();
+		return false;
+	}
+
+	_numInputs	= hello.numInputs;
+	_numOutputs	= hello.numOutputs;
+	_maxSamples	= hello.maxSamples;
+
+	return true;
+}
+
+
+//====================================================================
+// Close connection
+//====================================================================
+template <class T>
+void BPClientT<T>::close()
+{
+	if ( _socket.isOpen() )
+	{
+		// a request without samples ends the connection
+		BPServerRequest request;
+		request.count		= 0;
+		request.reserved	= 0;
+
+		_socket.write( &request, sizeof(request) );
+		_socket.close();
+	}
+
+	_numInputs	= 0;
+	_numOutputs	= 0;
+	_maxSamples	= 0;
+}
+
+
+//====================================================================
+// Evaluate input rows on the server
+//====================================================================
+template <class T>
+bool BPClientT<T>::predict(const T* in, T* out, int n)
+{
+	assert( n > 0 && in != NULL && out != NULL );
+
+	if ( !_socket.isOpen() || n > _maxSamples )
+		return false;
+
+	// header and inputs are sent with one write
+	size_t inBytes = (size_t)n * _numInputs * sizeof(T);
+	_request.resize( sizeof(BPServerRequest) + inBytes );
+
+	BPServerRequest request;
+	request.count		= n;
+	request.reserved	= 0;
+
+	memcpy( &_request[0], &request, sizeof(request) );
+	memcpy( &_request[sizeof(request)], in, inBytes );
+
+	BPServerReply reply;
+	if ( !_socket.write( &_request[0], _request.size() ) ||
+		 !_socket.read( &reply, sizeof(reply) ) ||
+		 reply.status != BPSERVER_OK || reply.count != (uint32_t)n ||
+		 !_socket.read( out, (size_t)n * _numOutputs * sizeof(T) ) )
+	{
+		_socket.close();
+		return false;
+	}
+
+	return true;
+}
+
+
+// explicit instantiation
+template class BPClientT<double>;
+template class BPClientT<float>;
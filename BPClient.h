@@ -0,0 +1,78 @@
+// BPClient.h: interface for the BPClient class.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+
+#ifndef _BPCLIENT_H
+#define _BPCLIENT_H
+
+#include <vector>
+#include "BPSocket.h"
+#include "BPServer.h"
+using namespace std;
+
+
+//////////////////////////////////////////////////////////////////////
+// BPClientT - connection to a BPServer (see BPServer.h for the
+// protocol). T must match the precision of the served network.
+//
+// A client sends one request at a time and waits for its reply, use
+// one client per thread for concurrent requests.
+//////////////////////////////////////////////////////////////////////
+template <class T>
+class BPClientT
+{
+// Methods
+public:
+	virtual ~BPClientT();	// destructor (closes connection)
+	BPClientT();			// default c-tor
+
+	// connect to a server on a Unix domain socket / loopback TCP port,
+	// fails if the server's precision differs
+	bool	connectUnix(const char* path);
+	bool	connectTcp(int port);
+
+	// close connection
+	void	close();
+
+	// is client connected
+	bool	isOpen() const		{ return _socket.isOpen(); }
+
+	// get input/output row size of the served network
+	int		numInputs() const	{ return _numInputs;  }
+	int		numOutputs() const	{ return _numOutputs; }
+
+	// get largest number of samples of one request
+	int		maxSamples() const	{ return _maxSamples; }
+
+	// evaluate n input rows into n output rows. false if n exceeds
+	// maxSamples() or on a connection error (the connection is closed)
+	bool	predict(const T* in, T* out, int n);
+
+protected:
+
+	// read and check the server's hello
+	bool	handshake();
+
+// Members
+protected:
+
+	BPSocket		_socket;		// connection
+	int				_numInputs;		// values per input row
+	int				_numOutputs;	// values per output row
+	int				_maxSamples;	// samples per request
+	vector<char>	_request;		// request header and inputs
+};
+
+// double and float clients
+typedef BPClientT<double>	BPClient;
+typedef BPClientT<float>	BPClientF;
+
+
+#endif // _BPCLIENT_H
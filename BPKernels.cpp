@@ -0,0 +1,564 @@
+// BPKernels.cpp: implementation of the BPKernels class.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include "BPKernels.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define BPKERNELS_X86
+#endif
+
+#ifdef BPKERNELS_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+
+//////////////////////////////////////////////////////////////////////
+// Scalar kernels
+//////////////////////////////////////////////////////////////////////
+
+template <class T>
+static void matVecScalar(const T* w, const T* bias, const T* in, T* out, int rows, int cols)
+{
+	for (int j = 0; j != rows; ++j, w += cols)
+	{
+		T total = (bias != NULL) ? bias[j] : 0;
+		for (int k = 0; k != cols; ++k)
+			total += in[k] * w[k];
+
+		out[j] = total;
+	}
+}
+
+
+template <class T>
+static void matTVecScalar(const T* w, const T* err, T* out, int rows, int cols, int ldw)
+{
+	for (int k = 0; k != cols; ++k)
+		out[k] = 0;
+
+	for (int j = 0; j != rows; ++j, w += ldw)
+	{
+		T e = err[j];
+		for (int k = 0; k != cols; ++k)
+			out[k] += e * w[k];
+	}
+}
+
+
+template <class T>
+static void updateScalar(T* w, T* d, const T* in, const T* err,
+						 T lr, T mt, int rows, int cols)
+{
+	for (int j = 0; j != rows; ++j, w += cols, d += cols)
+	{
+		T scale = lr * err[j];
+		for (int k = 0; k != cols; ++k)
+		{
+			T change = scale * in[k];
+			T deltaW = change + (mt * d[k]);
+			w[k] += deltaW;
+			d[k] = deltaW;
+		}
+	}
+}
+
+
+template <class T>
+static void batchMatVecScalar(const T* w, const T* bias, const T* in, T* out, int rows, int cols, int n)
+{
+	for (int s = 0; s != n; ++s)
+		matVecScalar<T>(w, bias, in + s * cols, out + s * rows, rows, cols);
+}
+
+
+template <class T>
+static void batchMatTVecScalar(const T* w, const T* err, T* out, int rows, int cols, int n)
+{
+	for (int s = 0; s != n; ++s)
+		matTVecScalar<T>(w, err + s * rows, out + s * cols, rows, cols, cols);
+}
+
+
+template <class T>
+static void gradientScalar(T* g, const T* in, const T* err, int rows, int cols, int n, int lde)
+{
+	for (int j = 0; j != rows; ++j, g += cols)
+		for (int s = 0; s != n; ++s)
+		{
+			T			e	= err[s * lde + j];
+			const T*	ins	= in + s * cols;
+			for (int k = 0; k != cols; ++k)
+				g[k] += e * ins[k];
+		}
+}
+
+
+template <class T>
+static void applyScalar(T* w, T* d, const T* g, T lr, T mt, int size)
+{
+	for (int i = 0; i != size; ++i)
+	{
+		T change = lr * g[i];
+		T deltaW = change + (mt * d[i]);
+		w[i] += deltaW;
+		d[i] = deltaW;
+	}
+}
+
+
+static void matVecI8Scalar(const int8_t* w, const uint8_t* in, int32_t* out, int rows, int cols)
+{
+	for (int j = 0; j != rows; ++j, w += cols)
+	{
+		int32_t total = 0;
+		for (int k = 0; k != cols; ++k)
+			total += (int32_t)in[k] * w[k];
+
+		out[j] = total;
+	}
+}
+
+
+namespace
+{
+
+//////////////////////////////////////////////////////////////////////
+// One-element vector traits (scalar sigmoid and optimizers of BPKernelsImpl.h)
+//////////////////////////////////////////////////////////////////////
+template <class T>
+struct ScalarVec
+{
+	typedef T S;
+	typedef T V;
+	enum { N = 1 };
+
+	static inline V		zero()							{ return 0; }
+	static inline V		set1(T x)						{ return x; }
+	static inline V		load(const T* p)				{ return *p; }
+	static inline void	store(T* p, V v)				{ *p = v; }
+	static inline V		add(V a, V b)					{ return a + b; }
+	static inline V		mul(V a, V b)					{ return a * b; }
+	static inline V		div(V a, V b)					{ return a / b; }
+	static inline V		min(V a, V b)					{ return (a < b) ? a : b; }
+	static inline V		max(V a, V b)					{ return (a > b) ? a : b; }
+	static inline V		sqrt(V a)						{ return std::sqrt(a); }
+	static inline V		fmadd(V a, V b, V c)			{ return a * b + c; }
+	static inline T		hsum(V v)						{ return v; }
+};
+
+} // namespace
+
+#include "BPKernelsImpl.h"
+
+
+//////////////////////////////////////////////////////////////////////
+// Sigmoid lookup table: values at STEPS points per unit over
+// [-RANGE, RANGE]. linear interpolation error is at most
+// sigmoid''max / (8 * STEPS^2) = 7.3e-7, and 1.1e-7 beyond the range
+//////////////////////////////////////////////////////////////////////
+template <class T>
+struct SigmoidTable
+{
+	enum
+	{
+		RANGE	= 16,
+		STEPS	= 128,
+		SIZE	= 2 * RANGE * STEPS		// number of intervals
+	};
+
+	T	values[SIZE + 1];
+
+	SigmoidTable()
+	{
+		for (int i = 0; i <= SIZE; ++i)
+			values[i] = (T)( 1.0 / (1.0 + exp( -((double)i / STEPS - RANGE) )) );
+	}
+};
+
+
+// vector kernel tables (NULL when not available on this platform)
+const BPKernels::Table* bpKernelsSSE2();
+const BPKernels::Table* bpKernelsAVX2();
+const BPKernels::Table* bpKernelsAVX512();
+
+const BPKernels::TableF* bpKernelsSSE2F();
+const BPKernels::TableF* bpKernelsAVX2F();
+const BPKernels::TableF* bpKernelsAVX512F();
+
+const BPKernels::TableI8* bpKernelsSSE2I8();
+const BPKernels::TableI8* bpKernelsAVX2I8();
+const BPKernels::TableI8* bpKernelsAVX512I8(bool vnni);
+
+
+#ifdef BPKERNELS_X86
+
+//====================================================================
+// cpuid/xgetbv helpers
+//====================================================================
+static void cpuid(unsigned int leaf, unsigned int subLeaf, unsigned int regs[4])
+{
+#ifdef _MSC_VER
+	int r[4];
+	__cpuidex(r, (int)leaf, (int)subLeaf);
+	for (int i = 0; i != 4; ++i)
+		regs[i] = (unsigned int)r[i];
+#else
+	regs[0] = regs[1] = regs[2] = regs[3] = 0;
+	__cpuid_count(leaf, subLeaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+
+static unsigned long long xgetbv()
+{
+#ifdef _MSC_VER
+	return _xgetbv(0);
+#else
+	unsigned int eax, edx;
+	__asm__ __volatile__ ("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+	return ((unsigned long long)edx << 32) | eax;
+#endif
+}
+
+
+//====================================================================
+// Check AVX-512 byte/word and VNNI instructions (int8 kernels)
+//====================================================================
+static void detectInt8(bool& avx512bw, bool& vnni)
+{
+	unsigned int regs[4];
+	cpuid(7, 0, regs);
+
+	avx512bw	= (regs[1] & (1u << 30)) != 0;
+	vnni		= (regs[2] & (1u << 11)) != 0;
+}
+
+#endif // BPKERNELS_X86
+
+
+//////////////////////////////////////////////////////////////////////
+// Kernel tables
+//////////////////////////////////////////////////////////////////////
+
+static const BPKernels::Table* const*	kernelTables();
+static const BPKernels::TableF* const*	kernelTablesF();
+static const BPKernels::TableI8* const*	kernelTablesI8();
+
+
+//////////////////////////////////////////////////////////////////////
+// BPKernels
+//////////////////////////////////////////////////////////////////////
+
+// select kernels during static initialization
+const BPKernels::Table*		BPKernels::_pTable	= BPKernels::initTable();
+const BPKernels::TableF*	BPKernels::_pTableF	= BPKernels::initTableF();
+const BPKernels::TableI8*	BPKernels::_pTableI8	= BPKernels::initTableI8();
+
+
+//====================================================================
+// Get best level supported by this CPU
+//====================================================================
+BPKernels::Level BPKernels::detectLevel()
+{
+	Level level = LEVEL_SCALAR;
+
+#ifdef BPKERNELS_X86
+	unsigned int regs[4];
+
+	cpuid(0, 0, regs);
+	unsigned int maxLeaf = regs[0];
+	if (maxLeaf < 1)
+		return level;
+
+	cpuid(1, 0, regs);
+	bool sse2	 = (regs[3] & (1u << 26)) != 0;
+	bool fma	 = (regs[2] & (1u << 12)) != 0;
+	bool osxsave = (regs[2] & (1u << 27)) != 0;
+	bool avx	 = (regs[2] & (1u << 28)) != 0;
+
+	if (!sse2)
+		return level;
+
+	level = LEVEL_SSE2;
+
+	// the OS must save the YMM (and ZMM) registers on context switch
+	if (!osxsave || !avx || maxLeaf < 7)
+		return level;
+
+	unsigned long long xcr0 = xgetbv();
+	if ((xcr0 & 0x6) != 0x6)
+		return level;
+
+	cpuid(7, 0, regs);
+	bool avx2	 = (regs[1] & (1u << 5))  != 0;
+	bool avx512f = (regs[1] & (1u << 16)) != 0;
+
+	if (avx2 && fma)
+		level = LEVEL_AVX2;
+
+	if (avx512f && (xcr0 & 0xE0) == 0xE0)
+		level = LEVEL_AVX512;
+#endif
+
+	return level;
+}
+
+
+//====================================================================
+// Get level used by kernels
+//====================================================================
+BPKernels::Level BPKernels::getLevel()
+{
+	return table((const double*)0)._level;
+}
+
+
+//====================================================================
+// Set level used by kernels
+//====================================================================
+bool BPKernels::setLevel(Level level)
+{
+	if (level < LEVEL_SCALAR || level > detectLevel())
+		return false;
+
+	_pTable		= kernelTables()[level];
+	_pTableF	= kernelTablesF()[level];
+	_pTableI8	= kernelTablesI8()[level];
+
+	return true;
+}
+
+
+//====================================================================
+// Get level name
+//====================================================================
+const char* BPKernels::levelName(Level level)
+{
+	switch (level)
+	{
+	case LEVEL_SCALAR:	return "scalar";
+	case LEVEL_SSE2:	return "sse2";
+	case LEVEL_AVX2:	return "avx2";
+	case LEVEL_AVX512:	return "avx512";
+	}
+
+	return "unknown";
+}
+
+
+//====================================================================
+// Get sigmoid mode name
+//====================================================================
+const char* BPKernels::sigmoidName(Sigmoid mode)
+{
+	switch (mode)
+	{
+	case SIGMOID_EXACT:		return "exact";
+	case SIGMOID_TABLE:		return "table";
+	case SIGMOID_RATIONAL:	return "rational";
+	}
+
+	return "unknown";
+}
+
+
+//====================================================================
+// Sigmoid with the C library exp
+//====================================================================
+template <class T>
+void BPKernels::sigmoidExact(T* x, int n)
+{
+	for (int i = 0; i != n; ++i)
+		x[i] = T(1.0) / (T(1.0) + exp(-x[i]));
+}
+
+
+//====================================================================
+// Sigmoid by table interpolation
+//====================================================================
+template <class T>
+void BPKernels::sigmoidTable(T* x, int n)
+{
+	typedef SigmoidTable<T> Table;
+
+	static const Table table;
+
+	const T* values = table.values;
+	for (int i = 0; i != n; ++i)
+	{
+		// position in table (NaN maps to the first entry)
+		double t = ((double)x[i] + Table::RANGE) * Table::STEPS;
+		t = (t > 0) ? t : 0;
+		t = (t < Table::SIZE) ? t : (double)Table::SIZE;
+
+		int k = (int)t;
+		k = (k < Table::SIZE) ? k : Table::SIZE - 1;
+
+		T f = (T)(t - k);
+		x[i] = values[k] + f * (values[k+1] - values[k]);
+	}
+}
+
+
+template void BPKernels::sigmoidExact(double* x, int n);
+template void BPKernels::sigmoidExact(float* x, int n);
+template void BPKernels::sigmoidTable(double* x, int n);
+template void BPKernels::sigmoidTable(float* x, int n);
+
+
+//====================================================================
+// Select initial level (best level, or BPNET_SIMD override)
+//====================================================================
+BPKernels::Level BPKernels::initLevel()
+{
+	Level level = detectLevel();
+
+	const char* env = getenv("BPNET_SIMD");
+	if (env != NULL)
+	{
+		for (int i = LEVEL_SCALAR; i <= level; ++i)
+		{
+			if (strcmp(env, levelName((Level)i)) == 0)
+			{
+				level = (Level)i;
+				break;
+			}
+		}
+	}
+
+	return level;
+}
+
+
+//====================================================================
+// Select initial kernel tables
+//====================================================================
+const BPKernels::Table* BPKernels::initTable()
+{
+	return kernelTables()[initLevel()];
+}
+
+
+const BPKernels::TableF* BPKernels::initTableF()
+{
+	return kernelTablesF()[initLevel()];
+}
+
+
+const BPKernels::TableI8* BPKernels::initTableI8()
+{
+	return kernelTablesI8()[initLevel()];
+}
+
+
+//====================================================================
+// Kernel tables of all levels
+// (levels without an implementation on this platform fall back to scalar,
+// tables of levels the CPU doesn't support are never looked up)
+//====================================================================
+template <class T>
+static const BPKernels::TableT<T>* const* buildKernelTables(const BPKernels::TableT<T>* sse2,
+															const BPKernels::TableT<T>* avx2,
+															const BPKernels::TableT<T>* avx512)
+{
+	static const BPKernels::TableT<T> scalar =
+	{
+		BPKernels::LEVEL_SCALAR,
+		matVecScalar<T>,
+		matTVecScalar<T>,
+		updateScalar<T>,
+		batchMatVecScalar<T>,
+		batchMatTVecScalar<T>,
+		gradientScalar<T>,
+		applyScalar<T>,
+		nesterovT< ScalarVec<T> >,
+		rmspropT< ScalarVec<T> >,
+		adamT< ScalarVec<T> >,
+		sigmoidT< ScalarVec<T> >
+	};
+
+	static const BPKernels::TableT<T>* tables[] = { &scalar, sse2, avx2, avx512 };
+
+	for (int i = BPKernels::LEVEL_SSE2; i <= BPKernels::LEVEL_AVX512; ++i)
+		if (tables[i] == NULL)
+			tables[i] = tables[i-1];
+
+	return tables;
+}
+
+
+static const BPKernels::Table* const* kernelTables()
+{
+	BPKernels::Level level = BPKernels::detectLevel();
+	static const BPKernels::Table* const* tables =
+		buildKernelTables<double>( ( level >= BPKernels::LEVEL_SSE2 )	? bpKernelsSSE2()	: NULL,
+								   ( level >= BPKernels::LEVEL_AVX2 )	? bpKernelsAVX2()	: NULL,
+								   ( level >= BPKernels::LEVEL_AVX512 )	? bpKernelsAVX512()	: NULL );
+
+	return tables;
+}
+
+
+static const BPKernels::TableF* const* kernelTablesF()
+{
+	BPKernels::Level level = BPKernels::detectLevel();
+	static const BPKernels::TableF* const* tables =
+		buildKernelTables<float>( ( level >= BPKernels::LEVEL_SSE2 )	? bpKernelsSSE2F()		: NULL,
+								  ( level >= BPKernels::LEVEL_AVX2 )	? bpKernelsAVX2F()		: NULL,
+								  ( level >= BPKernels::LEVEL_AVX512 )	? bpKernelsAVX512F()	: NULL );
+
+	return tables;
+}
+
+
+//====================================================================
+// Int8 kernel tables of all levels
+// (the AVX-512 kernels also need AVX-512BW, VNNI is used if present)
+//====================================================================
+static const BPKernels::TableI8* const* buildKernelTablesI8()
+{
+	static const BPKernels::TableI8 scalar = { BPKernels::LEVEL_SCALAR, matVecI8Scalar };
+
+	BPKernels::Level level = BPKernels::detectLevel();
+
+	bool avx512bw = false, vnni = false;
+#ifdef BPKERNELS_X86
+	if ( level == BPKernels::LEVEL_AVX512 )
+		detectInt8(avx512bw, vnni);
+#endif
+
+	static const BPKernels::TableI8* tables[] = { &scalar, NULL, NULL, NULL };
+
+	tables[BPKernels::LEVEL_SSE2]	= ( level >= BPKernels::LEVEL_SSE2 ) ? bpKernelsSSE2I8() : NULL;
+	tables[BPKernels::LEVEL_AVX2]	= ( level >= BPKernels::LEVEL_AVX2 ) ? bpKernelsAVX2I8() : NULL;
+	tables[BPKernels::LEVEL_AVX512]	= avx512bw ? bpKernelsAVX512I8(vnni) : NULL;
+
+	for (int i = BPKernels::LEVEL_SSE2; i <= BPKernels::LEVEL_AVX512; ++i)
+		if (tables[i] == NULL)
+			tables[i] = tables[i-1];
+
+	return tables;
+}
+
+
+static const BPKernels::TableI8* const* kernelTablesI8()
+{
+	static const BPKernels::TableI8* const* tables = buildKernelTablesI8();
+
+	return tables;
+}
@@ -0,0 +1,290 @@
+// BPKernels.h: interface for the BPKernels class.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+
+#ifndef _BPKERNELS_H
+#define _BPKERNELS_H
+
+#include <stdint.h>
+
+
+//////////////////////////////////////////////////////////////////////
+// BPKernels - layer-level numeric kernels.
+//
+// Each kernel has a scalar implementation and SSE2/AVX2/AVX-512
+// implementations. The best instruction set supported by the CPU is
+// selected on first use (using cpuid). The selection can be
+// overridden with setLevel() or with the BPNET_SIMD environment
+// variable ("scalar", "sse2", "avx2" or "avx512").
+//
+// The scalar kernels perform the exact same operations, in the same
+// order, as the original BPNode/BPLink code and produce bit-identical
+// results. The vector kernels change the summation order (and use
+// fused multiply-add) so their results may differ in the last bits.
+//
+// Matrices are row-major. A weight matrix 'w' has 'rows' nodes and
+// 'cols' inputs. Batch matrices hold one sample per row. The forward
+// kernels add the bias of each node to its sum (no bias if NULL).
+//
+// Every kernel exists for double and float matrices, the kernel
+// table is selected by the scalar type of the arguments.
+//
+// The sigmoid transfer function is evaluated by a kernel as well, in
+// one of three modes (largest absolute error over all inputs):
+//	SIGMOID_EXACT		1 / (1 + exp(-x)) with the C library exp, the
+//						same results at every level (reproducible)
+//	SIGMOID_TABLE		linear interpolation in a 4097 entry table
+//						over [-16, 16], error < 1e-6 (scalar code)
+//	SIGMOID_RATIONAL	0.5 + 0.5 * tanh(x / 2) with a rational tanh
+//						approximation, error < 2e-8 for double and
+//						3e-7 for float, vectorized
+//
+// The int8 kernel (matVecI8) multiplies 7-bit unsigned inputs by
+// int8 weights with exact int32 sums (pmaddubsw/pmaddwd, or VNNI
+// where available), so every level gives identical results.
+//////////////////////////////////////////////////////////////////////
+class BPKernels
+{
+// Types
+public:
+	enum Level
+	{
+		LEVEL_SCALAR = 0,
+		LEVEL_SSE2,
+		LEVEL_AVX2,
+		LEVEL_AVX512
+	};
+
+	// sigmoid evaluation mode (see above)
+	enum Sigmoid
+	{
+		SIGMOID_EXACT = 0,
+		SIGMOID_TABLE,
+		SIGMOID_RATIONAL
+	};
+
+	// kernels of one level for scalar type T (float or double)
+	template <class T>
+	struct TableT
+	{
+		// out[j] = bias[j] + sum_k( w[j][k] * in[k] )		(bias may be NULL)
+		typedef void (*MatVecFunc)(const T* w, const T* bias, const T* in, T* out, int rows, int cols);
+
+		// out[k] = sum_j( err[j] * w[j][k] )				(ldw - distance between rows of w)
+		typedef void (*MatTVecFunc)(const T* w, const T* err, T* out, int rows, int cols, int ldw);
+
+		// d[j][k] = lr * err[j] * in[k] + mt * d[j][k];  w[j][k] += d[j][k]
+		typedef void (*UpdateFunc)(T* w, T* d, const T* in, const T* err,
+								   T lr, T mt, int rows, int cols);
+
+		// out[s][j] = bias[j] + sum_k( w[j][k] * in[s][k] )	(n samples, bias may be NULL)
+		typedef void (*BatchMatVecFunc)(const T* w, const T* bias, const T* in, T* out, int rows, int cols, int n);
+
+		// out[s][k] = sum_j( err[s][j] * w[j][k] )				(n samples)
+		typedef void (*BatchMatTVecFunc)(const T* w, const T* err, T* out, int rows, int cols, int n);
+
+		// g[j][k] += sum_s( err[s][j] * in[s][k] )				(n samples, lde - distance between rows of err)
+		typedef void (*GradientFunc)(T* g, const T* in, const T* err, int rows, int cols, int n, int lde);
+
+		// d[i] = lr * g[i] + mt * d[i];  w[i] += d[i]
+		typedef void (*ApplyFunc)(T* w, T* d, const T* g, T lr, T mt, int size);
+
+		// adaptive update with two state vectors d, s			(RMSProp and Adam, see BPKernelsImpl.h)
+		typedef void (*AdaptiveFunc)(T* w, T* d, T* s, const T* g, T lr, T a, T b, T eps, int size);
+
+		// x[i] = 1 / (1 + exp(-x[i]))							(rational approximation)
+		typedef void (*SigmoidFunc)(T* x, int n);
+
+		Level				_level;
+		MatVecFunc			_matVec;
+		MatTVecFunc			_matTVec;
+		UpdateFunc			_update;
+		BatchMatVecFunc		_batchMatVec;
+		BatchMatTVecFunc	_batchMatTVec;
+		GradientFunc		_gradient;
+		ApplyFunc			_apply;
+		ApplyFunc			_nesterov;
+		AdaptiveFunc		_rmsprop;
+		AdaptiveFunc		_adam;
+		SigmoidFunc			_sigmoid;
+	};
+
+	typedef TableT<double>	Table;
+	typedef TableT<float>	TableF;
+
+	// int8 kernels of one level
+	struct TableI8
+	{
+		// out[j] = sum_k( w[j][k] * in[k] )		(cols - multiple of I8_BLOCK)
+		typedef void (*MatVecI8Func)(const int8_t* w, const uint8_t* in, int32_t* out, int rows, int cols);
+
+		Level			_level;
+		MatVecI8Func	_matVec;
+	};
+
+	enum
+	{
+		I8_BLOCK	= 16,	// int8 rows are padded to a multiple of this length
+		I8_MAX		= 127	// largest int8 input (larger inputs may saturate pmaddubsw)
+	};
+
+// Methods
+public:
+
+	// get best level supported by this CPU
+	static Level		detectLevel();
+
+	// get/set level used by kernels
+	// (setLevel fails if the level is not supported by this CPU)
+	static Level		getLevel();
+	static bool			setLevel(Level level);
+
+	// get level name
+	static const char*	levelName(Level level);
+
+	// get sigmoid mode name ("exact", "table" or "rational")
+	static const char*	sigmoidName(Sigmoid mode);
+
+	// forward-pass: weighted sum of inputs plus bias for each node
+	template <class T>
+	static void	matVec(const T* w, const T* bias, const T* in, T* out, int rows, int cols)
+	{
+		table(w)._matVec(w, bias, in, out, rows, cols);
+	}
+
+	// backward-pass: weighted sum of errors for each input node
+	template <class T>
+	static void	matTVec(const T* w, const T* err, T* out, int rows, int cols)
+	{
+		table(w)._matTVec(w, err, out, rows, cols, cols);
+	}
+
+	// backward-pass over a range of columns of a wider matrix
+	template <class T>
+	static void	matTVec(const T* w, const T* err, T* out, int rows, int cols, int ldw)
+	{
+		table(w)._matTVec(w, err, out, rows, cols, ldw);
+	}
+
+	// weights adjustment with momentum
+	template <class T>
+	static void	update(T* w, T* d, const T* in, const T* err,
+					   double lr, double mt, int rows, int cols)
+	{
+		table(w)._update(w, d, in, err, (T)lr, (T)mt, rows, cols);
+	}
+
+	// batch forward-pass
+	template <class T>
+	static void	batchMatVec(const T* w, const T* bias, const T* in, T* out, int rows, int cols, int n)
+	{
+		table(w)._batchMatVec(w, bias, in, out, rows, cols, n);
+	}
+
+	// batch backward-pass
+	template <class T>
+	static void	batchMatTVec(const T* w, const T* err, T* out, int rows, int cols, int n)
+	{
+		table(w)._batchMatTVec(w, err, out, rows, cols, n);
+	}
+
+	// accumulate weight gradient of a batch
+	template <class T>
+	static void	gradient(T* g, const T* in, const T* err, int rows, int cols, int n)
+	{
+		table(g)._gradient(g, in, err, rows, cols, n, rows);
+	}
+
+	// accumulate weight gradient of a range of rows
+	template <class T>
+	static void	gradient(T* g, const T* in, const T* err, int rows, int cols, int n, int lde)
+	{
+		table(g)._gradient(g, in, err, rows, cols, n, lde);
+	}
+
+	// apply accumulated gradient with momentum
+	template <class T>
+	static void	apply(T* w, T* d, const T* g, double lr, double mt, int size)
+	{
+		table(w)._apply(w, d, g, (T)lr, (T)mt, size);
+	}
+
+	// apply accumulated gradient with Nesterov momentum
+	template <class T>
+	static void	nesterov(T* w, T* d, const T* g, double lr, double mt, int size)
+	{
+		table(w)._nesterov(w, d, g, (T)lr, (T)mt, size);
+	}
+
+	// apply accumulated gradient with RMSProp (s - mean squared gradient)
+	template <class T>
+	static void	rmsprop(T* w, T* d, T* s, const T* g, double lr, double mt,
+						double decay, double eps, int size)
+	{
+		table(w)._rmsprop(w, d, s, g, (T)lr, (T)mt, (T)decay, (T)eps, size);
+	}
+
+	// apply accumulated gradient with Adam (m, v - first and second moments,
+	// lr includes the bias correction of the step)
+	template <class T>
+	static void	adam(T* w, T* m, T* v, const T* g, double lr, double beta1,
+					 double beta2, double eps, int size)
+	{
+		table(w)._adam(w, m, v, g, (T)lr, (T)beta1, (T)beta2, (T)eps, size);
+	}
+
+	// transfer function: x[i] = 1 / (1 + exp(-x[i]))
+	template <class T>
+	static void	sigmoid(T* x, int n, Sigmoid mode)
+	{
+		switch (mode)
+		{
+		case SIGMOID_TABLE:		sigmoidTable(x, n);				break;
+		case SIGMOID_RATIONAL:	table(x)._sigmoid(x, n);		break;
+		default:				sigmoidExact(x, n);				break;
+		}
+	}
+
+	// integer forward-pass: inputs 0..I8_MAX, int8 weights, int32 sums.
+	// rows of w and in are padded with zeros to cols (a multiple of I8_BLOCK)
+	static void	matVecI8(const int8_t* w, const uint8_t* in, int32_t* out, int rows, int cols)
+	{
+		tableI8()._matVec(w, in, out, rows, cols);
+	}
+
+protected:
+
+	// get active kernel table of a scalar type (selected by pointer type)
+	static const Table&		table(const double*)	{ if (_pTable == 0) _pTable = initTable(); return *_pTable; }
+	static const TableF&	table(const float*)		{ if (_pTableF == 0) _pTableF = initTableF(); return *_pTableF; }
+
+	// get active int8 kernel table
+	static const TableI8&	tableI8()				{ if (_pTableI8 == 0) _pTableI8 = initTableI8(); return *_pTableI8; }
+
+	// sigmoid modes that are the same at every level
+	template <class T>
+	static void				sigmoidExact(T* x, int n);
+	template <class T>
+	static void				sigmoidTable(T* x, int n);
+
+	static Level			initLevel();
+	static const Table*		initTable();
+	static const TableF*	initTableF();
+	static const TableI8*	initTableI8();
+
+// Members
+private:
+	static const Table*		_pTable;	// active double kernel table
+	static const TableF*	_pTableF;	// active float kernel table
+	static const TableI8*	_pTableI8;	// active int8 kernel table
+};
+
+
+#endif // _BPKERNELS_H
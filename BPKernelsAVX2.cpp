@@ -0,0 +1,190 @@
+// BPKernelsAVX2.cpp: AVX2 kernels.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <cstring>
+#include "BPKernels.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+
+#include <immintrin.h>
+
+// compile everything below for AVX2
+// (standard headers are included above so they keep the default target)
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx2,fma"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+#endif
+
+namespace
+{
+
+//////////////////////////////////////////////////////////////////////
+// AVX2 vector traits (double)
+//////////////////////////////////////////////////////////////////////
+struct Vec
+{
+	typedef double S;
+	typedef __m256d V;
+	enum { N = 4 };
+
+	static inline V		zero()							{ return _mm256_setzero_pd(); }
+	static inline V		set1(double x)					{ return _mm256_set1_pd(x); }
+	static inline V		load(const double* p)			{ return _mm256_loadu_pd(p); }
+	static inline void	store(double* p, V v)			{ _mm256_storeu_pd(p, v); }
+	static inline V		add(V a, V b)					{ return _mm256_add_pd(a, b); }
+	static inline V		mul(V a, V b)					{ return _mm256_mul_pd(a, b); }
+	static inline V		div(V a, V b)					{ return _mm256_div_pd(a, b); }
+	static inline V		min(V a, V b)					{ return _mm256_min_pd(a, b); }
+	static inline V		max(V a, V b)					{ return _mm256_max_pd(a, b); }
+	static inline V		sqrt(V a)						{ return _mm256_sqrt_pd(a); }
+	static inline V		fmadd(V a, V b, V c)			{ return _mm256_fmadd_pd(a, b, c); }
+
+	static inline double hsum(V v)
+	{
+		__m128d s = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+		return _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+	}
+};
+
+//////////////////////////////////////////////////////////////////////
+// AVX2 vector traits (float)
+//////////////////////////////////////////////////////////////////////
+struct VecF
+{
+	typedef float S;
+	typedef __m256 V;
+	enum { N = 8 };
+
+	static inline V		zero()							{ return _mm256_setzero_ps(); }
+	static inline V		set1(float x)					{ return _mm256_set1_ps(x); }
+	static inline V		load(const float* p)			{ return _mm256_loadu_ps(p); }
+	static inline void	store(float* p, V v)			{ _mm256_storeu_ps(p, v); }
+	static inline V		add(V a, V b)					{ return _mm256_add_ps(a, b); }
+	static inline V		mul(V a, V b)					{ return _mm256_mul_ps(a, b); }
+	static inline V		div(V a, V b)					{ return _mm256_div_ps(a, b); }
+	static inline V		min(V a, V b)					{ return _mm256_min_ps(a, b); }
+	static inline V		max(V a, V b)					{ return _mm256_max_ps(a, b); }
+	static inline V		sqrt(V a)						{ return _mm256_sqrt_ps(a); }
+	static inline V		fmadd(V a, V b, V c)			{ return _mm256_fmadd_ps(a, b, c); }
+
+	static inline float hsum(V v)
+	{
+		__m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+		s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+		return _mm_cvtss_f32(_mm_add_ss(s, _mm_shuffle_ps(s, s, 1)));
+	}
+};
+
+} // namespace
+
+#include "BPKernelsImpl.h"
+
+
+//====================================================================
+// AVX2 kernel tables (constant initialized, see BPKernelsImpl.h)
+//====================================================================
+static const BPKernels::Table	table	= BPKERNELS_TABLE(Vec, BPKernels::LEVEL_AVX2);
+static const BPKernels::TableF	tableF	= BPKERNELS_TABLE(VecF, BPKernels::LEVEL_AVX2);
+
+
+//====================================================================
+// out[j] = sum_k( w[j][k] * in[k] )	(uint8 x int8, pmaddubsw)
+//====================================================================
+static void matVecI8(const int8_t* w, const uint8_t* in, int32_t* out, int rows, int cols)
+{
+	const __m256i ones	= _mm256_set1_epi16(1);
+
+	for (int j = 0; j != rows; ++j, w += cols)
+	{
+		__m256i acc = _mm256_setzero_si256();
+
+		int k = 0;
+		for (; k + 32 <= cols; k += 32)
+		{
+			__m256i p = _mm256_maddubs_epi16( _mm256_loadu_si256((const __m256i*)(in + k)),
+											  _mm256_loadu_si256((const __m256i*)(w + k)) );
+			acc = _mm256_add_epi32(acc, _mm256_madd_epi16(p, ones));
+		}
+
+		__m128i sum = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+
+		// remaining block of 16
+		if (k != cols)
+		{
+			__m128i p = _mm_maddubs_epi16( _mm_loadu_si128((const __m128i*)(in + k)),
+										   _mm_loadu_si128((const __m128i*)(w + k)) );
+			sum = _mm_add_epi32(sum, _mm_madd_epi16(p, _mm256_castsi256_si128(ones)));
+		}
+
+		sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+		sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+		out[j] = _mm_cvtsi128_si32(sum);
+	}
+}
+
+
+//====================================================================
+// AVX2 int8 kernel table
+//====================================================================
+static const BPKernels::TableI8 tableI8 = { BPKernels::LEVEL_AVX2, matVecI8 };
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+
+//====================================================================
+// Get AVX2 kernel tables
+// (compiled for the default target, they run on any CPU)
+//====================================================================
+const BPKernels::Table* bpKernelsAVX2()
+{
+	return &table;
+}
+
+
+const BPKernels::TableF* bpKernelsAVX2F()
+{
+	return &tableF;
+}
+
+
+//====================================================================
+// Get AVX2 int8 kernel table
+//====================================================================
+const BPKernels::TableI8* bpKernelsAVX2I8()
+{
+	return &tableI8;
+}
+
+#else
+
+// not available on this platform
+const BPKernels::Table* bpKernelsAVX2()
+{
+	return NULL;
+}
+
+const BPKernels::TableF* bpKernelsAVX2F()
+{
+	return NULL;
+}
+
+const BPKernels::TableI8* bpKernelsAVX2I8()
+{
+	return NULL;
+}
+
+#endif
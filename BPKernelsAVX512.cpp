@@ -0,0 +1,251 @@
+// BPKernelsAVX512.cpp: AVX-512 kernels.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <cstring>
+#include "BPKernels.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+
+#include <immintrin.h>
+
+// compile everything below for AVX-512
+// (standard headers are included above so they keep the default target)
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx512f"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+#endif
+
+namespace
+{
+
+//////////////////////////////////////////////////////////////////////
+// AVX-512 vector traits (double)
+//////////////////////////////////////////////////////////////////////
+struct Vec
+{
+	typedef double S;
+	typedef __m512d V;
+	enum { N = 8 };
+
+	static inline V		zero()							{ return _mm512_setzero_pd(); }
+	static inline V		set1(double x)					{ return _mm512_set1_pd(x); }
+	static inline V		load(const double* p)			{ return _mm512_loadu_pd(p); }
+	static inline void	store(double* p, V v)			{ _mm512_storeu_pd(p, v); }
+	static inline V		add(V a, V b)					{ return _mm512_add_pd(a, b); }
+	static inline V		mul(V a, V b)					{ return _mm512_mul_pd(a, b); }
+	static inline V		div(V a, V b)					{ return _mm512_div_pd(a, b); }
+	// (zero-masked forms avoid GCC's uninitialized warning on _mm512_min/max/sqrt)
+	static inline V		min(V a, V b)					{ return _mm512_maskz_min_pd((__mmask8)-1, a, b); }
+	static inline V		max(V a, V b)					{ return _mm512_maskz_max_pd((__mmask8)-1, a, b); }
+	static inline V		sqrt(V a)						{ return _mm512_maskz_sqrt_pd((__mmask8)-1, a); }
+	static inline V		fmadd(V a, V b, V c)			{ return _mm512_fmadd_pd(a, b, c); }
+
+	static inline double hsum(V v)
+	{
+		double s[8];
+		_mm512_storeu_pd(s, v);
+		return ((s[0] + s[4]) + (s[1] + s[5])) + ((s[2] + s[6]) + (s[3] + s[7]));
+	}
+};
+
+//////////////////////////////////////////////////////////////////////
+// AVX-512 vector traits (float)
+//////////////////////////////////////////////////////////////////////
+struct VecF
+{
+	typedef float S;
+	typedef __m512 V;
+	enum { N = 16 };
+
+	static inline V		zero()							{ return _mm512_setzero_ps(); }
+	static inline V		set1(float x)					{ return _mm512_set1_ps(x); }
+	static inline V		load(const float* p)			{ return _mm512_loadu_ps(p); }
+	static inline void	store(float* p, V v)			{ _mm512_storeu_ps(p, v); }
+	static inline V		add(V a, V b)					{ return _mm512_add_ps(a, b); }
+	static inline V		mul(V a, V b)					{ return _mm512_mul_ps(a, b); }
+	static inline V		div(V a, V b)					{ return _mm512_div_ps(a, b); }
+	// (zero-masked forms avoid GCC's uninitialized warning on _mm512_min/max/sqrt)
+	static inline V		min(V a, V b)					{ return _mm512_maskz_min_ps((__mmask16)-1, a, b); }
+	static inline V		max(V a, V b)					{ return _mm512_maskz_max_ps((__mmask16)-1, a, b); }
+	static inline V		sqrt(V a)						{ return _mm512_maskz_sqrt_ps((__mmask16)-1, a); }
+	static inline V		fmadd(V a, V b, V c)			{ return _mm512_fmadd_ps(a, b, c); }
+
+	static inline float hsum(V v)
+	{
+		float s[16];
+		_mm512_storeu_ps(s, v);
+		for (int i = 0; i != 8; ++i)
+			s[i] += s[i + 8];
+		return ((s[0] + s[4]) + (s[1] + s[5])) + ((s[2] + s[6]) + (s[3] + s[7]));
+	}
+};
+
+} // namespace
+
+#include "BPKernelsImpl.h"
+
+
+//====================================================================
+// AVX-512 kernel tables (constant initialized, see BPKernelsImpl.h)
+//====================================================================
+static const BPKernels::Table	table	= BPKERNELS_TABLE(Vec, BPKernels::LEVEL_AVX512);
+static const BPKernels::TableF	tableF	= BPKERNELS_TABLE(VecF, BPKernels::LEVEL_AVX512);
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+
+// compile the int8 kernels for AVX-512BW and VNNI
+// (only called when the CPU supports them, see BPKernels.cpp)
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx512f,avx512bw,avx512vnni"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx512f,avx512bw,avx512vnni")
+#endif
+
+//====================================================================
+// Mask of the bytes of a partial block (n < 64)
+//====================================================================
+static inline __mmask64 tailMask(int n)
+{
+	return (~(__mmask64)0) >> (64 - n);
+}
+
+
+//====================================================================
+// Horizontal sum of 16 int32
+//====================================================================
+static inline int32_t hsumI32(__m512i v)
+{
+	int32_t s[16];
+	_mm512_storeu_si512(s, v);
+	for (int i = 0; i != 8; ++i)
+		s[i] += s[i + 8];
+	return ((s[0] + s[4]) + (s[1] + s[5])) + ((s[2] + s[6]) + (s[3] + s[7]));
+}
+
+
+//====================================================================
+// out[j] = sum_k( w[j][k] * in[k] )	(uint8 x int8, vpmaddubsw)
+//====================================================================
+static void matVecI8(const int8_t* w, const uint8_t* in, int32_t* out, int rows, int cols)
+{
+	const __m512i ones = _mm512_set1_epi16(1);
+
+	for (int j = 0; j != rows; ++j, w += cols)
+	{
+		__m512i acc = _mm512_setzero_si512();
+
+		int k = 0;
+		for (; k + 64 <= cols; k += 64)
+		{
+			__m512i p = _mm512_maddubs_epi16( _mm512_loadu_si512(in + k), _mm512_loadu_si512(w + k) );
+			acc = _mm512_add_epi32(acc, _mm512_madd_epi16(p, ones));
+		}
+
+		if (k != cols)
+		{
+			__mmask64	m = tailMask(cols - k);
+			__m512i		p = _mm512_maddubs_epi16( _mm512_maskz_loadu_epi8(m, in + k), _mm512_maskz_loadu_epi8(m, w + k) );
+			acc = _mm512_add_epi32(acc, _mm512_madd_epi16(p, ones));
+		}
+
+		out[j] = hsumI32(acc);
+	}
+}
+
+
+//====================================================================
+// out[j] = sum_k( w[j][k] * in[k] )	(uint8 x int8, vpdpbusd)
+//====================================================================
+static void matVecI8VNNI(const int8_t* w, const uint8_t* in, int32_t* out, int rows, int cols)
+{
+	for (int j = 0; j != rows; ++j, w += cols)
+	{
+		__m512i acc = _mm512_setzero_si512();
+
+		int k = 0;
+		for (; k + 64 <= cols; k += 64)
+			acc = _mm512_dpbusd_epi32(acc, _mm512_loadu_si512(in + k), _mm512_loadu_si512(w + k));
+
+		if (k != cols)
+		{
+			__mmask64 m = tailMask(cols - k);
+			acc = _mm512_dpbusd_epi32(acc, _mm512_maskz_loadu_epi8(m, in + k), _mm512_maskz_loadu_epi8(m, w + k));
+		}
+
+		out[j] = hsumI32(acc);
+	}
+}
+
+
+//====================================================================
+// AVX-512 int8 kernel tables
+//====================================================================
+static const BPKernels::TableI8 tableI8		= { BPKernels::LEVEL_AVX512, matVecI8 };
+static const BPKernels::TableI8 tableI8VNNI	= { BPKernels::LEVEL_AVX512, matVecI8VNNI };
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+
+//====================================================================
+// Get AVX-512 kernel tables
+// (compiled for the default target, they run on any CPU)
+//====================================================================
+const BPKernels::Table* bpKernelsAVX512()
+{
+	return &table;
+}
+
+
+const BPKernels::TableF* bpKernelsAVX512F()
+{
+	return &tableF;
+}
+
+
+//====================================================================
+// Get AVX-512 int8 kernel table
+//====================================================================
+const BPKernels::TableI8* bpKernelsAVX512I8(bool vnni)
+{
+	return vnni ? &tableI8VNNI : &tableI8;
+}
+
+#else
+
+// not available on this platform
+const BPKernels::Table* bpKernelsAVX512()
+{
+	return NULL;
+}
+
+const BPKernels::TableF* bpKernelsAVX512F()
+{
+	return NULL;
+}
+
+const BPKernels::TableI8* bpKernelsAVX512I8(bool)
+{
+	return NULL;
+}
+
+#endif
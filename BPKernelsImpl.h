@@ -0,0 +1,546 @@
+// BPKernelsImpl.h: vector kernel templates.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+//
+// Included by each instruction-set specific translation unit
+// (BPKernelsSSE2.cpp, BPKernelsAVX2.cpp, ...) after it selects its
+// target instruction set. The including unit defines a vector traits
+// class for each scalar type (double and float) with:
+//
+//	S						scalar type
+//	V						vector register type
+//	N						number of scalars in V
+//	zero(), set1(x)			create vectors
+//	load(p), store(p, v)	unaligned memory access
+//	add(a, b), mul(a, b)
+//	div(a, b), min(a, b), max(a, b)
+//	sqrt(a)
+//	fmadd(a, b, c)			a * b + c
+//	hsum(v)					horizontal sum
+//
+// The templates have internal linkage so every unit gets its own
+// copy compiled for its instruction set. BPKernels.cpp also includes
+// this file, with one-element traits, for the scalar sigmoid and optimizers.
+//
+//////////////////////////////////////////////////////////////////////
+
+#ifndef _BPKERNELSIMPL_H
+#define _BPKERNELSIMPL_H
+
+#include <cmath>
+#include <cstring>
+#include "BPKernels.h"
+
+namespace
+{
+
+// number of samples processed together by the batch kernels
+const int BATCH_BLOCK = 4;
+
+
+//====================================================================
+// out[j] = bias[j] + sum_k( w[j][k] * in[k] )
+//====================================================================
+template <class Vec, class S = typename Vec::S>
+void matVecT(const S* w, const S* bias, const S* in, S* out, int rows, int cols)
+{
+	typedef typename Vec::V V;
+
+	for (int j = 0; j != rows; ++j, w += cols)
+	{
+		V acc0 = Vec::zero();
+		V acc1 = Vec::zero();
+
+		int k = 0;
+		for (; k + 2 * Vec::N <= cols; k += 2 * Vec::N)
+		{
+			acc0 = Vec::fmadd(Vec::load(in + k),		  Vec::load(w + k),			 acc0);
+			acc1 = Vec::fmadd(Vec::load(in + k + Vec::N), Vec::load(w + k + Vec::N), acc1);
+		}
+
+		for (; k + Vec::N <= cols; k += Vec::N)
+			acc0 = Vec::fmadd(Vec::load(in + k), Vec::load(w + k), acc0);
+
+		S total = Vec::hsum(Vec::add(acc0, acc1)) + ((bias != NULL) ? bias[j] : S(0));
+
+		for (; k != cols; ++k)
+			total += in[k] * w[k];
+
+		out[j] = total;
+	}
+}
+
+
+//====================================================================
+// out[k] = sum_j( err[j] * w[j][k] )
+//====================================================================
+template <class Vec, class S = typename Vec::S>
+void matTVecT(const S* w, const S* err, S* out, int rows, int cols, int ldw)
+{
+	memset(out, 0, cols * sizeof(S));
+
+	for (int j = 0; j != rows; ++j, w += ldw)
+	{
+		typename Vec::V e = Vec::set1(err[j]);
+
+		int k = 0;
+		for (; k + Vec::N <= cols; k += Vec::N)
+			Vec::store(out + k, Vec::fmadd(e, Vec::load(w + k), Vec::load(out + k)));
+
+		for (; k != cols; ++k)
+			out[k] += err[j] * w[k];
+	}
+}
+
+
+//====================================================================
+// d[j][k] = lr * err[j] * in[k] + mt * d[j][k];  w[j][k] += d[j][k]
+//====================================================================
+template <class Vec, class S = typename Vec::S>
+void updateT(S* w, S* d, const S* in, const S* err,
+			 S lr, S mt, int rows, int cols)
+{
+	typedef typename Vec::V V;
+
+	V m = Vec::set1(mt);
+
+	for (int j = 0; j != rows; ++j, w += cols, d += cols)
+	{
+		S	scale = lr * err[j];
+		V		s	  = Vec::set1(scale);
+
+		int k = 0;
+		for (; k + Vec::N <= cols; k += Vec::N)
+		{
+			V deltaW = Vec::fmadd(m, Vec::load(d + k), Vec::mul(s, Vec::load(in + k)));
+			Vec::store(w + k, Vec::add(Vec::load(w + k), deltaW));
+			Vec::store(d + k, deltaW);
+		}
+
+		for (; k != cols; ++k)
+		{
+			S deltaW = scale * in[k] + (mt * d[k]);
+			w[k] += deltaW;
+			d[k] = deltaW;
+		}
+	}
+}
+
+
+//====================================================================
+// out[s][j] = bias[j] + sum_k( w[j][k] * in[s][k] )
+// each weight row is loaded once for a block of samples
+//====================================================================
+template <class Vec, class S = typename Vec::S>
+void batchMatVecT(const S* w, const S* bias, const S* in, S* out, int rows, int cols, int n)
+{
+	typedef typename Vec::V V;
+
+	int s = 0;
+	for (; s + BATCH_BLOCK <= n; s += BATCH_BLOCK)
+	{
+		const S* in0 = in + (s + 0) * cols;
+		const S* in1 = in + (s + 1) * cols;
+		const S* in2 = in + (s + 2) * cols;
+		const S* in3 = in + (s + 3) * cols;
+
+		const S* wj = w;
+		for (int j = 0; j != rows; ++j, wj += cols)
+		{
+			V acc0 = Vec::zero();
+			V acc1 = Vec::zero();
+			V acc2 = Vec::zero();
+			V acc3 = Vec::zero();
+
+			int k = 0;
+			for (; k + Vec::N <= cols; k += Vec::N)
+			{
+				V wk = Vec::load(wj + k);
+				acc0 = Vec::fmadd(Vec::load(in0 + k), wk, acc0);
+				acc1 = Vec::fmadd(Vec::load(in1 + k), wk, acc1);
+				acc2 = Vec::fmadd(Vec::load(in2 + k), wk, acc2);
+				acc3 = Vec::fmadd(Vec::load(in3 + k), wk, acc3);
+			}
+
+			S b  = (bias != NULL) ? bias[j] : S(0);
+			S t0 = Vec::hsum(acc0) + b;
+			S t1 = Vec::hsum(acc1) + b;
+			S t2 = Vec::hsum(acc2) + b;
+			S t3 = Vec::hsum(acc3) + b;
+
+			for (; k != cols; ++k)
+			{
+				t0 += in0[k] * wj[k];
+				t1 += in1[k] * wj[k];
+				t2 += in2[k] * wj[k];
+				t3 += in3[k] * wj[k];
+			}
+
+			out[(s + 0) * rows + j] = t0;
+			out[(s + 1) * rows + j] = t1;
+			out[(s + 2) * rows + j] = t2;
+			out[(s + 3) * rows + j] = t3;
+		}
+	}
+
+	// remaining samples
+	for (; s != n; ++s)
+		matVecT<Vec>(w, bias, in + s * cols, out + s * rows, rows, cols);
+}
+
+
+//====================================================================
+// out[s][k] = sum_j( err[s][j] * w[j][k] )
+// each weight row is loaded once for a block of samples
+//====================================================================
+template <class Vec, class S = typename Vec::S>
+void batchMatTVecT(const S* w, const S* err, S* out, int rows, int cols, int n)
+{
+	typedef typename Vec::V V;
+
+	int s = 0;
+	for (; s + BATCH_BLOCK <= n; s += BATCH_BLOCK)
+	{
+		S* out0 = out + (s + 0) * cols;
+		S* out1 = out + (s + 1) * cols;
+		S* out2 = out + (s + 2) * cols;
+		S* out3 = out + (s + 3) * cols;
+
+		memset(out0, 0, BATCH_BLOCK * cols * sizeof(S));
+
+		const S* wj = w;
+		for (int j = 0; j != rows; ++j, wj += cols)
+		{
+			S e0 = err[(s + 0) * rows + j];
+			S e1 = err[(s + 1) * rows + j];
+			S e2 = err[(s + 2) * rows + j];
+			S e3 = err[(s + 3) * rows + j];
+
+			V ve0 = Vec::set1(e0);
+			V ve1 = Vec::set1(e1);
+			V ve2 = Vec::set1(e2);
+			V ve3 = Vec::set1(e3);
+
+			int k = 0;
+			for (; k + Vec::N <= cols; k += Vec::N)
+			{
+				V wk = Vec::load(wj + k);
+				Vec::store(out0 + k, Vec::fmadd(ve0, wk, Vec::load(out0 + k)));
+				Vec::store(out1 + k, Vec::fmadd(ve1, wk, Vec::load(out1 + k)));
+				Vec::store(out2 + k, Vec::fmadd(ve2, wk, Vec::load(out2 + k)));
+				Vec::store(out3 + k, Vec::fmadd(ve3, wk, Vec::load(out3 + k)));
+			}
+
+			for (; k != cols; ++k)
+			{
+				out0[k] += e0 * wj[k];
+				out1[k] += e1 * wj[k];
+				out2[k] += e2 * wj[k];
+				out3[k] += e3 * wj[k];
+			}
+		}
+	}
+
+	// remaining samples
+	for (; s != n; ++s)
+		matTVecT<Vec>(w, err + s * rows, out + s * cols, rows, cols, cols);
+}
+
+
+//====================================================================
+// g[j][k] += sum_s( err[s][j] * in[s][k] )
+// each gradient row is loaded once for a block of samples
+//====================================================================
+template <class Vec, class S = typename Vec::S>
+void gradientT(S* g, const S* in, const S* err, int rows, int cols, int n, int lde)
+{
+	typedef typename Vec::V V;
+
+	for (int j = 0; j != rows; ++j, g += cols)
+	{
+		int s = 0;
+		for (; s + BATCH_BLOCK <= n; s += BATCH_BLOCK)
+		{
+			const S* in0 = in + (s + 0) * cols;
+			const S* in1 = in + (s + 1) * cols;
+			const S* in2 = in + (s + 2) * cols;
+			const S* in3 = in + (s + 3) * cols;
+
+			S e0 = err[(s + 0) * lde + j];
+			S e1 = err[(s + 1) * lde + j];
+			S e2 = err[(s + 2) * lde + j];
+			S e3 = err[(s + 3) * lde + j];
+
+			V ve0 = Vec::set1(e0);
+			V ve1 = Vec::set1(e1);
+			V ve2 = Vec::set1(e2);
+			V ve3 = Vec::set1(e3);
+
+			int k = 0;
+			for (; k + Vec::N <= cols; k += Vec::N)
+			{
+				V acc = Vec::load(g + k);
+				acc = Vec::fmadd(ve0, Vec::load(in0 + k), acc);
+				acc = Vec::fmadd(ve1, Vec::load(in1 + k), acc);
+				acc = Vec::fmadd(ve2, Vec::load(in2 + k), acc);
+				acc = Vec::fmadd(ve3, Vec::load(in3 + k), acc);
+				Vec::store(g + k, acc);
+			}
+
+			for (; k != cols; ++k)
+				g[k] += e0 * in0[k] + e1 * in1[k] + e2 * in2[k] + e3 * in3[k];
+		}
+
+		// remaining samples
+		for (; s != n; ++s)
+		{
+			const S* ins = in + s * cols;
+			S e = err[s * lde + j];
+			V ve = Vec::set1(e);
+
+			int k = 0;
+			for (; k + Vec::N <= cols; k += Vec::N)
+				Vec::store(g + k, Vec::fmadd(ve, Vec::load(ins + k), Vec::load(g + k)));
+
+			for (; k != cols; ++k)
+				g[k] += e * ins[k];
+		}
+	}
+}
+
+
+//====================================================================
+// d[i] = lr * g[i] + mt * d[i];  w[i] += d[i]
+//====================================================================
+template <class Vec, class S = typename Vec::S>
+void applyT(S* w, S* d, const S* g, S lr, S mt, int size)
+{
+	typedef typename Vec::V V;
+
+	V l = Vec::set1(lr);
+	V m = Vec::set1(mt);
+
+	int i = 0;
+	for (; i + Vec::N <= size; i += Vec::N)
+	{
+		V deltaW = Vec::fmadd(m, Vec::load(d + i), Vec::mul(l, Vec::load(g + i)));
+		Vec::store(w + i, Vec::add(Vec::load(w + i), deltaW));
+		Vec::store(d + i, deltaW);
+	}
+
+	for (; i != size; ++i)
+	{
+		S deltaW = lr * g[i] + (mt * d[i]);
+		w[i] += deltaW;
+		d[i] = deltaW;
+	}
+}
+
+
+//====================================================================
+// Nesterov momentum:
+// d[i] = lr * g[i] + mt * d[i];  w[i] += lr * g[i] + mt * d[i]
+//====================================================================
+template <class Vec, class S = typename Vec::S>
+void nesterovT(S* w, S* d, const S* g, S lr, S mt, int size)
+{
+	typedef typename Vec::V V;
+
+	V l = Vec::set1(lr);
+	V m = Vec::set1(mt);
+
+	int i = 0;
+	for (; i + Vec::N <= size; i += Vec::N)
+	{
+		V change = Vec::mul(l, Vec::load(g + i));
+		V deltaW = Vec::fmadd(m, Vec::load(d + i), change);
+		Vec::store(w + i, Vec::add(Vec::load(w + i), Vec::fmadd(m, deltaW, change)));
+		Vec::store(d + i, deltaW);
+	}
+
+	for (; i != size; ++i)
+	{
+		S change = lr * g[i];
+		S deltaW = change + (mt * d[i]);
+		w[i] += change + (mt * deltaW);
+		d[i] = deltaW;
+	}
+}
+
+
+//====================================================================
+// RMSProp with momentum:
+// s[i] = decay * s[i] + (1 - decay) * g[i]^2
+// d[i] = lr * g[i] / (sqrt(s[i]) + eps) + mt * d[i];  w[i] += d[i]
+//====================================================================
+template <class Vec, class S = typename Vec::S>
+void rmspropT(S* w, S* d, S* s, const S* g, S lr, S mt, S decay, S eps, int size)
+{
+	typedef typename Vec::V V;
+
+	V l = Vec::set1(lr);
+	V m = Vec::set1(mt);
+	V a = Vec::set1(decay);
+	V b = Vec::set1(S(1) - decay);
+	V e = Vec::set1(eps);
+
+	int i = 0;
+	for (; i + Vec::N <= size; i += Vec::N)
+	{
+		V gi = Vec::load(g + i);
+		V si = Vec::fmadd(b, Vec::mul(gi, gi), Vec::mul(a, Vec::load(s + i)));
+		V deltaW = Vec::fmadd(m, Vec::load(d + i), Vec::div(Vec::mul(l, gi), Vec::add(Vec::sqrt(si), e)));
+		Vec::store(w + i, Vec::add(Vec::load(w + i), deltaW));
+		Vec::store(d + i, deltaW);
+		Vec::store(s + i, si);
+	}
+
+	for (; i != size; ++i)
+	{
+		S si = decay * s[i] + (S(1) - decay) * g[i] * g[i];
+		S deltaW = lr * g[i] / (std::sqrt(si) + eps) + (mt * d[i]);
+		w[i] += deltaW;
+		d[i] = deltaW;
+		s[i] = si;
+	}
+}
+
+
+//====================================================================
+// Adam (lr includes the bias correction of the current step):
+// m[i] = b1 * m[i] + (1 - b1) * g[i]
+// v[i] = b2 * v[i] + (1 - b2) * g[i]^2
+// w[i] += lr * m[i] / (sqrt(v[i]) + eps)
+//====================================================================
+template <class Vec, class S = typename Vec::S>
+void adamT(S* w, S* m, S* v, const S* g, S lr, S b1, S b2, S eps, int size)
+{
+	typedef typename Vec::V V;
+
+	V l  = Vec::set1(lr);
+	V a1 = Vec::set1(b1);
+	V c1 = Vec::set1(S(1) - b1);
+	V a2 = Vec::set1(b2);
+	V c2 = Vec::set1(S(1) - b2);
+	V e  = Vec::set1(eps);
+
+	int i = 0;
+	for (; i + Vec::N <= size; i += Vec::N)
+	{
+		V gi = Vec::load(g + i);
+		V mi = Vec::fmadd(c1, gi, Vec::mul(a1, Vec::load(m + i)));
+		V vi = Vec::fmadd(c2, Vec::mul(gi, gi), Vec::mul(a2, Vec::load(v + i)));
+		V deltaW = Vec::div(Vec::mul(l, mi), Vec::add(Vec::sqrt(vi), e));
+		Vec::store(w + i, Vec::add(Vec::load(w + i), deltaW));
+		Vec::store(m + i, mi);
+		Vec::store(v + i, vi);
+	}
+
+	for (; i != size; ++i)
+	{
+		S mi = b1 * m[i] + (S(1) - b1) * g[i];
+		S vi = b2 * v[i] + (S(1) - b2) * g[i] * g[i];
+		w[i] += lr * mi / (std::sqrt(vi) + eps);
+		m[i] = mi;
+		v[i] = vi;
+	}
+}
+
+
+//====================================================================
+// x[i] = 1 / (1 + exp(-x[i])) = 0.5 + 0.5 * tanh(x[i] / 2)
+// tanh(u) is approximated by u * P(u^2) / Q(u^2) on [-9, 9] (outside
+// that range tanh(u) is 1 to float precision), the sigmoid error is
+// below 2e-8 when evaluated in double.
+//====================================================================
+template <class Vec, class S = typename Vec::S>
+void sigmoidT(S* x, int n)
+{
+	typedef typename Vec::V V;
+
+	const V half	= Vec::set1(S(0.5));
+	const V lo		= Vec::set1(S(-9.0));
+	const V hi		= Vec::set1(S(9.0));
+
+	// numerator (odd) and denominator (even) coefficients
+	const V p1		= Vec::set1(S( 4.89352455891786e-03));
+	const V p3		= Vec::set1(S( 6.37261928875436e-04));
+	const V p5		= Vec::set1(S( 1.48572235717979e-05));
+	const V p7		= Vec::set1(S( 5.12229709037114e-08));
+	const V p9		= Vec::set1(S(-8.60467152213735e-11));
+	const V p11		= Vec::set1(S( 2.00018790482477e-13));
+	const V p13		= Vec::set1(S(-2.76076847742355e-16));
+	const V q0		= Vec::set1(S( 4.89352518554385e-03));
+	const V q2		= Vec::set1(S( 2.26843463243900e-03));
+	const V q4		= Vec::set1(S( 1.18534705686654e-04));
+	const V q6		= Vec::set1(S( 1.19825839466702e-06));
+
+	S tail[Vec::N];
+
+	for (int i = 0; i < n; i += Vec::N)
+	{
+		// last partial vector is evaluated in a copy
+		S* p = x + i;
+		if ( i + Vec::N > n )
+		{
+			memset(tail, 0, sizeof(tail));
+			memcpy(tail, p, (n - i) * sizeof(S));
+			p = tail;
+		}
+
+		V u  = Vec::min(Vec::max(Vec::mul(Vec::load(p), half), lo), hi);
+		V u2 = Vec::mul(u, u);
+
+		V num = Vec::fmadd(u2, p13, p11);
+		num = Vec::fmadd(u2, num, p9);
+		num = Vec::fmadd(u2, num, p7);
+		num = Vec::fmadd(u2, num, p5);
+		num = Vec::fmadd(u2, num, p3);
+		num = Vec::fmadd(u2, num, p1);
+		num = Vec::mul(u, num);
+
+		V den = Vec::fmadd(u2, q6, q4);
+		den = Vec::fmadd(u2, den, q2);
+		den = Vec::fmadd(u2, den, q0);
+
+		Vec::store(p, Vec::fmadd(half, Vec::div(num, den), half));
+
+		if ( p == tail )
+			memcpy(x + i, tail, (n - i) * sizeof(S));
+	}
+}
+
+
+//====================================================================
+// Initializer of the kernel table of one level
+//
+// Tables are aggregates of function addresses, so they are constant
+// initialized and no code of the level runs before it is selected
+//====================================================================
+#define BPKERNELS_TABLE(Vec, level)	\
+	{								\
+		level,						\
+		matVecT<Vec>,				\
+		matTVecT<Vec>,				\
+		updateT<Vec>,				\
+		batchMatVecT<Vec>,			\
+		batchMatTVecT<Vec>,			\
+		gradientT<Vec>,				\
+		applyT<Vec>,				\
+		nesterovT<Vec>,				\
+		rmspropT<Vec>,				\
+		adamT<Vec>,					\
+		sigmoidT<Vec>				\
+	}
+
+} // namespace
+
+
+#endif // _BPKERNELSIMPL_H
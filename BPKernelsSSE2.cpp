@@ -0,0 +1,180 @@
+// BPKernelsSSE2.cpp: SSE2 kernels.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <cstring>
+#include "BPKernels.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+
+#include <immintrin.h>
+
+// compile everything below for SSE2
+// (standard headers are included above so they keep the default target)
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("sse2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("sse2")
+#endif
+
+namespace
+{
+
+//////////////////////////////////////////////////////////////////////
+// SSE2 vector traits (double)
+//////////////////////////////////////////////////////////////////////
+struct Vec
+{
+	typedef double S;
+	typedef __m128d V;
+	enum { N = 2 };
+
+	static inline V		zero()							{ return _mm_setzero_pd(); }
+	static inline V		set1(double x)					{ return _mm_set1_pd(x); }
+	static inline V		load(const double* p)			{ return _mm_loadu_pd(p); }
+	static inline void	store(double* p, V v)			{ _mm_storeu_pd(p, v); }
+	static inline V		add(V a, V b)					{ return _mm_add_pd(a, b); }
+	static inline V		mul(V a, V b)					{ return _mm_mul_pd(a, b); }
+	static inline V		div(V a, V b)					{ return _mm_div_pd(a, b); }
+	static inline V		min(V a, V b)					{ return _mm_min_pd(a, b); }
+	static inline V		max(V a, V b)					{ return _mm_max_pd(a, b); }
+	static inline V		sqrt(V a)						{ return _mm_sqrt_pd(a); }
+	static inline V		fmadd(V a, V b, V c)			{ return _mm_add_pd(_mm_mul_pd(a, b), c); }
+
+	static inline double hsum(V v)
+	{
+		return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v)));
+	}
+};
+
+//////////////////////////////////////////////////////////////////////
+// SSE2 vector traits (float)
+//////////////////////////////////////////////////////////////////////
+struct VecF
+{
+	typedef float S;
+	typedef __m128 V;
+	enum { N = 4 };
+
+	static inline V		zero()							{ return _mm_setzero_ps(); }
+	static inline V		set1(float x)					{ return _mm_set1_ps(x); }
+	static inline V		load(const float* p)			{ return _mm_loadu_ps(p); }
+	static inline void	store(float* p, V v)			{ _mm_storeu_ps(p, v); }
+	static inline V		add(V a, V b)					{ return _mm_add_ps(a, b); }
+	static inline V		mul(V a, V b)					{ return _mm_mul_ps(a, b); }
+	static inline V		div(V a, V b)					{ return _mm_div_ps(a, b); }
+	static inline V		min(V a, V b)					{ return _mm_min_ps(a, b); }
+	static inline V		max(V a, V b)					{ return _mm_max_ps(a, b); }
+	static inline V		sqrt(V a)						{ return _mm_sqrt_ps(a); }
+	static inline V		fmadd(V a, V b, V c)			{ return _mm_add_ps(_mm_mul_ps(a, b), c); }
+
+	static inline float hsum(V v)
+	{
+		__m128 s = _mm_add_ps(v, _mm_movehl_ps(v, v));
+		return _mm_cvtss_f32(_mm_add_ss(s, _mm_shuffle_ps(s, s, 1)));
+	}
+};
+
+} // namespace
+
+#include "BPKernelsImpl.h"
+
+
+//====================================================================
+// SSE2 kernel tables (constant initialized, see BPKernelsImpl.h)
+//====================================================================
+static const BPKernels::Table	table	= BPKERNELS_TABLE(Vec, BPKernels::LEVEL_SSE2);
+static const BPKernels::TableF	tableF	= BPKERNELS_TABLE(VecF, BPKernels::LEVEL_SSE2);
+
+
+//====================================================================
+// out[j] = sum_k( w[j][k] * in[k] )	(uint8 x int8, SSE2 has no
+// pmaddubsw: bytes are widened to 16 bits for pmaddwd)
+//====================================================================
+static void matVecI8(const int8_t* w, const uint8_t* in, int32_t* out, int rows, int cols)
+{
+	const __m128i zero = _mm_setzero_si128();
+
+	for (int j = 0; j != rows; ++j, w += cols)
+	{
+		__m128i acc = zero;
+		for (int k = 0; k != cols; k += 16)
+		{
+			__m128i a		= _mm_loadu_si128((const __m128i*)(in + k));
+			__m128i b		= _mm_loadu_si128((const __m128i*)(w + k));
+			__m128i sign	= _mm_cmpgt_epi8(zero, b);
+
+			acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, sign)));
+			acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, sign)));
+		}
+
+		acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, 0x4E));
+		acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, 0xB1));
+		out[j] = _mm_cvtsi128_si32(acc);
+	}
+}
+
+
+//====================================================================
+// SSE2 int8 kernel table
+//====================================================================
+static const BPKernels::TableI8 tableI8 = { BPKernels::LEVEL_SSE2, matVecI8 };
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+
+//====================================================================
+// Get SSE2 kernel tables
+// (compiled for the default target, they run on any CPU)
+//====================================================================
+const BPKernels::Table* bpKernelsSSE2()
+{
+	return &table;
+}
+
+
+const BPKernels::TableF* bpKernelsSSE2F()
+{
+	return &tableF;
+}
+
+
+//====================================================================
+// Get SSE2 int8 kernel table
+//====================================================================
+const BPKernels::TableI8* bpKernelsSSE2I8()
+{
+	return &tableI8;
+}
+
+#else
+
+// not available on this platform
+const BPKernels::Table* bpKernelsSSE2()
+{
+	return NULL;
+}
+
+const BPKernels::TableF* bpKernelsSSE2F()
+{
+	return NULL;
+}
+
+const BPKernels::TableI8* bpKernelsSSE2I8()
+{
+	return NULL;
+}
+
+#endif
@@ -0,0 +1,566 @@
+// BPLayer.cpp: implementation of the BPLayer class.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include "BPLayer.h"
+#include "BPKernels.h"
+
+// err[i] = f'(values[i]) * err[i] with the derivative of activation Act
+template <class Act, class T>
+static void scaleByDerivative(const T* values, T* err, size_t n)
+{
+	for (size_t i = 0; i != n; ++i)
+		err[i] = Act::derivative( values[i] ) * err[i];
+}
+
+
+//////////////////////////////////////////////////////////////////////
+// Construction/Destruction
+//////////////////////////////////////////////////////////////////////
+
+template <class T>
+BPLayerT<T>::~BPLayerT()
+{
+
+}
+
+
+template <class T>
+BPLayerT<T>::BPLayerT() :	_numNodes(0),
+							_numInputs(0),
+							_activation(BPActivation::SIGMOID),
+							_sigmoid(BPKernels::SIGMOID_EXACT),
+							_hasBias(false),
+							_optimizer(BPOptimizer::SGD)
+{
+
+}
+
+
+//====================================================================
+// Allocate layer storage
+//====================================================================
+template <class T>
+void BPLayerT<T>::create(int numNodes, int numInputs, bool allocateWeights)
+{
+	assert( numNodes >= 0 && numInputs >= 0 );
+
+	_numNodes	= numNodes;
+	_numInputs	= numInputs;
+
+	_values.resize( numNodes );
+	_errors.resize( numNodes );
+
+	_bias.release();
+	_biasDeltas.release();
+	_hasBias = false;
+
+	_moments.release();
+	_biasMoments.release();
+	_gradient.release();
+	_optimizer = BPOptimizer::SGD;
+
+	if ( !allocateWeights )
+	{
+		_weights.release();
+		_deltas.release();
+		return;
+	}
+
+	// weights start at zero, see initWeights
+	_weights.resize( (size_t)numNodes * numInputs );
+	_deltas.resize( (size_t)numNodes * numInputs );
+}
+
+
+//====================================================================
+// Create layer in caller supplied storage
+//====================================================================
+template <class T>
+void BPLayerT<T>::create(int numNodes, int numInputs, bool bias, BPOptimizer::Type optimizer,
+						 bool allocateWeights, T* storage)
+{
+	assert( numNodes >= 0 && numInputs >= 0 && storage != NULL );
+	assert( optimizer >= BPOptimizer::SGD && optimizer < BPOptimizer::NUM_TYPES );
+
+	size_t size = (size_t)numNodes * numInputs;
+
+	_numNodes	= numNodes;
+	_numInputs	= numInputs;
+	_optimizer	= optimizer;
+	_hasBias	= false;
+
+	take( _values, storage, numNodes );
+	take( _errors, storage, numNodes );
+
+	_weights.release();
+	_deltas.release();
+	_bias.release();
+	_biasDeltas.release();
+	_moments.release();
+	_biasMoments.release();
+	_gradient.release();
+
+	// weights are attached later
+	if ( !allocateWeights )
+		return;
+
+	// weights start at zero, see initWeights
+	take( _weights, storage, size );
+	take( _deltas, storage, size );
+
+	bool moments = BPOptimizer::hasMoments(optimizer);
+	if ( moments )
+		take( _moments, storage, size );
+
+	// biases are usually added after the network is created, their
+	// storage is reserved for every layer with inputs
+	if ( numInputs != 0 )
+	{
+		take( _bias, storage, numNodes );
+		take( _biasDeltas, storage, numNodes );
+
+		if ( moments )
+			take( _biasMoments, storage, numNodes );
+
+		_hasBias = bias;
+	}
+
+	if ( optimizer != BPOptimizer::SGD )
+		take( _gradient, storage, size );
+}
+
+
+//====================================================================
+// Number of values of layer storage
+//====================================================================
+template <class T>
+size_t BPLayerT<T>::storageSize(int numNodes, int numInputs, BPOptimizer::Type optimizer, bool allocateWeights)
+{
+	size_t	size	= (size_t)numNodes * numInputs;
+	size_t	total	= 2 * padded(numNodes);		// values, errors
+
+	if ( !allocateWeights )
+		return total;
+
+	// weights, deltas and gradient/moments of the optimizer
+	int matrices = 2;
+	int vectors	 = 2;	// bias, bias deltas
+
+	if ( BPOptimizer::hasMoments(optimizer) )
+	{
+		matrices++;
+		vectors++;
+	}
+
+	if ( optimizer != BPOptimizer::SGD )
+		matrices++;
+
+	if ( numInputs == 0 )
+		vectors = 0;
+
+	return total + matrices * padded(size) + vectors * padded(numNodes);
+}
+
+
+//====================================================================
+// Use external weight/delta matrices and bias vectors
+//====================================================================
+template <class T>
+void BPLayerT<T>::attach(T* weights, T* deltas, T* bias, T* biasDeltas,
+						 T* moments, T* biasMoments)
+{
+	assert( (bias == NULL) == (biasDeltas == NULL) );
+	assert( biasMoments == NULL || (bias != NULL && moments != NULL) );
+
+	size_t size = (size_t)_numNodes * _numInputs;
+
+	_weights.attach(weights, size);
+	_deltas.attach(deltas, size);
+
+	_hasBias = ( bias != NULL );
+	if ( _hasBias )
+	{
+		_bias.attach(bias, _numNodes);
+		_biasDeltas.attach(biasDeltas, _numNodes);
+	}
+	else
+	{
+		_bias.release();
+		_biasDeltas.release();
+	}
+
+	if ( moments != NULL )
+		_moments.attach(moments, size);
+	else
+		_moments.release();
+
+	if ( biasMoments != NULL )
+		_biasMoments.attach(biasMoments, _numNodes);
+	else
+		_biasMoments.release();
+
+	allocateState();
+}
+
+
+//====================================================================
+// Add or remove bias vectors
+//====================================================================
+template <class T>
+void BPLayerT<T>::enableBias(bool enable)
+{
+	if ( enable == _hasBias )
+		return;
+
+	_hasBias = enable;
+	if ( enable )
+	{
+		// biases start at zero, storage reserved by create is reused
+		if ( _bias.size() == (size_t)_numNodes && _biasDeltas.size() == (size_t)_numNodes )
+		{
+			_bias.zero();
+			_biasDeltas.zero();
+		}
+		else
+		{
+			_bias.resize( _numNodes );
+			_biasDeltas.resize( _numNodes );
+		}
+	}
+	else
+	{
+		_bias.release();
+		_biasDeltas.release();
+	}
+
+	allocateState();
+}
+
+
+//====================================================================
+// Select weight update rule
+//====================================================================
+template <class T>
+void BPLayerT<T>::setOptimizer(BPOptimizer::Type type)
+{
+	assert( type >= BPOptimizer::SGD && type < BPOptimizer::NUM_TYPES );
+
+	_optimizer = type;
+
+	allocateState();
+}
+
+
+//====================================================================
+// Zero optimizer state
+//====================================================================
+template <class T>
+void BPLayerT<T>::clearState()
+{
+	_deltas.zero();
+	_biasDeltas.zero();
+	_moments.zero();
+	_biasMoments.zero();
+}
+
+
+//====================================================================
+// Allocate or release optimizer state
+//====================================================================
+template <class T>
+void BPLayerT<T>::allocateState()
+{
+	size_t	size	= (size_t)_numNodes * _numInputs;
+	bool	moments	= BPOptimizer::hasMoments(_optimizer);
+
+	// state of layers created without weights is allocated
+	// (or attached) with the weights
+	if ( _weights.empty() && size != 0 )
+		return;
+
+	// second state of the weights (and biases)
+	if ( !moments )
+		_moments.release();
+	else if ( _moments.size() != size )
+		_moments.resize( size );
+
+	if ( !moments || !_hasBias )
+		_biasMoments.release();
+	else if ( _biasMoments.size() != (size_t)_numNodes )
+		_biasMoments.resize( _numNodes );
+
+	// learn() materializes the gradient for all rules but SGD
+	if ( _optimizer == BPOptimizer::SGD )
+		_gradient.release();
+	else if ( _gradient.size() != size )
+		_gradient.resize( size );
+}
+
+
+//====================================================================
+// Initialize weights
+//====================================================================
+template <class T>
+void BPLayerT<T>::initWeights(uint64_t seed, uint64_t stream, BPRandom::Init init, int first, int last)
+{
+	assert( first >= 0 && first <= last && last <= _numNodes && !_weights.empty() );
+
+	// weight [j][k] is number j * numInputs + k of the stream
+	double limit = BPRandom::limit( init, _numInputs, _numNodes );
+	size_t begin = (size_t)first * _numInputs;
+
+	BPRandom::fill( _weights.data() + begin, (size_t)(last - first) * _numInputs,
+					seed, stream, begin, -limit, limit );
+}
+
+
+//====================================================================
+// Run: forward-pass, input summation and activation
+//====================================================================
+template <class T>
+void BPLayerT<T>::run(const T* inValues, int first, int last)
+{
+	assert( inValues != NULL || _numInputs == 0 );
+	assert( first >= 0 && first <= last && last <= _numNodes );
+	assert( BPActivation::elementwise(_activation) || (first == 0 && last == _numNodes) );
+
+	// sum weighted values from input nodes (and bias)
+	BPKernels::matVec( _weights.data() + (size_t)first * _numInputs, biasFrom(first), inValues,
+					   _values.data() + first, last - first, _numInputs );
+
+	// pass sums through activation function
+	transferFunction( _values.data() + first, last - first );
+}
+
+
+//====================================================================
+// Transfer/activation function
+//====================================================================
+template <class T>
+void BPLayerT<T>::transferFunction(T* values, size_t n) const
+{
+	BPActivation::forward( _activation, values, n, _numNodes, _sigmoid );
+}
+
+
+//====================================================================
+// Derivative of transfer function, applied to errors
+//====================================================================
+template <class T>
+void BPLayerT<T>::derivativeFunction(const T* values, T* err, size_t n) const
+{
+	switch (_activation)
+	{
+	case BPActivation::TANH:	scaleByDerivative< BPActivation::TanhAct<T> >(values, err, n);		break;
+	case BPActivation::RELU:	scaleByDerivative< BPActivation::ReluAct<T> >(values, err, n);		break;
+	case BPActivation::LINEAR:	scaleByDerivative< BPActivation::LinearAct<T> >(values, err, n);	break;
+	case BPActivation::SOFTMAX:	scaleByDerivative< BPActivation::SoftmaxAct<T> >(values, err, n);	break;
+	default:					scaleByDerivative< BPActivation::SigmoidAct<T> >(values, err, n);	break;
+	}
+}
+
+
+//====================================================================
+// Compute output layer error
+//====================================================================
+template <class T>
+void BPLayerT<T>::computeOutputError()
+{
+	// The desired output for each node is now stored in _errors
+	// This occurs when the BPNet::setError() method is called
+	// during training
+
+	// We scale (desired - value) by the derivative of the transfer function:
+	//	error = f'(value) * ( desired - value )
+	for (int j = 0; j != _numNodes; ++j)
+		_errors[j] = _errors[j] - _values[j];
+
+	derivativeFunction( _values.data(), _errors.data(), _numNodes );
+}
+
+
+//====================================================================
+// Compute middle layer error
+//====================================================================
+template <class T>
+void BPLayerT<T>::computeError(const BPLayerT<T>& next, int first, int last)
+{
+	assert( next.numInputs() == _numNodes );
+	assert( first >= 0 && first <= last && last <= _numNodes );
+
+	// sum weighted error from each link of the next layer
+	// (columns [first, last) of the next layer's weight matrix)
+	BPKernels::matTVec( next.weights() + first, next.errors(), _errors.data() + first,
+						next.numNodes(), last - first, _numNodes );
+
+	// scale error by derivative of transfer function
+	derivativeFunction( _values.data() + first, _errors.data() + first, last - first );
+}
+
+
+//====================================================================
+// Learn: adjust weights of incoming links
+//====================================================================
+template <class T>
+void BPLayerT<T>::learn(const T* inValues, const BPOptimizer::Step& step, int first, int last)
+{
+	assert( inValues != NULL || _numInputs == 0 );
+	assert( first >= 0 && first <= last && last <= _numNodes );
+	assert( step.type == BPOptimizer::SGD || step.type == _optimizer );
+
+	size_t offset = (size_t)first * _numInputs;
+
+	if ( step.type != BPOptimizer::SGD )
+	{
+		// gradient of each weight is ( Error * InputValue ), the bias
+		// acts as the weight of an input that is always 1
+		T* g = _gradient.data() + offset;
+		memset( g, 0, (size_t)(last - first) * _numInputs * sizeof(T) );
+		BPKernels::gradient( g, inValues, _errors.data() + first, last - first, _numInputs, 1 );
+
+		applyGradient( _gradient.data(), _errors.data(), step, first, last );
+		return;
+	}
+
+	// weight change is ( learningRate * Error * InputValue ) plus
+	// a fraction (momentum) of the previous change
+	BPKernels::update( _weights.data() + offset, _deltas.data() + offset, inValues,
+					   _errors.data() + first, step.lr, step.mt, last - first, _numInputs );
+
+	// bias change is ( learningRate * Error ) plus momentum, the bias
+	// acts as the weight of an input that is always 1
+	if ( _hasBias )
+	{
+		BPKernels::apply( _bias.data() + first, _biasDeltas.data() + first,
+						  _errors.data() + first, step.lr, step.mt, last - first );
+	}
+}
+
+
+//====================================================================
+// Run batch: forward-pass of samples [first, last)
+//====================================================================
+template <class T>
+void BPLayerT<T>::runBatch(const T* in, T* out, int first, int last) const
+{
+	assert( in != NULL || _numInputs == 0 );
+	assert( first >= 0 && first <= last );
+
+	// sum weighted values from input nodes (and bias), for all samples
+	BPKernels::batchMatVec( _weights.data(), biasFrom(0), in + (size_t)first * _numInputs,
+							out + (size_t)first * _numNodes,
+							_numNodes, _numInputs, last - first );
+
+	// pass sums through activation function
+	transferFunction( out + (size_t)first * _numNodes, (size_t)(last - first) * _numNodes );
+}
+
+
+//====================================================================
+// Compute output layer error of n samples
+//====================================================================
+template <class T>
+double BPLayerT<T>::computeOutputErrorBatch(const T* values, T* err, int n) const
+{
+	double sumSquared = 0;
+
+	size_t size = (size_t)n * _numNodes;
+	for (size_t i = 0; i != size; ++i)
+	{
+		T diff = err[i] - values[i];
+		sumSquared += diff * diff;
+
+		err[i] = diff;
+	}
+
+	derivativeFunction( values, err, size );
+
+	return sumSquared;
+}
+
+
+//====================================================================
+// Compute middle layer error of samples [first, last)
+//====================================================================
+template <class T>
+void BPLayerT<T>::computeErrorBatch(const BPLayerT<T>& next, const T* nextErr,
+									 const T* values, T* err, int first, int last) const
+{
+	assert( next.numInputs() == _numNodes );
+	assert( first >= 0 && first <= last );
+
+	// sum weighted error from each link of the next layer
+	BPKernels::batchMatTVec( next.weights(), nextErr + (size_t)first * next.numNodes(),
+							 err + (size_t)first * _numNodes,
+							 next.numNodes(), _numNodes, last - first );
+
+	// scale error by derivative of transfer function
+	size_t offset = (size_t)first * _numNodes;
+	derivativeFunction( values + offset, err + offset, (size_t)(last - first) * _numNodes );
+}
+
+
+//====================================================================
+// Add weight and bias gradients of n samples to rows [first, last)
+//====================================================================
+template <class T>
+void BPLayerT<T>::accumulateGradient(const T* in, const T* err, int n,
+									  T* g, T* gb, int first, int last) const
+{
+	assert( in != NULL || _numInputs == 0 );
+	assert( first >= 0 && first <= last && last <= _numNodes );
+	assert( gb != NULL || !_hasBias );
+
+	BPKernels::gradient( g + (size_t)first * _numInputs, in, err + first,
+						 last - first, _numInputs, n, _numNodes );
+
+	// bias gradient is the sum of the node errors
+	if ( _hasBias )
+	{
+		for (int s = 0; s != n; ++s, err += _numNodes)
+			for (int j = first; j != last; ++j)
+				gb[j] += err[j];
+	}
+}
+
+
+//====================================================================
+// Adjust weights and bias of nodes [first, last) with summed gradients
+//====================================================================
+template <class T>
+void BPLayerT<T>::applyGradient(const T* g, const T* gb, const BPOptimizer::Step& step, int first, int last)
+{
+	assert( first >= 0 && first <= last && last <= _numNodes );
+	assert( gb != NULL || !_hasBias );
+	assert( step.type == BPOptimizer::SGD || step.type == _optimizer );
+
+	size_t	offset		= (size_t)first * _numInputs;
+	T*		moments		= _moments.empty() ? NULL : _moments.data() + offset;
+
+	BPOptimizer::apply( step, _weights.data() + offset, _deltas.data() + offset, moments,
+						g + offset, (last - first) * _numInputs );
+
+	if ( _hasBias )
+	{
+		T* biasMoments = _biasMoments.empty() ? NULL : _biasMoments.data() + first;
+
+		BPOptimizer::apply( step, _bias.data() + first, _biasDeltas.data() + first, biasMoments,
+							gb + first, last - first );
+	}
+}
+
+
+// explicit instantiation
+template class BPLayerT<double>;
+template class BPLayerT<float>;
\ No newline at end of file
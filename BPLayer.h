@@ -0,0 +1,257 @@
+// BPLayer.h: interface for the BPLayer class.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+
+#ifndef _BPLAYER_H
+#define _BPLAYER_H
+
+#include <cmath>
+#include "BPBuffer.h"
+#include "BPKernels.h"
+#include "BPActivation.h"
+#include "BPOptimizer.h"
+#include "BPRandom.h"
+
+
+//////////////////////////////////////////////////////////////////////
+// BPLayerT - dense storage for one network layer, T is the scalar
+// type of weights and values (double or float).
+//
+// The weights of all links entering the layer are stored as a
+// row-major matrix: row j holds the weights from every node of the
+// previous layer to node j of this layer. The input layer has no
+// incoming links and only uses the value/error vectors.
+//
+// The transfer function of the layer is one of the BPActivation
+// policies (sigmoid by default).
+//
+// A layer may have a bias for each node (see enableBias), added to the
+// node's weighted sum by the forward kernels and trained with momentum
+// like the weights.
+//
+// Weights are adjusted by one of the BPOptimizer rules. The delta
+// matrix holds the first state of the rule, RMSPROP and ADAM also
+// allocate a moments matrix (and bias moments) for the second state.
+//////////////////////////////////////////////////////////////////////
+template <class T>
+class BPLayerT
+{
+// Methods
+public:
+	virtual ~BPLayerT();	// destructor
+	BPLayerT();				// default c-tor
+
+	// allocate layer storage (numInputs is 0 for the input layer).
+	// if allocateWeights is false weights must be attached before use
+	void	create(int numNodes, int numInputs, bool allocateWeights = true);
+
+	// create layer in caller supplied storage of storageSize() values
+	// (zeroed, aligned to BPBUFFER_ALIGNMENT) that must outlive the layer.
+	// the storage holds the state of the optimizer and room for biases,
+	// so enableBias() doesn't allocate. without weights only the node
+	// values and errors are placed in the storage
+	void	create(int numNodes, int numInputs, bool bias, BPOptimizer::Type optimizer,
+				   bool allocateWeights, T* storage);
+
+	// number of values create() with storage places in the storage
+	static size_t	storageSize(int numNodes, int numInputs, BPOptimizer::Type optimizer,
+								bool allocateWeights);
+
+	// use external weight/delta matrices (e.g. a mapped model file),
+	// and bias/bias delta vectors if the layer has a bias. moments are
+	// attached if given, otherwise allocated (zero) if the optimizer needs them
+	void	attach(T* weights, T* deltas, T* bias = NULL, T* biasDeltas = NULL,
+				   T* moments = NULL, T* biasMoments = NULL);
+
+	// add (zero) bias vectors to the layer, or remove them
+	void	enableBias(bool enable);
+	bool	hasBias() const		{ return _hasBias; }
+
+	// set/get update rule, allocates or releases the optimizer state
+	// (the state is kept if the rule is not changed)
+	void				setOptimizer(BPOptimizer::Type type);
+	BPOptimizer::Type	getOptimizer() const	{ return _optimizer; }
+
+	// zero optimizer state (deltas and moments)
+	void				clearState();
+
+	// init weights of nodes [first, last) from stream of a seed (see
+	// BPRandom), the values don't depend on how the rows are split
+	void	initWeights(uint64_t seed, uint64_t stream, BPRandom::Init init, int first, int last);
+
+	// get layer dimensions
+	int		numNodes()	const	{ return _numNodes;  }
+	int		numInputs()	const	{ return _numInputs; }
+
+	// get number of incoming link weights
+	size_t	weightCount() const	{ return _weights.size(); }
+
+	// set/get transfer function
+	// (SOFTMAX layers can't run a node range, run() needs all nodes)
+	void				setActivation(BPActivation::Type type)	{ _activation = type; }
+	BPActivation::Type	getActivation() const					{ return _activation; }
+
+	// set/get sigmoid evaluation mode (see BPKernels)
+	void				setSigmoid(BPKernels::Sigmoid mode)	{ _sigmoid = mode; }
+	BPKernels::Sigmoid	getSigmoid() const					{ return _sigmoid; }
+
+	// weight/delta of the link from input node 'in' to node 'node'
+	T		getWeight(int node, int in) const			{ return _weights[node * _numInputs + in]; }
+	void	setWeight(int node, int in, T w)			{ _weights[node * _numInputs + in] = w;		}
+	T		getDelta(int node, int in) const			{ return _deltas[node * _numInputs + in];  }
+	void	setDelta(int node, int in, T d)				{ _deltas[node * _numInputs + in] = d;		}
+
+	// bias/bias delta of a node (layer must have a bias)
+	T		getBias(int node) const					{ return _bias[node];		}
+	void	setBias(int node, T b)					{ _bias[node] = b;			}
+	T		getBiasDelta(int node) const			{ return _biasDeltas[node];	}
+	void	setBiasDelta(int node, T d)				{ _biasDeltas[node] = d;	}
+
+	// node value/error
+	T		getValue(int node) const				{ return _values[node];	}
+	void	setValue(int node, T val)				{ _values[node] = val;	}
+	T		getError(int node) const				{ return _errors[node];	}
+	void	setError(int node, T err)				{ _errors[node] = err;	}
+
+	// raw storage
+	T*				weights()			{ return _weights.data(); }
+	const T*		weights()	const	{ return _weights.data(); }
+	T*				deltas()			{ return _deltas.data();  }
+	const T*		deltas()	const	{ return _deltas.data();  }
+	T*				bias()				{ return _bias.data();	  }
+	const T*		bias()		const	{ return _bias.data();	  }
+	T*				biasDeltas()		{ return _biasDeltas.data(); }
+	const T*		biasDeltas() const	{ return _biasDeltas.data(); }
+	T*				moments()			{ return _moments.data(); }
+	const T*		moments()	const	{ return _moments.data(); }
+	T*				biasMoments()		{ return _biasMoments.data(); }
+	const T*		biasMoments() const	{ return _biasMoments.data(); }
+	T*				values()			{ return _values.data();  }
+	const T*		values()	const	{ return _values.data();  }
+	T*				errors()			{ return _errors.data();  }
+	const T*		errors()	const	{ return _errors.data();  }
+
+	// forward-pass, compute node values from previous layer values
+	void	run(const T* inValues)			{ run(inValues, 0, _numNodes); }
+
+	// forward-pass of nodes [first, last)
+	void	run(const T* inValues, int first, int last);
+
+	// compute error of output layer
+	// (desired output must be stored in the error vector)
+	void	computeOutputError();
+
+	// compute error of middle layer from the following layer
+	void	computeError(const BPLayerT& next)	{ computeError(next, 0, _numNodes); }
+
+	// compute error of nodes [first, last)
+	void	computeError(const BPLayerT& next, int first, int last);
+
+	// adjust weights of incoming links (SGD)
+	void	learn(const T* inValues, double lr, double mt)		{ learn(inValues, lr, mt, 0, _numNodes); }
+
+	// adjust weights of incoming links of nodes [first, last) (SGD)
+	void	learn(const T* inValues, double lr, double mt, int first, int last)
+	{
+		learn(inValues, BPOptimizer::sgd(lr, mt), first, last);
+	}
+
+	// adjust weights of incoming links of nodes [first, last) with an
+	// optimizer step (the layer must have the state of step.type)
+	void	learn(const T* inValues, const BPOptimizer::Step& step, int first, int last);
+
+	// batch passes work on caller supplied storage (see BPWorkspace) with
+	// one row of numNodes (or numInputs) values per sample, so several
+	// threads may run them on the same layer at once.
+
+	// batch forward-pass of samples [first, last): out = f(W * in + bias)
+	void	runBatch(const T* in, T* out, int first, int last) const;
+
+	// compute batch error of output layer for n samples
+	// (err holds the desired outputs on entry)
+	// returns sum of squared differences between desired and actual outputs
+	double	computeOutputErrorBatch(const T* values, T* err, int n) const;
+
+	// compute batch error of middle layer for samples [first, last)
+	// from the errors of the following layer
+	void	computeErrorBatch(const BPLayerT& next, const T* nextErr,
+							  const T* values, T* err, int first, int last) const;
+
+	// add weight gradients of n samples to rows [first, last) of g
+	// and bias gradients to gb[first, last) (gb is not used without a bias)
+	void	accumulateGradient(const T* in, const T* err, int n,
+							   T* g, T* gb, int first, int last) const;
+
+	// adjust weights and bias of nodes [first, last) with summed gradients g, gb
+	void	applyGradient(const T* g, const T* gb, double lr, double mt, int first, int last)
+	{
+		applyGradient(g, gb, BPOptimizer::sgd(lr, mt), first, last);
+	}
+
+	void	applyGradient(const T* g, const T* gb, const BPOptimizer::Step& step, int first, int last);
+
+protected:
+
+	// apply transfer function to n values in place (rows of numNodes values)
+	void	transferFunction(T* values, size_t n) const;
+
+	// multiply n errors by the derivative of the transfer function at values
+	void	derivativeFunction(const T* values, T* err, size_t n) const;
+
+	// get bias of nodes starting at 'first' (NULL without a bias)
+	const T*	biasFrom(int first) const	{ return _hasBias ? _bias.data() + first : NULL; }
+
+	// number of values of a block padded to BPBUFFER_ALIGNMENT
+	static size_t	padded(size_t size)
+	{
+		const size_t n = BPBUFFER_ALIGNMENT / sizeof(T);
+		return (size + n - 1) / n * n;
+	}
+
+	// attach next block of caller storage to a buffer
+	static void		take(BPBuffer<T>& buffer, T*& storage, size_t size)
+	{
+		buffer.attach(storage, size);
+		storage += padded(size);
+	}
+
+	// allocate (zero) or release optimizer state to match
+	// the optimizer and bias, attached state of the right size is kept
+	void	allocateState();
+
+
+// Members
+protected:
+
+	int		_numNodes;	// number of nodes in layer
+	int		_numInputs;	// number of nodes in previous layer
+
+	BPActivation::Type	_activation;	// transfer function
+	BPKernels::Sigmoid	_sigmoid;		// sigmoid evaluation mode
+	bool				_hasBias;		// layer has bias vectors
+	BPOptimizer::Type	_optimizer;		// weight update rule
+
+	BPBuffer<T>			_weights;	// incoming link weights [numNodes x numInputs]
+	BPBuffer<T>			_deltas;	// delta from previous weight change [numNodes x numInputs]
+	BPBuffer<T>			_bias;		// node biases [numNodes]
+	BPBuffer<T>			_biasDeltas;	// delta from previous bias change [numNodes]
+	BPBuffer<T>			_moments;		// second optimizer state [numNodes x numInputs]
+	BPBuffer<T>			_biasMoments;	// second optimizer state of biases [numNodes]
+	BPBuffer<T>			_gradient;		// learn() gradient of non-SGD optimizers [numNodes x numInputs]
+	BPBuffer<T>			_values;	// current node values [numNodes]
+	BPBuffer<T>			_errors;	// last node errors [numNodes]
+};
+
+// double and float layers
+typedef BPLayerT<double>	BPLayer;
+typedef BPLayerT<float>		BPLayerF;
+
+
+#endif // _BPLAYER_H
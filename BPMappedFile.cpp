@@ -0,0 +1,127 @@
+// BPMappedFile.cpp: implementation of the BPMappedFile class.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <cassert>
+#include "BPMappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+
+//////////////////////////////////////////////////////////////////////
+// Construction/Destruction
+//////////////////////////////////////////////////////////////////////
+
+BPMappedFile::~BPMappedFile()
+{
+	close();
+}
+
+
+BPMappedFile::BPMappedFile() :	_pData(NULL),
+								_size(0)
+#ifdef _WIN32
+								, _hFile(NULL),
+								_hMapping(NULL)
+#endif
+{
+
+}
+
+
+//====================================================================
+// Map whole file
+//====================================================================
+bool BPMappedFile::open(const char* fileName)
+{
+	assert( fileName != NULL );
+
+	close();
+
+#ifdef _WIN32
+	HANDLE hFile = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, NULL,
+							   OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if ( hFile == INVALID_HANDLE_VALUE )
+		return false;
+
+	LARGE_INTEGER fileSize;
+	HANDLE hMapping = NULL;
+	if ( GetFileSizeEx(hFile, &fileSize) && fileSize.QuadPart > 0 )
+		hMapping = CreateFileMappingA(hFile, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+
+	if ( hMapping == NULL )
+	{
+		CloseHandle(hFile);
+		return false;
+	}
+
+	_pData		= (char*)MapViewOfFile(hMapping, FILE_MAP_COPY, 0, 0, 0);
+	_size		= (size_t)fileSize.QuadPart;
+	_hFile		= hFile;
+	_hMapping	= hMapping;
+
+	if ( _pData == NULL )
+	{
+		close();
+		return false;
+	}
+#else
+	int fd = ::open(fileName, O_RDONLY);
+	if ( fd < 0 )
+		return false;
+
+	struct stat st;
+	void* p = MAP_FAILED;
+	if ( fstat(fd, &st) == 0 && st.st_size > 0 )
+		p = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+
+	::close(fd);	// mapping stays valid
+
+	if ( p == MAP_FAILED )
+		return false;
+
+	_pData	= (char*)p;
+	_size	= st.st_size;
+#endif
+
+	return true;
+}
+
+
+//====================================================================
+// Unmap file
+//====================================================================
+void BPMappedFile::close()
+{
+#ifdef _WIN32
+	if ( _pData != NULL )
+		UnmapViewOfFile(_pData);
+	if ( _hMapping != NULL )
+		CloseHandle((HANDLE)_hMapping);
+	if ( _hFile != NULL )
+		CloseHandle((HANDLE)_hFile);
+
+	_hFile		= NULL;
+	_hMapping	= NULL;
+#else
+	if ( _pData != NULL )
+		munmap(_pData, _size);
+#endif
+
+	_pData	= NULL;
+	_size	= 0;
+}
@@ -0,0 +1,62 @@
+// BPMappedFile.h: interface for the BPMappedFile class.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+
+#ifndef _BPMAPPEDFILE_H
+#define _BPMAPPEDFILE_H
+
+#include <cstddef>
+
+
+//////////////////////////////////////////////////////////////////////
+// BPMappedFile - whole file mapped into memory (copy-on-write).
+//
+// Pages are loaded on first access and shared with the page cache.
+// Writing to the mapping is allowed, modified pages become private
+// copies and are never written back to the file.
+//////////////////////////////////////////////////////////////////////
+class BPMappedFile
+{
+// Methods
+public:
+	virtual ~BPMappedFile();	// destructor (unmaps file)
+	BPMappedFile();				// default c-tor
+
+	// map file, fails if it can't be opened or is empty
+	bool	open(const char* fileName);
+
+	// unmap file
+	void	close();
+
+	// is a file mapped
+	bool	isOpen() const	{ return _pData != NULL; }
+
+	// get mapped memory
+	char*	data() const	{ return _pData; }
+	size_t	size() const	{ return _size; }
+
+private:
+	BPMappedFile(const BPMappedFile&);				// not copyable
+	BPMappedFile& operator=(const BPMappedFile&);
+
+// Members
+protected:
+
+	char*		_pData;		// mapped file
+	size_t		_size;		// size of mapping
+
+#ifdef _WIN32
+	void*		_hFile;		// file handle
+	void*		_hMapping;	// file mapping handle
+#endif
+};
+
+
+#endif // _BPMAPPEDFILE_H
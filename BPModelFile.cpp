@@ -0,0 +1,439 @@
+// BPModelFile.cpp: implementation of the BPModelFile class.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <climits>
+#include <fstream>
+#include "BPModelFile.h"
+#include "BPNet.h"
+
+static const char		MAGIC[8]	= { 'B', 'P', 'N', 'E', 'T', 'B', 'I', 'N' };
+static const uint64_t	FNV_OFFSET	= 14695981039346656037ULL;
+static const uint64_t	FNV_PRIME	= 1099511628211ULL;
+
+// round size up to data block alignment
+static size_t aligned(size_t size)
+{
+	return (size + BPMODEL_ALIGNMENT - 1) & ~(size_t)(BPMODEL_ALIGNMENT - 1);
+}
+
+
+//////////////////////////////////////////////////////////////////////
+// Construction/Destruction
+//////////////////////////////////////////////////////////////////////
+
+BPModelFile::~BPModelFile()
+{
+	close();
+}
+
+
+BPModelFile::BPModelFile() :	_scalarSize(0),
+								_bias(false),
+								_moments(false),
+								_seed(0),
+								_weightInit(BPRandom::UNIFORM),
+								_seeded(false)
+{
+
+}
+
+
+//====================================================================
+// Compute block layout, returns total file size
+//====================================================================
+size_t BPModelFile::layout(const vector<int>& nodeCnt, size_t scalarSize, size_t tableEnd, bool bias,
+						   bool moments, vector<size_t>& offsets, size_t& dataOffset)
+{
+	int numLayers = nodeCnt.size();
+
+	dataOffset = aligned( tableEnd );
+
+	offsets.assign(numLayers, 0);
+
+	size_t offset = dataOffset;
+	for (int i = 1; i < numLayers; ++i)
+	{
+		size_t blockSize	= aligned( (size_t)nodeCnt[i] * nodeCnt[i-1] * scalarSize );
+		size_t biasSize		= bias ? aligned( (size_t)nodeCnt[i] * scalarSize ) : 0;
+
+		offsets[i] = offset;
+		offset += 2 * ( blockSize + biasSize );	// weights, deltas, bias and bias deltas
+
+		if ( moments )
+			offset += blockSize + biasSize;
+	}
+
+	return offset;
+}
+
+
+//====================================================================
+// Update checksum byte by byte
+//====================================================================
+uint64_t BPModelFile::hashBytes(uint64_t hash, const void* data, size_t size)
+{
+	const unsigned char* p = (const unsigned char*)data;
+	for (size_t i = 0; i != size; ++i)
+		hash = (hash ^ p[i]) * FNV_PRIME;
+
+	return hash;
+}
+
+
+//====================================================================
+// Update checksum one 8-byte word at a time
+//====================================================================
+uint64_t BPModelFile::hashWords(uint64_t hash, const void* data, size_t size)
+{
+	assert( size % sizeof(uint64_t) == 0 );
+
+	const char* p = (const char*)data;
+	for (size_t i = 0; i != size; i += sizeof(uint64_t))
+	{
+		uint64_t word;
+		memcpy(&word, p + i, sizeof(word));
+		hash = (hash ^ word) * FNV_PRIME;
+	}
+
+	return hash;
+}
+
+
+//====================================================================
+// Update checksum with a data block and its zero padding
+//====================================================================
+uint64_t BPModelFile::hashBlock(uint64_t hash, const void* data, size_t size)
+{
+	static const char zeros[BPMODEL_ALIGNMENT] = { 0 };
+
+	size_t whole = size & ~(size_t)(sizeof(uint64_t) - 1);
+	hash = hashWords( hash, data, whole );
+
+	// last partial word (odd number of floats) continues into the padding
+	size_t hashed = whole;
+	if ( whole != size )
+	{
+		uint64_t word = 0;
+		memcpy( &word, (const char*)data + whole, size - whole );
+		hash = hashWords( hash, &word, sizeof(word) );
+		hashed += sizeof(word);
+	}
+
+	return hashWords( hash, zeros, aligned(size) - hashed );
+}
+
+
+//====================================================================
+// Write network to binary model file
+//====================================================================
+template <class T>
+bool BPModelFile::write(const BPNetT<T>& net, const char* fileName)
+{
+	assert( fileName != NULL );
+
+	const vector<int>& nodeCnt = net.getNodeCount();
+
+	int				numLayers	= nodeCnt.size();
+	size_t			tableBytes	= 2 * numLayers * sizeof(uint32_t);
+	vector<size_t>	offsets;
+	size_t			dataOffset;
+	bool			bias		= net.hasBias();
+	bool			moments		= BPOptimizer::hasMoments( net.getOptimizer().getType() );
+	size_t			fileSize	= layout(nodeCnt, sizeof(T), sizeof(BPModelHeader) + tableBytes, bias, moments,
+										 offsets, dataOffset);
+
+	// node counts followed by activations
+	vector<uint32_t> table(2 * numLayers);
+	for (int i = 0; i != numLayers; ++i)
+	{
+		table[i]				= (uint32_t)nodeCnt[i];
+		table[numLayers + i]	= (uint32_t)net.getActivation(i);
+	}
+
+	// header (the checksum is zero while it is hashed)
+	BPModelHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version		= BPMODEL_VERSION;
+	header.numLayers	= numLayers;
+	header.learningRate	= net.getLearningRate();
+	header.momentum		= net.getMomentum();
+	header.dataOffset	= dataOffset;
+	header.dataSize		= fileSize - dataOffset;
+	header.scalarSize	= sizeof(T);
+	header.flags		= ( bias ? BPMODEL_BIAS : 0 ) | ( moments ? BPMODEL_MOMENTS : 0 ) |
+						  ( net.hasSeed() ? BPMODEL_SEED : 0 );
+
+	const BPOptimizer& optimizer = net.getOptimizer();
+	header.optimizer	= (uint32_t)optimizer.getType();
+	header.beta1		= optimizer.getBeta1();
+	header.beta2		= optimizer.getBeta2();
+	header.epsilon		= optimizer.getEpsilon();
+	header.steps		= optimizer.getSteps();
+	header.seed			= net.getSeed();
+	header.weightInit	= (uint32_t)net.getWeightInit();
+
+	// checksum of header, tables and data blocks (including zero padding)
+	static const char zeros[BPMODEL_ALIGNMENT] = { 0 };
+
+	uint64_t hash = hashBytes( FNV_OFFSET, &header, sizeof(header) );
+	hash = hashBytes( hash, table.empty() ? NULL : &table[0], tableBytes );
+	for (int i = 1; i < numLayers; ++i)
+	{
+		const BPLayerT<T>&	layer	= net.getLayer(i);
+		size_t				bytes	= layer.weightCount() * sizeof(T);
+
+		hash = hashBlock( hash, layer.weights(), bytes );
+		hash = hashBlock( hash, layer.deltas(), bytes );
+
+		if ( bias )
+		{
+			hash = hashBlock( hash, layer.bias(), layer.numNodes() * sizeof(T) );
+			hash = hashBlock( hash, layer.biasDeltas(), layer.numNodes() * sizeof(T) );
+		}
+
+		if ( moments )
+		{
+			hash = hashBlock( hash, layer.moments(), bytes );
+			if ( bias )
+				hash = hashBlock( hash, layer.biasMoments(), layer.numNodes() * sizeof(T) );
+		}
+	}
+
+	header.checksum = hash;
+
+	ofstream ost(fileName, ios::out | ios::binary | ios::trunc);
+	if ( !ost.good() )
+		return false;
+
+	ost.write( (const char*)&header, sizeof(header) );
+	if ( numLayers != 0 )
+		ost.write( (const char*)&table[0], tableBytes );
+	ost.write( zeros, dataOffset - sizeof(header) - tableBytes );
+
+	// data blocks
+	for (int i = 1; i < numLayers; ++i)
+	{
+		const BPLayerT<T>&	layer	= net.getLayer(i);
+		size_t				bytes	= layer.weightCount() * sizeof(T);
+		size_t				padding	= aligned(bytes) - bytes;
+
+		ost.write( (const char*)layer.weights(), bytes );
+		ost.write( zeros, padding );
+		ost.write( (const char*)layer.deltas(), bytes );
+		ost.write( zeros, padding );
+
+		if ( bias )
+		{
+			size_t biasBytes	= layer.numNodes() * sizeof(T);
+			size_t biasPadding	= aligned(biasBytes) - biasBytes;
+
+			ost.write( (const char*)layer.bias(), biasBytes );
+			ost.write( zeros, biasPadding );
+			ost.write( (const char*)layer.biasDeltas(), biasBytes );
+			ost.write( zeros, biasPadding );
+		}
+
+		if ( moments )
+		{
+			ost.write( (const char*)layer.moments(), bytes );
+			ost.write( zeros, padding );
+
+			if ( bias )
+			{
+				size_t biasBytes	= layer.numNodes() * sizeof(T);
+				size_t biasPadding	= aligned(biasBytes) - biasBytes;
+
+				ost.write( (const char*)layer.biasMoments(), biasBytes );
+				ost.write( zeros, biasPadding );
+			}
+		}
+	}
+
+	return ost.good();
+}
+
+
+//====================================================================
+// Map model file
+//====================================================================
+bool BPModelFile::open(const char* fileName, bool verify)
+{
+	assert( fileName != NULL );
+
+	close();
+
+	if ( !_file.open(fileName) || _file.size() < sizeof(BPModelHeader) )
+	{
+		close();
+		return false;
+	}
+
+	// validate header (version 1 headers end before scalarSize and hold doubles,
+	// activation tables were added in version 3, flags in version 4,
+	// the optimizer in version 5 and the seed in version 6)
+	const BPModelHeader& hdr = header();
+
+	bool	v1			= ( hdr.version == 1 );
+	size_t	headerSize	= v1 ? offsetof(BPModelHeader, scalarSize) :
+						  ( hdr.version < 5 ) ? offsetof(BPModelHeader, optimizer) :
+						  ( hdr.version < 6 ) ? offsetof(BPModelHeader, seed) : sizeof(BPModelHeader);
+	size_t	numTables	= ( hdr.version >= 3 ) ? 2 : 1;
+	size_t	tableBytes	= numTables * hdr.numLayers * sizeof(uint32_t);
+	_scalarSize			= v1 ? (uint32_t)sizeof(double) : hdr.scalarSize;
+	uint32_t flags		= ( hdr.version >= 4 ) ? hdr.flags : 0;
+	_bias				= ( flags & BPMODEL_BIAS ) != 0;
+	_moments			= ( flags & BPMODEL_MOMENTS ) != 0;
+	uint32_t optimizer	= ( hdr.version >= 5 ) ? hdr.optimizer : (uint32_t)BPOptimizer::SGD;
+	uint32_t weightInit	= ( hdr.version >= 6 ) ? hdr.weightInit : (uint32_t)BPRandom::UNIFORM;
+	_seed				= ( hdr.version >= 6 ) ? hdr.seed : 0;
+	_weightInit			= (BPRandom::Init)weightInit;
+	_seeded				= ( flags & BPMODEL_SEED ) != 0;
+
+	if ( memcmp(hdr.magic, MAGIC, sizeof(MAGIC)) != 0 || hdr.version < 1 || hdr.version > BPMODEL_VERSION ||
+		 (_scalarSize != sizeof(double) && _scalarSize != sizeof(float)) ||
+		 (flags & ~(BPMODEL_BIAS | BPMODEL_MOMENTS | BPMODEL_SEED)) != 0 ||
+		 optimizer >= BPOptimizer::NUM_TYPES || weightInit >= BPRandom::NUM_INITS ||
+		 headerSize + tableBytes > _file.size() )
+	{
+		close();
+		return false;
+	}
+
+	_optimizer.setType( (BPOptimizer::Type)optimizer );
+	if ( hdr.version >= 5 )
+	{
+		_optimizer.setBeta1( hdr.beta1 );
+		_optimizer.setBeta2( hdr.beta2 );
+		_optimizer.setEpsilon( hdr.epsilon );
+		_optimizer.setSteps( (unsigned long)hdr.steps );
+	}
+
+	// node counts must fit an int, and each weight matrix the file
+	// (so layout() can't overflow)
+	const uint32_t* table = (const uint32_t*)(_file.data() + headerSize);
+	for (uint32_t i = 0; i != hdr.numLayers; ++i)
+	{
+		uint64_t numInputs = ( i > 0 ) ? table[i-1] : 0;
+		if ( table[i] == 0 || table[i] > INT_MAX || table[i] * numInputs > _file.size() / _scalarSize )
+		{
+			close();
+			return false;
+		}
+	}
+
+	_nodeCount.assign(table, table + hdr.numLayers);
+
+	_activations.assign(hdr.numLayers, BPActivation::SIGMOID);
+	if ( numTables == 2 )
+	{
+		for (uint32_t i = 0; i != hdr.numLayers; ++i)
+		{
+			// softmax only normalizes the output layer
+			uint32_t type = table[hdr.numLayers + i];
+			if ( !BPActivation::isValid(type) ||
+				 (!BPActivation::elementwise((BPActivation::Type)type) && i != hdr.numLayers - 1) )
+			{
+				close();
+				return false;
+			}
+
+			_activations[i] = (BPActivation::Type)type;
+		}
+	}
+
+	size_t dataOffset;
+	size_t fileSize = layout(_nodeCount, _scalarSize, headerSize + tableBytes, _bias, _moments, _offsets, dataOffset);
+	if ( fileSize > _file.size() || dataOffset != hdr.dataOffset || fileSize - dataOffset != hdr.dataSize )
+	{
+		close();
+		return false;
+	}
+
+	// verify checksum (the header is covered from version 6, hashed
+	// with a zero checksum)
+	if ( verify )
+	{
+		uint64_t hash = FNV_OFFSET;
+		if ( hdr.version >= 6 )
+		{
+			BPModelHeader copy = hdr;
+			copy.checksum = 0;
+			hash = hashBytes( hash, &copy, sizeof(copy) );
+		}
+
+		hash = hashBytes( hash, table, tableBytes );
+		hash = hashWords( hash, _file.data() + dataOffset, hdr.dataSize );
+
+		if ( hash != hdr.checksum )
+		{
+			close();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+//====================================================================
+// Unmap file
+//====================================================================
+void BPModelFile::close()
+{
+	_file.close();
+	_nodeCount.clear();
+	_offsets.clear();
+	_activations.clear();
+
+	_scalarSize = 0;
+	_bias		= false;
+	_moments	= false;
+	_optimizer.setType( BPOptimizer::SGD );
+
+	_seed		= 0;
+	_weightInit	= BPRandom::UNIFORM;
+	_seeded		= false;
+}
+
+
+//====================================================================
+// Get weight, delta, bias or moment block of a layer
+//====================================================================
+char* BPModelFile::block(int layer, Block index) const
+{
+	assert( isOpen() && layer > 0 && layer < (int)_nodeCount.size() );
+
+	size_t	blockSize	= aligned( (size_t)_nodeCount[layer] * _nodeCount[layer-1] * _scalarSize );
+	size_t	biasSize	= _bias ? aligned( (size_t)_nodeCount[layer] * _scalarSize ) : 0;
+	char*	data		= _file.data() + _offsets[layer];
+
+	// blocks that are present follow each other in file order
+	switch (index)
+	{
+	case WEIGHTS:		return data;
+	case DELTAS:		return data + blockSize;
+	case BIAS:			return _bias ? data + 2 * blockSize : NULL;
+	case BIAS_DELTAS:	return _bias ? data + 2 * blockSize + biasSize : NULL;
+	case MOMENTS:		return _moments ? data + 2 * (blockSize + biasSize) : NULL;
+	case BIAS_MOMENTS:	return (_moments && _bias) ? data + 3 * blockSize + 2 * biasSize : NULL;
+	}
+
+	return NULL;
+}
+
+
+// explicit instantiation
+template bool BPModelFile::write(const BPNetT<double>& net, const char* fileName);
+template bool BPModelFile::write(const BPNetT<float>& net, const char* fileName);
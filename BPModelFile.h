@@ -0,0 +1,216 @@
+// BPModelFile.h: interface for the BPModelFile class.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+
+#ifndef _BPMODELFILE_H
+#define _BPMODELFILE_H
+
+#include <cstddef>
+#include <vector>
+#include <cassert>
+#include <stdint.h>
+#include "BPMappedFile.h"
+#include "BPActivation.h"
+#include "BPOptimizer.h"
+#include "BPRandom.h"
+using namespace std;
+
+template <class T> class BPNetT;
+
+
+// binary model format version
+#define BPMODEL_VERSION		6
+
+// alignment of data blocks in a binary model file
+#define BPMODEL_ALIGNMENT	64
+
+// header flags
+#define BPMODEL_BIAS		0x1		// layers have bias blocks (version 4)
+#define BPMODEL_MOMENTS		0x2		// layers have moment blocks (version 5)
+#define BPMODEL_SEED		0x4		// seed was set explicitly (version 6)
+
+
+//////////////////////////////////////////////////////////////////////
+// Binary model file header (little-endian).
+//
+// File layout:
+//	BPModelHeader
+//	uint32_t nodeCount[numLayers]
+//	uint32_t activation[numLayers]	(BPActivation::Type, version 3)
+//	padding to BPMODEL_ALIGNMENT
+//	for each layer except the input layer:
+//		weights [numNodes x numInputs values], padded to BPMODEL_ALIGNMENT
+//		deltas	[numNodes x numInputs values], padded to BPMODEL_ALIGNMENT
+//		bias	[numNodes values], padded to BPMODEL_ALIGNMENT	(BPMODEL_BIAS)
+//		bias deltas [numNodes values], padded to BPMODEL_ALIGNMENT	(BPMODEL_BIAS)
+//		moments [numNodes x numInputs values], padded				(BPMODEL_MOMENTS)
+//		bias moments [numNodes values], padded			(BPMODEL_BIAS and BPMODEL_MOMENTS)
+//
+// Values are doubles or floats (scalarSize). Version 1 files hold
+// doubles and end their header before scalarSize. Files before
+// version 3 have no activation table, all their layers are sigmoid.
+// Files before version 4 have no flags (always zero) and no biases.
+// Files before version 5 end their header before optimizer and were
+// trained with SGD. Moment blocks hold the second state of RMSPROP
+// and ADAM (see BPOptimizer). Files before version 6 end their header
+// before seed and have no seed, their weights were UNIFORM.
+// The seed is always stored, BPMODEL_SEED tells whether it was
+// chosen by the user (BPNet::setSeed) or drawn by createNetwork.
+//
+// The checksum covers the header with a zero checksum (version 6) and
+// the node count and activation tables (byte by byte), then the data
+// blocks including padding (8-byte words).
+//////////////////////////////////////////////////////////////////////
+struct BPModelHeader
+{
+	char		magic[8];		// "BPNETBIN"
+	uint32_t	version;		// BPMODEL_VERSION
+	uint32_t	numLayers;		// number of layers
+	double		learningRate;	// learning rate
+	double		momentum;		// momentum
+	uint64_t	dataOffset;		// file offset of first data block
+	uint64_t	dataSize;		// size of all data blocks
+	uint64_t	checksum;		// 64-bit FNV-1a (see BPModelFile::hashBytes)
+	uint32_t	scalarSize;		// bytes per value (8 - double, 4 - float)
+	uint32_t	flags;			// BPMODEL_BIAS, BPMODEL_MOMENTS
+	uint32_t	optimizer;		// BPOptimizer::Type
+	uint32_t	reserved;		// zero
+	double		beta1;			// optimizer hyper-parameters
+	double		beta2;
+	double		epsilon;
+	uint64_t	steps;			// weight updates done
+	uint64_t	seed;			// weight initialization seed
+	uint32_t	weightInit;		// BPRandom::Init
+	uint32_t	reserved2;		// zero
+};
+
+
+//////////////////////////////////////////////////////////////////////
+// BPModelFile - binary model file, read through a memory mapping.
+//
+// Weight blocks are used directly from the mapped pages: a network
+// attached to the file (BPNet::mapBinary) shares the operating
+// system's page cache with every other process mapping the same file.
+// The mapping is private, pages are copied only if they are written
+// (e.g. when an attached network is trained).
+//////////////////////////////////////////////////////////////////////
+class BPModelFile
+{
+// Methods
+public:
+	virtual ~BPModelFile();		// destructor (closes file)
+	BPModelFile();				// default c-tor
+
+	// map a model file, optionally verifying its checksum
+	bool	open(const char* fileName, bool verify = true);
+
+	// unmap file
+	void	close();
+
+	// is a file mapped
+	bool	isOpen() const	{ return _file.isOpen(); }
+
+	// get file header
+	const BPModelHeader&	header() const	{ return *(const BPModelHeader*)_file.data(); }
+
+	// get number of nodes in each layer
+	const vector<int>&		nodeCount() const	{ return _nodeCount; }
+
+	// get transfer function of each layer
+	const vector<BPActivation::Type>&	activations() const	{ return _activations; }
+
+	// get bytes per stored value (8 - double, 4 - float)
+	uint32_t	scalarSize() const	{ return _scalarSize; }
+
+	// do layers have bias blocks
+	bool		hasBias() const		{ return _bias; }
+
+	// do layers have moment blocks
+	bool		hasMoments() const	{ return _moments; }
+
+	// get update rule the network was trained with
+	const BPOptimizer&	optimizer() const	{ return _optimizer; }
+
+	// get weight initialization seed and scheme (0 and UNIFORM before
+	// version 6), was the seed set explicitly
+	uint64_t		seed() const		{ return _seed; }
+	BPRandom::Init	weightInit() const	{ return _weightInit; }
+	bool			hasSeed() const		{ return _seeded; }
+
+	// get weight/delta matrices of a layer (layer > 0) inside the mapping.
+	// T must match scalarSize()
+	template <class T>
+	T*			weights(int layer) const	{ assert( sizeof(T) == _scalarSize ); return (T*)block(layer, WEIGHTS); }
+	template <class T>
+	T*			deltas(int layer) const		{ assert( sizeof(T) == _scalarSize ); return (T*)block(layer, DELTAS); }
+
+	// get bias/bias delta vectors of a layer (layer > 0, NULL without biases)
+	template <class T>
+	T*			bias(int layer) const		{ assert( sizeof(T) == _scalarSize ); return (T*)block(layer, BIAS); }
+	template <class T>
+	T*			biasDeltas(int layer) const	{ assert( sizeof(T) == _scalarSize ); return (T*)block(layer, BIAS_DELTAS); }
+
+	// get moment matrix/bias moment vector of a layer (layer > 0, NULL without moments)
+	template <class T>
+	T*			moments(int layer) const	{ assert( sizeof(T) == _scalarSize ); return (T*)block(layer, MOMENTS); }
+	template <class T>
+	T*			biasMoments(int layer) const { assert( sizeof(T) == _scalarSize ); return (T*)block(layer, BIAS_MOMENTS); }
+
+	// write network to a binary model file (in the network's precision)
+	template <class T>
+	static bool	write(const BPNetT<T>& net, const char* fileName);
+
+protected:
+
+	// data blocks of a layer, in file order
+	enum Block
+	{
+		WEIGHTS = 0,
+		DELTAS,
+		BIAS,
+		BIAS_DELTAS,
+		MOMENTS,
+		BIAS_MOMENTS
+	};
+
+	// get a data block of a layer (NULL if the file doesn't have it)
+	char*			block(int layer, Block index) const;
+
+	// compute block layout of a network (tableEnd - end of header and tables)
+	static size_t	layout(const vector<int>& nodeCnt, size_t scalarSize, size_t tableEnd, bool bias,
+						   bool moments, vector<size_t>& offsets, size_t& dataOffset);
+
+	// 64-bit FNV-1a checksum, updated byte by byte (hashBytes) or
+	// one 8-byte word at a time (hashWords, size must be a multiple of 8)
+	static uint64_t	hashBytes(uint64_t hash, const void* data, size_t size);
+	static uint64_t	hashWords(uint64_t hash, const void* data, size_t size);
+
+	// checksum of a data block padded with zeros to BPMODEL_ALIGNMENT
+	static uint64_t	hashBlock(uint64_t hash, const void* data, size_t size);
+
+// Members
+protected:
+
+	BPMappedFile	_file;			// mapped file
+	vector<int>		_nodeCount;		// number of nodes in each layer
+	vector<size_t>	_offsets;		// file offset of each layer's weight block
+	uint32_t		_scalarSize;	// bytes per stored value
+	bool			_bias;			// layers have bias blocks
+	bool			_moments;		// layers have moment blocks
+	BPOptimizer		_optimizer;		// update rule and hyper-parameters
+	uint64_t		_seed;			// weight initialization seed
+	BPRandom::Init	_weightInit;	// weight initialization scheme
+	bool			_seeded;		// seed was set explicitly
+
+	vector<BPActivation::Type>	_activations;	// transfer function of each layer
+};
+
+
+#endif // _BPMODELFILE_H
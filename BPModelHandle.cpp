@@ -0,0 +1,116 @@
+// BPModelHandle.cpp: implementation of the BPModelHandle class.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <cassert>
+#include <fstream>
+#include "BPModelHandle.h"
+#include "BPNet.h"
+
+
+//////////////////////////////////////////////////////////////////////
+// Construction/Destruction
+//////////////////////////////////////////////////////////////////////
+
+template <class T>
+BPModelHandleT<T>::~BPModelHandleT()
+{
+
+}
+
+
+template <class T>
+BPModelHandleT<T>::BPModelHandleT() :	_version(0)
+{
+
+}
+
+
+template <class T>
+BPModelHandleT<T>::BPModelHandleT(const shared_ptr<const Net>& net) :	_net(net),
+																		_version(1)
+{
+	assert( net );
+}
+
+
+//====================================================================
+// Publish a new version
+//====================================================================
+template <class T>
+bool BPModelHandleT<T>::publish(const shared_ptr<const Net>& net)
+{
+	assert( net );
+
+	lock_guard<mutex> lock(_writeMutex);
+
+	shared_ptr<const Net> current = atomic_load(&_net);
+	if ( current && !compatible(*current, *net) )
+		return false;
+
+	// readers holding the previous version keep it alive
+	atomic_store( &_net, net );
+	_version++;
+
+	return true;
+}
+
+
+//====================================================================
+// Load a model file and publish it
+//====================================================================
+template <class T>
+bool BPModelHandleT<T>::load(const char* fileName, bool map)
+{
+	assert( fileName != NULL );
+
+	// the new version is built aside, readers keep the current one
+	shared_ptr<Net> net = make_shared<Net>();
+
+	bool loaded;
+	if ( map )
+	{
+		loaded = net->mapBinary(fileName);
+	}
+	else
+	{
+		loaded = net->loadBinary(fileName);
+		if ( !loaded )
+		{
+			ifstream ist(fileName);
+			loaded = net->load(ist);
+		}
+	}
+
+	if ( !loaded || net->getNumLayers() == 0 )
+		return false;
+
+	return publish(net);
+}
+
+
+//====================================================================
+// Can a network replace another one
+//====================================================================
+template <class T>
+bool BPModelHandleT<T>::compatible(const Net& current, const Net& next)
+{
+	int numLayers = next.getNumLayers();
+
+	// clients only see the input and output rows
+	return numLayers != 0 &&
+		   next.getNumNodes(0) == current.getNumNodes(0) &&
+		   next.getNumNodes(numLayers - 1) == current.getNumNodes(current.getNumLayers() - 1);
+}
+
+
+// explicit instantiation
+template class BPModelHandleT<double>;
+template class BPModelHandleT<float>;
@@ -0,0 +1,89 @@
+// BPModelHandle.h: interface for the BPModelHandle class.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+
+#ifndef _BPMODELHANDLE_H
+#define _BPMODELHANDLE_H
+
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <stdint.h>
+using namespace std;
+
+template <class T> class BPNetT;
+
+
+//////////////////////////////////////////////////////////////////////
+// BPModelHandleT - the current version of a served network, replaced
+// while it is in use (read-copy-update).
+//
+// Readers take a reference to the current network with get() and use
+// it for a whole request. A new version is loaded into a separate
+// network on the writer's thread and then swapped in with one atomic
+// pointer store, readers never wait for a load. The previous version
+// is freed when its last reader releases it.
+//
+// Networks are never changed after they were published, all readers
+// use them through const references (see BPNet::predict).
+//////////////////////////////////////////////////////////////////////
+template <class T>
+class BPModelHandleT
+{
+// Types
+public:
+	typedef BPNetT<T>	Net;	// served network
+
+// Methods
+public:
+	virtual ~BPModelHandleT();		// destructor
+	BPModelHandleT();				// default c-tor (no network)
+
+	// c-tor with the first version of the network
+	explicit BPModelHandleT(const shared_ptr<const Net>& net);
+
+	// get current network (NULL if none was published)
+	shared_ptr<const Net>	get() const		{ return atomic_load(&_net); }
+
+	// publish a new version. fails (the current version is kept) if its
+	// input or output layer size differs from the current network
+	bool	publish(const shared_ptr<const Net>& net);
+
+	// load a model file (binary model format, or text if it isn't one)
+	// and publish it, map - use weights of a binary file from a memory
+	// mapping (see BPNet::mapBinary)
+	bool	load(const char* fileName, bool map = false);
+
+	// get number of versions published
+	uint64_t	version() const		{ return _version.load(); }
+
+protected:
+
+	// can a network replace another one for the same clients
+	static bool	compatible(const Net& current, const Net& next);
+
+private:
+	BPModelHandleT(const BPModelHandleT&);				// not copyable
+	BPModelHandleT& operator=(const BPModelHandleT&);
+
+// Members
+protected:
+
+	shared_ptr<const Net>	_net;		// current version (atomic_load/atomic_store only)
+	mutex					_writeMutex;	// serializes publishers
+	atomic<uint64_t>		_version;	// versions published
+};
+
+// double and float handles
+typedef BPModelHandleT<double>	BPModelHandle;
+typedef BPModelHandleT<float>	BPModelHandleF;
+
+
+#endif // _BPMODELHANDLE_H
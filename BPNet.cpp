@@ -1,400 +1,1769 @@
-// BPNet.cpp: implementation of the BPNet class.
-//
-// Copyright Gideon Pertzov, 2003
-//
-// This software is provided "as is" without express or implied
-// warranties. You may freely copy and compile this source into
-// applications you distribute provided that credit is given to
-// the original author.
-//
-//////////////////////////////////////////////////////////////////////
-
-#include <ctime>
-#include <cstdarg>
-#include <iostream>
-#include <fstream>
-#include "BPNet.h"
-#include "BPLink.h"
-#include "BPNode.h"
-
-
-//////////////////////////////////////////////////////////////////////
-// Construction/Destruction
-//////////////////////////////////////////////////////////////////////
-BPNet::~BPNet()
-{
-	// cleanup
-	destroyNetwork();
-}
-
-
-BPNet::BPNet() :	_firstMiddleNode(0),
-					_firstOutputNode(0)
-{
-
-}
-
-
-BPNet::BPNet( double lr, double mt, int layers, ... )
-{
-	va_list vl;
-
-	// construct layers vector according to argument list
-	va_start(vl, layers );
-
-	vector<int> layersVec(layers);
-	for (int i = 0; i != layers; ++i)
-		layersVec[i] = va_arg(vl, int);
-
-	va_end( vl );
-
-	// create network
-	createNetwork( lr, mt, layersVec);
-}
-
-
-//====================================================================
-// Create neural-network according to parameters
-//====================================================================
-void BPNet::createNetwork( double lr, double mt, const vector<int>& nodeCnt)
-{
-	srand((unsigned)time(NULL));
-
-	// destroy existing network
-	destroyNetwork();
-
-	// copy node count vector (number of nodes in each layer)
-	_nodeCount	= nodeCnt; 
-
-	int numLayers = _nodeCount.size();
-	if ( numLayers == 0 )
-		return; // nothing to do if no layers
-
-
-	// create nodes
-	int numLinks = 0;
-	for(int i = 0; i < numLayers; ++i)
-	{
-		int numNodes = _nodeCount[i];
-		for(int j = 0; j < numNodes; ++j)
-		{
-			// create a new node 
-			BPNode* node = new BPNode(lr, mt);
-
-			// add it to the nodes vector
-			_nodes.push_back(node);
-		}
-
-		// count links while we're at it
-		if ( i > 0 )
-		  numLinks += _nodeCount[i-1] * numNodes; 
-	}
-	
-	// set index of first middle node 
-	// (index of last input node + 1)
-	_firstMiddleNode = _nodeCount[0];
-
-	// set index of first output node 
-	// (total number of nodes - number of output nodes)
-	_firstOutputNode = _nodes.size() - _nodeCount[numLayers-1];
-
-
-
-	// create links
-	for (i = 0; i < numLinks; ++i)               
-	{
-		// create new link
-		BPLink* link = new BPLink;
-
-		// add it to the links vector
-		_links.push_back(link);
-	}
-
-
-	// connect layers
-	int current		= 0;
-	int curLayer	= 0;
-	int	nextLayer	= _firstMiddleNode;
-
-	BPNode* pInNode		= NULL;
-	BPNode* pOutNode	= NULL;
-	BPLink*	pLink		= NULL;
-
-	for (i = 0; i < numLayers-1; ++i)
-	{
-		for (int j = 0; j < _nodeCount[i+1]; ++j)
-			for (int k = 0; k < _nodeCount[i]; ++k)
-			{
-				pInNode		= _nodes[curLayer+k];
-				pOutNode	= _nodes[nextLayer+j];
-				pLink		= _links[current++];
-
-				// connect input node to output node
-				pLink->connect(pInNode, pOutNode);
-			}
-
-		curLayer = nextLayer;
-		nextLayer += _nodeCount[i+1];
-	}
-
-
-}
-
-
-//====================================================================
-// Destroy neural-network
-//====================================================================
-void BPNet::destroyNetwork()
-{
-	// cleanup links and nodes
-	int numLinks = _links.size();
-	for(int i = 0; i != numLinks; ++i)
-		delete _links[i];
-
-	int numNodes = _nodes.size();
-	for(i = 0; i != numNodes; ++i)
-		delete _nodes[i];
-
-	_links.clear();
-	_nodes.clear();
-	_nodeCount.clear();
-
-	_firstMiddleNode	= 0;
-	_firstOutputNode	= 0;
-
-}
-
-
-
-//====================================================================
-// Get number of nodes in a specific layer
-//====================================================================
-int BPNet::getNumNodes(int layerIndex)
-{
-	assert ( _nodeCount.size() > layerIndex && layerIndex >= 0);
-
-	return _nodeCount[layerIndex];
-}
-
-
-//====================================================================
-// Set value of input node
-//====================================================================
-void BPNet::setInput(double value, int inputNodeIndex)
-{
-	assert ( _nodeCount.size() != 0 && inputNodeIndex >= 0 && inputNodeIndex < _nodeCount[0] );
-
-	_nodes[inputNodeIndex]->setValue(value);
-}
-
-
-//====================================================================
-// Set value of input node (using pattern)
-//====================================================================
-void BPNet::setInput( const Pattern* pattern )
-{
-	assert ( pattern != NULL && _nodeCount.size() != 0 && pattern->inSize() == _nodeCount[0]);
-
-	
-	int numInputNodes = _nodeCount[0];
-	for (int  i = 0;  i < numInputNodes; ++i) 
-	{
-        _nodes[i]->setValue(pattern->getInput(i));
-	}
-}
-
-
-//====================================================================
-// Get value of output node
-//====================================================================
-double BPNet::getOutput(int outputNodeIndex) const
-{
-	assert ( _nodeCount.size() != 0 && outputNodeIndex >= 0 && outputNodeIndex < _nodeCount[_nodeCount.size()-1] );
-	
-	return _nodes[ _firstOutputNode + outputNodeIndex ]->getValue();
-}
-
-
-//====================================================================
-// Get error of output node
-//====================================================================
-double BPNet::getError(int outputNodeIndex) const
-{
-	assert ( _nodeCount.size() != 0 && outputNodeIndex >= 0 && outputNodeIndex < _nodeCount[_nodeCount.size()-1] );
-	
-	return _nodes[ _firstOutputNode + outputNodeIndex ]->getError();
-}
-
-
-//====================================================================
-// Set desired output for error computation
-//====================================================================
-void BPNet::setError(double value, int outputNodeIndex)
-{
-	assert ( _nodeCount.size() != 0 && outputNodeIndex >= 0 && outputNodeIndex < _nodeCount[_nodeCount.size()-1] );
-
-	_nodes[ _firstOutputNode + outputNodeIndex ]->setError(value);
-}
-
-
-//====================================================================
-// Set desired output for error computation (using Pattern)
-//====================================================================
-void BPNet::setError( const Pattern* pattern)
-{
-	assert ( pattern != NULL && _nodeCount.size() != 0 && pattern->outSize() == _nodeCount[_nodeCount.size()-1]);
-
-	int numOutputNodes = _nodeCount[_nodeCount.size()-1];
-	for (int  i = 0;  i < numOutputNodes; ++i) 
-          _nodes[i + _firstOutputNode]->setError(pattern->getOutput(i));
-}
-
-
-//====================================================================
-// Set learning rate for all nodes
-//====================================================================	
-void BPNet::setLearningRate(double lr)
-{
-	int numNodes = _nodes.size();
-	for(int i = 0; i != numNodes; ++i)
-		_nodes[i]->setLearningRate(lr);
-}
-
-
-
-//====================================================================
-// Set momentum for all nodes
-//====================================================================	
-void BPNet::setMomentum(double mt)
-{
-	int numNodes = _nodes.size();
-	for(int i = 0; i != numNodes; ++i)
-		_nodes[i]->setMomentum(mt);
-}
-
-
-//====================================================================
-// Get learning rate
-//====================================================================	
-double BPNet::getLearningRate()
-{
-	assert( _nodes.size() != 0);
-
-	return _nodes[0]->getLearningRate();
-}
-
-
-//====================================================================
-// Get momentum
-//====================================================================	
-double BPNet::getMomentum()
-{
-	assert( _nodes.size() != 0);
-
-	return _nodes[0]->getMomentum();
-}
-
-
-//====================================================================
-// Run - forward pass
-//====================================================================	
-void BPNet::run()
-{
-	// run only nodes in middle and output layers
-	// (input nodes don't have input links)
-	int numNodes = _nodes.size();
-	for (int i = _firstMiddleNode; i != numNodes; ++i) 
-	{
-		_nodes[i]->run();
-	}
-}
-
-
-
-//====================================================================
-// Learn - backward pass
-//====================================================================	
-void BPNet::learn()
-{
-	// we loop backwards from output nodes towards the middle nodes
-	int numNodes = _nodes.size();
-	for(int i = numNodes-1; i >= _firstMiddleNode; i--)
-	{
-		_nodes[i]->learn();
-	}
-}
-
-
-//====================================================================
-// Save network to file
-//====================================================================
-bool BPNet::save( ofstream &ost ) const
-{
-	if ( !ost.good() )
-		return false;
-
-	int numLayers = _nodeCount.size();
-	int numNodes = _nodes.size();
-	int numLinks = _links.size();
-
-	ost << numLayers << endl; // num layers
-	
-	for(int i = 0; i != numLayers; ++i)
-		ost << _nodeCount[i] << endl; // number of nodes in each layer
-	
-	ost << numNodes << endl; // total number of nodes
-	ost << numLinks << endl; // total number of links
-
-	// save nodes data
-	for(i = 0; i != numNodes; ++i)
-		_nodes[i]->save(ost);
-
-	// save links data
-	for(i = 0; i != numLinks; ++i)
-		_links[i]->save(ost);
-	
-	if (!ost.good())
-		return false;
-
-	return true;
-}
-
-
-//====================================================================
-// Load network from file
-//====================================================================
-bool BPNet::load( ifstream &ist )
-{
-	if ( !ist.good() )
-		return false;
-	
-	int numLayers	= 0;
-	int numNodes	= 0;
-	int numLinks	= 0;
-
-	ist >> numLayers;	// num layers
-	
-	vector<int> layers(numLayers);
-	for(int i = 0; i != numLayers; ++i)
-		ist >> layers[i];	// number of nodes in each layer
-
-	ist >> numNodes;
-	ist >> numLinks;
-
-	// create network structure (nodes and links)
-	createNetwork(0, 0, layers);
-	
-	// load nodes data
-	for (i = 0; i != numNodes; ++i)
-		_nodes[i]->load(ist);
-
-	// load links data
-	for(i = 0; i != numLinks; ++i)
-		_links[i]->load(ist);
-
-
-	if (!ist.good())
-		return false;
-
-	return true;
-}
\ No newline at end of file
+// BPNet.cpp: implementation of the BPNet class.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cstring>
+#include <cstdarg>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include "BPNet.h"
+#include "BPLink.h"
+#include "BPNode.h"
+#include "BPThreadPool.h"
+#include "BPWorkspace.h"
+#include "BPModelFile.h"
+
+// default minimal number of weights for a layer to be split between threads
+#define DEFAULT_PARALLEL_THRESHOLD	16384
+
+// copy values, converting precision
+template <class T, class S>
+static void copyValues(T* dst, const S* src, size_t count)
+{
+	for (size_t i = 0; i != count; ++i)
+		dst[i] = (T)src[i];
+}
+
+
+//////////////////////////////////////////////////////////////////////
+// Construction/Destruction
+//////////////////////////////////////////////////////////////////////
+template <class T>
+BPNetT<T>::~BPNetT()
+{
+	// cleanup
+	destroyNetwork();
+}
+
+
+template <class T>
+BPNetT<T>::BPNetT() :	_firstMiddleNode(0),
+						_firstOutputNode(0),
+						_lr(0),
+						_mt(0),
+						_batchSize(0),
+						_bias(false),
+						_legacyOrder(false),
+						_seed(0),
+						_seeded(false),
+						_weightInit(BPRandom::UNIFORM),
+						_sigmoid(BPKernels::SIGMOID_EXACT),
+						_pPool(NULL),
+						_parallelThreshold(DEFAULT_PARALLEL_THRESHOLD)
+{
+
+}
+
+
+template <class T>
+BPNetT<T>::BPNetT( double lr, double mt, int layers, ... ) :	_batchSize(0),
+																_bias(false),
+																_legacyOrder(false),
+																_seed(0),
+																_seeded(false),
+																_weightInit(BPRandom::UNIFORM),
+																_sigmoid(BPKernels::SIGMOID_EXACT),
+																_pPool(NULL),
+																_parallelThreshold(DEFAULT_PARALLEL_THRESHOLD)
+{
+	va_list vl;
+
+	// construct layers vector according to argument list
+	va_start(vl, layers );
+
+	vector<int> layersVec(layers);
+	for (int i = 0; i != layers; ++i)
+		layersVec[i] = va_arg(vl, int);
+
+	va_end( vl );
+
+	// create network
+	createNetwork( lr, mt, layersVec);
+}
+
+
+template <class T>
+BPNetT<T>::BPNetT( const BPNetT& other ) :	_firstMiddleNode(0),
+											_firstOutputNode(0),
+											_lr(0),
+											_mt(0),
+											_batchSize(0),
+											_bias(false),
+											_legacyOrder(false),
+											_seed(0),
+											_seeded(false),
+											_weightInit(BPRandom::UNIFORM),
+											_sigmoid(BPKernels::SIGMOID_EXACT),
+											_pPool(NULL),
+											_parallelThreshold(DEFAULT_PARALLEL_THRESHOLD)
+{
+	*this = other;
+}
+
+
+//====================================================================
+// Copy a network into own storage
+//====================================================================
+template <class T>
+BPNetT<T>& BPNetT<T>::operator=( const BPNetT& other )
+{
+	if ( this == &other )
+		return *this;
+
+	_batchSize			= other._batchSize;
+	_legacyOrder		= other._legacyOrder;
+	_seed				= other._seed;
+	_seeded				= other._seeded;
+	_weightInit			= other._weightInit;
+	_sigmoid			= other._sigmoid;
+	_parallelThreshold	= other._parallelThreshold;
+
+	// an external pool is shared, an owned one is not
+	if ( other._ownedPool )
+		setNumThreads( other._ownedPool->numThreads() );
+	else
+		setThreadPool( other._pPool );
+
+	int numLayers = other._layers.size();
+
+	vector<BPActivation::Type> activations( numLayers, BPActivation::SIGMOID );
+	for (int i = 1; i < numLayers; ++i)
+		activations[i] = other._layers[i].getActivation();
+
+	// same layout as a new network of this structure
+	createLayers( other._lr, other._mt, other._nodeCount, activations, other._bias,
+				  other._optimizer, true );
+
+	for (int i = 0; i < numLayers; ++i)
+	{
+		Layer&			dst			= _layers[i];
+		const Layer&	src			= other._layers[i];
+		size_t			numNodes	= src.numNodes();
+		size_t			numWeights	= src.weightCount();
+
+		assert( dst.weightCount() == numWeights && dst.hasBias() == src.hasBias() );
+		assert( ( dst.moments() == NULL ) == ( src.moments() == NULL ) );
+
+		memcpy( dst.values(), src.values(), numNodes * sizeof(T) );
+		memcpy( dst.errors(), src.errors(), numNodes * sizeof(T) );
+
+		if ( numWeights == 0 )
+			continue;
+
+		memcpy( dst.weights(), src.weights(), numWeights * sizeof(T) );
+		memcpy( dst.deltas(), src.deltas(), numWeights * sizeof(T) );
+
+		if ( src.moments() != NULL )
+			memcpy( dst.moments(), src.moments(), numWeights * sizeof(T) );
+
+		if ( src.hasBias() )
+		{
+			memcpy( dst.bias(), src.bias(), numNodes * sizeof(T) );
+			memcpy( dst.biasDeltas(), src.biasDeltas(), numNodes * sizeof(T) );
+
+			if ( src.biasMoments() != NULL )
+				memcpy( dst.biasMoments(), src.biasMoments(), numNodes * sizeof(T) );
+		}
+	}
+
+	return *this;
+}
+
+
+//====================================================================
+// Create neural-network according to parameters
+//====================================================================
+template <class T>
+void BPNetT<T>::createNetwork( double lr, double mt, const vector<int>& nodeCnt)
+{
+	createNetwork( lr, mt, nodeCnt, vector<BPActivation::Type>(nodeCnt.size(), BPActivation::SIGMOID) );
+}
+
+
+//====================================================================
+// Create neural-network with a transfer function for each layer
+//====================================================================
+template <class T>
+void BPNetT<T>::createNetwork( double lr, double mt, const vector<int>& nodeCnt,
+							   const vector<BPActivation::Type>& activations )
+{
+	// keep the selected update rule, training starts over
+	BPOptimizer optimizer = _optimizer;
+	optimizer.setSteps(0);
+
+	createLayers(lr, mt, nodeCnt, activations, false, optimizer, true);
+
+	if ( !_seeded )
+		_seed = BPRandom::newSeed();
+
+	initWeights();
+}
+
+
+//====================================================================
+// Set seed of weight initialization
+//====================================================================
+template <class T>
+void BPNetT<T>::setSeed(uint64_t seed)
+{
+	_seed	= seed;
+	_seeded	= true;
+}
+
+
+//====================================================================
+// Set weight initialization scheme
+//====================================================================
+template <class T>
+void BPNetT<T>::setWeightInit(BPRandom::Init init)
+{
+	assert( init >= BPRandom::UNIFORM && init < BPRandom::NUM_INITS );
+
+	_weightInit = init;
+}
+
+
+//====================================================================
+// Initialize weights from the seed
+//====================================================================
+template <class T>
+void BPNetT<T>::initWeights()
+{
+	// each layer is a stream of the seed, rows may be split between
+	// threads in any way without changing the values
+	int numLayers = _layers.size();
+	for (int i = 1; i < numLayers; ++i)
+	{
+		Layer& layer = _layers[i];
+
+		if ( useThreads( layer.weightCount() ) )
+			_pPool->parallelFor( layer.numNodes(), [&](int first, int last) { layer.initWeights(_seed, i, _weightInit, first, last); } );
+		else
+			layer.initWeights( _seed, i, _weightInit, 0, layer.numNodes() );
+
+		if ( layer.hasBias() )
+			memset( layer.bias(), 0, layer.numNodes() * sizeof(T) );
+
+		layer.clearState();
+	}
+
+	_optimizer.setSteps(0);
+}
+
+
+//====================================================================
+// Re-initialize network in place
+//====================================================================
+template <class T>
+void BPNetT<T>::reset(uint64_t seed)
+{
+	setSeed(seed);
+	initWeights();
+
+	int numLayers = _layers.size();
+	for (int i = 0; i < numLayers; ++i)
+	{
+		memset( _layers[i].values(), 0, _nodeCount[i] * sizeof(T) );
+		memset( _layers[i].errors(), 0, _nodeCount[i] * sizeof(T) );
+	}
+}
+
+
+//====================================================================
+// Create layers, weights are initialized only if allocated
+//====================================================================
+template <class T>
+void BPNetT<T>::createLayers( double lr, double mt, const vector<int>& nodeCnt,
+							  const vector<BPActivation::Type>& activations, bool bias,
+							  const BPOptimizer& optimizer, bool allocateWeights )
+{
+	assert( activations.size() == nodeCnt.size() );
+
+	// destroy existing network
+	destroyNetwork();
+
+	_lr			= lr;
+	_mt			= mt;
+	_bias		= bias;
+	_optimizer	= optimizer;
+
+	// copy node count vector (number of nodes in each layer)
+	_nodeCount	= nodeCnt; 
+
+	int numLayers = _nodeCount.size();
+	_stats.create(numLayers);
+
+	if ( numLayers == 0 )
+		return; // nothing to do if no layers
+
+
+	// all layers are stored in one arena allocation, kept between
+	// networks: a network that fits in it is created without allocating
+	size_t size = 0;
+	for (int i = 0; i < numLayers; ++i)
+	{
+		int numInputs = (i > 0) ? _nodeCount[i-1] : 0;
+		size += Layer::storageSize( _nodeCount[i], numInputs, optimizer.getType(), allocateWeights );
+	}
+
+	if ( _arena.size() < size )
+		_arena.resize(size);
+	else
+		memset( _arena.data(), 0, size * sizeof(T) );
+
+	// create layers, each layer holds the weights of its incoming links
+	_layers.resize(numLayers);
+
+	T*	storage		= _arena.data();
+	int	numNodes	= 0;
+	for (int i = 0; i < numLayers; ++i)
+	{
+		int					numInputs	= (i > 0) ? _nodeCount[i-1] : 0;
+		BPOptimizer::Type	type		= (i > 0) ? optimizer.getType() : BPOptimizer::SGD;
+
+		// mapped biases and optimizer state are attached with the weights
+		_layers[i].create( _nodeCount[i], numInputs, bias && allocateWeights && i > 0, type,
+						   allocateWeights, storage );
+		_layers[i].setSigmoid(_sigmoid);
+
+		storage += Layer::storageSize( _nodeCount[i], numInputs, type, allocateWeights );
+
+		if ( i > 0 )
+			setActivation(i, activations[i]);
+
+		numNodes += _nodeCount[i];
+	}
+	
+	// set index of first middle node 
+	// (index of last input node + 1)
+	_firstMiddleNode = _nodeCount[0];
+
+	// set index of first output node 
+	// (total number of nodes - number of output nodes)
+	_firstOutputNode = numNodes - _nodeCount[numLayers-1];
+}
+
+
+//====================================================================
+// Destroy neural-network
+//====================================================================
+template <class T>
+void BPNetT<T>::destroyNetwork()
+{
+	destroyGraphView();
+
+	_layers.clear();
+	_nodeCount.clear();
+
+	// release mapping only after layers no longer use it
+	_modelFile.reset();
+
+	_firstMiddleNode	= 0;
+	_firstOutputNode	= 0;
+
+}
+
+
+//====================================================================
+// Destroy graph view
+//====================================================================
+template <class T>
+void BPNetT<T>::destroyGraphView()
+{
+	// cleanup links and nodes
+	int numLinks = _links.size();
+	for (int i = 0; i != numLinks; ++i)
+		delete _links[i];
+
+	int numNodes = _nodes.size();
+	for (int i = 0; i != numNodes; ++i)
+		delete _nodes[i];
+
+	_links.clear();
+	_nodes.clear();
+}
+
+
+//====================================================================
+// Build BPNode/BPLink graph mirroring current network state
+//====================================================================
+template <class T>
+void BPNetT<T>::buildGraphView()
+{
+	destroyGraphView();
+
+	int numLayers = _layers.size();
+	if ( numLayers == 0 )
+		return;
+
+	// nodes and links are numbered in the order of save()
+	_nodes.reserve( _firstOutputNode + _nodeCount.back() );
+
+	// create nodes
+	for (int i = 0; i < numLayers; ++i)
+	{
+		const Layer& layer = _layers[i];
+		for (int j = 0; j < layer.numNodes(); ++j)
+		{
+			BPNode* node = new BPNode(_lr, _mt, i, j, _nodes.size());
+			node->setValue( layer.getValue(j) );
+			node->setError( layer.getError(j) );
+
+			_nodes.push_back(node);
+		}
+	}
+
+	// connect layers
+	int curLayer	= 0;
+	int	nextLayer	= _firstMiddleNode;
+
+	for (int i = 1; i < numLayers; ++i)
+	{
+		const Layer& layer = _layers[i];
+		for (int j = 0; j < layer.numNodes(); ++j)
+			for (int k = 0; k < layer.numInputs(); ++k)
+			{
+				BPLink* link = new BPLink(_links.size());
+				link->connect(_nodes[curLayer+k], _nodes[nextLayer+j]);
+				link->setWeight( layer.getWeight(j, k) );
+				link->setDelta( layer.getDelta(j, k) );
+
+				_links.push_back(link);
+			}
+
+		curLayer = nextLayer;
+		nextLayer += layer.numNodes();
+	}
+}
+
+
+//====================================================================
+// Get graph view node
+//====================================================================
+template <class T>
+const BPNode* BPNetT<T>::getGraphNode(int index) const
+{
+	assert( index >= 0 && index < _nodes.size() );
+
+	return _nodes[index];
+}
+
+
+//====================================================================
+// Get graph view link
+//====================================================================
+template <class T>
+const BPLink* BPNetT<T>::getGraphLink(int index) const
+{
+	assert( index >= 0 && index < _links.size() );
+
+	return _links[index];
+}
+
+
+//====================================================================
+// Get dense storage of a specific layer
+//====================================================================
+template <class T>
+BPLayerT<T>& BPNetT<T>::getLayer(int layerIndex)
+{
+	assert ( _layers.size() > layerIndex && layerIndex >= 0);
+
+	return _layers[layerIndex];
+}
+
+
+template <class T>
+const BPLayerT<T>& BPNetT<T>::getLayer(int layerIndex) const
+{
+	assert ( _layers.size() > layerIndex && layerIndex >= 0);
+
+	return _layers[layerIndex];
+}
+
+
+
+//====================================================================
+// Get number of nodes in a specific layer
+//====================================================================
+template <class T>
+int BPNetT<T>::getNumNodes(int layerIndex) const
+{
+	assert ( _nodeCount.size() > layerIndex && layerIndex >= 0);
+
+	return _nodeCount[layerIndex];
+}
+
+
+//====================================================================
+// Set value of input node
+//====================================================================
+template <class T>
+void BPNetT<T>::setInput(T value, int inputNodeIndex)
+{
+	assert ( _nodeCount.size() != 0 && inputNodeIndex >= 0 && inputNodeIndex < _nodeCount[0] );
+
+	_layers[0].setValue(inputNodeIndex, value);
+}
+
+
+//====================================================================
+// Set value of input node (using pattern)
+//====================================================================
+template <class T>
+void BPNetT<T>::setInput( const Pattern* pattern )
+{
+	assert ( pattern != NULL && _nodeCount.size() != 0 && pattern->inSize() == _nodeCount[0]);
+
+	
+	memcpy( _layers[0].values(), pattern->inputs(), _nodeCount[0] * sizeof(T) );
+}
+
+
+//====================================================================
+// Get value of output node
+//====================================================================
+template <class T>
+T BPNetT<T>::getOutput(int outputNodeIndex) const
+{
+	assert ( _nodeCount.size() != 0 && outputNodeIndex >= 0 && outputNodeIndex < _nodeCount[_nodeCount.size()-1] );
+	
+	return _layers.back().getValue(outputNodeIndex);
+}
+
+
+//====================================================================
+// Get error of output node
+//====================================================================
+template <class T>
+T BPNetT<T>::getError(int outputNodeIndex) const
+{
+	assert ( _nodeCount.size() != 0 && outputNodeIndex >= 0 && outputNodeIndex < _nodeCount[_nodeCount.size()-1] );
+	
+	return _layers.back().getError(outputNodeIndex);
+}
+
+
+//====================================================================
+// Set desired output for error computation
+//====================================================================
+template <class T>
+void BPNetT<T>::setError(T value, int outputNodeIndex)
+{
+	assert ( _nodeCount.size() != 0 && outputNodeIndex >= 0 && outputNodeIndex < _nodeCount[_nodeCount.size()-1] );
+
+	_layers.back().setError(outputNodeIndex, value);
+}
+
+
+//====================================================================
+// Set desired output for error computation (using Pattern)
+//====================================================================
+template <class T>
+void BPNetT<T>::setError( const Pattern* pattern)
+{
+	assert ( pattern != NULL && _nodeCount.size() != 0 && pattern->outSize() == _nodeCount[_nodeCount.size()-1]);
+
+	int numOutputNodes = _nodeCount[_nodeCount.size()-1];
+	memcpy( _layers.back().errors(), pattern->outputs(), numOutputNodes * sizeof(T) );
+}
+
+
+//====================================================================
+// Set learning rate (one value shared by all layers)
+//====================================================================	
+template <class T>
+void BPNetT<T>::setLearningRate(double lr)
+{
+	_lr = lr;
+}
+
+
+
+//====================================================================
+// Set momentum (one value shared by all layers)
+//====================================================================	
+template <class T>
+void BPNetT<T>::setMomentum(double mt)
+{
+	_mt = mt;
+}
+
+
+//====================================================================
+// Get learning rate
+//====================================================================	
+template <class T>
+double BPNetT<T>::getLearningRate() const
+{
+	assert( _layers.size() != 0);
+
+	return _lr;
+}
+
+
+//====================================================================
+// Get momentum
+//====================================================================	
+template <class T>
+double BPNetT<T>::getMomentum() const
+{
+	assert( _layers.size() != 0);
+
+	return _mt;
+}
+
+
+//====================================================================
+// Add or remove node biases
+//====================================================================	
+template <class T>
+void BPNetT<T>::enableBias(bool enable)
+{
+	_bias = enable;
+
+	int numLayers = _layers.size();
+	for (int i = 1; i < numLayers; ++i)
+		_layers[i].enableBias(enable);
+}
+
+
+//====================================================================
+// Select weight update rule
+//====================================================================	
+template <class T>
+void BPNetT<T>::setOptimizer(BPOptimizer::Type type)
+{
+	_optimizer.setType(type);
+
+	int numLayers = _layers.size();
+	for (int i = 1; i < numLayers; ++i)
+	{
+		_layers[i].setOptimizer(type);
+		_layers[i].clearState();
+	}
+}
+
+
+//====================================================================
+// Set weight update rule with hyper-parameters
+//====================================================================	
+template <class T>
+void BPNetT<T>::setOptimizer(const BPOptimizer& optimizer)
+{
+	_optimizer = optimizer;
+
+	// moments a rule didn't have before start at zero
+	int numLayers = _layers.size();
+	for (int i = 1; i < numLayers; ++i)
+		_layers[i].setOptimizer( optimizer.getType() );
+}
+
+
+//====================================================================
+// Set transfer function of a layer
+//====================================================================	
+template <class T>
+void BPNetT<T>::setActivation(int layerIndex, BPActivation::Type type)
+{
+	assert ( _layers.size() > layerIndex && layerIndex >= 0 && BPActivation::isValid(type) );
+
+	// softmax normalizes the network outputs only
+	assert ( BPActivation::elementwise(type) || layerIndex == (int)_layers.size() - 1 );
+
+	_layers[layerIndex].setActivation(type);
+}
+
+
+//====================================================================
+// Get transfer function of a layer
+//====================================================================	
+template <class T>
+BPActivation::Type BPNetT<T>::getActivation(int layerIndex) const
+{
+	assert ( _layers.size() > layerIndex && layerIndex >= 0 );
+
+	return _layers[layerIndex].getActivation();
+}
+
+
+//====================================================================
+// Set sigmoid evaluation mode of all layers
+//====================================================================	
+template <class T>
+void BPNetT<T>::setSigmoid(BPKernels::Sigmoid mode)
+{
+	_sigmoid = mode;
+
+	int numLayers = _layers.size();
+	for (int i = 0; i < numLayers; ++i)
+		_layers[i].setSigmoid(mode);
+}
+
+
+//====================================================================
+// Use an external thread pool
+//====================================================================	
+template <class T>
+void BPNetT<T>::setThreadPool(BPThreadPool* pool)
+{
+	_ownedPool.reset();
+	_pPool = pool;
+}
+
+
+//====================================================================
+// Create a thread pool owned by the network
+//====================================================================	
+template <class T>
+void BPNetT<T>::setNumThreads(int numThreads)
+{
+	if ( numThreads <= 0 )
+		numThreads = BPThreadPool::hardwareThreads();
+
+	if ( numThreads == 1 )
+	{
+		setThreadPool(NULL);
+		return;
+	}
+
+	_ownedPool.reset( new BPThreadPool(numThreads) );
+	_pPool = _ownedPool.get();
+}
+
+
+//====================================================================
+// Set minimal work for a layer to be split between threads
+//====================================================================	
+template <class T>
+void BPNetT<T>::setParallelThreshold(int numWeights)
+{
+	assert( numWeights >= 0 );
+
+	_parallelThreshold = numWeights;
+}
+
+
+//====================================================================
+// Should a layer step run on the thread pool
+//====================================================================	
+template <class T>
+bool BPNetT<T>::useThreads(size_t work) const
+{
+	return ( _pPool != NULL && _pPool->numThreads() > 1 && work >= (size_t)_parallelThreshold );
+}
+
+
+//====================================================================
+// Run - forward pass
+//====================================================================	
+template <class T>
+void BPNetT<T>::run()
+{
+	// run only middle and output layers
+	// (input nodes don't have input links)
+	// nodes of a layer are independent and may run on several threads
+	// (except for softmax, which normalizes all nodes of the layer),
+	// a layer is started only after the previous layer is done.
+	int numLayers = _layers.size();
+	for (int i = 1; i < numLayers; ++i) 
+	{
+		Layer&			layer	= _layers[i];
+		const T*		in		= _layers[i-1].values();
+
+		BPSTATS( uint64_t start = BPStats::now() );
+
+		if ( useThreads( layer.weightCount() ) && BPActivation::elementwise( layer.getActivation() ) )
+			_pPool->parallelFor( layer.numNodes(), [&](int first, int last) { layer.run(in, first, last); } );
+		else
+			layer.run(in);
+
+		BPSTATS( _stats.addTime(BPStats::FORWARD, i, start) );
+		BPSTATS( _stats.addSamples(i, 1) );
+	}
+}
+
+
+
+//====================================================================
+// Learn - backward pass
+//====================================================================	
+template <class T>
+void BPNetT<T>::learn()
+{
+	int numLayers = _layers.size();
+	if ( numLayers < 2 )
+		return; // nothing to learn
+
+	// one weight update of every layer
+	BPOptimizer::Step step = beginUpdate();
+
+	if ( _legacyOrder )
+	{
+		learnLegacy(step);
+		return;
+	}
+
+	// first propagate the errors from the output layer towards the
+	// middle layers, through weights that are not changed yet
+	BPSTATS( uint64_t start = BPStats::now() );
+
+	_layers[numLayers-1].computeOutputError();
+
+	BPSTATS( _stats.addTime(BPStats::BACKWARD, numLayers-1, start) );
+
+	for (int i = numLayers-2; i >= 1; --i)
+	{
+		Layer&			layer	= _layers[i];
+		const Layer&	next	= _layers[i+1];
+
+		BPSTATS( start = BPStats::now() );
+
+		if ( useThreads( next.weightCount() ) )
+			_pPool->parallelFor( layer.numNodes(), [&](int first, int last) { layer.computeError(next, first, last); } );
+		else
+			layer.computeError(next);
+
+		BPSTATS( _stats.addTime(BPStats::BACKWARD, i, start) );
+	}
+
+	// then adjust the weights. layers no longer depend on each other,
+	// the nodes of all layers are split between threads at once
+	int		numNodes	= 0;
+	size_t	numWeights	= 0;
+	for (int i = 1; i < numLayers; ++i)
+	{
+		numNodes	+= _layers[i].numNodes();
+		numWeights	+= _layers[i].weightCount();
+	}
+
+	if ( useThreads( numWeights ) )
+		_pPool->parallelFor( numNodes, [&](int first, int last) { learnNodes(step, first, last); } );
+	else
+		learnNodes( step, 0, numNodes );
+}
+
+
+//====================================================================
+// Adjust weights of nodes [first, last) of the middle and output layers
+//====================================================================	
+template <class T>
+void BPNetT<T>::learnNodes(const BPOptimizer::Step& step, int first, int last)
+{
+	int numLayers	= _layers.size();
+	int layerFirst	= 0;	// number of the layer's first node
+
+	for (int i = 1; i < numLayers && layerFirst < last; ++i)
+	{
+		Layer&	layer		= _layers[i];
+		int		layerLast	= layerFirst + layer.numNodes();
+
+		// part of [first, last) inside this layer
+		int begin	= max( first, layerFirst ) - layerFirst;
+		int end		= min( last, layerLast ) - layerFirst;
+
+		if ( begin < end )
+		{
+			BPSTATS( uint64_t start = BPStats::now() );
+
+			layer.learn( _layers[i-1].values(), step, begin, end );
+
+			BPSTATS( _stats.addTime(BPStats::UPDATE, i, start) );
+		}
+
+		layerFirst = layerLast;
+	}
+}
+
+
+//====================================================================
+// Learn - backward pass with legacy ordering
+//====================================================================	
+template <class T>
+void BPNetT<T>::learnLegacy(const BPOptimizer::Step& step)
+{
+	// we loop backwards from output layer towards the middle layers.
+	// each layer computes its error (from the already adjusted weights
+	// of the following layer) and then adjusts its own weights.
+	int numLayers = _layers.size();
+	for(int i = numLayers-1; i >= 1; i--)
+	{
+		Layer&			layer	= _layers[i];
+		const T*		in		= _layers[i-1].values();
+
+		BPSTATS( uint64_t start = BPStats::now() );
+
+		if ( i == numLayers-1 )
+		{
+			layer.computeOutputError();
+		}
+		else
+		{
+			const Layer& next = _layers[i+1];
+
+			if ( useThreads( next.weightCount() ) )
+				_pPool->parallelFor( layer.numNodes(), [&](int first, int last) { layer.computeError(next, first, last); } );
+			else
+				layer.computeError(next);
+		}
+
+		BPSTATS( _stats.addTime(BPStats::BACKWARD, i, start) );
+		BPSTATS( start = BPStats::now() );
+
+		if ( useThreads( layer.weightCount() ) )
+			_pPool->parallelFor( layer.numNodes(), [&](int first, int last) { layer.learn(in, step, first, last); } );
+		else
+			layer.learn(in, step, 0, layer.numNodes());
+
+		BPSTATS( _stats.addTime(BPStats::UPDATE, i, start) );
+	}
+}
+
+
+//====================================================================
+// Set mini-batch size
+//====================================================================	
+template <class T>
+void BPNetT<T>::setBatchSize(int size)
+{
+	assert( size >= 0 );
+
+	_batchSize = size;
+}
+
+
+//====================================================================
+// Allocate a workspace for predict()
+//====================================================================	
+template <class T>
+void BPNetT<T>::createWorkspace( Workspace& ws, int batchSize ) const
+{
+	ws.create( _nodeCount, batchSize, false );
+}
+
+
+//====================================================================
+// Thread-safe inference of n samples
+//====================================================================	
+template <class T>
+void BPNetT<T>::predict( const T* in, T* out, int n, Workspace& ws ) const
+{
+	assert( in != NULL && out != NULL && _nodeCount.size() != 0 );
+
+	int numLayers	= _layers.size();
+	int numOutputs	= _nodeCount[numLayers-1];
+
+	// allocates only on first use of a workspace
+	ws.reserve( _nodeCount, n, false );
+
+	forward( ws, in, n );
+
+	const T* result = (numLayers > 1) ? ws.values(numLayers-1) : in;
+	memcpy( out, result, (size_t)n * numOutputs * sizeof(T) );
+}
+
+
+//====================================================================
+// Forward pass of n samples using caller supplied workspace
+//====================================================================	
+template <class T>
+void BPNetT<T>::forward( Workspace& ws, const T* inputs, int n ) const
+{
+	assert( ws.numLayers() == (int)_layers.size() && ws.batchCapacity() >= n );
+
+	int numLayers = _layers.size();
+	for (int i = 1; i < numLayers; ++i)
+	{
+		BPSTATS( uint64_t start = BPStats::now() );
+
+		_layers[i].runBatch( inputs, ws.values(i), 0, n );
+		inputs = ws.values(i);
+
+		BPSTATS( _stats.addTime(BPStats::FORWARD, i, start) );
+		BPSTATS( _stats.addSamples(i, n) );
+	}
+}
+
+
+//====================================================================
+// Backward pass of n samples using caller supplied workspace
+//====================================================================	
+template <class T>
+double BPNetT<T>::backward( Workspace& ws, const T* inputs, int n ) const
+{
+	assert( ws.numLayers() == (int)_layers.size() && ws.batchCapacity() >= n && ws.hasGradients() );
+
+	int numLayers = _layers.size();
+	if ( numLayers < 2 )
+		return 0;
+
+	// compute errors of all layers
+	BPSTATS( uint64_t start = BPStats::now() );
+
+	int		last		= numLayers-1;
+	double	sumSquared	= _layers[last].computeOutputErrorBatch( ws.values(last), ws.errors(last), n );
+
+	BPSTATS( _stats.addTime(BPStats::BACKWARD, last, start) );
+
+	for (int i = last-1; i >= 1; --i)
+	{
+		BPSTATS( start = BPStats::now() );
+
+		_layers[i].computeErrorBatch( _layers[i+1], ws.errors(i+1), ws.values(i), ws.errors(i), 0, n );
+
+		BPSTATS( _stats.addTime(BPStats::BACKWARD, i, start) );
+	}
+
+	// sum weight gradients
+	ws.zeroGradients();
+	for (int i = 1; i < numLayers; ++i)
+	{
+		BPSTATS( start = BPStats::now() );
+
+		const T* in = (i == 1) ? inputs : ws.values(i-1);
+		_layers[i].accumulateGradient( in, ws.errors(i), n, ws.gradient(i), ws.biasGradient(i), 0, _layers[i].numNodes() );
+
+		BPSTATS( _stats.addTime(BPStats::UPDATE, i, start) );
+	}
+
+	ws.setSumSquaredError(sumSquared);
+
+	return sumSquared;
+}
+
+
+//====================================================================
+// Adjust weights with gradients summed in a workspace
+//====================================================================	
+template <class T>
+void BPNetT<T>::applyGradients( const Workspace& ws )
+{
+	assert( ws.numLayers() == (int)_layers.size() && ws.hasGradients() );
+
+	BPOptimizer::Step step = beginUpdate();
+
+	int numLayers = _layers.size();
+	for (int i = 1; i < numLayers; ++i)
+	{
+		BPSTATS( uint64_t start = BPStats::now() );
+
+		_layers[i].applyGradient( ws.gradient(i), ws.biasGradient(i), step, 0, _layers[i].numNodes() );
+
+		BPSTATS( _stats.addTime(BPStats::UPDATE, i, start) );
+	}
+}
+
+
+//====================================================================
+// Forward pass of n samples through middle and output layers
+//====================================================================	
+template <class T>
+void BPNetT<T>::runBatchLayers(Workspace& ws, const T* inputs, int n)
+{
+	// samples of a batch are split between threads
+	int numLayers = _layers.size();
+	for (int i = 1; i < numLayers; ++i)
+	{
+		const Layer&	layer	= _layers[i];
+		T*				out		= ws.values(i);
+
+		BPSTATS( uint64_t start = BPStats::now() );
+
+		if ( useThreads( layer.weightCount() * n ) )
+			_pPool->parallelFor( n, [&](int first, int last) { layer.runBatch(inputs, out, first, last); } );
+		else
+			layer.runBatch(inputs, out, 0, n);
+
+		BPSTATS( _stats.addTime(BPStats::FORWARD, i, start) );
+		BPSTATS( _stats.addSamples(i, n) );
+
+		inputs = out;
+	}
+}
+
+
+//====================================================================
+// Run batch - forward pass of n patterns
+//====================================================================	
+template <class T>
+void BPNetT<T>::runBatch( const Pattern* const* batch, size_t n, T* outputs )
+{
+	assert ( batch != NULL && _nodeCount.size() != 0 );
+
+	int numLayers	= _layers.size();
+	int numInputs	= _nodeCount[0];
+	int numOutputs	= _nodeCount[numLayers-1];
+	int batchSize	= ( _batchSize > 0 && (size_t)_batchSize < n ) ? _batchSize : (int)n;
+
+	_batch.reserve(_nodeCount, batchSize, false);
+
+	for (size_t first = 0; first < n; first += batchSize)
+	{
+		int count = (int)( (n - first < (size_t)batchSize) ? n - first : batchSize );
+
+		// copy pattern inputs to input layer batch
+		T* in = _batch.values(0);
+		for (int s = 0; s != count; ++s, in += numInputs)
+		{
+			const Pattern* pattern = batch[first + s];
+			assert ( pattern != NULL && pattern->inSize() == numInputs );
+
+			memcpy( in, pattern->inputs(), numInputs * sizeof(T) );
+		}
+
+		runBatchLayers( _batch, _batch.values(0), count );
+
+		if ( outputs != NULL )
+		{
+			memcpy( outputs + first * numOutputs, _batch.values(numLayers-1),
+					count * numOutputs * sizeof(T) );
+		}
+	}
+}
+
+
+//====================================================================
+// Run batch - forward pass of n input rows
+//====================================================================	
+template <class T>
+void BPNetT<T>::runBatch( const T* inputs, size_t n, T* outputs )
+{
+	assert ( inputs != NULL && outputs != NULL && _nodeCount.size() != 0 );
+
+	int numLayers	= _layers.size();
+	int numInputs	= _nodeCount[0];
+	int numOutputs	= _nodeCount[numLayers-1];
+	int batchSize	= ( _batchSize > 0 && (size_t)_batchSize < n ) ? _batchSize : (int)n;
+
+	if ( numLayers == 1 )
+	{
+		memcpy( outputs, inputs, n * numInputs * sizeof(T) );
+		return;
+	}
+
+	_batch.reserve(_nodeCount, batchSize, false);
+
+	for (size_t first = 0; first < n; first += batchSize)
+	{
+		int count = (int)( (n - first < (size_t)batchSize) ? n - first : batchSize );
+
+		runBatchLayers( _batch, inputs + first * numInputs, count );
+
+		memcpy( outputs + first * numOutputs, _batch.values(numLayers-1),
+				count * numOutputs * sizeof(T) );
+	}
+}
+
+
+//====================================================================
+// Train on patterns in a given order, online or in mini-batches
+//====================================================================	
+template <class T>
+double BPNetT<T>::trainPatterns( const Pattern* const* patterns, size_t n, int batchSize )
+{
+	assert( patterns != NULL && batchSize > 0 );
+
+	double sumSquared = 0;
+
+	if ( batchSize > 1 )
+	{
+		for (size_t first = 0; first < n; first += batchSize)
+		{
+			size_t count = (n - first < (size_t)batchSize) ? n - first : batchSize;
+
+			sumSquared += trainBatch( patterns + first, count );
+		}
+
+		return sumSquared;
+	}
+
+	// online training
+	int numOutputs = _nodeCount[_nodeCount.size() - 1];
+	for (size_t s = 0; s != n; ++s)
+	{
+		const Pattern* pattern = patterns[s];
+
+		setInput(pattern);
+		run();
+
+		for (int i = 0; i != numOutputs; ++i)
+		{
+			double diff = pattern->getOutput(i) - getOutput(i);
+			sumSquared += diff * diff;
+		}
+
+		setError(pattern);
+		learn();
+	}
+
+	return sumSquared;
+}
+
+
+//====================================================================
+// Train batch - forward and backward pass of n patterns
+//====================================================================	
+template <class T>
+double BPNetT<T>::trainBatch( const Pattern* const* batch, size_t n )
+{
+	assert ( batch != NULL && _nodeCount.size() != 0 );
+
+	int numLayers	= _layers.size();
+	int numInputs	= _nodeCount[0];
+	int numOutputs	= _nodeCount[numLayers-1];
+	int batchSize	= ( _batchSize > 0 && (size_t)_batchSize < n ) ? _batchSize : (int)n;
+
+	if ( numLayers < 2 )
+		return 0; // nothing to learn
+
+	_batch.reserve(_nodeCount, batchSize, true);
+
+	double sumSquared = 0;
+	for (size_t first = 0; first < n; first += batchSize)
+	{
+		int count = (int)( (n - first < (size_t)batchSize) ? n - first : batchSize );
+
+		// copy pattern inputs to input layer batch and
+		// desired outputs to output layer batch errors
+		T* in		= _batch.values(0);
+		T* out		= _batch.errors(numLayers-1);
+		for (int s = 0; s != count; ++s, in += numInputs, out += numOutputs)
+		{
+			const Pattern* pattern = batch[first + s];
+			assert ( pattern != NULL && pattern->inSize() == numInputs && pattern->outSize() == numOutputs );
+
+			memcpy( in, pattern->inputs(), numInputs * sizeof(T) );
+			memcpy( out, pattern->outputs(), numOutputs * sizeof(T) );
+		}
+
+		// forward pass
+		runBatchLayers( _batch, _batch.values(0), count );
+
+		// compute errors of all layers before any weight is changed
+		BPSTATS( uint64_t start = BPStats::now() );
+
+		sumSquared += _layers[numLayers-1].computeOutputErrorBatch( _batch.values(numLayers-1),
+																	_batch.errors(numLayers-1), count );
+
+		BPSTATS( _stats.addTime(BPStats::BACKWARD, numLayers-1, start) );
+
+		for (int i = numLayers-2; i >= 1; --i)
+		{
+			const Layer&	layer		= _layers[i];
+			const Layer&	next		= _layers[i+1];
+			const T*		nextErr		= _batch.errors(i+1);
+			const T*		values		= _batch.values(i);
+			T*				err			= _batch.errors(i);
+
+			BPSTATS( start = BPStats::now() );
+
+			if ( useThreads( next.weightCount() * count ) )
+				_pPool->parallelFor( count, [&](int first, int last) { layer.computeErrorBatch(next, nextErr, values, err, first, last); } );
+			else
+				layer.computeErrorBatch(next, nextErr, values, err, 0, count);
+
+			BPSTATS( _stats.addTime(BPStats::BACKWARD, i, start) );
+		}
+
+		// one weight adjustment per layer
+		// (rows of the weight matrix are split between threads)
+		BPOptimizer::Step update = beginUpdate();
+
+		for (int i = numLayers-1; i >= 1; --i)
+		{
+			Layer&			layer	= _layers[i];
+			const T*		in		= _batch.values(i-1);
+			const T*		err		= _batch.errors(i);
+			T*				g		= _batch.gradient(i);
+			T*				gb		= _batch.biasGradient(i);
+
+			auto step = [&](int first, int last)
+			{
+				memset( g + (size_t)first * layer.numInputs(), 0, (size_t)(last - first) * layer.numInputs() * sizeof(T) );
+				memset( gb + first, 0, (last - first) * sizeof(T) );
+				layer.accumulateGradient(in, err, count, g, gb, first, last);
+				layer.applyGradient(g, gb, update, first, last);
+			};
+
+			BPSTATS( start = BPStats::now() );
+
+			if ( useThreads( layer.weightCount() * count ) )
+				_pPool->parallelFor( layer.numNodes(), step );
+			else
+				step( 0, layer.numNodes() );
+
+			BPSTATS( _stats.addTime(BPStats::UPDATE, i, start) );
+		}
+	}
+
+	return sumSquared;
+}
+
+
+//====================================================================
+// Save network to file
+//====================================================================
+template <class T>
+bool BPNetT<T>::save( ofstream &ost ) const
+{
+	if ( !ost.good() )
+		return false;
+
+	int numLayers = _nodeCount.size();
+	int numNodes = 0;
+	int numLinks = 0;
+	for (int i = 0; i != numLayers; ++i)
+	{
+		numNodes += _layers[i].numNodes();
+		numLinks += _layers[i].numNodes() * _layers[i].numInputs();
+	}
+
+	ost << numLayers << endl; // num layers
+	
+	for(int i = 0; i != numLayers; ++i)
+		ost << _nodeCount[i] << endl; // number of nodes in each layer
+	
+	ost << numNodes << endl; // total number of nodes
+	ost << numLinks << endl; // total number of links
+
+	// save nodes data
+	int nodeId = 0;
+	for (int i = 0; i != numLayers; ++i)
+	{
+		const Layer& layer = _layers[i];
+		for (int j = 0; j != layer.numNodes(); ++j)
+		{
+			ost << setw(4) << nodeId++ << endl;						// id
+			ost << setprecision(16) << _lr << endl;					// learning rate
+			ost << setprecision(16) << _mt << endl;					// momentum
+			ost << setprecision(16) << layer.getValue(j) << endl;	// value
+			ost << setprecision(16) << layer.getError(j) << endl;	// error
+		}
+	}
+
+	// save links data
+	int linkId		= 0;
+	int inLayer		= 0;				// id of first node in previous layer
+	int outLayer	= _firstMiddleNode;	// id of first node in current layer
+	for (int i = 1; i < numLayers; ++i)
+	{
+		const Layer& layer = _layers[i];
+		for (int j = 0; j != layer.numNodes(); ++j)
+			for (int k = 0; k != layer.numInputs(); ++k)
+			{
+				ost << setw(4) << linkId++ <<  " " << setprecision(16)	// id
+					<< layer.getWeight(j, k) << " " << setprecision(16)	// weight
+					<< layer.getDelta(j, k)  << " " << setw(4)			// delta
+					<< inLayer + k << " "								// in	 node ID
+					<< setw(4) << outLayer + j << endl;					// out node ID
+			}
+
+		inLayer = outLayer;
+		outLayer += layer.numNodes();
+	}
+
+	// save transfer functions, only if a layer is not sigmoid
+	// (files of sigmoid networks keep the original format)
+	bool sigmoid = true;
+	for (int i = 1; i < numLayers; ++i)
+		sigmoid = sigmoid && ( _layers[i].getActivation() == BPActivation::SIGMOID );
+
+	if ( !sigmoid )
+	{
+		ost << "activations";
+		for (int i = 0; i != numLayers; ++i)
+			ost << " " << BPActivation::name( _layers[i].getActivation() );
+		ost << endl;
+	}
+
+	// save node biases, only if the network has them
+	if ( _bias )
+	{
+		ost << "bias" << endl;
+
+		int nodeId = _firstMiddleNode;
+		for (int i = 1; i < numLayers; ++i)
+		{
+			const Layer& layer = _layers[i];
+			for (int j = 0; j != layer.numNodes(); ++j)
+			{
+				ost << setw(4) << nodeId++ << " " << setprecision(16)	// id
+					<< layer.getBias(j) << " " << setprecision(16)		// bias
+					<< layer.getBiasDelta(j) << endl;					// delta
+			}
+		}
+	}
+
+	// save initialization seed and scheme, only if the seed was set
+	// or the scheme is not the original one
+	if ( _seeded || _weightInit != BPRandom::UNIFORM )
+	{
+		ost << "seed " << _seed << " " << BPRandom::name(_weightInit)
+			<< " " << ( _seeded ? 1 : 0 ) << endl;
+	}
+
+	// save update rule and its state, only if it is not SGD
+	BPOptimizer::Type optimizer = _optimizer.getType();
+	if ( optimizer != BPOptimizer::SGD )
+	{
+		ost << "optimizer " << BPOptimizer::name(optimizer) << " " << setprecision(16)
+			<< _optimizer.getBeta1() << " " << setprecision(16)
+			<< _optimizer.getBeta2() << " " << setprecision(16)
+			<< _optimizer.getEpsilon() << " "
+			<< _optimizer.getSteps() << endl;
+	}
+
+	if ( BPOptimizer::hasMoments(optimizer) )
+	{
+		ost << "moments" << endl;
+
+		int linkId = 0;
+		for (int i = 1; i < numLayers; ++i)
+		{
+			const Layer&	layer	= _layers[i];
+			size_t			count	= layer.weightCount();
+			for (size_t k = 0; k != count; ++k)
+				ost << setw(4) << linkId++ << " " << setprecision(16) << layer.moments()[k] << endl;
+		}
+
+		int nodeId = _firstMiddleNode;
+		for (int i = 1; i < numLayers && _bias; ++i)
+		{
+			const Layer& layer = _layers[i];
+			for (int j = 0; j != layer.numNodes(); ++j)
+				ost << setw(4) << nodeId++ << " " << setprecision(16) << layer.biasMoments()[j] << endl;
+		}
+	}
+	
+	if (!ost.good())
+		return false;
+
+	return true;
+}
+
+
+//====================================================================
+// Load network from file
+//====================================================================
+template <class T>
+bool BPNetT<T>::load( ifstream &ist )
+{
+	if ( !ist.good() )
+		return false;
+	
+	int numLayers	= 0;
+	int numNodes	= 0;
+	int numLinks	= 0;
+
+	ist >> numLayers;	// num layers
+	
+	vector<int> layers(numLayers);
+	for(int i = 0; i != numLayers; ++i)
+		ist >> layers[i];	// number of nodes in each layer
+
+	ist >> numNodes;
+	ist >> numLinks;
+
+	// create network structure (layers), the weights are read below
+	createLayers(0, 0, layers, vector<BPActivation::Type>(numLayers, BPActivation::SIGMOID), false,
+				 BPOptimizer(), true);
+
+	_seeded		= false;
+	_weightInit	= BPRandom::UNIFORM;
+	
+	// load nodes data
+	int id;
+	T value, error;
+	for (int i = 0; i != numLayers; ++i)
+	{
+		Layer& layer = _layers[i];
+		for (int j = 0; j != layer.numNodes(); ++j)
+		{
+			ist >> id;		// id
+			ist >> _lr;		// learning rate
+			ist >> _mt;		// momentum
+			ist >> value;	// value
+			ist >> error;	// error
+
+			layer.setValue(j, value);
+			layer.setError(j, error);
+		}
+	}
+
+	// load links data
+	// the link connections are implied by the layer structure,
+	// in/out node ids are read and ignored.
+	T weight, delta;
+	int inNodeId, outNodeId;
+	for (int i = 1; i < numLayers; ++i)
+	{
+		Layer& layer = _layers[i];
+		for (int j = 0; j != layer.numNodes(); ++j)
+			for (int k = 0; k != layer.numInputs(); ++k)
+			{
+				ist >> id;			// id
+				ist >> weight;		// weight
+				ist >> delta;		// delta
+				ist >> inNodeId;	// in  node ID
+				ist >> outNodeId;	// out node ID
+
+				layer.setWeight(j, k, weight);
+				layer.setDelta(j, k, delta);
+			}
+	}
+
+
+	if (!ist.good())
+		return false;
+
+	// optional transfer functions, biases, seed and optimizer state (see save),
+	// the stream is left after the last one found
+	for (;;)
+	{
+		streampos	pos = ist.tellg();
+		string		tag;
+		if ( !(ist >> tag) || (tag != "activations" && tag != "bias" && tag != "seed" &&
+							   tag != "optimizer" && tag != "moments") )
+		{
+			ist.clear();
+			ist.seekg(pos);
+			return true;
+		}
+
+		if ( tag == "activations" )
+		{
+			for (int i = 0; i != numLayers; ++i)
+			{
+				string name;
+				ist >> name;
+
+				int type = 0;
+				while ( BPActivation::isValid(type) && name != BPActivation::name((BPActivation::Type)type) )
+					++type;
+
+				// softmax only normalizes the output layer
+				if ( !BPActivation::isValid(type) || (i == 0 && type != BPActivation::SIGMOID) ||
+					 (!BPActivation::elementwise((BPActivation::Type)type) && i != numLayers - 1) )
+					return false;
+
+				if ( i > 0 )
+					setActivation(i, (BPActivation::Type)type);
+			}
+		}
+		else if ( tag == "seed" )
+		{
+			uint64_t	seed;
+			string		name;
+			int			seeded;
+			ist >> seed >> name >> seeded;
+
+			BPRandom::Init init;
+			if ( !BPRandom::parse(name.c_str(), init) )
+				return false;
+
+			_seed		= seed;
+			_seeded		= ( seeded != 0 );
+			_weightInit	= init;
+		}
+		else if ( tag == "optimizer" )
+		{
+			string			name;
+			double			beta1, beta2, epsilon;
+			unsigned long	steps;
+			ist >> name >> beta1 >> beta2 >> epsilon >> steps;
+
+			BPOptimizer			optimizer;
+			BPOptimizer::Type	type;
+			if ( !BPOptimizer::parse(name.c_str(), type) )
+				return false;
+
+			optimizer.setType(type);
+			optimizer.setBeta1(beta1);
+			optimizer.setBeta2(beta2);
+			optimizer.setEpsilon(epsilon);
+			optimizer.setSteps(steps);
+			setOptimizer(optimizer);
+		}
+		else if ( tag == "moments" )
+		{
+			// written after the optimizer and biases
+			if ( !BPOptimizer::hasMoments(_optimizer.getType()) )
+				return false;
+
+			T moment;
+			for (int i = 1; i < numLayers; ++i)
+			{
+				Layer&	layer	= _layers[i];
+				size_t	count	= layer.weightCount();
+				for (size_t k = 0; k != count; ++k)
+				{
+					ist >> id >> moment;
+					layer.moments()[k] = moment;
+				}
+			}
+
+			for (int i = 1; i < numLayers && _bias; ++i)
+			{
+				Layer& layer = _layers[i];
+				for (int j = 0; j != layer.numNodes(); ++j)
+				{
+					ist >> id >> moment;
+					layer.biasMoments()[j] = moment;
+				}
+			}
+		}
+		else
+		{
+			enableBias(true);
+
+			T bias;
+			for (int i = 1; i < numLayers; ++i)
+			{
+				Layer& layer = _layers[i];
+				for (int j = 0; j != layer.numNodes(); ++j)
+				{
+					ist >> id;		// id
+					ist >> bias;	// bias
+					ist >> delta;	// delta
+
+					layer.setBias(j, bias);
+					layer.setBiasDelta(j, delta);
+				}
+			}
+		}
+
+		if (!ist.good())
+			return false;
+	}
+}
+
+
+//====================================================================
+// Save network in binary model format
+//====================================================================
+template <class T>
+bool BPNetT<T>::saveBinary( const char* fileName ) const
+{
+	return BPModelFile::write(*this, fileName);
+}
+
+
+//====================================================================
+// Load network from binary model file (weights are copied)
+//====================================================================
+template <class T>
+bool BPNetT<T>::loadBinary( const char* fileName, bool verify )
+{
+	BPModelFile file;
+	if ( !file.open(fileName, verify) )
+		return false;
+
+	const BPModelHeader& header = file.header();
+
+	createLayers(header.learningRate, header.momentum, file.nodeCount(), file.activations(), file.hasBias(),
+				 file.optimizer(), true);
+
+	_seed		= file.seed();
+	_seeded		= file.hasSeed();
+	_weightInit	= file.weightInit();
+
+	// weights stored in the other precision are converted
+	int numLayers = _nodeCount.size();
+	for (int i = 1; i < numLayers; ++i)
+	{
+		Layer&	layer	= _layers[i];
+		size_t	count	= layer.weightCount();
+		size_t	nodes	= layer.numNodes();
+
+		if ( file.scalarSize() == sizeof(double) )
+		{
+			copyValues( layer.weights(), file.weights<double>(i), count );
+			copyValues( layer.deltas(),  file.deltas<double>(i),  count );
+
+			if ( _bias )
+			{
+				copyValues( layer.bias(),		file.bias<double>(i),		nodes );
+				copyValues( layer.biasDeltas(), file.biasDeltas<double>(i), nodes );
+			}
+
+			if ( file.hasMoments() && layer.moments() != NULL )
+			{
+				copyValues( layer.moments(), file.moments<double>(i), count );
+				if ( _bias )
+					copyValues( layer.biasMoments(), file.biasMoments<double>(i), nodes );
+			}
+		}
+		else
+		{
+			copyValues( layer.weights(), file.weights<float>(i), count );
+			copyValues( layer.deltas(),  file.deltas<float>(i),  count );
+
+			if ( _bias )
+			{
+				copyValues( layer.bias(),		file.bias<float>(i),		nodes );
+				copyValues( layer.biasDeltas(), file.biasDeltas<float>(i),	nodes );
+			}
+
+			if ( file.hasMoments() && layer.moments() != NULL )
+			{
+				copyValues( layer.moments(), file.moments<float>(i), count );
+				if ( _bias )
+					copyValues( layer.biasMoments(), file.biasMoments<float>(i), nodes );
+			}
+		}
+	}
+
+	return true;
+}
+
+
+//====================================================================
+// Use weights of a binary model file straight from the mapping
+//====================================================================
+template <class T>
+bool BPNetT<T>::mapBinary( const char* fileName, bool verify )
+{
+	shared_ptr<BPModelFile> file(new BPModelFile);
+	if ( !file->open(fileName, verify) )
+		return false;
+
+	// weights are used in place, precision must match
+	if ( file->scalarSize() != sizeof(T) )
+		return false;
+
+	const BPModelHeader& header = file->header();
+
+	createLayers(header.learningRate, header.momentum, file->nodeCount(), file->activations(), file->hasBias(),
+				 file->optimizer(), false);
+
+	_seed		= file->seed();
+	_seeded		= file->hasSeed();
+	_weightInit	= file->weightInit();
+
+	// moments of files without them are allocated by the layers
+	int numLayers = _nodeCount.size();
+	for (int i = 1; i < numLayers; ++i)
+	{
+		_layers[i].attach( file->weights<T>(i), file->deltas<T>(i), file->bias<T>(i), file->biasDeltas<T>(i),
+						   file->moments<T>(i), file->biasMoments<T>(i) );
+	}
+
+	_modelFile = file;
+
+	return true;
+}
+
+
+// explicit instantiation
+template class BPNetT<double>;
+template class BPNetT<float>;
\ No newline at end of file
@@ -1,87 +1,322 @@
-// BPNet.h: interface for the BPNet class.
-//
-// Copyright Gideon Pertzov, 2003
-//
-// This software is provided "as is" without express or implied
-// warranties. You may freely copy and compile this source into
-// applications you distribute provided that credit is given to
-// the original author.
-//
-//////////////////////////////////////////////////////////////////////
-
-#ifndef _BPNET_H
-#define _BPNET_H
-
-#include <cmath>
-#include <vector>
-#include "Pattern.h"
-using namespace std;
-
-class BPLink;
-class BPNode;
-
-class BPNet  
-{
-// Methods
-public:
-	virtual ~BPNet();	// destructor
-	BPNet();			// default c-tor	
-	BPNet( double lr, double mt, int layers, ... ); // c-tor with network parameters
-	
-	// create network structure
-	void	createNetwork( double lr, double mt, const vector<int>& nodeCnt);
-
-	// forward-pass
-	void	run();	
-
-	// backward-pass
-	void	learn();
-
-	// get number of layers 
-	int		getNumLayers()	{ return _nodeCount.size(); }
-
-	// get numer of nodes in a specific layer
-	int		getNumNodes(int layerIndex);
-
-	// set values of input nodes
-	void	setInput(double value, int inputNodeIndex);
-	void	setInput( const Pattern* pattern );
-
-	// set desired output for error computation
-	void	setError(double value, int outputNodeIndex);
-	void	setError( const Pattern* pattern);
-
-	// get values/errors of output nodes
-	double	getOutput(int outputNodeIndex)	const;
-	double	getError(int outputNodeIndex)	const;
-
-	// set training parameters
-	void	setLearningRate(double lr);
-	void	setMomentum(double mt);
-
-	// get training parameters
-	double	getLearningRate();
-	double	getMomentum();
-
-	// save/load network
-	bool save( ofstream &ost ) const;
-	bool load( ifstream &ist );
-
-protected:
-
-	// cleanup
-	void destroyNetwork();
-
-
-// Members
-protected:
-	
-	int				_firstMiddleNode;	// index of first node in middle layer
-	int				_firstOutputNode;	// index of first node in output layer
-
-	vector<int>		_nodeCount;		// stores number of nodes in each layer
-	vector<BPNode*>	_nodes;			// vector of network nodes
-	vector<BPLink*> _links;			// vector of links between nodes
-};
-
-#endif // _BPNET_H
+// BPNet.h: interface for the BPNet class.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+
+#ifndef _BPNET_H
+#define _BPNET_H
+
+#include <cmath>
+#include <vector>
+#include <memory>
+#include <fstream>
+#include "Pattern.h"
+#include "BPLayer.h"
+#include "BPWorkspace.h"
+#include "BPStats.h"
+using namespace std;
+
+class BPLink;
+class BPNode;
+class BPThreadPool;
+class BPModelFile;
+
+template <class T>
+class BPNetT  
+{
+// Types
+public:
+	typedef PatternT<T>		Pattern;	// pattern of the same precision
+	typedef BPLayerT<T>		Layer;		// dense layer storage
+
+	// per-thread scratch storage for predict()
+	typedef BPWorkspaceT<T>	Workspace;
+
+// Methods
+public:
+	virtual ~BPNetT();	// destructor
+	BPNetT();			// default c-tor	
+	BPNetT( double lr, double mt, int layers, ... ); // c-tor with network parameters
+
+	// copies hold the weights, optimizer state and node values in their
+	// own storage (also of a mapped network) and get their own thread
+	// pool if the network owns one. the graph view is not copied
+	BPNetT( const BPNetT& other );
+	BPNetT& operator=( const BPNetT& other );
+	
+	// create network structure (all layers sigmoid)
+	void	createNetwork( double lr, double mt, const vector<int>& nodeCnt);
+
+	// create network structure with the transfer function of each layer
+	// (one entry per layer, the entry of the input layer is not used,
+	// SOFTMAX is only valid for the output layer)
+	void	createNetwork( double lr, double mt, const vector<int>& nodeCnt,
+						   const vector<BPActivation::Type>& activations );
+
+	// set seed of weight initialization: networks created afterwards get
+	// the same weights for the same seed and structure, on any number of
+	// threads. without a seed every createNetwork draws a new one
+	void		setSeed(uint64_t seed);
+	uint64_t	getSeed() const		{ return _seed; }
+
+	// was the seed set (by setSeed or from a model file)
+	bool		hasSeed() const		{ return _seeded; }
+
+	// set/get weight initialization scheme used by createNetwork
+	// (see BPRandom, UNIFORM - original [-1, 1] range)
+	void			setWeightInit(BPRandom::Init init);
+	BPRandom::Init	getWeightInit() const	{ return _weightInit; }
+
+	// initialize weights from the seed, biases and optimizer state are zeroed
+	void	initWeights();
+
+	// start over with a seed: weights are initialized as createNetwork
+	// would with this seed, biases, optimizer state and node values are
+	// zeroed. the network keeps its storage, nothing is allocated
+	void	reset(uint64_t seed);
+
+	// forward-pass
+	void	run();	
+
+	// backward-pass
+	void	learn();
+
+	// set/get legacy ordering of learn(). by default the errors of all
+	// layers are computed before any weight is adjusted (the gradient of
+	// the current weights). the legacy ordering adjusts the weights of
+	// each layer before the error of the previous layer is computed
+	// through them, as the original BPNode code did
+	void	setLegacyOrder(bool legacy)		{ _legacyOrder = legacy; }
+	bool	getLegacyOrder() const			{ return _legacyOrder; }
+
+	// set/get mini-batch size used by runBatch/trainBatch
+	// (0 - process all given patterns as a single batch)
+	void	setBatchSize(int size);
+	int		getBatchSize() const	{ return _batchSize; }
+
+	// forward-pass of n patterns.
+	// if outputs is not NULL it receives n rows of output node values
+	void	runBatch( const Pattern* const* batch, size_t n, T* outputs = NULL );
+	void	runBatch( const T* inputs, size_t n, T* outputs );
+
+	// allocate a workspace for predicting up to batchSize samples at once
+	void	createWorkspace( Workspace& ws, int batchSize = 1 ) const;
+
+	// thread-safe inference: evaluate one input row (n rows) into out.
+	// all intermediate values are kept in the caller's workspace, so any
+	// number of threads may predict concurrently, each with its own workspace.
+	// no memory is allocated once the workspace was created for this network.
+	void	predict( const T* in, T* out, Workspace& ws ) const				{ predict(in, out, 1, ws); }
+	void	predict( const T* in, T* out, int n, Workspace& ws ) const;
+
+	// evaluate n input rows using caller supplied workspace
+	// (runs on the calling thread only and does not modify the network)
+	void	forward( Workspace& ws, const T* inputs, int n ) const;
+
+	// compute errors and summed weight gradients of the n samples last
+	// evaluated by forward(). desired outputs must be stored in the
+	// output layer errors of the workspace. returns sum of squared errors
+	double	backward( Workspace& ws, const T* inputs, int n ) const;
+
+	// adjust weights with the gradients summed in a workspace
+	void	applyGradients( const Workspace& ws );
+
+	// use an external thread pool to evaluate layers (pool is not owned, NULL - single thread)
+	void	setThreadPool(BPThreadPool* pool);
+
+	// create a thread pool owned by the network (0 - one thread per core, 1 - single thread)
+	void	setNumThreads(int numThreads);
+
+	// get thread pool used to evaluate layers (NULL if single threaded)
+	BPThreadPool*	getThreadPool() const	{ return _pPool; }
+
+	// set/get minimal amount of work (number of link weights, times number of
+	// samples in batch mode) for a layer to be split between threads
+	void	setParallelThreshold(int numWeights);
+	int		getParallelThreshold() const	{ return _parallelThreshold; }
+
+	// train on n patterns: errors of each mini-batch are computed in one
+	// pass, gradients are summed and weights are adjusted once per mini-batch.
+	// returns sum of squared output errors (before adjustment)
+	double	trainBatch( const Pattern* const* batch, size_t n );
+
+	// train on n patterns in the given order, online with run()/learn()
+	// if batchSize is 1, otherwise with trainBatch() on each batchSize
+	// patterns. returns sum of squared output errors (before adjustment)
+	double	trainPatterns( const Pattern* const* patterns, size_t n, int batchSize );
+
+	// get number of layers 
+	int		getNumLayers()	const	{ return _nodeCount.size(); }
+
+	// get number of nodes in each layer
+	const vector<int>&	getNodeCount() const	{ return _nodeCount; }
+
+	// get numer of nodes in a specific layer
+	int		getNumNodes(int layerIndex) const;
+
+	// set values of input nodes
+	void	setInput(T value, int inputNodeIndex);
+	void	setInput( const Pattern* pattern );
+
+	// set desired output for error computation
+	void	setError(T value, int outputNodeIndex);
+	void	setError( const Pattern* pattern);
+
+	// get values/errors of output nodes
+	T		getOutput(int outputNodeIndex)	const;
+	T		getError(int outputNodeIndex)	const;
+
+	// set training parameters
+	void	setLearningRate(double lr);
+	void	setMomentum(double mt);
+
+	// get training parameters
+	double	getLearningRate() const;
+	double	getMomentum() const;
+
+	// select weight update rule (see BPOptimizer) with its default
+	// hyper-parameters. deltas and moments of all layers are zeroed and
+	// the step count is reset. createNetwork keeps the selected rule
+	void	setOptimizer(BPOptimizer::Type type);
+
+	// set update rule with its hyper-parameters and step count, the
+	// deltas and moments of the layers are kept (e.g. to resume training)
+	void	setOptimizer(const BPOptimizer& optimizer);
+
+	// get update rule and hyper-parameters
+	const BPOptimizer&	getOptimizer() const	{ return _optimizer; }
+
+	// count a weight update and get its parameters, for trainers
+	// that adjust the layers themselves (see BPLayer::applyGradient)
+	BPOptimizer::Step	beginUpdate()
+	{
+		BPSTATS( _stats.addUpdates(1) );
+		return _optimizer.nextStep(_lr, _mt);
+	}
+
+	// get per-layer timing and update counters (see BPStats). counters
+	// are recorded only when built with BPNET_STATS, otherwise all 0
+	BPStats::Snapshot	stats() const	{ return _stats.snapshot(); }
+
+	// zero all counters
+	void	resetStats()				{ _stats.reset(); }
+
+	// start/stop hardware counters of the calling thread
+	// (false if perf events are not available)
+	bool	enableHardwareStats(bool enable)	{ return _stats.enableHardware(enable); }
+
+	// counters, for trainers recording their own time (e.g. pattern I/O)
+	BPStats&	getStats()			{ return _stats; }
+
+	// add a bias to every node of the middle and output layers (biases
+	// start at zero and are trained like the weights), or remove them
+	void	enableBias(bool enable);
+	bool	hasBias() const		{ return _bias; }
+
+	// set/get transfer function of a layer
+	void				setActivation(int layerIndex, BPActivation::Type type);
+	BPActivation::Type	getActivation(int layerIndex) const;
+
+	// set/get sigmoid evaluation mode of all layers (see BPKernels).
+	// SIGMOID_EXACT (default) reproduces the original results
+	void				setSigmoid(BPKernels::Sigmoid mode);
+	BPKernels::Sigmoid	getSigmoid() const	{ return _sigmoid; }
+
+	// save/load network
+	bool save( ofstream &ost ) const;
+	bool load( ifstream &ist );
+
+	// save/load network in binary model format (see BPModelFile.h).
+	// node values/errors are not part of the binary format
+	bool saveBinary( const char* fileName ) const;
+	bool loadBinary( const char* fileName, bool verify = true );
+
+	// use weights of a binary model file directly from a memory mapping
+	// (no copy). the mapping is kept until the network is destroyed or
+	// recreated, trained weights are never written back to the file
+	bool mapBinary( const char* fileName, bool verify = true );
+
+	// get dense storage of a specific layer
+	Layer&			getLayer(int layerIndex);
+	const Layer&	getLayer(int layerIndex) const;
+
+	// debugging view: build BPNode/BPLink graph mirroring current network state
+	void	buildGraphView();
+
+	// get nodes/links of graph view (valid until next buildGraphView() call)
+	int		getNumGraphNodes()	const	{ return _nodes.size(); }
+	int		getNumGraphLinks()	const	{ return _links.size(); }
+	const BPNode*	getGraphNode(int index) const;
+	const BPLink*	getGraphLink(int index) const;
+
+protected:
+
+	// create layers without initializing weights if allocateWeights is false
+	void createLayers( double lr, double mt, const vector<int>& nodeCnt,
+					   const vector<BPActivation::Type>& activations, bool bias,
+					   const BPOptimizer& optimizer, bool allocateWeights );
+
+	// cleanup
+	void destroyNetwork();
+	void destroyGraphView();
+
+	// forward-pass of n samples using the thread pool
+	void runBatchLayers(Workspace& ws, const T* inputs, int n);
+
+	// backward-pass with the legacy ordering (see setLegacyOrder)
+	void learnLegacy(const BPOptimizer::Step& step);
+
+	// adjust weights of nodes [first, last), numbered over the middle
+	// and output layers, with the errors computed by learn()
+	void learnNodes(const BPOptimizer::Step& step, int first, int last);
+
+	// should a layer step with the given amount of work run on the thread pool
+	bool useThreads(size_t work) const;
+
+
+// Members
+protected:
+	
+	int				_firstMiddleNode;	// index of first node in middle layer
+	int				_firstOutputNode;	// index of first node in output layer
+
+	double			_lr;			// learning rate
+	double			_mt;			// momentum
+	int				_batchSize;		// mini-batch size (0 - unlimited)
+	bool			_bias;			// nodes have a bias
+	bool			_legacyOrder;	// learn() with legacy ordering
+	BPOptimizer		_optimizer;		// weight update rule
+	mutable BPStats	_stats;			// hot path counters (recorded by const passes too)
+	uint64_t		_seed;			// weight initialization seed
+	bool			_seeded;		// seed was set, createNetwork doesn't draw one
+	BPRandom::Init	_weightInit;	// weight initialization scheme
+
+	BPKernels::Sigmoid	_sigmoid;	// sigmoid evaluation mode
+
+	BPThreadPool*				_pPool;				// thread pool used for layers (may be NULL)
+	shared_ptr<BPThreadPool>	_ownedPool;			// pool created by setNumThreads()
+	int							_parallelThreshold;	// minimal work for multithreaded layer
+
+	Workspace		_batch;			// storage used by runBatch/trainBatch
+
+	vector<int>		_nodeCount;		// stores number of nodes in each layer
+	vector<Layer>	_layers;		// dense storage of each layer
+	BPBuffer<T>		_arena;			// storage of all layers (see createLayers)
+
+	shared_ptr<BPModelFile>	_modelFile;	// mapped model file (see mapBinary)
+
+	vector<BPNode*>	_nodes;			// graph view nodes (see buildGraphView)
+	vector<BPLink*> _links;			// graph view links (see buildGraphView)
+};
+
+// double and float networks
+typedef BPNetT<double>	BPNet;
+typedef BPNetT<float>	BPNetF;
+
+#endif // _BPNET_H
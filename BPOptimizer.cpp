@@ -0,0 +1,108 @@
+// BPOptimizer.cpp: implementation of the BPOptimizer class.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include "BPOptimizer.h"
+
+
+//////////////////////////////////////////////////////////////////////
+// Construction/Destruction
+//////////////////////////////////////////////////////////////////////
+
+BPOptimizer::BPOptimizer()
+{
+	setType(SGD);
+}
+
+
+//====================================================================
+// Select update rule with its default hyper-parameters
+//====================================================================
+void BPOptimizer::setType(Type type)
+{
+	assert( type >= SGD && type < NUM_TYPES );
+
+	_type		= type;
+	_beta1		= 0.9;
+	_beta2		= ( type == RMSPROP ) ? 0.9 : 0.999;
+	_epsilon	= 1e-8;
+	_steps		= 0;
+}
+
+
+//====================================================================
+// Count a weight update and get its parameters
+//====================================================================
+BPOptimizer::Step BPOptimizer::nextStep(double lr, double mt)
+{
+	++_steps;
+
+	Step step	= { _type, lr, mt, _beta1, _beta2, _epsilon };
+
+	// Adam moments start at zero, scale the first
+	// updates up to make up for the bias towards zero
+	if ( _type == ADAM )
+	{
+		double t	= (double)_steps;
+		step.lr		= lr * sqrt( 1.0 - pow(_beta2, t) ) / ( 1.0 - pow(_beta1, t) );
+	}
+
+	return step;
+}
+
+
+//====================================================================
+// Parameters of an SGD update
+//====================================================================
+BPOptimizer::Step BPOptimizer::sgd(double lr, double mt)
+{
+	Step step = { SGD, lr, mt, 0, 0, 0 };
+
+	return step;
+}
+
+
+//====================================================================
+// Get name of update rule
+//====================================================================
+const char* BPOptimizer::name(Type type)
+{
+	switch (type)
+	{
+	case SGD:		return "sgd";
+	case NESTEROV:	return "nesterov";
+	case RMSPROP:	return "rmsprop";
+	case ADAM:		return "adam";
+	default:		break;
+	}
+
+	return "unknown";
+}
+
+
+//====================================================================
+// Find update rule by name
+//====================================================================
+bool BPOptimizer::parse(const char* str, Type& type)
+{
+	for (int i = SGD; i != NUM_TYPES; ++i)
+	{
+		if ( strcmp(str, name((Type)i)) == 0 )
+		{
+			type = (Type)i;
+			return true;
+		}
+	}
+
+	return false;
+}
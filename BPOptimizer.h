@@ -0,0 +1,125 @@
+// BPOptimizer.h: interface for the BPOptimizer class.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+
+#ifndef _BPOPTIMIZER_H
+#define _BPOPTIMIZER_H
+
+#include <cstddef>
+#include "BPKernels.h"
+
+
+//////////////////////////////////////////////////////////////////////
+// BPOptimizer - weight update rule of a network.
+//
+// The update of every weight is computed from its gradient g (the
+// error of the node times the input value, summed over a mini-batch)
+// and up to two state values kept per weight:
+//
+//	SGD			d = lr * g + mt * d;  w += d				(original rule)
+//	NESTEROV	d = lr * g + mt * d;  w += lr * g + mt * d
+//	RMSPROP		s = b2 * s + (1 - b2) * g^2
+//				d = lr * g / (sqrt(s) + eps) + mt * d;  w += d
+//	ADAM		d = b1 * d + (1 - b1) * g
+//				s = b2 * s + (1 - b2) * g^2
+//				w += lr' * d / (sqrt(s) + eps)
+//
+// The first state is the delta (momentum) storage of the layer, the
+// second state (moments) is only allocated by RMSPROP and ADAM. Adam's
+// bias correction is folded into lr' = lr * sqrt(1 - b2^t) / (1 - b1^t)
+// where t counts the weight updates since the optimizer was selected.
+//
+// nextStep() is called once per weight update (one learn() call or one
+// mini-batch), the returned Step is then applied to every layer.
+//////////////////////////////////////////////////////////////////////
+class BPOptimizer
+{
+// Types
+public:
+	enum Type
+	{
+		SGD = 0,		// gradient descent with momentum
+		NESTEROV,		// Nesterov accelerated gradient
+		RMSPROP,		// RMSProp (with momentum)
+		ADAM,			// Adam
+		NUM_TYPES
+	};
+
+	// parameters of one weight update
+	struct Step
+	{
+		Type	type;
+		double	lr;			// learning rate (bias corrected for ADAM)
+		double	mt;			// momentum (not used by ADAM)
+		double	beta1;		// ADAM first moment decay
+		double	beta2;		// ADAM/RMSPROP squared gradient decay
+		double	epsilon;	// added to the root of the squared gradient average
+	};
+
+// Methods
+public:
+	BPOptimizer();		// default c-tor (SGD)
+
+	// select update rule, resets hyper-parameters to the
+	// defaults of the rule and the step count
+	void	setType(Type type);
+	Type	getType() const		{ return _type; }
+
+	// set/get hyper-parameters
+	void	setBeta1(double beta1)		{ _beta1 = beta1; }
+	void	setBeta2(double beta2)		{ _beta2 = beta2; }
+	void	setEpsilon(double eps)		{ _epsilon = eps; }
+	double	getBeta1()	 const			{ return _beta1; }
+	double	getBeta2()	 const			{ return _beta2; }
+	double	getEpsilon() const			{ return _epsilon; }
+
+	// set/get number of weight updates done (ADAM bias correction)
+	void			setSteps(unsigned long steps)	{ _steps = steps; }
+	unsigned long	getSteps() const				{ return _steps; }
+
+	// count a weight update and get its parameters
+	Step	nextStep(double lr, double mt);
+
+	// parameters of an SGD update (the original rule)
+	static Step	sgd(double lr, double mt);
+
+	// does the rule keep a second state (moments) per weight
+	static bool	hasMoments(Type type)	{ return type == RMSPROP || type == ADAM; }
+
+	// get name of a rule / find rule by name (false if unknown)
+	static const char*	name(Type type);
+	static bool			parse(const char* str, Type& type);
+
+	// update size weights w with gradient g, d and s are the
+	// first and second state (s is not used by SGD and NESTEROV)
+	template <class T>
+	static void	apply(const Step& step, T* w, T* d, T* s, const T* g, int size)
+	{
+		switch (step.type)
+		{
+		case NESTEROV:	BPKernels::nesterov(w, d, g, step.lr, step.mt, size);									break;
+		case RMSPROP:	BPKernels::rmsprop(w, d, s, g, step.lr, step.mt, step.beta2, step.epsilon, size);		break;
+		case ADAM:		BPKernels::adam(w, d, s, g, step.lr, step.beta1, step.beta2, step.epsilon, size);		break;
+		default:		BPKernels::apply(w, d, g, step.lr, step.mt, size);										break;
+		}
+	}
+
+// Members
+protected:
+
+	Type			_type;		// update rule
+	double			_beta1;		// first moment decay
+	double			_beta2;		// squared gradient decay
+	double			_epsilon;	// numerical stability term
+	unsigned long	_steps;		// weight updates done
+};
+
+
+#endif // _BPOPTIMIZER_H
@@ -0,0 +1,214 @@
+// BPParallelTrainer.cpp: implementation of the BPParallelTrainer class.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <cassert>
+#include <cstring>
+#include "BPParallelTrainer.h"
+#include "BPNet.h"
+#include "BPThreadPool.h"
+#include "Pattern.h"
+
+// default number of patterns per weight update
+#define DEFAULT_BATCH_SIZE	256
+
+
+//////////////////////////////////////////////////////////////////////
+// Construction/Destruction
+//////////////////////////////////////////////////////////////////////
+
+template <class T>
+BPParallelTrainerT<T>::~BPParallelTrainerT()
+{
+
+}
+
+
+template <class T>
+BPParallelTrainerT<T>::BPParallelTrainerT(Net* net, BPThreadPool* pool) :	_pNet(net),
+																			_pPool(pool),
+																			_batchSize(0)
+{
+	assert( _pNet != NULL );
+
+	if ( _pPool == NULL )
+		_pPool = _pNet->getThreadPool();
+
+	_workspaces.resize( (_pPool != NULL) ? _pPool->numThreads() : 1 );
+
+	setBatchSize(DEFAULT_BATCH_SIZE);
+}
+
+
+//====================================================================
+// Set number of patterns per weight update
+//====================================================================
+template <class T>
+void BPParallelTrainerT<T>::setBatchSize(int size)
+{
+	assert( size > 0 );
+
+	_batchSize = size;
+
+	// each thread gets at most ceil(batchSize / numThreads) patterns
+	int numThreads	= _workspaces.size();
+	int shardSize	= (_batchSize + numThreads - 1) / numThreads;
+
+	for (int t = 0; t != numThreads; ++t)
+		_workspaces[t].create( _pNet->getNodeCount(), shardSize, true );
+}
+
+
+//====================================================================
+// Train on n patterns
+//====================================================================
+template <class T>
+double BPParallelTrainerT<T>::train(const Pattern* const* patterns, size_t n)
+{
+	assert( patterns != NULL || n == 0 );
+
+	// network structure may have changed since construction
+	for (int t = 0; t != numThreads(); ++t)
+		_workspaces[t].reserve( _pNet->getNodeCount(), (_batchSize + numThreads() - 1) / numThreads(), true );
+
+	double sumSquared = 0;
+	for (size_t first = 0; first < n; first += _batchSize)
+	{
+		int count = (int)( (n - first < (size_t)_batchSize) ? n - first : _batchSize );
+
+		sumSquared += trainBatch( patterns + first, count );
+	}
+
+	return sumSquared;
+}
+
+
+//====================================================================
+// Forward/backward pass and weight update of one mini-batch
+//====================================================================
+template <class T>
+double BPParallelTrainerT<T>::trainBatch(const Pattern* const* batch, int n)
+{
+	int numThreads = _workspaces.size();
+	int numLayers  = _pNet->getNumLayers();
+
+	if ( numLayers < 2 )
+		return 0; // nothing to learn
+
+	// each thread evaluates its own shard
+	auto shards = [&](int first, int last)
+	{
+		for (int t = first; t != last; ++t)
+		{
+			int begin	= (int)( (long long)n * t		/ numThreads );
+			int end		= (int)( (long long)n * (t + 1) / numThreads );
+
+			runShard( _workspaces[t], batch + begin, end - begin );
+		}
+	};
+
+	if ( _pPool != NULL )
+		_pPool->parallelFor( numThreads, shards );
+	else
+		shards( 0, numThreads );
+
+	// sum gradients and adjust weights, weight rows are split between threads
+	BPOptimizer::Step step = _pNet->beginUpdate();
+
+	for (int i = 1; i < numLayers; ++i)
+	{
+		auto reduce = [&](int first, int last) { reduceAndApply(i, step, first, last); };
+
+		if ( _pPool != NULL )
+			_pPool->parallelFor( _pNet->getNumNodes(i), reduce );
+		else
+			reduce( 0, _pNet->getNumNodes(i) );
+	}
+
+	double sumSquared = 0;
+	for (int t = 0; t != numThreads; ++t)
+		sumSquared += _workspaces[t].sumSquaredError();
+
+	return sumSquared;
+}
+
+
+//====================================================================
+// Forward/backward pass of one shard
+//====================================================================
+template <class T>
+void BPParallelTrainerT<T>::runShard(Workspace& ws, const Pattern* const* shard, int n)
+{
+	if ( n == 0 )
+	{
+		ws.zeroGradients();
+		ws.setSumSquaredError(0);
+		return;
+	}
+
+	int numLayers	= ws.numLayers();
+	int numInputs	= ws.numNodes(0);
+	int numOutputs	= ws.numNodes(numLayers-1);
+
+	// copy pattern inputs to input layer and
+	// desired outputs to output layer errors
+	T* in		= ws.values(0);
+	T* out		= ws.errors(numLayers-1);
+	for (int s = 0; s != n; ++s, in += numInputs, out += numOutputs)
+	{
+		const Pattern* pattern = shard[s];
+		assert ( pattern != NULL && pattern->inSize() == numInputs && pattern->outSize() == numOutputs );
+
+		memcpy( in, pattern->inputs(), numInputs * sizeof(T) );
+		memcpy( out, pattern->outputs(), numOutputs * sizeof(T) );
+	}
+
+	_pNet->forward( ws, ws.values(0), n );
+	_pNet->backward( ws, ws.values(0), n );
+}
+
+
+//====================================================================
+// Sum gradients of all workspaces and adjust weights of nodes [first, last)
+//====================================================================
+template <class T>
+void BPParallelTrainerT<T>::reduceAndApply(int layer, const BPOptimizer::Step& step, int first, int last)
+{
+	BPLayerT<T>&	l			= _pNet->getLayer(layer);
+	int				numInputs	= l.numInputs();
+	size_t			begin		= (size_t)first * numInputs;
+	size_t			end			= (size_t)last * numInputs;
+
+	// sum into the first workspace
+	T* g	= _workspaces[0].gradient(layer);
+	T* gb	= _workspaces[0].biasGradient(layer);
+
+	int numThreads = _workspaces.size();
+	for (int t = 1; t < numThreads; ++t)
+	{
+		const T* gt = _workspaces[t].gradient(layer);
+		for (size_t i = begin; i != end; ++i)
+			g[i] += gt[i];
+
+		if ( l.hasBias() )
+		{
+			const T* gbt = _workspaces[t].biasGradient(layer);
+			for (int j = first; j != last; ++j)
+				gb[j] += gbt[j];
+		}
+	}
+
+	l.applyGradient( g, gb, step, first, last );
+}
+
+
+// explicit instantiation
+template class BPParallelTrainerT<double>;
+template class BPParallelTrainerT<float>;
\ No newline at end of file
@@ -0,0 +1,89 @@
+// BPParallelTrainer.h: interface for the BPParallelTrainer class.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+
+#ifndef _BPPARALLELTRAINER_H
+#define _BPPARALLELTRAINER_H
+
+#include <vector>
+#include "BPWorkspace.h"
+#include "BPOptimizer.h"
+using namespace std;
+
+template <class T> class BPNetT;
+template <class T> class PatternT;
+class BPThreadPool;
+
+
+//////////////////////////////////////////////////////////////////////
+// BPParallelTrainerT - data-parallel mini-batch training.
+//
+// Each mini-batch is split into one shard per thread. Every thread
+// runs the forward and backward pass of its shard on its own
+// workspace (activations, errors and gradients), without touching
+// the network. The per-thread gradients are then summed (each thread
+// reduces a slice of the weight rows) and the network weights are
+// adjusted once per mini-batch.
+//////////////////////////////////////////////////////////////////////
+template <class T>
+class BPParallelTrainerT
+{
+// Types
+public:
+	typedef BPNetT<T>		Net;		// trained network
+	typedef PatternT<T>		Pattern;	// pattern of the same precision
+	typedef BPWorkspaceT<T>	Workspace;	// per-thread storage
+
+// Methods
+public:
+	virtual ~BPParallelTrainerT();	// destructor
+
+	// c-tor, pool is used for the worker threads
+	// (NULL - use the network's thread pool, if any)
+	BPParallelTrainerT(Net* net, BPThreadPool* pool = NULL);
+
+	// set/get number of patterns per weight update
+	void	setBatchSize(int size);
+	int		getBatchSize() const	{ return _batchSize; }
+
+	// get number of worker threads
+	int		numThreads() const		{ return _workspaces.size(); }
+
+	// train on n patterns (in the given order), one weight update per
+	// mini-batch. returns sum of squared output errors
+	double	train(const Pattern* const* patterns, size_t n);
+
+protected:
+
+	// forward/backward pass and single weight update of one mini-batch
+	double	trainBatch(const Pattern* const* batch, int n);
+
+	// forward/backward pass of one shard on a workspace
+	void	runShard(Workspace& ws, const Pattern* const* shard, int n);
+
+	// sum gradients of all workspaces and adjust weights of a layer's nodes [first, last)
+	void	reduceAndApply(int layer, const BPOptimizer::Step& step, int first, int last);
+
+// Members
+protected:
+
+	Net*				_pNet;			// trained network
+	BPThreadPool*		_pPool;			// worker threads (may be NULL)
+	int					_batchSize;		// patterns per weight update
+	vector<Workspace>	_workspaces;	// one workspace per thread
+};
+
+
+// double and float trainers
+typedef BPParallelTrainerT<double>	BPParallelTrainer;
+typedef BPParallelTrainerT<float>	BPParallelTrainerF;
+
+
+#endif // _BPPARALLELTRAINER_H
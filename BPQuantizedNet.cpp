@@ -0,0 +1,345 @@
+// BPQuantizedNet.cpp: implementation of the BPQuantizedNet class.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include "BPQuantizedNet.h"
+#include "BPKernels.h"
+#include "BPNet.h"
+#include "PatternSet.h"
+
+// largest number of inputs of a layer (int32 sums must not overflow)
+#define MAX_INPUTS		65536
+
+
+//////////////////////////////////////////////////////////////////////
+// Construction/Destruction
+//////////////////////////////////////////////////////////////////////
+
+BPQuantizedNet::~BPQuantizedNet()
+{
+
+}
+
+
+BPQuantizedNet::BPQuantizedNet() :	_granularity(PER_ROW),
+									_sigmoid(BPKernels::SIGMOID_EXACT)
+{
+
+}
+
+
+//====================================================================
+// Quantize weights of a trained network
+//====================================================================
+template <class T>
+bool BPQuantizedNet::quantize(const BPNetT<T>& net, Granularity granularity)
+{
+	_granularity	= granularity;
+	_sigmoid		= net.getSigmoid();
+	_nodeCount		= net.getNodeCount();
+	_layers.clear();
+
+	int numLayers = _nodeCount.size();
+	if ( numLayers == 0 )
+		return false;
+
+	// int32 sums of wider layers may overflow
+	for (int i = 1; i < numLayers; ++i)
+	{
+		if ( net.getLayer(i).numInputs() > MAX_INPUTS )
+		{
+			_nodeCount.clear();
+			return false;
+		}
+	}
+
+	_layers.resize(numLayers);
+
+	for (int i = 1; i < numLayers; ++i)
+	{
+		const BPLayerT<T>&	src		= net.getLayer(i);
+		Layer&				layer	= _layers[i];
+
+		int			rows	= src.numNodes();
+		int			cols	= src.numInputs();
+		const T*	w		= src.weights();
+
+		layer.numNodes		= rows;
+		layer.numInputs		= cols;
+		layer.activation	= src.getActivation();
+		layer.stride		= (cols + BPKernels::I8_BLOCK - 1) / BPKernels::I8_BLOCK * BPKernels::I8_BLOCK;
+
+		layer.weights.resize( (size_t)rows * layer.stride );
+		layer.scales.assign( rows, 1.0f );
+		layer.rowSums.assign( rows, 0 );
+
+		// biases are added after rescaling
+		layer.bias.clear();
+		if ( src.hasBias() )
+			layer.bias.assign( src.bias(), src.bias() + rows );
+
+		// largest weight magnitude of each row (or of the whole layer)
+		vector<double> range(rows, 0.0);
+		for (int j = 0; j != rows; ++j)
+			for (int k = 0; k != cols; ++k)
+				range[j] = max( range[j], fabs((double)w[(size_t)j * cols + k]) );
+
+		if ( granularity == PER_LAYER && rows != 0 )
+			range.assign( rows, *max_element(range.begin(), range.end()) );
+
+		// symmetric int8 weights (-127..127, padding stays zero)
+		for (int j = 0; j != rows; ++j)
+		{
+			double		scale	= (range[j] > 0) ? range[j] / 127 : 1.0;
+			const T*	row		= w + (size_t)j * cols;
+			int8_t*		q		= layer.weights.data() + (size_t)j * layer.stride;
+			int32_t		sum		= 0;
+
+			for (int k = 0; k != cols; ++k)
+			{
+				double v = floor(row[k] / scale + 0.5);
+				v = (v > 127) ? 127 : (v < -127) ? -127 : v;
+
+				q[k] = (int8_t)v;
+				sum += q[k];
+			}
+
+			layer.scales[j]		= (float)scale;
+			layer.rowSums[j]	= sum;
+		}
+	}
+
+	return true;
+}
+
+
+//====================================================================
+// Get bytes used by quantized weights
+//====================================================================
+size_t BPQuantizedNet::weightBytes() const
+{
+	size_t bytes = 0;
+
+	int numLayers = _layers.size();
+	for (int i = 1; i < numLayers; ++i)
+	{
+		const Layer& layer = _layers[i];
+
+		bytes += layer.weights.size() * sizeof(int8_t);
+		bytes += layer.scales.size() * sizeof(float);
+		bytes += layer.rowSums.size() * sizeof(int32_t);
+		bytes += layer.bias.size() * sizeof(float);
+	}
+
+	return bytes;
+}
+
+
+//====================================================================
+// Allocate workspace for predict()
+//====================================================================
+void BPQuantizedNet::createWorkspace(Workspace& ws) const
+{
+	int maxStride	= 0;
+	int maxNodes	= 0;
+
+	int numLayers = _layers.size();
+	for (int i = 1; i < numLayers; ++i)
+	{
+		maxStride	= max( maxStride, _layers[i].stride );
+		maxNodes	= max( maxNodes, _layers[i].numNodes );
+	}
+
+	ws.input.resize(maxStride);
+	ws.sums.resize(maxNodes);
+	ws.values.resize(maxNodes);
+}
+
+
+//====================================================================
+// Quantize values to 0..127 (scale and zero point cover their range
+// and zero), returns scale
+//====================================================================
+template <class T>
+float BPQuantizedNet::quantizeInput(const T* in, int n, uint8_t* q, int& zero)
+{
+	float lo = 0;
+	float hi = 0;
+	for (int i = 0; i != n; ++i)
+	{
+		float v = (float)in[i];
+		lo = (v < lo) ? v : lo;
+		hi = (v > hi) ? v : hi;
+	}
+
+	float scale = (hi - lo) / BPKernels::I8_MAX;
+	if ( !(scale > 0) )
+		scale = 1;
+
+	float inv	= 1 / scale;
+	float bias	= floorf(-lo * inv + 0.5f);	// zero point
+	zero		= (int)bias;
+
+	// round to nearest, values are non-negative after adding the zero point
+	for (int i = 0; i != n; ++i)
+	{
+		float v = (float)in[i] * inv + bias + 0.5f;
+		v = (v < 0) ? 0 : (v > BPKernels::I8_MAX) ? (float)BPKernels::I8_MAX : v;
+
+		q[i] = (uint8_t)v;
+	}
+
+	return scale;
+}
+
+
+//====================================================================
+// Evaluate n input rows
+//====================================================================
+template <class T>
+void BPQuantizedNet::predict(const T* in, T* out, int n, Workspace& ws) const
+{
+	// (a network of only an input layer copies its inputs, without buffers)
+	int numLayers = _nodeCount.size();
+	assert( numLayers != 0 && (numLayers == 1 || ws.values.size() >= (size_t)_nodeCount.back()) );
+
+	int numInputs	= _nodeCount[0];
+	int numOutputs	= _nodeCount[numLayers-1];
+
+	uint8_t*	q		= ws.input.data();
+	int32_t*	sums	= ws.sums.data();
+	float*		values	= ws.values.data();
+
+	for (int s = 0; s != n; ++s, in += numInputs, out += numOutputs)
+	{
+		if ( numLayers == 1 )
+		{
+			memcpy( out, in, numOutputs * sizeof(T) );
+			continue;
+		}
+
+		int		zero;
+		float	scale = quantizeInput(in, numInputs, q, zero);
+
+		for (int i = 1; i < numLayers; ++i)
+		{
+			const Layer& layer = _layers[i];
+
+			BPKernels::matVecI8( layer.weights.data(), q, sums, layer.numNodes, layer.stride );
+
+			// rescale sums (removing the zero point), add biases and apply transfer function
+			for (int j = 0; j != layer.numNodes; ++j)
+				values[j] = scale * layer.scales[j] * (float)(sums[j] - zero * layer.rowSums[j]);
+
+			if ( !layer.bias.empty() )
+			{
+				for (int j = 0; j != layer.numNodes; ++j)
+					values[j] += layer.bias[j];
+			}
+
+			BPActivation::forward( layer.activation, values, layer.numNodes, layer.numNodes, _sigmoid );
+
+			if ( i == numLayers-1 )
+			{
+				for (int j = 0; j != numOutputs; ++j)
+					out[j] = (T)values[j];
+			}
+			else
+				scale = quantizeInput(values, layer.numNodes, q, zero);
+		}
+	}
+}
+
+
+//====================================================================
+// Compare outputs with the original network
+//====================================================================
+template <class T>
+BPQuantizedNet::Report BPQuantizedNet::compare(const BPNetT<T>& net, const PatternSetT<T>& set) const
+{
+	assert( net.getNodeCount() == _nodeCount );
+	assert( set.size() == 0 || (set.inSize() == _nodeCount.front() && set.outSize() == _nodeCount.back()) );
+
+	Report report;
+	memset( &report, 0, sizeof(report) );
+
+	int		numInputs	= _nodeCount.front();
+	int		numOutputs	= _nodeCount.back();
+	size_t	count		= set.size();
+
+	typename BPNetT<T>::Workspace netWs;
+	net.createWorkspace(netWs);
+
+	Workspace ws;
+	createWorkspace(ws);
+
+	vector<T> ref(numOutputs), quant(numOutputs);
+
+	double	sumAbs		= 0;
+	double	sumSquared	= 0;
+	size_t	agree		= 0;
+
+	for (size_t p = 0; p != count; ++p)
+	{
+		const T* in			= set.inputs()  + p * numInputs;
+		const T* desired	= set.outputs() + p * numOutputs;
+
+		net.predict( in, &ref[0], netWs );
+		predict( in, &quant[0], ws );
+
+		int refMax = 0, quantMax = 0;
+		for (int j = 0; j != numOutputs; ++j)
+		{
+			double diff = (double)quant[j] - (double)ref[j];
+
+			sumAbs		+= fabs(diff);
+			sumSquared	+= diff * diff;
+
+			report.maxError	= max( report.maxError, fabs(diff) );
+
+			double errQuant	= (double)desired[j] - (double)quant[j];
+			double errRef	= (double)desired[j] - (double)ref[j];
+			report.sumSquared		+= errQuant * errQuant;
+			report.sumSquaredRef	+= errRef * errRef;
+
+			refMax		= (ref[j] > ref[refMax]) ? j : refMax;
+			quantMax	= (quant[j] > quant[quantMax]) ? j : quantMax;
+		}
+
+		if ( refMax == quantMax )
+			++agree;
+	}
+
+	report.count = count;
+	if ( count != 0 )
+	{
+		double values = (double)count * numOutputs;
+
+		report.meanError	= sumAbs / values;
+		report.rmsError		= sqrt(sumSquared / values);
+		report.agreement	= (double)agree / count;
+	}
+
+	return report;
+}
+
+
+// explicit instantiation
+template bool	BPQuantizedNet::quantize(const BPNetT<double>& net, Granularity granularity);
+template bool	BPQuantizedNet::quantize(const BPNetT<float>& net, Granularity granularity);
+template void	BPQuantizedNet::predict(const double* in, double* out, int n, Workspace& ws) const;
+template void	BPQuantizedNet::predict(const float* in, float* out, int n, Workspace& ws) const;
+
+template BPQuantizedNet::Report	BPQuantizedNet::compare(const BPNetT<double>& net, const PatternSetT<double>& set) const;
+template BPQuantizedNet::Report	BPQuantizedNet::compare(const BPNetT<float>& net, const PatternSetT<float>& set) const;
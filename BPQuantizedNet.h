@@ -0,0 +1,144 @@
+// BPQuantizedNet.h: interface for the BPQuantizedNet class.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+
+#ifndef _BPQUANTIZEDNET_H
+#define _BPQUANTIZEDNET_H
+
+#include <cstddef>
+#include <vector>
+#include <stdint.h>
+#include "BPBuffer.h"
+#include "BPKernels.h"
+#include "BPActivation.h"
+using namespace std;
+
+template <class T> class BPNetT;
+template <class T> class PatternSetT;
+
+
+//////////////////////////////////////////////////////////////////////
+// BPQuantizedNet - int8 inference engine built from a trained network.
+//
+// quantize() converts the weights of a BPNet (double or float) to int8
+// with a symmetric scale per layer or per node (row of the weight
+// matrix). At run time the inputs of each layer are quantized per
+// sample to 0..127 with a scale and zero point taken from their range,
+// products are summed exactly in int32 (BPKernels::matVecI8) and the
+// sums are rescaled to float, and the node biases (kept in float) are
+// added, before the layer's transfer function.
+//
+// Weights take an eighth of the memory of double weights (a quarter of
+// float) and no deltas are kept: the engine only predicts. compare()
+// reports how far the quantized outputs are from the original network.
+//////////////////////////////////////////////////////////////////////
+class BPQuantizedNet
+{
+// Types
+public:
+	// weight scale granularity
+	enum Granularity
+	{
+		PER_LAYER = 0,	// one scale for all weights of a layer
+		PER_ROW			// one scale for the incoming weights of each node
+	};
+
+	// per-thread scratch storage for predict()
+	struct Workspace
+	{
+		BPBuffer<uint8_t>	input;		// quantized values of previous layer
+		BPBuffer<int32_t>	sums;		// integer sums of current layer
+		BPBuffer<float>		values;		// values of current layer
+	};
+
+	// accuracy of the quantized network against the original one
+	struct Report
+	{
+		size_t	count;			// number of patterns compared
+		double	maxError;		// largest absolute output difference
+		double	meanError;		// mean absolute output difference
+		double	rmsError;		// root mean square output difference
+		double	agreement;		// fraction of patterns with the same largest output node
+		double	sumSquared;		// sum of squared errors against desired outputs
+		double	sumSquaredRef;	// same for the original network
+	};
+
+protected:
+
+	// quantized layer
+	struct Layer
+	{
+		int					numNodes;	// number of nodes
+		int					numInputs;	// number of nodes in previous layer
+		int					stride;		// row length, padded to BPKernels::I8_BLOCK
+		BPActivation::Type	activation;	// transfer function
+		BPBuffer<int8_t>	weights;	// int8 weights [numNodes x stride]
+		vector<float>		scales;		// weight scale of each node
+		vector<int32_t>		rowSums;	// sum of int8 weights of each node (zero point correction)
+		vector<float>		bias;		// bias of each node (empty if the network has none)
+	};
+
+// Methods
+public:
+	virtual ~BPQuantizedNet();	// destructor
+	BPQuantizedNet();			// default c-tor
+
+	// quantize weights of a trained network, returns false if it has no
+	// layers or a layer has more than 65536 inputs (int32 sums overflow)
+	template <class T>
+	bool	quantize(const BPNetT<T>& net, Granularity granularity = PER_ROW);
+
+	// get scale granularity
+	Granularity	getGranularity() const	{ return _granularity; }
+
+	// set/get sigmoid evaluation mode (quantize() takes the network's mode)
+	void				setSigmoid(BPKernels::Sigmoid mode)	{ _sigmoid = mode; }
+	BPKernels::Sigmoid	getSigmoid() const					{ return _sigmoid; }
+
+	// get number of layers
+	int		getNumLayers() const	{ return _nodeCount.size(); }
+
+	// get number of nodes in each layer
+	const vector<int>&	getNodeCount() const	{ return _nodeCount; }
+
+	// get bytes used by quantized weights, scales, row sums and biases
+	size_t	weightBytes() const;
+
+	// allocate a workspace for predict()
+	void	createWorkspace(Workspace& ws) const;
+
+	// evaluate one input row (n rows) into out. thread-safe, each thread
+	// needs its own workspace
+	template <class T>
+	void	predict(const T* in, T* out, Workspace& ws) const	{ predict(in, out, 1, ws); }
+	template <class T>
+	void	predict(const T* in, T* out, int n, Workspace& ws) const;
+
+	// compare outputs with the original network on a pattern set
+	template <class T>
+	Report	compare(const BPNetT<T>& net, const PatternSetT<T>& set) const;
+
+protected:
+
+	// quantize n values to 0..127, returns scale, zero is the zero point
+	template <class T>
+	static float	quantizeInput(const T* in, int n, uint8_t* q, int& zero);
+
+// Members
+protected:
+
+	Granularity			_granularity;	// weight scale granularity
+	BPKernels::Sigmoid	_sigmoid;		// sigmoid evaluation mode
+	vector<int>			_nodeCount;		// number of nodes in each layer
+	vector<Layer>		_layers;		// quantized layers (layer 0 is unused)
+};
+
+
+#endif // _BPQUANTIZEDNET_H
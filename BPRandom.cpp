@@ -0,0 +1,90 @@
+// BPRandom.cpp: implementation of the BPRandom class.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <atomic>
+#include <chrono>
+#include "BPRandom.h"
+using namespace std;
+
+
+//====================================================================
+// A different seed on every call
+//====================================================================
+uint64_t BPRandom::newSeed()
+{
+	// the count keeps calls within one clock tick apart
+	static atomic<uint64_t> calls(0);
+
+	uint64_t time = (uint64_t)chrono::high_resolution_clock::now().time_since_epoch().count();
+
+	return mix( time ^ mix( calls.fetch_add(1) + 0x9E3779B97F4A7C15ULL ) );
+}
+
+
+//====================================================================
+// Range of initial weights of a layer
+//====================================================================
+double BPRandom::limit(Init init, int fanIn, int fanOut)
+{
+	assert( init >= UNIFORM && init < NUM_INITS );
+
+	switch (init)
+	{
+	case XAVIER:
+		return ( fanIn + fanOut > 0 ) ? sqrt( 6.0 / (fanIn + fanOut) ) : 1.0;
+
+	case HE:
+		return ( fanIn > 0 ) ? sqrt( 6.0 / fanIn ) : 1.0;
+
+	default:
+		break;
+	}
+
+	return 1.0;
+}
+
+
+//====================================================================
+// Get name of initialization scheme
+//====================================================================
+const char* BPRandom::name(Init init)
+{
+	switch (init)
+	{
+	case UNIFORM:	return "uniform";
+	case XAVIER:	return "xavier";
+	case HE:		return "he";
+	default:		break;
+	}
+
+	return "unknown";
+}
+
+
+//====================================================================
+// Find initialization scheme by name
+//====================================================================
+bool BPRandom::parse(const char* str, Init& init)
+{
+	for (int i = UNIFORM; i != NUM_INITS; ++i)
+	{
+		if ( strcmp(str, name((Init)i)) == 0 )
+		{
+			init = (Init)i;
+			return true;
+		}
+	}
+
+	return false;
+}
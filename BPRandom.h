@@ -0,0 +1,110 @@
+// BPRandom.h: interface for the BPRandom class.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+
+#ifndef _BPRANDOM_H
+#define _BPRANDOM_H
+
+#include <cstddef>
+#include <utility>
+#include <stdint.h>
+
+
+//////////////////////////////////////////////////////////////////////
+// BPRandom - counter-based random numbers and weight initialization.
+//
+// The i-th number of a stream is a hash of (seed, stream, i): there
+// is no state to share or advance, so any range of a stream can be
+// generated on any thread and the result never depends on how the
+// work was split. Seed, stream and counter are combined with the
+// SplitMix64 finalizer.
+//
+// A network uses its seed with one stream per layer and the index of
+// each weight in the layer's matrix as counter. Weights are drawn
+// uniformly from [-limit, limit]:
+//
+//	UNIFORM		limit = 1								(original scheme)
+//	XAVIER		limit = sqrt(6 / (fanIn + fanOut))		(Glorot, sigmoid/tanh)
+//	HE			limit = sqrt(6 / fanIn)					(ReLU)
+//////////////////////////////////////////////////////////////////////
+class BPRandom
+{
+// Types
+public:
+	enum Init
+	{
+		UNIFORM = 0,	// [-1, 1]
+		XAVIER,			// Glorot uniform
+		HE,				// He uniform
+		NUM_INITS
+	};
+
+// Methods
+public:
+
+	// i-th 64-bit number of a stream
+	static uint64_t	get(uint64_t seed, uint64_t stream, uint64_t index)
+	{
+		return mix( mix( seed ^ (stream * 0xD1B54A32D192ED03ULL) ) + (index + 1) * 0x9E3779B97F4A7C15ULL );
+	}
+
+	// i-th number of a stream in [0, 1) (53 random bits)
+	static double	uniform(uint64_t seed, uint64_t stream, uint64_t index)
+	{
+		return (double)( get(seed, stream, index) >> 11 ) * (1.0 / 9007199254740992.0);
+	}
+
+	// out[i] = number first + i of a stream in [low, high)
+	template <class T>
+	static void		fill(T* out, size_t n, uint64_t seed, uint64_t stream, uint64_t first,
+						 double low, double high)
+	{
+		double scale = high - low;
+		for (size_t i = 0; i != n; ++i)
+			out[i] = (T)( low + scale * uniform(seed, stream, first + i) );
+	}
+
+	// SplitMix64 finalizer
+	static uint64_t	mix(uint64_t z)
+	{
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+
+		return z ^ (z >> 31);
+	}
+
+	// next number of a SplitMix64 sequence (for sequential uses
+	// such as shuffling, where a state is advanced)
+	static uint64_t	next(uint64_t& state)
+	{
+		return mix( state += 0x9E3779B97F4A7C15ULL );
+	}
+
+	// random permutation of n items (Fisher-Yates) from a sequence state
+	template <class T>
+	static void		shuffle(T* items, size_t n, uint64_t& state)
+	{
+		for (size_t i = n; i > 1; --i)
+			std::swap( items[i-1], items[next(state) % i] );
+	}
+
+	// a different seed on every call (time and call count)
+	static uint64_t	newSeed();
+
+	// weights of a layer are drawn from [-limit, limit]
+	static double	limit(Init init, int fanIn, int fanOut);
+
+	// get name of initialization scheme / find scheme by name
+	static const char*	name(Init init);
+	static bool			parse(const char* str, Init& init);
+};
+
+
+#endif // _BPRANDOM_H
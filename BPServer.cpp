@@ -0,0 +1,608 @@
+// BPServer.cpp: implementation of the BPServer class.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <cassert>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include "BPServer.h"
+#include "BPNet.h"
+#include "BPStats.h"
+
+// time an accept thread waits for a connection before checking for stop (ms)
+#define ACCEPT_POLL		100
+
+// latency histogram: 8 buckets per power of two of nanoseconds
+#define HISTOGRAM_SUB	8
+#define HISTOGRAM_SIZE	(64 * HISTOGRAM_SUB)
+
+
+//////////////////////////////////////////////////////////////////////
+// Construction/Destruction
+//////////////////////////////////////////////////////////////////////
+
+template <class T>
+BPServerT<T>::~BPServerT()
+{
+	stop();
+}
+
+
+template <class T>
+BPServerT<T>::BPServerT(const Net* net) :	_ownModel( new Model( shared_ptr<const Net>( net, [](const Net*){} ) ) ),
+											_pModel(_ownModel.get()),
+											_numInputs(0),
+											_numOutputs(0),
+											_maxBatch(BPSERVER_MAX_BATCH),
+											_maxLatency(BPSERVER_MAX_LATENCY),
+											_maxRequest(BPSERVER_MAX_REQUEST),
+											_port(0),
+											_running(false),
+											_queuedSamples(0),
+											_stop(false),
+											_histogram(HISTOGRAM_SIZE, 0)
+{
+	resetStats();
+}
+
+
+template <class T>
+BPServerT<T>::BPServerT(Model* model) :	_pModel(model),
+										_numInputs(0),
+										_numOutputs(0),
+										_maxBatch(BPSERVER_MAX_BATCH),
+										_maxLatency(BPSERVER_MAX_LATENCY),
+										_maxRequest(BPSERVER_MAX_REQUEST),
+										_port(0),
+										_running(false),
+										_queuedSamples(0),
+										_stop(false),
+										_histogram(HISTOGRAM_SIZE, 0)
+{
+	assert( model != NULL );
+
+	resetStats();
+}
+
+
+//====================================================================
+// Set largest number of samples evaluated at once
+//====================================================================
+template <class T>
+void BPServerT<T>::setMaxBatch(int samples)
+{
+	assert( samples > 0 && !_running );
+
+	_maxBatch = samples;
+}
+
+
+//====================================================================
+// Set time a request waits for others to join its batch
+//====================================================================
+template <class T>
+void BPServerT<T>::setMaxLatency(int microseconds)
+{
+	assert( microseconds >= 0 );
+
+	_maxLatency = microseconds;
+}
+
+
+//====================================================================
+// Set largest number of samples of one request
+//====================================================================
+template <class T>
+void BPServerT<T>::setMaxRequest(int samples)
+{
+	assert( samples > 0 && !_running );
+
+	_maxRequest = samples;
+}
+
+
+//====================================================================
+// Accept clients on a Unix domain socket
+//====================================================================
+template <class T>
+bool BPServerT<T>::listenUnix(const char* path)
+{
+	assert( !_running );
+
+	unique_ptr<BPSocket> listener( new BPSocket );
+	if ( !listener->listenUnix(path) )
+		return false;
+
+	_listeners.push_back( move(listener) );
+	return true;
+}
+
+
+//====================================================================
+// Accept clients on a loopback TCP port
+//====================================================================
+template <class T>
+bool BPServerT<T>::listenTcp(int port)
+{
+	assert( !_running );
+
+	unique_ptr<BPSocket> listener( new BPSocket );
+	if ( !listener->listenTcp(port) )
+		return false;
+
+	_port = listener->port();
+	_listeners.push_back( move(listener) );
+	return true;
+}
+
+
+//====================================================================
+// Start serving
+//====================================================================
+template <class T>
+bool BPServerT<T>::start()
+{
+	// later versions have the same input and output sizes
+	shared_ptr<const Net> net = _pModel->get();
+	if ( _running || _listeners.empty() || !net || net->getNumLayers() == 0 )
+		return false;
+
+	_numInputs	= net->getNumNodes(0);
+	_numOutputs	= net->getNumNodes(net->getNumLayers() - 1);
+
+	// batch storage is allocated once (and again for a version
+	// of another hidden topology)
+	net->createWorkspace( _ws, _maxBatch );
+	_in.resize( (size_t)_maxBatch * _numInputs );
+	_out.resize( (size_t)_maxBatch * _numOutputs );
+
+	_stop = false;
+	resetStats();
+
+	_batchThread = thread( &BPServerT::batchLoop, this );
+
+	for (size_t i = 0; i != _listeners.size(); ++i)
+		_acceptThreads.push_back( thread( &BPServerT::acceptLoop, this, _listeners[i].get() ) );
+
+	_running = true;
+	return true;
+}
+
+
+//====================================================================
+// Stop serving
+//====================================================================
+template <class T>
+void BPServerT<T>::stop()
+{
+	if ( _running )
+	{
+		// wake threads blocked on sockets or waiting for requests
+		{
+			lock_guard<mutex> lock(_mutex);
+			_stop = true;
+
+			for (set<BPSocket*>::iterator it = _clients.begin(); it != _clients.end(); ++it)
+				(*it)->shutdown();
+		}
+
+		_queued.notify_all();
+
+		for (size_t i = 0; i != _listeners.size(); ++i)
+			_listeners[i]->shutdown();
+
+		for (size_t i = 0; i != _acceptThreads.size(); ++i)
+			_acceptThreads[i].join();
+
+		// queued requests are still evaluated, then connections close
+		{
+			unique_lock<mutex> lock(_mutex);
+			_closed.wait( lock, [&]{ return _clients.empty(); } );
+		}
+
+		_batchThread.join();
+
+		_acceptThreads.clear();
+		_running = false;
+	}
+
+	_listeners.clear();
+	_port = 0;
+}
+
+
+//====================================================================
+// Accept connections of a listening socket
+//====================================================================
+template <class T>
+void BPServerT<T>::acceptLoop(BPSocket* listener)
+{
+	for (;;)
+	{
+		unique_ptr<BPSocket> client( new BPSocket );
+		bool accepted = listener->accept( *client, ACCEPT_POLL );
+
+		lock_guard<mutex> lock(_mutex);
+		if ( _stop )
+			break;
+
+		if ( accepted )
+		{
+			// the connection thread owns the socket, stop() waits for it
+			_clients.insert( client.get() );
+			thread( &BPServerT::clientLoop, this, client.release() ).detach();
+		}
+	}
+}
+
+
+//====================================================================
+// Serve a connection
+//====================================================================
+template <class T>
+void BPServerT<T>::clientLoop(BPSocket* client)
+{
+	BPServerHello hello;
+	memset( &hello, 0, sizeof(hello) );
+	memcpy( hello.magic, "BPNETSRV", 8 );
+	hello.version		= BPSERVER_VERSION;
+	hello.scalarSize	= sizeof(T);
+	hello.numInputs		= _numInputs;
+	hello.numOutputs	= _numOutputs;
+	hello.maxSamples	= _maxRequest;
+
+	// the reply header is stored in front of the outputs, so a reply
+	// is sent with one write
+	const size_t header = ( sizeof(BPServerReply) + sizeof(T) - 1 ) / sizeof(T);
+
+	BPBuffer<T> in, out;
+
+	bool ok = client->write( &hello, sizeof(hello) );
+	while ( ok )
+	{
+		BPServerRequest request;
+		if ( !client->read( &request, sizeof(request) ) || request.count == 0 )
+			break;
+
+		BPServerReply reply;
+		reply.count		= request.count;
+		reply.status	= BPSERVER_OK;
+
+		if ( request.count > (uint32_t)_maxRequest )
+		{
+			reply.count		= 0;
+			reply.status	= BPSERVER_TOO_LARGE;
+			client->write( &reply, sizeof(reply) );
+			break;
+		}
+
+		// buffers grow to the largest request of the connection
+		size_t inSize	= (size_t)request.count * _numInputs;
+		size_t outSize	= header + (size_t)request.count * _numOutputs;
+		size_t outBytes	= sizeof(reply) + (size_t)request.count * _numOutputs * sizeof(T);
+
+		if ( in.size() < inSize )
+			in.resize( inSize );
+		if ( out.size() < outSize )
+			out.resize( outSize );
+
+		if ( !client->read( in.data(), inSize * sizeof(T) ) )
+			break;
+
+		Request r;
+		r.in		= in.data();
+		r.out		= out.data() + header;
+		r.count		= request.count;
+		r.arrival	= BPStats::now();
+		r.done		= false;
+
+		if ( !submit(r) )
+			break;
+
+		// header ends right before the outputs
+		char* p = (char*)r.out - sizeof(reply);
+		memcpy( p, &reply, sizeof(reply) );
+
+		ok = client->write( p, outBytes );
+	}
+
+	lock_guard<mutex> lock(_mutex);
+	_clients.erase( client );
+	delete client;
+
+	_closed.notify_all();
+}
+
+
+//====================================================================
+// Queue a request and wait for its outputs
+//====================================================================
+template <class T>
+bool BPServerT<T>::submit(Request& request)
+{
+	unique_lock<mutex> lock(_mutex);
+	if ( _stop )
+		return false;
+
+	_queue.push_back( &request );
+	_queuedSamples += request.count;
+	_queued.notify_one();
+
+	_done.wait( lock, [&]{ return request.done; } );
+	return true;
+}
+
+
+//====================================================================
+// Evaluate queued requests in micro-batches
+//====================================================================
+template <class T>
+void BPServerT<T>::batchLoop()
+{
+	vector<Request*> batch;
+
+	for (;;)
+	{
+		unique_lock<mutex> lock(_mutex);
+		_queued.wait( lock, [&]{ return _stop || !_queue.empty(); } );
+
+		// stopped, submit() doesn't queue anymore
+		if ( _queue.empty() )
+			break;
+
+		// the first request waits for others until the batch is full.
+		// a connection has one request at a time, once every connection
+		// has queued one no more can arrive
+		chrono::steady_clock::time_point deadline( chrono::nanoseconds( _queue.front()->arrival ) );
+		deadline += chrono::microseconds( _maxLatency );
+
+		while ( !_stop && _queuedSamples < _maxBatch && _queue.size() < _clients.size() )
+		{
+			if ( _queued.wait_until( lock, deadline ) == cv_status::timeout )
+				break;
+		}
+
+		// take whole requests up to the batch size (a larger
+		// request is evaluated alone)
+		batch.clear();
+		int samples = 0;
+
+		while ( !_queue.empty() && ( batch.empty() || samples + _queue.front()->count <= _maxBatch ) )
+		{
+			batch.push_back( _queue.front() );
+			samples += _queue.front()->count;
+			_queue.pop_front();
+		}
+
+		_queuedSamples -= samples;
+		lock.unlock();
+
+		evaluate( batch, samples );
+		record( batch, samples, BPStats::now() );
+
+		lock.lock();
+		for (size_t i = 0; i != batch.size(); ++i)
+			batch[i]->done = true;
+		lock.unlock();
+
+		_done.notify_all();
+	}
+}
+
+
+//====================================================================
+// Evaluate a batch of requests
+//====================================================================
+template <class T>
+void BPServerT<T>::evaluate(const vector<Request*>& batch, int samples)
+{
+	// the whole batch uses one version, a replaced version is
+	// freed here if this batch was its last reader
+	shared_ptr<const Net> net = _pModel->get();
+
+	// a single request is evaluated in place
+	if ( batch.size() == 1 )
+	{
+		Request& r = *batch[0];
+
+		for (int first = 0; first < r.count; first += _maxBatch)
+		{
+			int n = min( _maxBatch, r.count - first );
+			net->predict( r.in + (size_t)first * _numInputs, r.out + (size_t)first * _numOutputs, n, _ws );
+		}
+
+		return;
+	}
+
+	// gather inputs, one pass over all layers, scatter outputs
+	T* in = _in.data();
+	for (size_t i = 0; i != batch.size(); ++i)
+	{
+		size_t size = (size_t)batch[i]->count * _numInputs;
+		memcpy( in, batch[i]->in, size * sizeof(T) );
+		in += size;
+	}
+
+	net->predict( _in.data(), _out.data(), samples, _ws );
+
+	const T* out = _out.data();
+	for (size_t i = 0; i != batch.size(); ++i)
+	{
+		size_t size = (size_t)batch[i]->count * _numOutputs;
+		memcpy( batch[i]->out, out, size * sizeof(T) );
+		out += size;
+	}
+}
+
+
+//====================================================================
+// Count an evaluated batch
+//====================================================================
+template <class T>
+void BPServerT<T>::record(const vector<Request*>& batch, int samples, uint64_t now)
+{
+	lock_guard<mutex> lock(_statsMutex);
+
+	_requests	+= batch.size();
+	_samples	+= samples;
+	_batches	+= 1;
+
+	for (size_t i = 0; i != batch.size(); ++i)
+	{
+		uint64_t time = now - batch[i]->arrival;
+
+		_histogram[ bucket(time) ]++;
+		_maxTime = max( _maxTime, time );
+	}
+}
+
+
+//====================================================================
+// Get counters
+//====================================================================
+template <class T>
+typename BPServerT<T>::Stats BPServerT<T>::stats() const
+{
+	Stats stats;
+	{
+		lock_guard<mutex> lock(_mutex);
+		stats.clients = _clients.size();
+	}
+
+	lock_guard<mutex> lock(_statsMutex);
+
+	stats.requests		= _requests;
+	stats.samples		= _samples;
+	stats.batches		= _batches;
+	stats.p50			= percentile(0.50);
+	stats.p99			= percentile(0.99);
+	stats.maxLatency	= _maxTime * 1e-3;
+	stats.seconds		= ( BPStats::now() - _start ) * 1e-9;
+
+	return stats;
+}
+
+
+//====================================================================
+// Zero counters
+//====================================================================
+template <class T>
+void BPServerT<T>::resetStats()
+{
+	lock_guard<mutex> lock(_statsMutex);
+
+	_requests	= 0;
+	_samples	= 0;
+	_batches	= 0;
+	_maxTime	= 0;
+	_start		= BPStats::now();
+
+	fill( _histogram.begin(), _histogram.end(), 0 );
+}
+
+
+//====================================================================
+// Print counters
+//====================================================================
+template <class T>
+void BPServerT<T>::print(ostream& ost, const Stats& stats)
+{
+	ios::fmtflags flags = ost.flags();
+	streamsize precision = ost.precision();
+
+	double seconds = ( stats.seconds > 0 ) ? stats.seconds : 1;
+
+	ost << fixed << setprecision(1);
+	ost << "requests " << stats.requests
+		<< " samples " << stats.samples
+		<< " batches " << stats.batches
+		<< " avg_batch " << ( stats.batches != 0 ? (double)stats.samples / stats.batches : 0.0 )
+		<< " clients " << stats.clients << endl;
+
+	ost << "latency_us p50 " << stats.p50
+		<< " p99 " << stats.p99
+		<< " max " << stats.maxLatency
+		<< " requests_per_s " << stats.requests / seconds
+		<< " samples_per_s " << stats.samples / seconds << endl;
+
+	ost.flags( flags );
+	ost.precision( precision );
+}
+
+
+//====================================================================
+// Histogram bucket of a latency
+//====================================================================
+template <class T>
+int BPServerT<T>::bucket(uint64_t ns)
+{
+	if ( ns < HISTOGRAM_SUB )
+		return (int)ns;
+
+	// exponent of the highest bit, the next 3 bits select the sub-bucket
+	int e = 0;
+	while ( (ns >> e) >= 2 * HISTOGRAM_SUB )
+		++e;
+
+	return ( e + 1 ) * HISTOGRAM_SUB + (int)( (ns >> e) - HISTOGRAM_SUB );
+}
+
+
+//====================================================================
+// Latency (nanoseconds) at the middle of a histogram bucket
+//====================================================================
+template <class T>
+double BPServerT<T>::bucketValue(int index)
+{
+	if ( index < HISTOGRAM_SUB )
+		return index;
+
+	int		e		= index / HISTOGRAM_SUB - 1;
+	double	low		= (double)( HISTOGRAM_SUB + index % HISTOGRAM_SUB ) * ( (uint64_t)1 << e );
+	double	width	= (double)( (uint64_t)1 << e );
+
+	return low + 0.5 * ( width - 1 );
+}
+
+
+//====================================================================
+// Latency of a percentile (microseconds)
+//====================================================================
+template <class T>
+double BPServerT<T>::percentile(double p) const
+{
+	uint64_t total = 0;
+	for (int i = 0; i != HISTOGRAM_SIZE; ++i)
+		total += _histogram[i];
+
+	if ( total == 0 )
+		return 0;
+
+	// smallest bucket with at least p of all latencies
+	uint64_t rank = (uint64_t)ceil( p * total );
+	uint64_t count = 0;
+
+	for (int i = 0; i != HISTOGRAM_SIZE; ++i)
+	{
+		count += _histogram[i];
+		if ( count >= rank && count != 0 )
+			return bucketValue(i) * 1e-3;
+	}
+
+	return _maxTime * 1e-3;
+}
+
+
+// explicit instantiation
+template class BPServerT<double>;
+template class BPServerT<float>;
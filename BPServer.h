@@ -0,0 +1,247 @@
+// BPServer.h: interface for the BPServer class.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+
+#ifndef _BPSERVER_H
+#define _BPSERVER_H
+
+#include <vector>
+#include <deque>
+#include <set>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <ostream>
+#include <stdint.h>
+#include "BPBuffer.h"
+#include "BPSocket.h"
+#include "BPWorkspace.h"
+#include "BPModelHandle.h"
+using namespace std;
+
+template <class T> class BPNetT;
+
+
+// inference protocol version
+#define BPSERVER_VERSION		1
+
+// reply status
+#define BPSERVER_OK				0	// outputs follow
+#define BPSERVER_TOO_LARGE		1	// more samples than maxSamples, connection is closed
+
+// defaults of BPServer settings
+#define BPSERVER_MAX_BATCH		64		// samples per micro-batch
+#define BPSERVER_MAX_LATENCY	200		// microseconds a batch waits for more requests
+#define BPSERVER_MAX_REQUEST	4096	// samples per request
+
+
+//////////////////////////////////////////////////////////////////////
+// Inference protocol (little-endian, values in the precision of the
+// server's network, scalarSize bytes each).
+//
+// On connect the server sends a BPServerHello. Each request is a
+// BPServerRequest followed by count rows of numInputs values and is
+// answered with a BPServerReply followed by count rows of numOutputs
+// values. A request with count 0 closes the connection.
+//////////////////////////////////////////////////////////////////////
+struct BPServerHello
+{
+	char		magic[8];		// "BPNETSRV"
+	uint32_t	version;		// BPSERVER_VERSION
+	uint32_t	scalarSize;		// bytes per value (8 - double, 4 - float)
+	uint32_t	numInputs;		// values per input row
+	uint32_t	numOutputs;		// values per output row
+	uint32_t	maxSamples;		// largest count of a request
+	uint32_t	reserved;		// zero
+};
+
+struct BPServerRequest
+{
+	uint32_t	count;			// number of input rows
+	uint32_t	reserved;		// zero
+};
+
+struct BPServerReply
+{
+	uint32_t	count;			// number of output rows
+	uint32_t	status;			// BPSERVER_OK, BPSERVER_TOO_LARGE
+};
+
+
+//////////////////////////////////////////////////////////////////////
+// BPServerT - inference daemon for one network.
+//
+// Clients connect over Unix domain sockets or loopback TCP, each
+// connection is served by its own thread. Requests of all connections
+// are queued and a single batch thread evaluates them in micro-batches:
+// the first queued request waits up to maxLatency microseconds for
+// others to arrive (or until every connection has a request queued),
+// then up to maxBatch samples are evaluated with one predict() pass
+// over all layers and the replies are sent.
+//
+// The network is only read (see BPNet::predict) and must not be
+// changed while the server is running. A server of a model handle
+// takes the current version for each batch, new versions published to
+// the handle are served from the next batch on (see BPModelHandle).
+//////////////////////////////////////////////////////////////////////
+template <class T>
+class BPServerT
+{
+// Types
+public:
+	typedef BPNetT<T>			Net;		// served network
+	typedef BPWorkspaceT<T>		Workspace;	// batch storage
+	typedef BPModelHandleT<T>	Model;		// versions of the served network
+
+	// counters since start or resetStats(), latencies in microseconds
+	// from a request being read to its outputs being computed
+	struct Stats
+	{
+		uint64_t	requests;	// requests answered
+		uint64_t	samples;	// samples evaluated
+		uint64_t	batches;	// micro-batches evaluated
+		int			clients;	// open connections
+		double		p50;		// median latency
+		double		p99;		// 99th percentile latency
+		double		maxLatency;	// largest latency
+		double		seconds;	// time counted
+	};
+
+// Methods
+public:
+	virtual ~BPServerT();				// destructor (stops server)
+	explicit BPServerT(const Net* net);	// c-tor
+	explicit BPServerT(Model* model);	// c-tor serving the current version of a model
+
+	// set/get largest number of samples evaluated at once
+	void	setMaxBatch(int samples);
+	int		getMaxBatch() const			{ return _maxBatch; }
+
+	// set/get time a request waits for others to join its batch
+	// (microseconds, 0 - evaluate what is queued at once)
+	void	setMaxLatency(int microseconds);
+	int		getMaxLatency() const		{ return _maxLatency; }
+
+	// set/get largest number of samples of one request
+	void	setMaxRequest(int samples);
+	int		getMaxRequest() const		{ return _maxRequest; }
+
+	// accept clients on a Unix domain socket / loopback TCP port
+	// (port 0 - any free port). call before start()
+	bool	listenUnix(const char* path);
+	bool	listenTcp(int port);
+
+	// get TCP port of the last listenTcp() call
+	int		getPort() const				{ return _port; }
+
+	// start serving, false if nothing is listened on
+	bool	start();
+
+	// stop serving: connections are closed and listening sockets removed
+	void	stop();
+
+	// is the server running
+	bool	isRunning() const			{ return _running; }
+
+	// get/zero counters
+	Stats	stats() const;
+	void	resetStats();
+
+	// print counters with throughput
+	static void	print(ostream& ost, const Stats& stats);
+
+protected:
+
+	// a request waiting for its batch
+	struct Request
+	{
+		const T*	in;			// input rows
+		T*			out;		// output rows
+		int			count;		// number of rows
+		uint64_t	arrival;	// time the request was read (BPStats::now)
+		bool		done;		// outputs are computed
+	};
+
+	// thread accepting connections of a listening socket
+	void	acceptLoop(BPSocket* listener);
+
+	// thread serving a connection
+	void	clientLoop(BPSocket* client);
+
+	// batch thread: evaluate queued requests
+	void	batchLoop();
+
+	// queue a request and wait until it was evaluated, false if stopped
+	bool	submit(Request& request);
+
+	// evaluate a batch of requests
+	void	evaluate(const vector<Request*>& batch, int samples);
+
+	// count an evaluated batch
+	void	record(const vector<Request*>& batch, int samples, uint64_t now);
+
+	// latency histogram bucket of a time (nanoseconds) and its value
+	static int		bucket(uint64_t ns);
+	static double	bucketValue(int index);
+
+	// latency (microseconds) of a percentile of the histogram
+	double	percentile(double p) const;
+
+private:
+	BPServerT(const BPServerT&);				// not copyable
+	BPServerT& operator=(const BPServerT&);
+
+// Members
+protected:
+
+	unique_ptr<Model>	_ownModel;		// handle of a network passed to the c-tor
+	Model*				_pModel;		// served model
+	int					_numInputs;		// values per input row
+	int					_numOutputs;	// values per output row
+
+	int					_maxBatch;		// samples per batch
+	int					_maxLatency;	// batch window (microseconds)
+	int					_maxRequest;	// samples per request
+	int					_port;			// TCP port of last listenTcp
+
+	vector< unique_ptr<BPSocket> >	_listeners;		// listening sockets
+	vector<thread>					_acceptThreads;	// one per listening socket
+	thread							_batchThread;	// evaluates batches
+	bool							_running;		// threads were started
+
+	mutable mutex		_mutex;			// guards queue and clients
+	condition_variable	_queued;		// signaled when a request is queued or on stop
+	condition_variable	_done;			// signaled when a batch was evaluated
+	condition_variable	_closed;		// signaled when a connection is closed
+	deque<Request*>		_queue;			// requests waiting for a batch
+	int					_queuedSamples;	// samples of queued requests
+	set<BPSocket*>		_clients;		// open connections
+	bool				_stop;			// threads should exit
+
+	Workspace			_ws;			// batch thread storage
+	BPBuffer<T>			_in;			// gathered input rows of a batch
+	BPBuffer<T>			_out;			// output rows of a batch
+
+	mutable mutex		_statsMutex;	// guards counters
+	uint64_t			_requests;		// requests answered
+	uint64_t			_samples;		// samples evaluated
+	uint64_t			_batches;		// micro-batches evaluated
+	uint64_t			_maxTime;		// largest latency (nanoseconds)
+	uint64_t			_start;			// time counters were zeroed
+	vector<uint64_t>	_histogram;		// latency histogram (see bucket)
+};
+
+// double and float servers
+typedef BPServerT<double>	BPServer;
+typedef BPServerT<float>	BPServerF;
+
+
+#endif // _BPSERVER_H
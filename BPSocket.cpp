@@ -0,0 +1,371 @@
+// BPSocket.cpp: implementation of the BPSocket class.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include "BPSocket.h"
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#endif
+
+// don't raise SIGPIPE when the peer is gone, writes just fail
+#ifdef MSG_NOSIGNAL
+#define BPSOCKET_SEND_FLAGS	MSG_NOSIGNAL
+#else
+#define BPSOCKET_SEND_FLAGS	0
+#endif
+
+// pending connections of a listening socket
+#define BPSOCKET_BACKLOG	128
+
+
+#ifndef _WIN32
+
+//====================================================================
+// Set options of a new stream socket
+//====================================================================
+static void setOptions(int fd, bool tcp)
+{
+	int one = 1;
+
+#ifdef SO_NOSIGPIPE
+	setsockopt( fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one) );
+#endif
+
+	// requests and replies are small, send them at once
+	if ( tcp )
+		setsockopt( fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one) );
+}
+
+
+//====================================================================
+// Fill a Unix socket address, false if the path is too long
+//====================================================================
+static bool unixAddress(const char* path, sockaddr_un& addr)
+{
+	memset( &addr, 0, sizeof(addr) );
+	addr.sun_family = AF_UNIX;
+
+	if ( strlen(path) >= sizeof(addr.sun_path) )
+		return false;
+
+	strcpy( addr.sun_path, path );
+	return true;
+}
+
+
+//====================================================================
+// Fill a loopback TCP address
+//====================================================================
+static void tcpAddress(int port, sockaddr_in& addr)
+{
+	memset( &addr, 0, sizeof(addr) );
+	addr.sin_family			= AF_INET;
+	addr.sin_port			= htons( (unsigned short)port );
+	addr.sin_addr.s_addr	= htonl( INADDR_LOOPBACK );
+}
+
+#endif
+
+
+//////////////////////////////////////////////////////////////////////
+// Construction/Destruction
+//////////////////////////////////////////////////////////////////////
+
+BPSocket::~BPSocket()
+{
+	close();
+}
+
+
+BPSocket::BPSocket() :	_fd(-1),
+						_port(0)
+{
+
+}
+
+
+//====================================================================
+// Listen on a Unix domain socket
+//====================================================================
+bool BPSocket::listenUnix(const char* path)
+{
+	assert( path != NULL );
+
+	close();
+
+#ifdef _WIN32
+	return false;
+#else
+	sockaddr_un addr;
+	if ( !unixAddress(path, addr) )
+		return false;
+
+	_fd = socket( AF_UNIX, SOCK_STREAM, 0 );
+	if ( _fd < 0 )
+		return false;
+
+	// replace socket file left by a previous server, any other
+	// file at the path is kept (bind fails)
+	struct stat st;
+	if ( lstat( path, &st ) == 0 && S_ISSOCK( st.st_mode ) )
+		unlink( path );
+
+	if ( bind( _fd, (sockaddr*)&addr, sizeof(addr) ) != 0 || listen( _fd, BPSOCKET_BACKLOG ) != 0 )
+	{
+		close();
+		return false;
+	}
+
+	_path = path;
+	return true;
+#endif
+}
+
+
+//====================================================================
+// Listen on a loopback TCP port
+//====================================================================
+bool BPSocket::listenTcp(int port)
+{
+	assert( port >= 0 && port < 65536 );
+
+	close();
+
+#ifdef _WIN32
+	return false;
+#else
+	sockaddr_in addr;
+	tcpAddress( port, addr );
+
+	_fd = socket( AF_INET, SOCK_STREAM, 0 );
+	if ( _fd < 0 )
+		return false;
+
+	int one = 1;
+	setsockopt( _fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one) );
+
+	if ( bind( _fd, (sockaddr*)&addr, sizeof(addr) ) != 0 || listen( _fd, BPSOCKET_BACKLOG ) != 0 )
+	{
+		close();
+		return false;
+	}
+
+	// port chosen by the system
+	socklen_t size = sizeof(addr);
+	if ( getsockname( _fd, (sockaddr*)&addr, &size ) != 0 )
+	{
+		close();
+		return false;
+	}
+
+	_port = ntohs( addr.sin_port );
+	return true;
+#endif
+}
+
+
+//====================================================================
+// Accept a connection
+//====================================================================
+bool BPSocket::accept(BPSocket& client, int timeout)
+{
+	if ( _fd < 0 )
+		return false;
+
+#ifdef _WIN32
+	return false;
+#else
+	pollfd p;
+	p.fd		= _fd;
+	p.events	= POLLIN;
+	p.revents	= 0;
+
+	int ready;
+	do
+	{
+		ready = poll( &p, 1, timeout );
+	}
+	while ( ready < 0 && errno == EINTR );
+
+	if ( ready <= 0 || (p.revents & POLLIN) == 0 )
+		return false;
+
+	int fd = ::accept( _fd, NULL, NULL );
+	if ( fd < 0 )
+		return false;
+
+	client.close();
+	client._fd = fd;
+	setOptions( fd, _path.empty() );
+
+	return true;
+#endif
+}
+
+
+//====================================================================
+// Connect to a Unix domain socket
+//====================================================================
+bool BPSocket::connectUnix(const char* path)
+{
+	assert( path != NULL );
+
+	close();
+
+#ifdef _WIN32
+	return false;
+#else
+	sockaddr_un addr;
+	if ( !unixAddress(path, addr) )
+		return false;
+
+	_fd = socket( AF_UNIX, SOCK_STREAM, 0 );
+	if ( _fd < 0 )
+		return false;
+
+	if ( connect( _fd, (sockaddr*)&addr, sizeof(addr) ) != 0 )
+	{
+		close();
+		return false;
+	}
+
+	setOptions( _fd, false );
+	return true;
+#endif
+}
+
+
+//====================================================================
+// Connect to a loopback TCP port
+//====================================================================
+bool BPSocket::connectTcp(int port)
+{
+	assert( port > 0 && port < 65536 );
+
+	close();
+
+#ifdef _WIN32
+	return false;
+#else
+	sockaddr_in addr;
+	tcpAddress( port, addr );
+
+	_fd = socket( AF_INET, SOCK_STREAM, 0 );
+	if ( _fd < 0 )
+		return false;
+
+	if ( connect( _fd, (sockaddr*)&addr, sizeof(addr) ) != 0 )
+	{
+		close();
+		return false;
+	}
+
+	setOptions( _fd, true );
+	return true;
+#endif
+}
+
+
+//====================================================================
+// Read size bytes
+//====================================================================
+bool BPSocket::read(void* data, size_t size)
+{
+#ifdef _WIN32
+	return false;
+#else
+	char* p = (char*)data;
+	while ( size != 0 )
+	{
+		ssize_t n = recv( _fd, p, size, 0 );
+		if ( n < 0 && errno == EINTR )
+			continue;
+
+		// error or connection closed
+		if ( n <= 0 )
+			return false;
+
+		p		+= n;
+		size	-= n;
+	}
+
+	return true;
+#endif
+}
+
+
+//====================================================================
+// Write size bytes
+//====================================================================
+bool BPSocket::write(const void* data, size_t size)
+{
+#ifdef _WIN32
+	return false;
+#else
+	const char* p = (const char*)data;
+	while ( size != 0 )
+	{
+		ssize_t n = send( _fd, p, size, BPSOCKET_SEND_FLAGS );
+		if ( n < 0 && errno == EINTR )
+			continue;
+
+		if ( n <= 0 )
+			return false;
+
+		p		+= n;
+		size	-= n;
+	}
+
+	return true;
+#endif
+}
+
+
+//====================================================================
+// Stop transfers of other threads
+//====================================================================
+void BPSocket::shutdown()
+{
+#ifndef _WIN32
+	if ( _fd >= 0 )
+		::shutdown( _fd, SHUT_RDWR );
+#endif
+}
+
+
+//====================================================================
+// Close socket
+//====================================================================
+void BPSocket::close()
+{
+#ifndef _WIN32
+	if ( _fd >= 0 )
+		::close( _fd );
+
+	if ( !_path.empty() )
+		unlink( _path.c_str() );
+#endif
+
+	_fd		= -1;
+	_port	= 0;
+	_path.clear();
+}
+
@@ -0,0 +1,81 @@
+// BPSocket.h: interface for the BPSocket class.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+
+#ifndef _BPSOCKET_H
+#define _BPSOCKET_H
+
+#include <cstddef>
+#include <string>
+using namespace std;
+
+
+//////////////////////////////////////////////////////////////////////
+// BPSocket - blocking stream socket on the local machine, either a
+// Unix domain socket (a path) or TCP on the loopback interface.
+//
+// Reads and writes transfer whole messages: they return false if the
+// peer closed the connection or an error occurred before all bytes
+// were transferred. Sockets are only available on POSIX systems,
+// elsewhere every call fails.
+//////////////////////////////////////////////////////////////////////
+class BPSocket
+{
+// Methods
+public:
+	virtual ~BPSocket();	// destructor (closes socket)
+	BPSocket();				// default c-tor
+
+	// listen on a Unix domain socket (an existing socket file is replaced,
+	// fails if another kind of file is at the path)
+	bool	listenUnix(const char* path);
+
+	// listen on a loopback TCP port (0 - any free port, see port())
+	bool	listenTcp(int port);
+
+	// accept a connection of a listening socket, waits up to timeout
+	// milliseconds (-1 - forever). false on timeout or error
+	bool	accept(BPSocket& client, int timeout);
+
+	// connect to a Unix domain socket / loopback TCP port
+	bool	connectUnix(const char* path);
+	bool	connectTcp(int port);
+
+	// read/write size bytes
+	bool	read(void* data, size_t size);
+	bool	write(const void* data, size_t size);
+
+	// stop transfers: blocked reads, writes and accepts of other
+	// threads return false. the socket stays open until close()
+	void	shutdown();
+
+	// close socket (a Unix socket file created by listenUnix is removed)
+	void	close();
+
+	// is a socket open
+	bool	isOpen() const	{ return _fd >= 0; }
+
+	// get TCP port of a listening socket (0 for Unix sockets)
+	int		port() const	{ return _port; }
+
+private:
+	BPSocket(const BPSocket&);				// not copyable
+	BPSocket& operator=(const BPSocket&);
+
+// Members
+protected:
+
+	int		_fd;		// socket descriptor (-1 - closed)
+	int		_port;		// TCP port of listening socket
+	string	_path;		// Unix socket file created by listenUnix
+};
+
+
+#endif // _BPSOCKET_H
@@ -0,0 +1,299 @@
+// BPStats.cpp: implementation of the BPStats class.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <cassert>
+#include <cstring>
+#include <chrono>
+#include <iomanip>
+#include "BPStats.h"
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+
+//////////////////////////////////////////////////////////////////////
+// Construction/Destruction
+//////////////////////////////////////////////////////////////////////
+
+BPStats::~BPStats()
+{
+	enableHardware(false);
+}
+
+
+BPStats::BPStats() :	_numLayers(0),
+						_updates(0),
+						_ioWait(0),
+						_perfGroup(-1)
+{
+	for (int i = 0; i != 3; ++i)
+		_perfEvents[i] = -1;
+}
+
+
+BPStats::BPStats(const BPStats& other) :	_numLayers(0),
+											_updates(0),
+											_ioWait(0),
+											_perfGroup(-1)
+{
+	for (int i = 0; i != 3; ++i)
+		_perfEvents[i] = -1;
+
+	copy(other);
+}
+
+
+BPStats& BPStats::operator=(const BPStats& other)
+{
+	if ( this != &other )
+		copy(other);
+
+	return *this;
+}
+
+
+//====================================================================
+// Is recording compiled in
+//====================================================================
+bool BPStats::compiled()
+{
+#ifdef BPNET_STATS
+	return true;
+#else
+	return false;
+#endif
+}
+
+
+//====================================================================
+// Monotonic time in nanoseconds
+//====================================================================
+uint64_t BPStats::now()
+{
+	return chrono::duration_cast<chrono::nanoseconds>( chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+
+//====================================================================
+// Set number of layers
+//====================================================================
+void BPStats::create(int numLayers)
+{
+	assert( numLayers >= 0 );
+
+	if ( numLayers != _numLayers )
+	{
+		_layers.reset( numLayers > 0 ? new Counters[numLayers] : NULL );
+		_numLayers = numLayers;
+	}
+
+	reset();
+}
+
+
+//====================================================================
+// Zero all counters
+//====================================================================
+void BPStats::reset()
+{
+	for (int i = 0; i != _numLayers; ++i)
+	{
+		for (int p = 0; p != NUM_PHASES; ++p)
+			_layers[i].time[p] = 0;
+
+		_layers[i].samples = 0;
+	}
+
+	_updates	= 0;
+	_ioWait		= 0;
+
+#ifdef __linux__
+	if ( _perfGroup >= 0 )
+		ioctl( _perfGroup, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP );
+#endif
+}
+
+
+//====================================================================
+// Start/stop hardware counters
+//====================================================================
+bool BPStats::enableHardware(bool enable)
+{
+#ifdef __linux__
+	if ( !enable )
+	{
+		for (int i = 0; i != 3; ++i)
+		{
+			if ( _perfEvents[i] >= 0 )
+				close( _perfEvents[i] );
+
+			_perfEvents[i] = -1;
+		}
+
+		if ( _perfGroup >= 0 )
+			close( _perfGroup );
+
+		_perfGroup = -1;
+		return true;
+	}
+
+	if ( _perfGroup >= 0 )
+		return true;
+
+	// cycles lead the group, all events start and stop together
+	static const uint64_t config[4] =	{
+											PERF_COUNT_HW_CPU_CYCLES,
+											PERF_COUNT_HW_INSTRUCTIONS,
+											PERF_COUNT_HW_CACHE_MISSES,
+											PERF_COUNT_HW_BRANCH_MISSES
+										};
+
+	for (int i = 0; i != 4; ++i)
+	{
+		perf_event_attr attr;
+		memset( &attr, 0, sizeof(attr) );
+
+		attr.size			= sizeof(attr);
+		attr.type			= PERF_TYPE_HARDWARE;
+		attr.config			= config[i];
+		attr.disabled		= ( i == 0 );
+		attr.inherit		= 1;
+		attr.exclude_kernel	= 1;
+		attr.exclude_hv		= 1;
+
+		int fd = (int)syscall( __NR_perf_event_open, &attr, 0, -1, ( i == 0 ) ? -1 : _perfGroup, 0 );
+		if ( fd < 0 )
+		{
+			enableHardware(false);
+			return false;
+		}
+
+		if ( i == 0 )
+			_perfGroup = fd;
+		else
+			_perfEvents[i-1] = fd;
+	}
+
+	ioctl( _perfGroup, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP );
+	ioctl( _perfGroup, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP );
+
+	return true;
+#else
+	return !enable;
+#endif
+}
+
+
+//====================================================================
+// Get current counters
+//====================================================================
+BPStats::Snapshot BPStats::snapshot() const
+{
+	Snapshot stats;
+
+	stats.layers.resize( _numLayers );
+	for (int i = 0; i != _numLayers; ++i)
+	{
+		for (int p = 0; p != NUM_PHASES; ++p)
+			stats.layers[i].time[p] = _layers[i].time[p].load( memory_order_relaxed );
+
+		stats.layers[i].samples = _layers[i].samples.load( memory_order_relaxed );
+	}
+
+	stats.updates	= _updates.load( memory_order_relaxed );
+	stats.ioWait	= _ioWait.load( memory_order_relaxed );
+
+	memset( &stats.hardware, 0, sizeof(stats.hardware) );
+
+#ifdef __linux__
+	if ( _perfGroup >= 0 )
+	{
+		// inherited events can't be read as a group, read one by one
+		uint64_t value[4] = { 0, 0, 0, 0 };
+		bool valid = ( read(_perfGroup, &value[0], sizeof(uint64_t)) == sizeof(uint64_t) );
+
+		for (int i = 0; i != 3; ++i)
+			valid = valid && ( read(_perfEvents[i], &value[i+1], sizeof(uint64_t)) == sizeof(uint64_t) );
+
+		stats.hardware.valid		= valid;
+		stats.hardware.cycles		= value[0];
+		stats.hardware.instructions	= value[1];
+		stats.hardware.cacheMisses	= value[2];
+		stats.hardware.branchMisses	= value[3];
+	}
+#endif
+
+	return stats;
+}
+
+
+//====================================================================
+// Write a snapshot as a table (times in milliseconds)
+//====================================================================
+void BPStats::print(ostream& ost, const Snapshot& stats)
+{
+	ios::fmtflags flags = ost.flags();
+	streamsize precision = ost.precision();
+
+	ost << fixed << setprecision(3);
+	ost << "layer      samples   forward_ms  backward_ms    update_ms" << endl;
+
+	for (size_t i = 1; i < stats.layers.size(); ++i)
+	{
+		const Layer& layer = stats.layers[i];
+
+		ost << setw(5)	<< i
+			<< setw(13)	<< layer.samples
+			<< setw(13)	<< layer.time[FORWARD] * 1e-6
+			<< setw(13)	<< layer.time[BACKWARD] * 1e-6
+			<< setw(13)	<< layer.time[UPDATE] * 1e-6 << endl;
+	}
+
+	ost << "updates " << stats.updates << " io_wait_ms " << stats.ioWait * 1e-6 << endl;
+
+	if ( stats.hardware.valid )
+	{
+		double ipc = ( stats.hardware.cycles != 0 ) ? (double)stats.hardware.instructions / stats.hardware.cycles : 0;
+
+		ost << "cycles " << stats.hardware.cycles
+			<< " instructions " << stats.hardware.instructions
+			<< " ipc " << ipc
+			<< " cache_misses " << stats.hardware.cacheMisses
+			<< " branch_misses " << stats.hardware.branchMisses << endl;
+	}
+
+	ost.flags( flags );
+	ost.precision( precision );
+}
+
+
+//====================================================================
+// Copy counter values of another object
+//====================================================================
+void BPStats::copy(const BPStats& other)
+{
+	create( other._numLayers );
+
+	for (int i = 0; i != _numLayers; ++i)
+	{
+		for (int p = 0; p != NUM_PHASES; ++p)
+			_layers[i].time[p] = other._layers[i].time[p].load( memory_order_relaxed );
+
+		_layers[i].samples = other._layers[i].samples.load( memory_order_relaxed );
+	}
+
+	_updates	= other._updates.load( memory_order_relaxed );
+	_ioWait		= other._ioWait.load( memory_order_relaxed );
+}
@@ -0,0 +1,162 @@
+// BPStats.h: interface for the BPStats class.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+
+#ifndef _BPSTATS_H
+#define _BPSTATS_H
+
+#include <cstddef>
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <ostream>
+#include <stdint.h>
+using namespace std;
+
+
+// instrumentation statements are compiled only if BPNET_STATS is defined
+#ifdef BPNET_STATS
+#define BPSTATS(statement)	statement
+#else
+#define BPSTATS(statement)
+#endif
+
+
+//////////////////////////////////////////////////////////////////////
+// BPStats - hot path counters of a network.
+//
+// Records for each layer the time spent in the forward pass, in
+// error computation (backward) and in weight updates, and the number
+// of samples evaluated; for the network the number of weight updates
+// and the time trainers waited for patterns to be read.
+//
+// Times are wall-clock nanoseconds of each layer step. The update
+// step of learn() adjusts all layers at once, its per-layer times are
+// the sum over the threads working on the layer.
+//
+// Counters are updated with relaxed atomics, so any number of threads
+// may record at once. The network records only when compiled with
+// BPNET_STATS (see the BPSTATS macro), otherwise all counters stay 0.
+//
+// Hardware counters (cycles, instructions, cache and branch misses)
+// use perf_event_open on Linux. They count the thread that enabled
+// them and threads it creates afterwards.
+//////////////////////////////////////////////////////////////////////
+class BPStats
+{
+// Types
+public:
+	enum Phase
+	{
+		FORWARD = 0,	// run/runBatch/forward
+		BACKWARD,		// error computation
+		UPDATE,			// weight updates (and gradient accumulation)
+		NUM_PHASES
+	};
+
+	// counters of a layer
+	struct Layer
+	{
+		uint64_t	time[NUM_PHASES];	// nanoseconds in each phase
+		uint64_t	samples;			// samples evaluated
+	};
+
+	// hardware counters (valid - counters were enabled and read)
+	struct Hardware
+	{
+		bool		valid;
+		uint64_t	cycles;
+		uint64_t	instructions;
+		uint64_t	cacheMisses;
+		uint64_t	branchMisses;
+	};
+
+	// snapshot of all counters
+	struct Snapshot
+	{
+		vector<Layer>	layers;		// one entry per layer (the input layer's are 0)
+		uint64_t		updates;	// weight updates of the network
+		uint64_t		ioWait;		// nanoseconds trainers waited for patterns
+		Hardware		hardware;
+	};
+
+// Methods
+public:
+	virtual ~BPStats();					// destructor
+	BPStats();							// default c-tor
+	BPStats(const BPStats& other);		// copy c-tor (hardware counters are not copied)
+	BPStats& operator=(const BPStats& other);
+
+	// is recording compiled in (BPNET_STATS)
+	static bool		compiled();
+
+	// monotonic time in nanoseconds
+	static uint64_t	now();
+
+	// set number of layers, counters are reset
+	void	create(int numLayers);
+
+	// zero all counters
+	void	reset();
+
+	// add time since start to a phase of a layer
+	void	addTime(Phase phase, int layer, uint64_t start)
+	{
+		_layers[layer].time[phase].fetch_add( now() - start, memory_order_relaxed );
+	}
+
+	// count evaluated samples of a layer
+	void	addSamples(int layer, uint64_t n)	{ _layers[layer].samples.fetch_add( n, memory_order_relaxed ); }
+
+	// count weight updates
+	void	addUpdates(uint64_t n)				{ _updates.fetch_add( n, memory_order_relaxed ); }
+
+	// add time since start to pattern wait time
+	void	addIOWait(uint64_t start)			{ _ioWait.fetch_add( now() - start, memory_order_relaxed ); }
+
+	// start/stop hardware counters (false if not available)
+	bool	enableHardware(bool enable);
+	bool	hardwareEnabled() const		{ return _perfGroup >= 0; }
+
+	// get current counters
+	Snapshot	snapshot() const;
+
+	// write a snapshot as a table
+	static void	print(ostream& ost, const Snapshot& stats);
+
+protected:
+
+	// copy counter values of another object
+	void	copy(const BPStats& other);
+
+// Types
+protected:
+
+	// atomic counters of a layer
+	struct Counters
+	{
+		atomic<uint64_t>	time[NUM_PHASES];
+		atomic<uint64_t>	samples;
+	};
+
+// Members
+protected:
+
+	int						_numLayers;		// number of layers
+	unique_ptr<Counters[]>	_layers;		// counters of each layer
+	atomic<uint64_t>		_updates;		// weight updates
+	atomic<uint64_t>		_ioWait;		// pattern wait time
+
+	int						_perfGroup;		// perf event group leader (-1 - disabled)
+	int						_perfEvents[3];	// other perf events of the group
+};
+
+
+#endif // _BPSTATS_H
@@ -0,0 +1,253 @@
+// BPStreamTrainer.cpp: implementation of the BPStreamTrainer class.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <cassert>
+#include <thread>
+#include "BPStreamTrainer.h"
+#include "BPNet.h"
+#include "BPRandom.h"
+
+// default number of patterns per chunk
+#define DEFAULT_CHUNK_SIZE	65536
+
+
+//////////////////////////////////////////////////////////////////////
+// Construction/Destruction
+//////////////////////////////////////////////////////////////////////
+
+template <class T>
+BPStreamTrainerT<T>::~BPStreamTrainerT()
+{
+	close();
+}
+
+
+template <class T>
+BPStreamTrainerT<T>::BPStreamTrainerT(Net* net) :	_pNet(net),
+													_chunkSize(DEFAULT_CHUNK_SIZE),
+													_batchSize(1),
+													_shuffle(true),
+													_seed(0),
+													_epoch(0),
+													_patternCount(0),
+													_fail(false)
+{
+	assert( _pNet != NULL );
+}
+
+
+//====================================================================
+// Open pattern file
+//====================================================================
+template <class T>
+bool BPStreamTrainerT<T>::open(const char* fileName)
+{
+	int numLayers = _pNet->getNumLayers();
+	assert( numLayers != 0 );
+
+	_epoch	= 0;
+	_fail	= false;
+
+	return _reader.open( fileName, _pNet->getNumNodes(0), _pNet->getNumNodes(numLayers-1) );
+}
+
+
+//====================================================================
+// Close pattern file and release chunk buffers
+//====================================================================
+template <class T>
+void BPStreamTrainerT<T>::close()
+{
+	_reader.close();
+
+	for (int k = 0; k != 2; ++k)
+	{
+		_chunks[k].set.clear();
+		vector<const Pattern*>().swap(_chunks[k].order);
+	}
+}
+
+
+//====================================================================
+// Set number of patterns per chunk
+//====================================================================
+template <class T>
+void BPStreamTrainerT<T>::setChunkSize(size_t size)
+{
+	assert( size > 0 );
+
+	_chunkSize = size;
+}
+
+
+//====================================================================
+// Set number of patterns per weight update
+//====================================================================
+template <class T>
+void BPStreamTrainerT<T>::setBatchSize(int size)
+{
+	assert( size > 0 );
+
+	_batchSize = size;
+}
+
+
+//====================================================================
+// Enable/disable shuffling
+//====================================================================
+template <class T>
+void BPStreamTrainerT<T>::setShuffle(bool shuffle, uint64_t seed)
+{
+	_shuffle	= shuffle;
+	_seed		= seed;
+}
+
+
+//====================================================================
+// Train one pass over the file
+//====================================================================
+template <class T>
+double BPStreamTrainerT<T>::trainEpoch()
+{
+	assert( _reader.isOpen() );
+
+	for (int k = 0; k != 2; ++k)
+	{
+		_chunks[k].full = false;
+		_chunks[k].last = false;
+	}
+
+	_patternCount = 0;
+
+	// a different order every epoch
+	uint64_t seed = _seed + (uint64_t)_epoch * 0x9E3779B97F4A7C15ULL;
+
+	thread io( &BPStreamTrainerT::readEpoch, this, seed );
+
+	double sumSquared = 0;
+	for (int k = 0; ; k ^= 1)
+	{
+		Chunk& chunk = _chunks[k];
+
+		// wait for I/O thread to fill chunk
+		{
+			BPSTATS( uint64_t start = BPStats::now() );
+
+			unique_lock<mutex> lock(_mutex);
+			_filled.wait( lock, [&]{ return chunk.full; } );
+
+			BPSTATS( _pNet->getStats().addIOWait(start) );
+		}
+
+		bool	last	= chunk.last;
+		size_t	n		= chunk.order.size();
+
+		if ( n != 0 )
+			sumSquared += _pNet->trainPatterns( &chunk.order[0], n, _batchSize );
+
+		_patternCount += n;
+
+		// hand chunk back to I/O thread
+		{
+			lock_guard<mutex> lock(_mutex);
+			chunk.full = false;
+		}
+		_freed.notify_one();
+
+		if ( last )
+			break;
+	}
+
+	io.join();
+
+	_fail = _reader.fail();
+	++_epoch;
+
+	return sumSquared;
+}
+
+
+//====================================================================
+// I/O thread: read chunks of one epoch
+//====================================================================
+template <class T>
+void BPStreamTrainerT<T>::readEpoch(uint64_t seed)
+{
+	uint64_t state = seed;
+
+	_reader.rewind();
+
+	// binary files can be read in any order: shuffle order of chunks
+	vector<size_t> chunkOrder;
+	if ( _reader.isBinary() )
+	{
+		size_t numChunks = (_reader.size() + _chunkSize - 1) / _chunkSize;
+		for (size_t i = 0; i != numChunks; ++i)
+			chunkOrder.push_back(i);
+
+		if ( _shuffle && numChunks != 0 )
+			BPRandom::shuffle( &chunkOrder[0], numChunks, state );
+	}
+
+	for (size_t index = 0, k = 0; ; ++index, k ^= 1)
+	{
+		Chunk& chunk = _chunks[k];
+
+		// wait for training thread to release chunk
+		{
+			unique_lock<mutex> lock(_mutex);
+			_freed.wait( lock, [&]{ return !chunk.full; } );
+		}
+
+		// storage is kept from previous chunks
+		chunk.set.resize(0);
+
+		size_t	n		= 0;
+		bool	last	= false;
+		if ( _reader.isBinary() )
+		{
+			if ( index < chunkOrder.size() && _reader.seek(chunkOrder[index] * _chunkSize) )
+				n = _reader.read(chunk.set, _chunkSize);
+
+			last = ( index + 1 >= chunkOrder.size() );
+		}
+		else
+		{
+			chunk.set.reserve(_chunkSize);
+			n = _reader.read(chunk.set, _chunkSize);
+
+			last = ( n < _chunkSize || _reader.eof() );
+		}
+
+		last = ( last || _reader.fail() );
+
+		const Pattern* const* patterns = chunk.set.patterns();
+		chunk.order.assign( patterns, patterns + n );
+
+		if ( _shuffle && n != 0 )
+			BPRandom::shuffle( &chunk.order[0], n, state );
+
+		{
+			lock_guard<mutex> lock(_mutex);
+			chunk.full = true;
+			chunk.last = last;
+		}
+		_filled.notify_one();
+
+		if ( last )
+			break;
+	}
+}
+
+
+// explicit instantiation
+template class BPStreamTrainerT<double>;
+template class BPStreamTrainerT<float>;
\ No newline at end of file
@@ -0,0 +1,131 @@
+// BPStreamTrainer.h: interface for the BPStreamTrainer class.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+
+#ifndef _BPSTREAMTRAINER_H
+#define _BPSTREAMTRAINER_H
+
+#include <cstddef>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <stdint.h>
+#include "PatternSet.h"
+#include "PatternReader.h"
+using namespace std;
+
+template <class T> class BPNetT;
+
+
+//////////////////////////////////////////////////////////////////////
+// BPStreamTrainerT - trains a network from a pattern file that does
+// not have to fit in memory.
+//
+// The file is read in chunks of a fixed number of patterns by a
+// background I/O thread into one of two chunk buffers, while the
+// network is trained on the other one (double buffering), so reading
+// and parsing overlap with training. Each chunk is a shuffle window:
+// its patterns are presented in a new random order every epoch
+// (binary files are also visited in a random chunk order).
+//
+// Memory use is bounded by two chunks and the reader's buffer,
+// independent of the size of the file.
+//////////////////////////////////////////////////////////////////////
+template <class T>
+class BPStreamTrainerT
+{
+// Types
+public:
+	typedef BPNetT<T>			Net;		// trained network
+	typedef PatternT<T>			Pattern;	// pattern of the same precision
+	typedef PatternSetT<T>		PatternSet;	// chunk storage
+	typedef PatternReaderT<T>	Reader;		// pattern file reader
+
+// Methods
+public:
+	virtual ~BPStreamTrainerT();		// destructor
+	explicit BPStreamTrainerT(Net* net);	// c-tor
+
+	// open a pattern file (text or binary PatternSet) matching the network's input/output layers
+	bool	open(const char* fileName);
+
+	// close pattern file
+	void	close();
+
+	// set/get number of patterns per chunk (shuffle window)
+	void	setChunkSize(size_t size);
+	size_t	getChunkSize() const	{ return _chunkSize; }
+
+	// set/get number of patterns per weight update
+	// (1 - online training with run()/learn(), default)
+	void	setBatchSize(int size);
+	int		getBatchSize() const	{ return _batchSize; }
+
+	// enable/disable shuffling, seed selects the sequence of orders
+	void	setShuffle(bool shuffle, uint64_t seed = 0);
+
+	// train one pass over the file, returns sum of squared output errors
+	// (before adjustment). check fail() for read errors
+	double	trainEpoch();
+
+	// get number of patterns trained in last epoch
+	size_t	getPatternCount() const	{ return _patternCount; }
+
+	// get number of completed epochs
+	int		getEpoch() const		{ return _epoch; }
+
+	// did last epoch stop on a read error
+	bool	fail() const			{ return _fail; }
+
+protected:
+
+	// I/O thread: read chunks of one epoch into free buffers
+	void	readEpoch(uint64_t seed);
+
+// Types
+protected:
+
+	// chunk buffer
+	struct Chunk
+	{
+		PatternSet				set;	// patterns of chunk
+		vector<const Pattern*>	order;	// training order
+		bool					full;	// filled by I/O thread
+		bool					last;	// no more chunks follow
+	};
+
+// Members
+protected:
+
+	Net*				_pNet;			// trained network
+	Reader				_reader;		// pattern file
+
+	size_t				_chunkSize;		// patterns per chunk
+	int					_batchSize;		// patterns per weight update
+	bool				_shuffle;		// shuffle each chunk
+	uint64_t			_seed;			// shuffle seed
+
+	Chunk				_chunks[2];		// double buffer
+	mutex				_mutex;			// guards chunk state
+	condition_variable	_filled;		// signaled when a chunk is full
+	condition_variable	_freed;			// signaled when a chunk is free
+
+	int					_epoch;			// completed epochs
+	size_t				_patternCount;	// patterns of last epoch
+	bool				_fail;			// read error in last epoch
+};
+
+
+// double and float trainers
+typedef BPStreamTrainerT<double>	BPStreamTrainer;
+typedef BPStreamTrainerT<float>		BPStreamTrainerF;
+
+
+#endif // _BPSTREAMTRAINER_H
@@ -0,0 +1,165 @@
+// BPThreadPool.cpp: implementation of the BPThreadPool class.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <cassert>
+#include "BPThreadPool.h"
+
+// set on pool worker threads, nested run() calls execute serially
+static thread_local bool t_inPool = false;
+
+
+//////////////////////////////////////////////////////////////////////
+// Construction/Destruction
+//////////////////////////////////////////////////////////////////////
+
+BPThreadPool::~BPThreadPool()
+{
+	{
+		lock_guard<mutex> lock(_mutex);
+		_stop = true;
+	}
+	_startCond.notify_all();
+
+	int numWorkers = _workers.size();
+	for (int i = 0; i != numWorkers; ++i)
+		_workers[i].join();
+}
+
+
+BPThreadPool::BPThreadPool(int numThreads) :	_numThreads(numThreads),
+												_generation(0),
+												_pending(0),
+												_stop(false),
+												_func(NULL),
+												_context(NULL),
+												_count(0)
+{
+	if ( _numThreads <= 0 )
+		_numThreads = hardwareThreads();
+
+	// the calling thread is used as the first thread
+	for (int i = 1; i < _numThreads; ++i)
+		_workers.push_back( thread(&BPThreadPool::workerLoop, this, i) );
+}
+
+
+//====================================================================
+// Get number of hardware threads
+//====================================================================
+int BPThreadPool::hardwareThreads()
+{
+	int n = (int)thread::hardware_concurrency();
+
+	return (n > 0) ? n : 1;
+}
+
+
+//====================================================================
+// Get part of [0, count) handled by thread 'index'
+//====================================================================
+void BPThreadPool::getRange(int count, int index, int& first, int& last) const
+{
+	assert( index >= 0 && index < _numThreads );
+
+	first	= (int)( (long long)count * index		/ _numThreads );
+	last	= (int)( (long long)count * (index + 1) / _numThreads );
+}
+
+
+//====================================================================
+// Run task on all threads and wait for completion
+//====================================================================
+void BPThreadPool::run(int count, TaskFunc func, void* context)
+{
+	assert( func != NULL );
+
+	if ( count <= 0 )
+		return;
+
+	// single thread, small task or nested call from a worker
+	if ( _numThreads == 1 || count == 1 || t_inPool )
+	{
+		func(context, 0, count);
+		return;
+	}
+
+	lock_guard<mutex> runLock(_runMutex);
+
+	// post task
+	{
+		lock_guard<mutex> lock(_mutex);
+		_func		= func;
+		_context	= context;
+		_count		= count;
+		_pending	= _numThreads - 1;
+		++_generation;
+	}
+	_startCond.notify_all();
+
+	// process first part on calling thread
+	int first, last;
+	getRange(count, 0, first, last);
+	if ( first != last )
+	{
+		t_inPool = true;
+		func(context, first, last);
+		t_inPool = false;
+	}
+
+	// wait for workers
+	unique_lock<mutex> lock(_mutex);
+	while ( _pending != 0 )
+		_doneCond.wait(lock);
+}
+
+
+//====================================================================
+// Worker thread main loop
+//====================================================================
+void BPThreadPool::workerLoop(int index)
+{
+	t_inPool = true;
+
+	unsigned generation = 0;
+	for (;;)
+	{
+		TaskFunc	func;
+		void*		context;
+		int			count;
+
+		// wait for next task
+		{
+			unique_lock<mutex> lock(_mutex);
+			while ( !_stop && _generation == generation )
+				_startCond.wait(lock);
+
+			if ( _stop )
+				return;
+
+			generation	= _generation;
+			func		= _func;
+			context		= _context;
+			count		= _count;
+		}
+
+		int first, last;
+		getRange(count, index, first, last);
+		if ( first != last )
+			func(context, first, last);
+
+		// report completion
+		{
+			lock_guard<mutex> lock(_mutex);
+			if ( --_pending == 0 )
+				_doneCond.notify_one();
+		}
+	}
+}
@@ -0,0 +1,86 @@
+// BPThreadPool.h: interface for the BPThreadPool class.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+
+#ifndef _BPTHREADPOOL_H
+#define _BPTHREADPOOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+using namespace std;
+
+
+//////////////////////////////////////////////////////////////////////
+// BPThreadPool - fixed set of worker threads for data-parallel loops.
+//
+// run() splits a range of items into one contiguous part per thread
+// and returns only after all parts are done, so consecutive calls
+// act as a barrier (e.g. between network layers).
+// The calling thread processes the first part itself.
+//////////////////////////////////////////////////////////////////////
+class BPThreadPool
+{
+// Types
+public:
+	// process items [first, last)
+	typedef void (*TaskFunc)(void* context, int first, int last);
+
+// Methods
+public:
+	virtual ~BPThreadPool();						// destructor
+	explicit BPThreadPool(int numThreads = 0);		// c-tor (0 - one thread per core)
+
+	// get number of threads (including the calling thread)
+	int		numThreads() const	{ return _numThreads; }
+
+	// split [0, count) between threads and wait until all parts are done
+	void	run(int count, TaskFunc func, void* context);
+
+	// same as run(), func is any callable taking (int first, int last)
+	template <class F>
+	void	parallelFor(int count, const F& func)	{ run(count, &invoke<F>, (void*)&func); }
+
+	// get part of [0, count) handled by thread 'index'
+	void	getRange(int count, int index, int& first, int& last) const;
+
+	// number of hardware threads
+	static int	hardwareThreads();
+
+protected:
+
+	template <class F>
+	static void	invoke(void* context, int first, int last)	{ (*(const F*)context)(first, last); }
+
+	void	workerLoop(int index);
+
+// Members
+protected:
+
+	int					_numThreads;	// number of threads (including caller)
+	vector<thread>		_workers;		// worker threads
+
+	mutex				_runMutex;		// serializes run() calls
+	mutex				_mutex;			// protects state below
+	condition_variable	_startCond;		// signaled when a new task is posted
+	condition_variable	_doneCond;		// signaled when last worker finishes
+
+	unsigned			_generation;	// incremented for each posted task
+	int					_pending;		// number of workers still running
+	bool				_stop;			// workers should exit
+
+	TaskFunc			_func;			// current task
+	void*				_context;		// current task context
+	int					_count;			// current task item count
+};
+
+
+#endif // _BPTHREADPOOL_H
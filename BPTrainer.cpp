@@ -0,0 +1,367 @@
+// BPTrainer.cpp: implementation of the BPTrainer class.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include "BPTrainer.h"
+#include "BPNet.h"
+#include "BPRandom.h"
+
+// default maximal number of epochs
+#define DEFAULT_MAX_EPOCHS	100
+
+// number of patterns evaluated at once
+#define EVALUATE_BLOCK		256
+
+static const double PI = 3.14159265358979323846;
+
+
+//////////////////////////////////////////////////////////////////////
+// Construction/Destruction
+//////////////////////////////////////////////////////////////////////
+
+template <class T>
+BPTrainerT<T>::~BPTrainerT()
+{
+
+}
+
+
+template <class T>
+BPTrainerT<T>::BPTrainerT(Net* net) :	_pNet(net),
+										_train(NULL),
+										_valid(NULL),
+										_batchSize(1),
+										_shuffle(true),
+										_seed(0),
+										_maxEpochs(DEFAULT_MAX_EPOCHS),
+										_schedule(CONSTANT),
+										_baseLR(0),
+										_minLR(0),
+										_gamma(0.1),
+										_period(0),
+										_patience(0),
+										_minDelta(0),
+										_statsEpochs(0),
+										_statsStream(NULL)
+{
+	assert( _pNet != NULL );
+
+	reset();
+}
+
+
+//====================================================================
+// Set training and validation sets
+//====================================================================
+template <class T>
+void BPTrainerT<T>::setData(const PatternSet* train, const PatternSet* validation)
+{
+	assert( _pNet->getNumLayers() != 0 );
+	assert( train == NULL || (train->inSize() == _pNet->getNumNodes(0) &&
+							  train->outSize() == _pNet->getNumNodes(_pNet->getNumLayers()-1)) );
+	assert( validation == NULL || (validation->inSize() == _pNet->getNumNodes(0) &&
+								   validation->outSize() == _pNet->getNumNodes(_pNet->getNumLayers()-1)) );
+
+	_train	= train;
+	_valid	= validation;
+
+	reset();
+}
+
+
+//====================================================================
+// Set number of patterns per weight update
+//====================================================================
+template <class T>
+void BPTrainerT<T>::setBatchSize(int size)
+{
+	assert( size > 0 );
+
+	_batchSize = size;
+}
+
+
+//====================================================================
+// Enable/disable shuffling
+//====================================================================
+template <class T>
+void BPTrainerT<T>::setShuffle(bool shuffle, uint64_t seed)
+{
+	_shuffle	= shuffle;
+	_seed		= seed;
+}
+
+
+//====================================================================
+// Set maximal number of epochs
+//====================================================================
+template <class T>
+void BPTrainerT<T>::setMaxEpochs(int epochs)
+{
+	assert( epochs >= 0 );
+
+	_maxEpochs = epochs;
+}
+
+
+//====================================================================
+// Set learning rate schedule
+//====================================================================
+template <class T>
+void BPTrainerT<T>::setSchedule(Schedule schedule, double gamma, int period)
+{
+	assert( schedule >= CONSTANT && schedule <= COSINE && period >= 0 );
+
+	_schedule	= schedule;
+	_gamma		= gamma;
+	_period		= period;
+}
+
+
+//====================================================================
+// Get learning rate of an epoch
+//====================================================================
+template <class T>
+double BPTrainerT<T>::learningRate(int epoch) const
+{
+	int period = ( _period > 0 ) ? _period : _maxEpochs;
+
+	switch (_schedule)
+	{
+	case STEP:
+		return _baseLR * pow( _gamma, (double)(period > 0 ? epoch / period : 0) );
+
+	case EXPONENTIAL:
+		return _baseLR * pow( _gamma, (double)epoch );
+
+	case COSINE:
+		{
+			// restart at the end of each cycle
+			double t = ( period > 0 ) ? (double)(epoch % period) / period : 0;
+			return _minLR + (_baseLR - _minLR) * 0.5 * ( 1.0 + cos(PI * t) );
+		}
+
+	default:
+		break;
+	}
+
+	return _baseLR;
+}
+
+
+//====================================================================
+// Set early stopping
+//====================================================================
+template <class T>
+void BPTrainerT<T>::setEarlyStopping(int patience, double minDelta)
+{
+	assert( patience >= 0 && minDelta >= 0 );
+
+	_patience	= patience;
+	_minDelta	= minDelta;
+}
+
+
+//====================================================================
+// Dump counters periodically
+//====================================================================
+template <class T>
+void BPTrainerT<T>::setStatsDump(int epochs, ostream* ost)
+{
+	assert( epochs >= 0 && (epochs == 0 || ost != NULL) );
+
+	_statsEpochs	= epochs;
+	_statsStream	= ost;
+}
+
+
+//====================================================================
+// Start training over
+//====================================================================
+template <class T>
+void BPTrainerT<T>::reset()
+{
+	_baseLR		= _pNet->getLearningRate();
+	_bestEpoch	= -1;
+	_bestError	= 0;
+	_stopped	= false;
+
+	_best.clear();
+	_history.clear();
+}
+
+
+//====================================================================
+// Run one epoch
+//====================================================================
+template <class T>
+typename BPTrainerT<T>::Epoch BPTrainerT<T>::trainEpoch()
+{
+	assert( _train != NULL );
+
+	int numOutputs	= _pNet->getNumNodes( _pNet->getNumLayers() - 1 );
+	size_t n		= _train->size();
+
+	Epoch result;
+	result.epoch		= _history.size();
+	result.learningRate	= learningRate( result.epoch );
+
+	_pNet->setLearningRate( result.learningRate );
+
+	// a different order every epoch
+	const Pattern* const* patterns = _train->patterns();
+	_order.assign( patterns, patterns + n );
+
+	if ( _shuffle && n != 0 )
+	{
+		uint64_t state = _seed + (uint64_t)result.epoch * 0x9E3779B97F4A7C15ULL;
+		BPRandom::shuffle( &_order[0], n, state );
+	}
+
+	double sumSquared = ( n != 0 ) ? _pNet->trainPatterns( &_order[0], n, _batchSize ) : 0;
+
+	result.trainError = ( n != 0 ) ? sumSquared / ( (double)n * numOutputs ) : 0;
+	result.validError = ( _valid != NULL ) ? evaluate( *_valid ) : 0;
+
+	_history.push_back( result );
+
+	if ( _statsEpochs > 0 && (result.epoch + 1) % _statsEpochs == 0 )
+	{
+		*_statsStream << "epoch " << result.epoch << endl;
+		BPStats::print( *_statsStream, _pNet->stats() );
+	}
+
+	// keep weights of lowest error
+	double error = ( _valid != NULL ) ? result.validError : result.trainError;
+	if ( _bestEpoch < 0 || error < _bestError - _minDelta )
+	{
+		_bestEpoch	= result.epoch;
+		_bestError	= error;
+
+		if ( _patience > 0 )
+			saveBest();
+	}
+	else if ( _patience > 0 && result.epoch - _bestEpoch >= _patience )
+	{
+		_stopped = true;
+		restoreBest();
+	}
+
+	return result;
+}
+
+
+//====================================================================
+// Run epochs until done
+//====================================================================
+template <class T>
+int BPTrainerT<T>::train()
+{
+	int epochs = 0;
+	while ( !_stopped && getEpoch() < _maxEpochs )
+	{
+		trainEpoch();
+		++epochs;
+	}
+
+	return epochs;
+}
+
+
+//====================================================================
+// Mean squared output error over a pattern set
+//====================================================================
+template <class T>
+double BPTrainerT<T>::evaluate(const PatternSet& set)
+{
+	int		numOutputs	= set.outSize();
+	size_t	n			= set.size();
+
+	if ( n == 0 || numOutputs == 0 )
+		return 0;
+
+	_outputs.resize( (size_t)EVALUATE_BLOCK * numOutputs );
+
+	double sumSquared = 0;
+	for (size_t first = 0; first < n; first += EVALUATE_BLOCK)
+	{
+		size_t count = (n - first < EVALUATE_BLOCK) ? n - first : EVALUATE_BLOCK;
+
+		_pNet->runBatch( set.inputs() + first * set.inSize(), count, &_outputs[0] );
+
+		const T* desired = set.outputs() + first * numOutputs;
+		for (size_t i = 0; i != count * numOutputs; ++i)
+		{
+			double diff = desired[i] - _outputs[i];
+			sumSquared += diff * diff;
+		}
+	}
+
+	return sumSquared / ( (double)n * numOutputs );
+}
+
+
+//====================================================================
+// Save weights and biases of the best epoch
+//====================================================================
+template <class T>
+void BPTrainerT<T>::saveBest()
+{
+	_best.clear();
+
+	int numLayers = _pNet->getNumLayers();
+	for (int i = 1; i < numLayers; ++i)
+	{
+		const BPLayerT<T>& layer = _pNet->getLayer(i);
+
+		_best.insert( _best.end(), layer.weights(), layer.weights() + layer.weightCount() );
+
+		if ( layer.hasBias() )
+			_best.insert( _best.end(), layer.bias(), layer.bias() + layer.numNodes() );
+	}
+}
+
+
+//====================================================================
+// Restore weights and biases of the best epoch
+//====================================================================
+template <class T>
+void BPTrainerT<T>::restoreBest()
+{
+	if ( _best.empty() )
+		return;
+
+	const T* p = &_best[0];
+
+	int numLayers = _pNet->getNumLayers();
+	for (int i = 1; i < numLayers; ++i)
+	{
+		BPLayerT<T>& layer = _pNet->getLayer(i);
+
+		memcpy( layer.weights(), p, layer.weightCount() * sizeof(T) );
+		p += layer.weightCount();
+
+		if ( layer.hasBias() )
+		{
+			memcpy( layer.bias(), p, layer.numNodes() * sizeof(T) );
+			p += layer.numNodes();
+		}
+	}
+
+	assert( p == &_best[0] + _best.size() );
+}
+
+
+// explicit instantiation
+template class BPTrainerT<double>;
+template class BPTrainerT<float>;
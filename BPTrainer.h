@@ -0,0 +1,185 @@
+// BPTrainer.h: interface for the BPTrainer class.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+
+#ifndef _BPTRAINER_H
+#define _BPTRAINER_H
+
+#include <cstddef>
+#include <vector>
+#include <ostream>
+#include <stdint.h>
+#include "PatternSet.h"
+using namespace std;
+
+template <class T> class BPNetT;
+
+
+//////////////////////////////////////////////////////////////////////
+// BPTrainerT - training loop of a network over an in-memory
+// training set, with an optional validation set.
+//
+// Each epoch presents the training patterns in a new random order
+// (online with learn(), or in mini-batches with trainBatch), then
+// evaluates the validation set. The learning rate of each epoch is
+// set on the network from a schedule:
+//
+//	CONSTANT		lr = lr0
+//	STEP			lr = lr0 * gamma ^ floor(epoch / period)
+//	EXPONENTIAL		lr = lr0 * gamma ^ epoch
+//	COSINE			lr = lrMin + (lr0 - lrMin) * (1 + cos(pi * (epoch % period) / period)) / 2
+//
+// lr0 is the network's learning rate when the trainer is reset.
+// COSINE approaches lrMin at the end of each cycle and restarts at lr0
+// every period epochs (warm restarts).
+//
+// Early stopping watches the validation error (the training error if
+// there is no validation set) and stops when it did not improve for
+// a number of epochs, restoring the weights of the best epoch.
+//////////////////////////////////////////////////////////////////////
+template <class T>
+class BPTrainerT
+{
+// Types
+public:
+	typedef BPNetT<T>			Net;		// trained network
+	typedef PatternT<T>			Pattern;	// pattern of the same precision
+	typedef PatternSetT<T>		PatternSet;	// training/validation data
+
+	// learning rate schedules
+	enum Schedule
+	{
+		CONSTANT = 0,
+		STEP,
+		EXPONENTIAL,
+		COSINE
+	};
+
+	// result of one epoch
+	struct Epoch
+	{
+		int		epoch;			// epoch number (from 0)
+		double	learningRate;	// learning rate used
+		double	trainError;		// mean squared training error (before adjustment)
+		double	validError;		// mean squared validation error (after the epoch, 0 without validation set)
+	};
+
+// Methods
+public:
+	virtual ~BPTrainerT();				// destructor
+	explicit BPTrainerT(Net* net);		// c-tor
+
+	// set training and validation sets (validation may be NULL).
+	// the sets must stay valid while training, the trainer is reset
+	void	setData(const PatternSet* train, const PatternSet* validation = NULL);
+
+	// set/get number of patterns per weight update
+	// (1 - online training with run()/learn(), default)
+	void	setBatchSize(int size);
+	int		getBatchSize() const	{ return _batchSize; }
+
+	// enable/disable shuffling, seed selects the sequence of orders
+	void	setShuffle(bool shuffle, uint64_t seed = 0);
+
+	// set/get maximal number of epochs run by train()
+	void	setMaxEpochs(int epochs);
+	int		getMaxEpochs() const	{ return _maxEpochs; }
+
+	// set learning rate schedule. gamma is the decay factor of STEP and
+	// EXPONENTIAL, period the epochs per STEP or of a COSINE cycle
+	// (0 - maximal number of epochs)
+	void	setSchedule(Schedule schedule, double gamma = 0.1, int period = 0);
+
+	// set final learning rate of COSINE
+	void	setMinLearningRate(double lr)	{ _minLR = lr; }
+
+	// get learning rate of an epoch
+	double	learningRate(int epoch) const;
+
+	// stop when the error did not improve by more than minDelta for
+	// patience epochs (0 - disabled, default)
+	void	setEarlyStopping(int patience, double minDelta = 0);
+
+	// write the network's counters (see BPNet::stats) to a stream after
+	// every given number of epochs (0 - never, default)
+	void	setStatsDump(int epochs, ostream* ost);
+
+	// start over: epoch count, history and best weights are cleared
+	// and the current learning rate of the network becomes lr0
+	void	reset();
+
+	// run one epoch
+	Epoch	trainEpoch();
+
+	// run epochs until the maximal number of epochs or early stopping,
+	// returns number of epochs run
+	int		train();
+
+	// mean squared output error of the network over a pattern set
+	double	evaluate(const PatternSet& set);
+
+	// get results of all epochs since reset
+	const vector<Epoch>&	history() const	{ return _history; }
+
+	// get number of completed epochs
+	int		getEpoch() const			{ return _history.size(); }
+
+	// get best epoch (-1 if none) and its error
+	int		getBestEpoch() const		{ return _bestEpoch; }
+	double	getBestError() const		{ return _bestError; }
+
+	// did early stopping end training
+	bool	stopped() const				{ return _stopped; }
+
+protected:
+
+	// save/restore weights and biases of the network
+	void	saveBest();
+	void	restoreBest();
+
+// Members
+protected:
+
+	Net*				_pNet;			// trained network
+	const PatternSet*	_train;			// training set
+	const PatternSet*	_valid;			// validation set (may be NULL)
+
+	int					_batchSize;		// patterns per weight update
+	bool				_shuffle;		// shuffle every epoch
+	uint64_t			_seed;			// shuffle seed
+	int					_maxEpochs;		// epochs run by train()
+
+	Schedule			_schedule;		// learning rate schedule
+	double				_baseLR;		// lr0
+	double				_minLR;			// final COSINE learning rate
+	double				_gamma;			// STEP/EXPONENTIAL decay
+	int					_period;		// STEP/COSINE period in epochs
+
+	int					_patience;		// early stopping patience (0 - disabled)
+	double				_minDelta;		// minimal improvement
+	int					_bestEpoch;		// epoch of lowest error
+	double				_bestError;		// lowest error
+	bool				_stopped;		// early stopping ended training
+	int					_statsEpochs;	// epochs between counter dumps (0 - never)
+	ostream*			_statsStream;	// counter dump stream
+	vector<T>			_best;			// weights and biases of best epoch
+
+	vector<const Pattern*>	_order;		// training order
+	vector<T>				_outputs;	// evaluation outputs
+	vector<Epoch>			_history;	// results of each epoch
+};
+
+
+// double and float trainers
+typedef BPTrainerT<double>	BPTrainer;
+typedef BPTrainerT<float>	BPTrainerF;
+
+
+#endif // _BPTRAINER_H
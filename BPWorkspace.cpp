@@ -0,0 +1,92 @@
+// BPWorkspace.cpp: implementation of the BPWorkspace class.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <cassert>
+#include "BPWorkspace.h"
+
+
+//////////////////////////////////////////////////////////////////////
+// Construction/Destruction
+//////////////////////////////////////////////////////////////////////
+
+template <class T>
+BPWorkspaceT<T>::~BPWorkspaceT()
+{
+
+}
+
+
+template <class T>
+BPWorkspaceT<T>::BPWorkspaceT() :	_batchCapacity(0),
+									_sumSquared(0)
+{
+
+}
+
+
+//====================================================================
+// Allocate storage
+//====================================================================
+template <class T>
+void BPWorkspaceT<T>::create(const vector<int>& nodeCnt, int batchSize, bool gradients)
+{
+	assert( batchSize >= 0 );
+
+	_nodeCount		= nodeCnt;
+	_batchCapacity	= batchSize;
+	_sumSquared		= 0;
+
+	int numLayers = _nodeCount.size();
+
+	_values.resize(numLayers);
+	_errors.resize(numLayers);
+	for (int i = 0; i != numLayers; ++i)
+	{
+		_values[i].resize( (size_t)batchSize * _nodeCount[i] );
+		_errors[i].resize( (size_t)batchSize * _nodeCount[i] );
+	}
+
+	_gradients.clear();
+	if ( gradients )
+	{
+		_gradients.resize(numLayers);
+		for (int i = 1; i < numLayers; ++i)
+			_gradients[i].resize( (size_t)_nodeCount[i] * _nodeCount[i-1] + _nodeCount[i] );
+	}
+}
+
+
+//====================================================================
+// Make sure workspace fits network and batch size
+//====================================================================
+template <class T>
+void BPWorkspaceT<T>::reserve(const vector<int>& nodeCnt, int batchSize, bool gradients)
+{
+	if ( _nodeCount != nodeCnt || _batchCapacity < batchSize || (gradients && !hasGradients()) )
+		create(nodeCnt, batchSize, gradients);
+}
+
+
+//====================================================================
+// Set all gradients to zero
+//====================================================================
+template <class T>
+void BPWorkspaceT<T>::zeroGradients()
+{
+	int numGradients = _gradients.size();
+	for (int i = 0; i != numGradients; ++i)
+		_gradients[i].zero();
+}
+
+
+// explicit instantiation
+template class BPWorkspaceT<double>;
+template class BPWorkspaceT<float>;
\ No newline at end of file
@@ -0,0 +1,96 @@
+// BPWorkspace.h: interface for the BPWorkspace class.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+
+#ifndef _BPWORKSPACE_H
+#define _BPWORKSPACE_H
+
+#include <vector>
+#include "BPBuffer.h"
+using namespace std;
+
+
+//////////////////////////////////////////////////////////////////////
+// BPWorkspaceT - activation, error and gradient storage for evaluating
+// a network, kept apart from the network weights.
+//
+// Each thread that evaluates or trains a network uses its own
+// workspace, the network weights are only read (or updated once the
+// workspaces of all threads are done).
+//////////////////////////////////////////////////////////////////////
+template <class T>
+class BPWorkspaceT
+{
+// Methods
+public:
+	virtual ~BPWorkspaceT();	// destructor
+	BPWorkspaceT();				// default c-tor
+
+	// allocate storage for a network with the given number of nodes in
+	// each layer, for up to batchSize samples.
+	// gradient storage is allocated only if 'gradients' is true
+	void	create(const vector<int>& nodeCnt, int batchSize, bool gradients);
+
+	// make sure workspace fits network and batch size (keeps storage if it does)
+	void	reserve(const vector<int>& nodeCnt, int batchSize, bool gradients);
+
+	// get dimensions
+	int		numLayers()		const	{ return _nodeCount.size(); }
+	int		numNodes(int layer) const	{ return _nodeCount[layer]; }
+	int		batchCapacity() const	{ return _batchCapacity; }
+	bool	hasGradients()	const	{ return _gradients.size() != 0; }
+
+	// node values/errors of a layer: one row of numNodes per sample
+	T*				values(int layer)			{ return _values[layer].data(); }
+	const T*		values(int layer) const		{ return _values[layer].data(); }
+	T*				errors(int layer)			{ return _errors[layer].data(); }
+	const T*		errors(int layer) const		{ return _errors[layer].data(); }
+
+	// summed weight gradient of a layer's incoming links [numNodes x numInputs]
+	T*				gradient(int layer)			{ return _gradients[layer].data(); }
+	const T*		gradient(int layer) const	{ return _gradients[layer].data(); }
+
+	// summed bias gradient of a layer's nodes [numNodes] (follows the weight gradient)
+	T*				biasGradient(int layer)			{ return gradient(layer) + biasOffset(layer); }
+	const T*		biasGradient(int layer) const	{ return gradient(layer) + biasOffset(layer); }
+
+	// set all gradients to zero
+	void	zeroGradients();
+
+	// sum of squared output errors of the last batch
+	double	sumSquaredError() const				{ return _sumSquared; }
+	void	setSumSquaredError(double sse)		{ _sumSquared = sse; }
+
+protected:
+
+	// offset of the bias gradient in a layer's gradient storage
+	size_t	biasOffset(int layer) const		{ return (size_t)_nodeCount[layer] * _nodeCount[layer-1]; }
+
+// Members
+protected:
+
+	vector<int>					_nodeCount;		// number of nodes in each layer
+	int							_batchCapacity;	// max number of samples
+
+	vector< BPBuffer<T> >		_values;		// node values of each layer
+	vector< BPBuffer<T> >		_errors;		// node errors of each layer
+	vector< BPBuffer<T> >		_gradients;		// weight and bias gradients of each layer
+
+	double						_sumSquared;	// sum of squared output errors
+};
+
+
+
+// double and float workspaces
+typedef BPWorkspaceT<double>	BPWorkspace;
+typedef BPWorkspaceT<float>		BPWorkspaceF;
+
+
+#endif // _BPWORKSPACE_H
@@ -1,177 +1,259 @@
-// Pattern.cpp: implementation of the Pattern class.
-//
-// Copyright Gideon Pertzov, 2003
-//
-// This software is provided "as is" without express or implied
-// warranties. You may freely copy and compile this source into
-// applications you distribute provided that credit is given to
-// the original author.
-//
-//////////////////////////////////////////////////////////////////////
-#include <cstdarg>
-#include <cassert>
-#include <iostream>
-#include <iomanip>
-#include <fstream>
-#include "Pattern.h"
-
-
-//////////////////////////////////////////////////////////////////////
-// Construction/Destruction
-//////////////////////////////////////////////////////////////////////
-
-Pattern::~Pattern()
-{
-
-}
-
-
-Pattern::Pattern() : _id(-1)
-{
-
-}
-
-
-//====================================================================
-// Constructor with pattern dimensions supplied
-//====================================================================
-Pattern::Pattern(int inSize, int outSize) : _id(-1)
-{
-	assert (inSize > 0 && outSize > 0);
-
-	_inVec.resize(inSize);
-	_outVec.resize(outSize);	
-}
-
-
-//====================================================================
-// Constructor with pattern data supplied
-//====================================================================
-Pattern::Pattern( int inSize, int outSize, int id, ... )
-{
-	assert (inSize > 0 && outSize > 0);
-
-	_inVec.resize(inSize);
-	_outVec.resize(outSize);
-
-	_id = id;
-	
-	va_list vl;
-
-	va_start(vl, id );
-	
-	for (int i = 0; i != inSize; ++i)
-	   _inVec[i] = va_arg(vl, double);
-
-	for ( i = 0; i  != outSize; ++i)
-	   _outVec[i] = va_arg(vl, double);
-
-	va_end( vl );
-}
-
-
-//====================================================================
-// Get input value
-//====================================================================
-double Pattern::getInput(int index) const
-{
-	assert( index >= 0 && index < _inVec.size() );
-
-	return _inVec[index];
-}
-
-
-//====================================================================
-// Get output value
-//====================================================================
-double Pattern::getOutput(int index) const
-{
-	assert( index >= 0 && index < _outVec.size() );
-
-	return _outVec[index];
-
-}
-
-
-//====================================================================
-// Set input value
-//====================================================================
-void Pattern::setInput(double value, int index)
-{
-	assert( index >= 0 && index < _inVec.size() );
-
-	_inVec[index] = value;
-}
-
-
-//====================================================================
-// Set output value
-//====================================================================
-void Pattern::setOutput(double value, int index)
-{
-	assert( index >= 0 && index < _outVec.size() );
-
-	_outVec[index] = value;
-
-}
-
-
-//====================================================================
-// Save pattern to file
-//====================================================================
-bool Pattern::save( ofstream &ost ) const
-{
-	if ( !ost.good() )
-		return false;
-
-	ost << _id << "\t"; // pattern id
-
-	int numInputs = _inVec.size();
-	for(int i = 0; i != numInputs; ++i)
-		ost <<  setprecision(16) << _inVec[i] << "\t"; // input values
-
-	int numOutputs = _outVec.size();
-	for(i = 0; i != numOutputs; ++i)
-	{
-		ost <<  setprecision(16) << _outVec[i]; // output values
-		if ( i != numOutputs-1) 
-			 ost << "\t";
-	}
-
-	ost << endl;
-
-	return true;
-}
-
-
-//====================================================================
-// Load pattern from file
-//====================================================================
-bool Pattern::load( ifstream &ist )
-{
-	if ( !ist.good() )
-		return false;
-
-	ist >> _id; // pattern id
-
-	int numInputs = _inVec.size();
-	for(int i = 0; i != numInputs; ++i)
-		ist >> _inVec[i]; // input values
-
-	int numOutputs = _outVec.size();
-	for(i = 0; i != numOutputs; ++i)
-		ist >> _outVec[i]; // output values
-
-	// "eat" white space
-	char ch = ist.peek();
-	while ( isspace(ch) )
-	{
-		ch = ist.get();
-		if (ch == EOF)
-			break;
-
-		ch = ist.peek();
-	}
-
-	return true;
-}
+// Pattern.cpp: implementation of the Pattern class.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+#include <cstdarg>
+#include <cassert>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include "Pattern.h"
+
+
+//////////////////////////////////////////////////////////////////////
+// Construction/Destruction
+//////////////////////////////////////////////////////////////////////
+
+template <class T>
+PatternT<T>::~PatternT()
+{
+
+}
+
+
+template <class T>
+PatternT<T>::PatternT() :	_id(-1),
+							_inSize(0),
+							_outSize(0),
+							_pIn(NULL),
+							_pOut(NULL)
+{
+
+}
+
+
+//====================================================================
+// Constructor with pattern dimensions supplied
+//====================================================================
+template <class T>
+PatternT<T>::PatternT(int inSize, int outSize) :	_id(-1),
+													_inSize(inSize),
+													_outSize(outSize)
+{
+	assert (inSize > 0 && outSize > 0);
+
+	_data.resize(inSize + outSize);
+	_pIn	= &_data[0];
+	_pOut	= _pIn + inSize;
+}
+
+
+//====================================================================
+// Constructor with pattern data supplied
+//====================================================================
+template <class T>
+PatternT<T>::PatternT( int inSize, int outSize, int id, ... ) :	_inSize(inSize),
+																_outSize(outSize)
+{
+	assert (inSize > 0 && outSize > 0);
+
+	_data.resize(inSize + outSize);
+	_pIn	= &_data[0];
+	_pOut	= _pIn + inSize;
+
+	_id = id;
+	
+	va_list vl;
+
+	va_start(vl, id );
+	
+	for (int i = 0; i != inSize; ++i)
+	   _pIn[i] = va_arg(vl, double);
+
+	for (int i = 0; i != outSize; ++i)
+	   _pOut[i] = va_arg(vl, double);
+
+	va_end( vl );
+}
+
+
+//====================================================================
+// Constructor of a view of external storage
+//====================================================================
+template <class T>
+PatternT<T>::PatternT(T* in, int inSize, T* out, int outSize, int id) :	_id(id),
+																		_inSize(inSize),
+																		_outSize(outSize),
+																		_pIn(in),
+																		_pOut(out)
+{
+	assert (in != NULL && out != NULL && inSize > 0 && outSize > 0);
+}
+
+
+//====================================================================
+// Copy constructor
+//====================================================================
+template <class T>
+PatternT<T>::PatternT(const PatternT& other) :	_id(-1),
+												_inSize(0),
+												_outSize(0),
+												_pIn(NULL),
+												_pOut(NULL)
+{
+	*this = other;
+}
+
+
+//====================================================================
+// Assignment
+//====================================================================
+template <class T>
+PatternT<T>& PatternT<T>::operator=(const PatternT& other)
+{
+	if (this == &other)
+		return *this;
+
+	_id			= other._id;
+	_inSize		= other._inSize;
+	_outSize	= other._outSize;
+	_data		= other._data;
+
+	if ( _data.empty() )
+	{
+		// view (or empty pattern) - share storage
+		_pIn	= other._pIn;
+		_pOut	= other._pOut;
+	}
+	else
+	{
+		_pIn	= &_data[0];
+		_pOut	= _pIn + _inSize;
+	}
+
+	return *this;
+}
+
+
+//====================================================================
+// Get input value
+//====================================================================
+template <class T>
+T PatternT<T>::getInput(int index) const
+{
+	assert( index >= 0 && index < _inSize );
+
+	return _pIn[index];
+}
+
+
+//====================================================================
+// Get output value
+//====================================================================
+template <class T>
+T PatternT<T>::getOutput(int index) const
+{
+	assert( index >= 0 && index < _outSize );
+
+	return _pOut[index];
+
+}
+
+
+//====================================================================
+// Set input value
+//====================================================================
+template <class T>
+void PatternT<T>::setInput(T value, int index)
+{
+	assert( index >= 0 && index < _inSize );
+
+	_pIn[index] = value;
+}
+
+
+//====================================================================
+// Set output value
+//====================================================================
+template <class T>
+void PatternT<T>::setOutput(T value, int index)
+{
+	assert( index >= 0 && index < _outSize );
+
+	_pOut[index] = value;
+
+}
+
+
+//====================================================================
+// Save pattern to file
+//====================================================================
+template <class T>
+bool PatternT<T>::save( ofstream &ost ) const
+{
+	if ( !ost.good() )
+		return false;
+
+	ost << _id << "\t"; // pattern id
+
+	int numInputs = _inSize;
+	for(int i = 0; i != numInputs; ++i)
+		ost <<  setprecision(16) << _pIn[i] << "\t"; // input values
+
+	int numOutputs = _outSize;
+	for(int i = 0; i != numOutputs; ++i)
+	{
+		ost <<  setprecision(16) << _pOut[i]; // output values
+		if ( i != numOutputs-1) 
+			 ost << "\t";
+	}
+
+	ost << endl;
+
+	return true;
+}
+
+
+//====================================================================
+// Load pattern from file
+//====================================================================
+template <class T>
+bool PatternT<T>::load( ifstream &ist )
+{
+	if ( !ist.good() )
+		return false;
+
+	ist >> _id; // pattern id
+
+	int numInputs = _inSize;
+	for(int i = 0; i != numInputs; ++i)
+		ist >> _pIn[i]; // input values
+
+	int numOutputs = _outSize;
+	for(int i = 0; i != numOutputs; ++i)
+		ist >> _pOut[i]; // output values
+
+	// "eat" white space
+	char ch = ist.peek();
+	while ( isspace(ch) )
+	{
+		ch = ist.get();
+		if (ch == EOF)
+			break;
+
+		ch = ist.peek();
+	}
+
+	return true;
+}
+
+
+// explicit instantiation
+template class PatternT<double>;
+template class PatternT<float>;
\ No newline at end of file
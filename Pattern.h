@@ -1,58 +1,85 @@
-// Pattern.h: interface for the Pattern class.
-//
-// Copyright Gideon Pertzov, 2003
-//
-// This software is provided "as is" without express or implied
-// warranties. You may freely copy and compile this source into
-// applications you distribute provided that credit is given to
-// the original author.
-//
-//////////////////////////////////////////////////////////////////////
-
-#ifndef _PATTERN_H
-#define _PATTERN_H
-
-#include <vector>
-using namespace std;
-
-class Pattern  
-{
-// Methods
-public:
-	Pattern(int inSize, int outSize);
-	Pattern( int inSize, int outSize, int id, ... );
-	virtual ~Pattern();
-	
-	// set/get pattern id
-	void	setId(int id)	  { _id = id; }
-	int		getId()		const { return _id; }
-
-	// get sizes of input/output sets
-	int		inSize()	const { return _inVec.size();  }
-	int		outSize()	const { return _outVec.size(); }
-
-	// get input/output values
-	double	getInput(int index) const;
-	double	getOutput(int index) const;
-
-	// set input/output values
-	void	setInput(double value, int index);
-	void	setOutput(double value, int index);
-
-	// save/load pattern
-	bool save( ofstream &ost ) const;
-	bool load( ifstream &ist );
-
-private:
-	Pattern(); // private constructor
-
-// Members
-protected:
-
-	int				_id;	
-	vector<double>	_inVec;		// vector of input values
-	vector<double>	_outVec;	// vector of desired output values
-};
-
-#endif // _PATTERN_H
-
+// Pattern.h: interface for the Pattern class.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+
+#ifndef _PATTERN_H
+#define _PATTERN_H
+
+#include <vector>
+#include <fstream>
+using namespace std;
+
+template <class T>
+class PatternT  
+{
+// Methods
+public:
+	PatternT(int inSize, int outSize);
+	PatternT( int inSize, int outSize, int id, ... );
+	PatternT(const PatternT& other);
+	virtual ~PatternT();
+
+	// view of values stored elsewhere (e.g. a PatternSet row).
+	// the storage is not copied and must outlive the pattern
+	PatternT(T* in, int inSize, T* out, int outSize, int id);
+
+	// assignment makes an owned copy of a pattern, or a view of the same storage if it is a view
+	PatternT& operator=(const PatternT& other);
+	
+	// set/get pattern id
+	void	setId(int id)	  { _id = id; }
+	int		getId()		const { return _id; }
+
+	// get sizes of input/output sets
+	int		inSize()	const { return _inSize;  }
+	int		outSize()	const { return _outSize; }
+
+	// get all input/output values
+	T*				inputs()		{ return _pIn;	}
+	const T*		inputs()  const { return _pIn;	}
+	T*				outputs()		{ return _pOut;	}
+	const T*		outputs() const { return _pOut;	}
+
+	// is pattern a view of external storage
+	bool	isView()	const { return _data.empty() && _pIn != NULL; }
+
+	// get input/output values
+	T		getInput(int index) const;
+	T		getOutput(int index) const;
+
+	// set input/output values
+	void	setInput(T value, int index);
+	void	setOutput(T value, int index);
+
+	// save/load pattern
+	bool save( ofstream &ost ) const;
+	bool load( ifstream &ist );
+
+private:
+	PatternT(); // private constructor
+
+// Members
+protected:
+
+	int				_id;	
+	int				_inSize;	// number of input values
+	int				_outSize;	// number of desired output values
+	T*				_pIn;		// input values
+	T*				_pOut;		// desired output values
+	vector<T>		_data;		// input and output values (empty for a view)
+};
+
+
+// double and float patterns
+typedef PatternT<double>	Pattern;
+typedef PatternT<float>		PatternF;
+
+#endif // _PATTERN_H
+
@@ -0,0 +1,487 @@
+// PatternReader.cpp: implementation of the PatternReader class.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include "PatternReader.h"
+
+// size of text file read buffer
+#define TEXT_CHUNK_SIZE		(1 << 20)
+
+static const char MAGIC[8] = { 'B', 'P', 'P', 'A', 'T', 'S', 'E', 'T' };
+
+// powers of ten that are exact doubles
+static const double POW10[] = {	1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+								1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+								1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+// seek to a (64-bit) file offset
+static bool seekFile(FILE* fp, uint64_t offset)
+{
+#ifdef _WIN32
+	return _fseeki64(fp, (__int64)offset, SEEK_SET) == 0;
+#else
+	return fseeko(fp, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+static bool isSpace(char ch)
+{
+	return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r' || ch == '\v' || ch == '\f';
+}
+
+static bool isDigit(char ch)
+{
+	return ch >= '0' && ch <= '9';
+}
+
+
+//====================================================================
+// Parse a decimal number, returns pointer past it (NULL on error).
+// Numbers with up to 19 significant digits whose mantissa and
+// power of ten are exact doubles are converted directly (correctly
+// rounded), anything else is handed to strtod.
+//====================================================================
+static const char* parseDouble(const char* p, double& value)
+{
+	const char* start = p;
+
+	bool negative = (*p == '-');
+	if (*p == '-' || *p == '+')
+		++p;
+
+	uint64_t	mantissa	= 0;
+	int			digits		= 0;	// significant digits in mantissa
+	int			exponent	= 0;
+	bool		exact		= true;
+	bool		any			= false;
+
+	for (; isDigit(*p); ++p, any = true)
+	{
+		if (digits < 19)
+		{
+			mantissa = mantissa * 10 + (*p - '0');
+			if (mantissa != 0)
+				++digits;
+		}
+		else
+			exact = false;
+	}
+
+	if (*p == '.')
+	{
+		for (++p; isDigit(*p); ++p, any = true)
+		{
+			if (digits < 19)
+			{
+				mantissa = mantissa * 10 + (*p - '0');
+				if (mantissa != 0)
+					++digits;
+				--exponent;
+			}
+			else
+				exact = false;
+		}
+	}
+
+	if (any && (*p == 'e' || *p == 'E'))
+	{
+		const char* q = p + 1;
+
+		bool negExp = (*q == '-');
+		if (*q == '-' || *q == '+')
+			++q;
+
+		if (isDigit(*q))
+		{
+			int e = 0;
+			for (; isDigit(*q); ++q)
+				if (e < 100000)
+					e = e * 10 + (*q - '0');
+
+			exponent += negExp ? -e : e;
+			p = q;
+		}
+	}
+
+	if ( any && exact && mantissa <= ((uint64_t)1 << 53) && exponent >= -22 && exponent <= 22 )
+	{
+		value = (double)mantissa;
+		value = (exponent < 0) ? value / POW10[-exponent] : value * POW10[exponent];
+		if (negative)
+			value = -value;
+
+		return p;
+	}
+
+	// slow path (many digits, large exponents, inf/nan)
+	char* end;
+	value = strtod(start, &end);
+
+	return (end != start) ? end : NULL;
+}
+
+
+//====================================================================
+// Parse a decimal integer, returns pointer past it (NULL on error)
+//====================================================================
+static const char* parseInt(const char* p, int& value)
+{
+	bool negative = (*p == '-');
+	if (*p == '-' || *p == '+')
+		++p;
+
+	if ( !isDigit(*p) )
+		return NULL;
+
+	long n = 0;
+	for (; isDigit(*p); ++p)
+		if (n < 0x7fffffff)
+			n = n * 10 + (*p - '0');
+
+	value = (int)(negative ? -n : n);
+
+	return p;
+}
+
+
+//////////////////////////////////////////////////////////////////////
+// Construction/Destruction
+//////////////////////////////////////////////////////////////////////
+
+template <class T>
+PatternReaderT<T>::~PatternReaderT()
+{
+	close();
+}
+
+
+template <class T>
+PatternReaderT<T>::PatternReaderT() :	_pFile(NULL),
+										_binary(false),
+										_eof(false),
+										_fail(false),
+										_index(0),
+										_length(0),
+										_pos(0),
+										_end(0),
+										_saved(0),
+										_last(false),
+										_field(0),
+										_record(1, 1)
+{
+	memset(&_header, 0, sizeof(_header));
+}
+
+
+//====================================================================
+// Open pattern file
+//====================================================================
+template <class T>
+bool PatternReaderT<T>::open(const char* fileName, int inSize, int outSize)
+{
+	assert( fileName != NULL && inSize > 0 && outSize > 0 );
+
+	close();
+
+	_pFile = fopen(fileName, "rb");
+	if ( _pFile == NULL )
+		return false;
+
+	_record = Pattern(inSize, outSize);
+
+	// detect binary format
+	memset(&_header, 0, sizeof(_header));
+	if ( fread(&_header, 1, sizeof(_header), _pFile) == sizeof(_header) &&
+		 memcmp(_header.magic, MAGIC, sizeof(MAGIC)) == 0 )
+	{
+		if ( !_header.supported() || _header.valueSize() != sizeof(T) ||
+			 _header.inSize != (uint32_t)inSize || _header.outSize != (uint32_t)outSize )
+		{
+			close();
+			return false;
+		}
+
+		_binary = true;
+	}
+	else
+		memset(&_header, 0, sizeof(_header));
+
+	return rewind();
+}
+
+
+//====================================================================
+// Close file
+//====================================================================
+template <class T>
+void PatternReaderT<T>::close()
+{
+	if ( _pFile != NULL )
+		fclose(_pFile);
+
+	_pFile	= NULL;
+	_binary	= false;
+	_eof	= false;
+	_fail	= false;
+	_index	= 0;
+	_length	= 0;
+	_pos	= 0;
+	_end	= 0;
+	_last	= false;
+	_field	= 0;
+
+	memset(&_header, 0, sizeof(_header));
+
+	// release buffers
+	vector<char>().swap(_buffer);
+	vector<int32_t>().swap(_ids);
+}
+
+
+//====================================================================
+// Restart from first pattern
+//====================================================================
+template <class T>
+bool PatternReaderT<T>::rewind()
+{
+	if ( _pFile == NULL )
+		return false;
+
+	_eof	= false;
+	_fail	= false;
+	_index	= 0;
+	_length	= 0;
+	_pos	= 0;
+	_end	= 0;
+	_last	= false;
+	_field	= 0;
+
+	if ( !_binary )
+	{
+		_buffer.resize(TEXT_CHUNK_SIZE + 1);
+		_buffer[0] = '\0';
+		_saved = '\0';
+	}
+
+	return fseek(_pFile, 0, SEEK_SET) == 0;
+}
+
+
+//====================================================================
+// Continue reading at pattern index
+//====================================================================
+template <class T>
+bool PatternReaderT<T>::seek(size_t index)
+{
+	if ( _pFile == NULL || !_binary || index > _header.count )
+		return false;
+
+	_index	= index;
+	_eof	= (index == _header.count);
+
+	return true;
+}
+
+
+//====================================================================
+// Append up to count patterns to set
+//====================================================================
+template <class T>
+size_t PatternReaderT<T>::read(PatternSet& set, size_t count)
+{
+	assert( set.size() == 0 || (set.inSize() == inSize() && set.outSize() == outSize()) );
+
+	if ( _pFile == NULL || _fail || count == 0 )
+		return 0;
+
+	return _binary ? readBinary(set, count) : readText(set, count);
+}
+
+
+//====================================================================
+// Read patterns of a binary file
+//====================================================================
+template <class T>
+size_t PatternReaderT<T>::readBinary(PatternSet& set, size_t count)
+{
+	size_t available = (size_t)_header.count - _index;
+	if ( count > available )
+		count = available;
+
+	if ( count == 0 )
+	{
+		_eof = true;
+		return 0;
+	}
+
+	int		in		= inSize();
+	int		out		= outSize();
+	size_t	first	= set.size();
+
+	if ( set.inSize() != in || set.outSize() != out )
+		set.create(in, out, 0);
+
+	set.resize(first + count);
+
+	// inputs, outputs and ids are separate blocks of the file
+	_ids.resize(count);
+
+	bool ok = ( seekFile(_pFile, _header.inputsOffset + _index * in * sizeof(T)) &&
+				fread(set.inputs() + first * in, sizeof(T) * in, count, _pFile) == count &&
+				seekFile(_pFile, _header.outputsOffset + _index * out * sizeof(T)) &&
+				fread(set.outputs() + first * out, sizeof(T) * out, count, _pFile) == count &&
+				seekFile(_pFile, _header.idsOffset + _index * sizeof(int32_t)) &&
+				fread(&_ids[0], sizeof(int32_t), count, _pFile) == count );
+
+	if ( !ok )
+	{
+		_fail = true;
+		set.resize(first);
+		return 0;
+	}
+
+	for (size_t i = 0; i != count; ++i)
+		set.setId(first + i, _ids[i]);
+
+	_index += count;
+	_eof = (_index == _header.count);
+
+	return count;
+}
+
+
+//====================================================================
+// Read next part of a text file
+//====================================================================
+template <class T>
+bool PatternReaderT<T>::fill()
+{
+	if ( _last )
+		return false;
+
+	// keep value split by the end of the previous part
+	_buffer[_end] = _saved;
+	_length -= _end;
+	memmove(&_buffer[0], &_buffer[_end], _length);
+
+	_length += fread(&_buffer[_length], 1, TEXT_CHUNK_SIZE - _length, _pFile);
+
+	if ( ferror(_pFile) )
+	{
+		_fail = true;
+		return false;
+	}
+
+	_last = ( feof(_pFile) != 0 );
+
+	// parse up to last white space (or everything at end of file)
+	_end = _length;
+	if ( !_last )
+	{
+		while ( _end != 0 && !isSpace(_buffer[_end-1]) )
+			--_end;
+
+		if ( _end == 0 )
+		{
+			_fail = true;	// single value longer than the buffer
+			return false;
+		}
+	}
+
+	_saved = _buffer[_end];
+	_buffer[_end] = '\0';
+	_pos = 0;
+
+	return true;
+}
+
+
+//====================================================================
+// Read patterns of a text file
+//====================================================================
+template <class T>
+size_t PatternReaderT<T>::readText(PatternSet& set, size_t count)
+{
+	int numFields	= 1 + inSize() + outSize();
+	int numInputs	= inSize();
+
+	T*		in	= _record.inputs();
+	T*		out	= _record.outputs();
+
+	size_t n = 0;
+	while ( n != count )
+	{
+		const char* p = &_buffer[_pos];
+
+		while ( isSpace(*p) )
+			++p;
+
+		if ( *p == '\0' )
+		{
+			// parsed everything in buffer
+			if ( !fill() )
+			{
+				if ( !_fail && _field != 0 )
+					_fail = true;	// incomplete pattern at end of file
+
+				_eof = !_fail;
+				break;
+			}
+
+			continue;
+		}
+
+		if ( _field == 0 )
+		{
+			int id;
+			p = parseInt(p, id);
+			if ( p != NULL )
+				_record.setId(id);
+		}
+		else
+		{
+			double value;
+			p = parseDouble(p, value);
+			if ( p != NULL )
+			{
+				if ( _field <= numInputs )
+					in[_field - 1] = value;
+				else
+					out[_field - 1 - numInputs] = value;
+			}
+		}
+
+		// values must be separated by white space
+		if ( p == NULL || (*p != '\0' && !isSpace(*p)) )
+		{
+			_fail = true;
+			break;
+		}
+
+		_pos = p - &_buffer[0];
+
+		if ( ++_field == numFields )
+		{
+			_field = 0;
+			set.add(_record);
+			++n;
+		}
+	}
+
+	return n;
+}
+
+
+// explicit instantiation
+template class PatternReaderT<double>;
+template class PatternReaderT<float>;
\ No newline at end of file
@@ -0,0 +1,124 @@
+// PatternReader.h: interface for the PatternReader class.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+
+#ifndef _PATTERNREADER_H
+#define _PATTERNREADER_H
+
+#include <cstddef>
+#include <cstdio>
+#include <vector>
+#include "Pattern.h"
+#include "PatternSet.h"
+using namespace std;
+
+
+//////////////////////////////////////////////////////////////////////
+// PatternReaderT - sequential reader of a pattern file, a chunk of
+// patterns at a time.
+//
+// Reads text files (Pattern::save format) through a fixed size
+// buffer and binary PatternSet files (the format is detected from
+// the file contents). Only the buffer and the patterns of the
+// current chunk are held in memory, whatever the size of the file.
+//////////////////////////////////////////////////////////////////////
+template <class T>
+class PatternReaderT
+{
+// Types
+public:
+	typedef PatternT<T>		Pattern;	// pattern of the same precision
+	typedef PatternSetT<T>	PatternSet;	// pattern set of the same precision
+
+// Methods
+public:
+	virtual ~PatternReaderT();	// destructor (closes file)
+	PatternReaderT();			// default c-tor
+
+	// open a pattern file with the given pattern sizes
+	bool	open(const char* fileName, int inSize, int outSize);
+
+	// close file
+	void	close();
+
+	// is a file open
+	bool	isOpen() const		{ return _pFile != NULL; }
+
+	// get pattern sizes
+	int		inSize()	const	{ return _record.inSize();	}
+	int		outSize()	const	{ return _record.outSize();	}
+
+	// is file in binary PatternSet format
+	bool	isBinary()	const	{ return _binary; }
+
+	// get number of patterns in a binary file (unknown for text files)
+	size_t	size()		const	{ return (size_t)_header.count; }
+
+	// append up to count patterns to set, returns number of patterns read
+	// (less than count only at end of file or on error)
+	size_t	read(PatternSet& set, size_t count);
+
+	// has end of file been reached
+	bool	eof()	const	{ return _eof; }
+
+	// did a read or parse error occur
+	bool	fail()	const	{ return _fail; }
+
+	// restart from first pattern
+	bool	rewind();
+
+	// continue reading at pattern index (binary files only)
+	bool	seek(size_t index);
+
+protected:
+
+	// read next part of a text file, returns false at end of file
+	bool	fill();
+
+	// read patterns of a binary file
+	size_t	readBinary(PatternSet& set, size_t count);
+
+	// read patterns of a text file
+	size_t	readText(PatternSet& set, size_t count);
+
+private:
+	PatternReaderT(const PatternReaderT&);			// not copyable
+	PatternReaderT& operator=(const PatternReaderT&);
+
+// Members
+protected:
+
+	FILE*				_pFile;		// open file
+	bool				_binary;	// binary PatternSet format
+	bool				_eof;		// end of file reached
+	bool				_fail;		// read or parse error
+
+	PatternSetHeader	_header;	// header of binary file
+	size_t				_index;		// next pattern of binary file
+
+	vector<char>		_buffer;	// text buffer
+	size_t				_length;	// bytes in buffer
+	size_t				_pos;		// parse position in buffer
+	size_t				_end;		// end of complete values in buffer
+	char				_saved;		// character replaced by terminator at _end
+	bool				_last;		// buffer holds end of file
+	int					_field;		// field of current pattern (0 - id)
+
+	Pattern				_record;	// pattern being parsed
+	vector<int32_t>		_ids;		// ids of binary chunk
+};
+
+
+// double and float readers
+typedef PatternReaderT<double>	PatternReader;
+typedef PatternReaderT<float>	PatternReaderF;
+
+
+#endif // _PATTERNREADER_H
@@ -0,0 +1,448 @@
+// PatternSet.cpp: implementation of the PatternSet class.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <climits>
+#include "PatternSet.h"
+#include "PatternReader.h"
+
+// initial capacity when growing a set
+#define MIN_CAPACITY		1024
+
+static const char MAGIC[8] = { 'B', 'P', 'P', 'A', 'T', 'S', 'E', 'T' };
+
+// round size up to data block alignment
+static size_t aligned(size_t size)
+{
+	return (size + PATTERNSET_ALIGNMENT - 1) & ~(size_t)(PATTERNSET_ALIGNMENT - 1);
+}
+
+// do count rows of rowBytes at offset fit in a file of fileSize bytes
+// (divides instead of multiplying, untrusted sizes can't overflow)
+static bool fits(uint64_t offset, uint64_t count, uint64_t rowBytes, uint64_t fileSize)
+{
+	return offset <= fileSize && count <= (fileSize - offset) / rowBytes;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Construction/Destruction
+//////////////////////////////////////////////////////////////////////
+
+template <class T>
+PatternSetT<T>::~PatternSetT()
+{
+	clear();
+}
+
+
+template <class T>
+PatternSetT<T>::PatternSetT() :	_inSize(0),
+								_outSize(0),
+								_count(0),
+								_capacity(0)
+{
+
+}
+
+
+//====================================================================
+// Allocate zeroed patterns
+//====================================================================
+template <class T>
+void PatternSetT<T>::create(int inSize, int outSize, size_t count)
+{
+	assert( inSize > 0 && outSize > 0 );
+
+	clear();
+
+	_inSize		= inSize;
+	_outSize	= outSize;
+
+	resize(count);
+}
+
+
+//====================================================================
+// Remove all patterns
+//====================================================================
+template <class T>
+void PatternSetT<T>::clear()
+{
+	_pointers.clear();
+	_views.clear();
+
+	_inputs.release();
+	_outputs.release();
+	_ids.release();
+
+	_file.close();
+
+	_inSize		= 0;
+	_outSize	= 0;
+	_count		= 0;
+	_capacity	= 0;
+}
+
+
+//====================================================================
+// Append a copy of a pattern
+//====================================================================
+template <class T>
+void PatternSetT<T>::add(const Pattern& pattern)
+{
+	if ( _count == 0 && (_inSize != pattern.inSize() || _outSize != pattern.outSize()) )
+	{
+		// empty set takes the pattern's sizes (allocated rows are resized)
+		_inSize		= pattern.inSize();
+		_outSize	= pattern.outSize();
+
+		reallocate(_capacity);
+		buildViews();
+	}
+
+	assert( pattern.inSize() == _inSize && pattern.outSize() == _outSize );
+
+	bool grow = ( _count == _capacity || isMapped() );
+	if ( grow )
+		reallocate( _capacity < MIN_CAPACITY ? MIN_CAPACITY : 2 * _capacity );
+
+	T* in		= _inputs.data()  + _count * _inSize;
+	T* out		= _outputs.data() + _count * _outSize;
+
+	memcpy( in,  pattern.inputs(),  _inSize  * sizeof(T) );
+	memcpy( out, pattern.outputs(), _outSize * sizeof(T) );
+	_ids[_count] = pattern.getId();
+
+	++_count;
+
+	if ( grow )
+		buildViews();
+	else
+	{
+		// views have room for all allocated rows, existing pointers stay valid
+		_views.push_back( Pattern(in, _inSize, out, _outSize, pattern.getId()) );
+		_pointers.push_back( &_views.back() );
+	}
+}
+
+
+//====================================================================
+// Make room for capacity patterns
+//====================================================================
+template <class T>
+void PatternSetT<T>::reserve(size_t capacity)
+{
+	if ( capacity > _capacity || isMapped() )
+	{
+		reallocate( capacity > _capacity ? capacity : _capacity );
+		buildViews();
+	}
+}
+
+
+//====================================================================
+// Set number of patterns
+//====================================================================
+template <class T>
+void PatternSetT<T>::resize(size_t count)
+{
+	assert( count == 0 || (_inSize > 0 && _outSize > 0) );
+
+	if ( count > _capacity || isMapped() )
+		reallocate( count > _capacity ? count : _capacity );
+
+	// new patterns are zeroed, ids are their index
+	for (size_t i = _count; i < count; ++i)
+	{
+		memset( _inputs.data()  + i * _inSize,  0, _inSize  * sizeof(T) );
+		memset( _outputs.data() + i * _outSize, 0, _outSize * sizeof(T) );
+		_ids[i] = (int32_t)i;
+	}
+
+	_count = count;
+
+	buildViews();
+}
+
+
+//====================================================================
+// Reallocate storage, keeping contents
+//====================================================================
+template <class T>
+void PatternSetT<T>::reallocate(size_t capacity)
+{
+	if ( capacity < _count )
+		capacity = _count;
+
+	BPBuffer<T>			inputs( capacity * _inSize );
+	BPBuffer<T>			outputs( capacity * _outSize );
+	BPBuffer<int32_t>	ids( capacity );
+
+	if ( _count != 0 )
+	{
+		memcpy( inputs.data(),  _inputs.data(),  _count * _inSize  * sizeof(T) );
+		memcpy( outputs.data(), _outputs.data(), _count * _outSize * sizeof(T) );
+		memcpy( ids.data(),     _ids.data(),     _count * sizeof(int32_t) );
+	}
+
+	_inputs.swap(inputs);
+	_outputs.swap(outputs);
+	_ids.swap(ids);
+
+	// storage no longer refers to mapped file
+	_file.close();
+
+	_capacity = capacity;
+}
+
+
+//====================================================================
+// Rebuild Pattern views of all rows
+//====================================================================
+template <class T>
+void PatternSetT<T>::buildViews()
+{
+	_views.clear();
+	_pointers.clear();
+
+	_views.reserve(_capacity);
+	_pointers.reserve(_capacity);
+
+	T* in		= _inputs.data();
+	T* out		= _outputs.data();
+	for (size_t i = 0; i != _count; ++i, in += _inSize, out += _outSize)
+	{
+		_views.push_back( Pattern(in, _inSize, out, _outSize, _ids[i]) );
+		_pointers.push_back( &_views.back() );
+	}
+}
+
+
+//====================================================================
+// Get pattern id
+//====================================================================
+template <class T>
+int PatternSetT<T>::getId(size_t index) const
+{
+	assert( index < _count );
+
+	return _ids[index];
+}
+
+
+//====================================================================
+// Set pattern id
+//====================================================================
+template <class T>
+void PatternSetT<T>::setId(size_t index, int id)
+{
+	assert( index < _count );
+
+	_ids[index] = id;
+	_views[index].setId(id);
+}
+
+
+//====================================================================
+// Get Pattern view of a row
+//====================================================================
+template <class T>
+PatternT<T>* PatternSetT<T>::getPattern(size_t index)
+{
+	assert( index < _count );
+
+	return &_views[index];
+}
+
+
+template <class T>
+const PatternT<T>* PatternSetT<T>::getPattern(size_t index) const
+{
+	assert( index < _count );
+
+	return &_views[index];
+}
+
+
+//====================================================================
+// Load text file
+//====================================================================
+template <class T>
+bool PatternSetT<T>::loadText(const char* fileName, int inSize, int outSize)
+{
+	assert( fileName != NULL && inSize > 0 && outSize > 0 );
+
+	clear();
+
+	PatternReaderT<T> reader;
+	if ( !reader.open(fileName, inSize, outSize) )
+		return false;
+
+	_inSize		= inSize;
+	_outSize	= outSize;
+
+	reader.read(*this, (size_t)-1);
+
+	if ( reader.fail() )
+	{
+		clear();
+		return false;
+	}
+
+	// release unused rows
+	if ( _capacity != _count )
+	{
+		reallocate(_count);
+		buildViews();
+	}
+
+	return true;
+}
+
+
+//====================================================================
+// Save text file
+//====================================================================
+template <class T>
+bool PatternSetT<T>::saveText(const char* fileName) const
+{
+	assert( fileName != NULL );
+
+	FILE* fp = fopen(fileName, "w");
+	if ( fp == NULL )
+		return false;
+
+	const T* in			= _inputs.data();
+	const T* out		= _outputs.data();
+	int			digits	= (sizeof(T) == sizeof(float)) ? 9 : 16;	// enough to restore a float
+	for (size_t i = 0; i != _count; ++i)
+	{
+		fprintf(fp, "%d\t", (int)_ids[i]);
+
+		for (int j = 0; j != _inSize; ++j)
+			fprintf(fp, "%.*g\t", digits, (double)*in++);
+
+		for (int j = 0; j != _outSize; ++j)
+			fprintf(fp, (j != _outSize-1) ? "%.*g\t" : "%.*g\n", digits, (double)*out++);
+	}
+
+	bool ok = ( ferror(fp) == 0 );
+
+	return ( fclose(fp) == 0 && ok );
+}
+
+
+//====================================================================
+// Save in binary format
+//====================================================================
+template <class T>
+bool PatternSetT<T>::saveBinary(const char* fileName) const
+{
+	assert( fileName != NULL );
+
+	static const char zeros[PATTERNSET_ALIGNMENT] = { 0 };
+
+	size_t inBytes	= _count * _inSize  * sizeof(T);
+	size_t outBytes	= _count * _outSize * sizeof(T);
+	size_t idBytes	= _count * sizeof(int32_t);
+
+	PatternSetHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version			= PATTERNSET_VERSION;
+	header.scalarSize		= sizeof(T);
+	header.inSize			= _inSize;
+	header.outSize			= _outSize;
+	header.count			= _count;
+	header.inputsOffset		= aligned( sizeof(header) );
+	header.outputsOffset	= header.inputsOffset  + aligned(inBytes);
+	header.idsOffset		= header.outputsOffset + aligned(outBytes);
+
+	FILE* fp = fopen(fileName, "wb");
+	if ( fp == NULL )
+		return false;
+
+	fwrite( &header, sizeof(header), 1, fp );
+	fwrite( zeros, 1, header.inputsOffset - sizeof(header), fp );
+	fwrite( _inputs.data(), 1, inBytes, fp );
+	fwrite( zeros, 1, aligned(inBytes) - inBytes, fp );
+	fwrite( _outputs.data(), 1, outBytes, fp );
+	fwrite( zeros, 1, aligned(outBytes) - outBytes, fp );
+	fwrite( _ids.data(), 1, idBytes, fp );
+
+	bool ok = ( ferror(fp) == 0 );
+
+	return ( fclose(fp) == 0 && ok );
+}
+
+
+//====================================================================
+// Use binary file straight from a memory mapping
+//====================================================================
+template <class T>
+bool PatternSetT<T>::mapBinary(const char* fileName)
+{
+	assert( fileName != NULL );
+
+	clear();
+
+	if ( !_file.open(fileName) || _file.size() < sizeof(PatternSetHeader) )
+	{
+		clear();
+		return false;
+	}
+
+	// validate header and block bounds
+	const PatternSetHeader& header = *(const PatternSetHeader*)_file.data();
+
+	uint64_t count	= header.count;
+	bool	 ok		= ( memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0 &&
+						header.supported() && header.valueSize() == sizeof(T) &&
+						header.inSize > 0 && header.outSize > 0 &&
+						header.inSize <= INT_MAX && header.outSize <= INT_MAX &&
+						count < ((uint64_t)1 << 40) );
+	if ( ok )
+	{
+		ok = ( header.inputsOffset % PATTERNSET_ALIGNMENT == 0 &&
+			   header.outputsOffset % PATTERNSET_ALIGNMENT == 0 &&
+			   header.idsOffset % sizeof(int32_t) == 0 &&
+			   fits( header.inputsOffset,  count, (uint64_t)header.inSize  * sizeof(T), _file.size() ) &&
+			   fits( header.outputsOffset, count, (uint64_t)header.outSize * sizeof(T), _file.size() ) &&
+			   fits( header.idsOffset,     count, sizeof(int32_t),                       _file.size() ) );
+	}
+
+	if ( !ok )
+	{
+		clear();
+		return false;
+	}
+
+	_inSize		= header.inSize;
+	_outSize	= header.outSize;
+	_count		= (size_t)count;
+	_capacity	= _count;
+
+	_inputs.attach( (T*)(_file.data() + header.inputsOffset), _count * _inSize );
+	_outputs.attach( (T*)(_file.data() + header.outputsOffset), _count * _outSize );
+	_ids.attach( (int32_t*)(_file.data() + header.idsOffset), _count );
+
+	buildViews();
+
+	return true;
+}
+
+
+// explicit instantiation
+template class PatternSetT<double>;
+template class PatternSetT<float>;
\ No newline at end of file
@@ -0,0 +1,174 @@
+// PatternSet.h: interface for the PatternSet class.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+
+#ifndef _PATTERNSET_H
+#define _PATTERNSET_H
+
+#include <cstddef>
+#include <vector>
+#include <stdint.h>
+#include "Pattern.h"
+#include "BPBuffer.h"
+#include "BPMappedFile.h"
+using namespace std;
+
+
+// binary pattern set format version
+#define PATTERNSET_VERSION		2
+
+// alignment of data blocks in a binary pattern set file
+#define PATTERNSET_ALIGNMENT	64
+
+
+//////////////////////////////////////////////////////////////////////
+// Binary pattern set file header (little-endian).
+//
+// File layout:
+//	PatternSetHeader, padded to PATTERNSET_ALIGNMENT
+//	inputs	[count x inSize values], padded to PATTERNSET_ALIGNMENT
+//	outputs	[count x outSize values], padded to PATTERNSET_ALIGNMENT
+//	ids		[count int32]
+//
+// Values are doubles or floats (scalarSize). Version 1 files, which
+// predate float sets, always hold doubles.
+//////////////////////////////////////////////////////////////////////
+struct PatternSetHeader
+{
+	char		magic[8];		// "BPPATSET"
+	uint32_t	version;		// PATTERNSET_VERSION
+	uint32_t	inSize;			// number of input values per pattern
+	uint32_t	outSize;		// number of output values per pattern
+	uint32_t	scalarSize;		// bytes per value (8 - double, 4 - float)
+	uint64_t	count;			// number of patterns
+	uint64_t	inputsOffset;	// file offset of inputs block
+	uint64_t	outputsOffset;	// file offset of outputs block
+	uint64_t	idsOffset;		// file offset of ids block
+
+	// is version supported
+	bool		supported() const	{ return version >= 1 && version <= PATTERNSET_VERSION; }
+
+	// get bytes per value
+	uint32_t	valueSize() const	{ return version == 1 ? (uint32_t)sizeof(double) : scalarSize; }
+};
+
+
+//////////////////////////////////////////////////////////////////////
+// PatternSetT - patterns stored in two contiguous row-major buffers,
+// one for all input values and one for all desired output values.
+//
+// Each row is also available as a Pattern view of the set's storage,
+// so a set can be passed wherever Pattern pointers are expected
+// (BPNet::setInput, BPNet::trainBatch, BPParallelTrainer::train...).
+// Views are invalidated when the set is reloaded, cleared or grows.
+//////////////////////////////////////////////////////////////////////
+template <class T>
+class PatternSetT
+{
+// Types
+public:
+	typedef PatternT<T>	Pattern;	// pattern of the same precision
+
+// Methods
+public:
+	virtual ~PatternSetT();	// destructor
+	PatternSetT();			// default c-tor
+
+	// allocate count zeroed patterns
+	void	create(int inSize, int outSize, size_t count);
+
+	// remove all patterns
+	void	clear();
+
+	// append a copy of a pattern (an empty set takes the pattern's sizes)
+	void	add(const Pattern& pattern);
+
+	// make room for capacity patterns without reallocating
+	void	reserve(size_t capacity);
+
+	// set number of patterns, new patterns are zeroed (storage is kept when shrinking)
+	void	resize(size_t count);
+
+	// get number of patterns that fit without reallocating
+	size_t	capacity()	const	{ return _capacity; }
+
+	// get number of patterns and pattern sizes
+	size_t	size()		const	{ return _count;	}
+	int		inSize()	const	{ return _inSize;	}
+	int		outSize()	const	{ return _outSize;	}
+
+	// get input/output rows of all patterns
+	T*				inputs()			{ return _inputs.data();	}
+	const T*		inputs()	const	{ return _inputs.data();	}
+	T*				outputs()			{ return _outputs.data();	}
+	const T*		outputs()	const	{ return _outputs.data();	}
+
+	// get/set pattern id
+	int		getId(size_t index) const;
+	void	setId(size_t index, int id);
+
+	// get Pattern view of a row
+	Pattern*		getPattern(size_t index);
+	const Pattern*	getPattern(size_t index) const;
+
+	// get views of all rows
+	const Pattern* const*	patterns() const	{ return _count != 0 ? &_pointers[0] : NULL; }
+
+	// load/save text file, one pattern per line in Pattern::save format
+	// (id, input values, output values). see also PatternReader
+	bool	loadText(const char* fileName, int inSize, int outSize);
+	bool	saveText(const char* fileName) const;
+
+	// save in binary format
+	bool	saveBinary(const char* fileName) const;
+
+	// use a binary file straight from a memory mapping (no copy)
+	bool	mapBinary(const char* fileName);
+
+	// is set stored in a mapped file
+	bool	isMapped() const	{ return _file.isOpen(); }
+
+protected:
+
+	// reallocate storage for capacity patterns, keeping contents (views are not updated)
+	void	reallocate(size_t capacity);
+
+	// rebuild Pattern views of all rows
+	void	buildViews();
+
+private:
+	PatternSetT(const PatternSetT&);			// not copyable
+	PatternSetT& operator=(const PatternSetT&);
+
+// Members
+protected:
+
+	int					_inSize;	// number of input values per pattern
+	int					_outSize;	// number of output values per pattern
+	size_t				_count;		// number of patterns
+	size_t				_capacity;	// number of allocated patterns
+
+	BPBuffer<T>			_inputs;	// input values [capacity x inSize]
+	BPBuffer<T>			_outputs;	// output values [capacity x outSize]
+	BPBuffer<int32_t>	_ids;		// pattern ids [capacity]
+
+	vector<Pattern>			_views;		// Pattern view of each row
+	vector<const Pattern*>	_pointers;	// pointers to views
+
+	BPMappedFile		_file;		// mapped binary file (see mapBinary)
+};
+
+
+// double and float pattern sets
+typedef PatternSetT<double>	PatternSet;
+typedef PatternSetT<float>	PatternSetF;
+
+
+#endif // _PATTERNSET_H
@@ -0,0 +1,489 @@
+// BPBench.cpp: benchmark suite for BPNet.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+//
+// Measures the engine over a matrix of network topologies and prints
+// one JSON document to stdout (or the file given with --output):
+//
+//	forward			run() of one sample
+//	learn			run() and learn() of one sample (online training)
+//	forward_batch	runBatch() in mini-batches
+//	train_batch		trainBatch() in mini-batches
+//	epoch			one BPTrainer epoch (online, shuffled)
+//	init			initWeights() of the network
+//	create			createNetwork() again on the same network (reuses storage)
+//	save_text		save() / load() of the text format
+//	load_text
+//	save_binary		saveBinary() / loadBinary() of the binary format
+//	load_binary
+//	parse_pattern	Pattern::load() of a text pattern file
+//	parse_set		PatternSet::loadText() of the same file
+//
+// Each result reports ns_per_sample, gflops and bytes_per_sample.
+// Flops count multiplies and adds of the weight matrices (W weights,
+// W2 weights past the first middle layer, B the batch size):
+//
+//	forward			2W flops,					W values read
+//	learn			2W + 2W2 + 4W flops,		W + W2 + 4W values (weights and deltas read and written)
+//	forward_batch	2W flops,					W / B values
+//	train_batch		2W + 2W2 + 2W flops,		(W + W2 + 2W + 5W) / B values (gradients summed, then applied once)
+//	epoch			as learn
+//
+// Init and load/save results are per model (bytes_per_sample is the file size)
+// and pattern parsing per pattern (bytes of text per pattern).
+//
+// Usage: bpbench [--float] [--min-time seconds] [--max-weights n]
+//				  [--filter topology] [--threads n] [--batch n] [--output file]
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <fstream>
+#include "BPNet.h"
+#include "BPTrainer.h"
+#include "PatternSet.h"
+#include "BPKernels.h"
+using namespace std;
+
+// default minimal measured time of a benchmark (seconds)
+#define DEFAULT_MIN_TIME		0.25
+
+// default largest network measured (number of weights)
+#define DEFAULT_MAX_WEIGHTS		(16 << 20)
+
+// largest network saved/loaded in text format (number of weights)
+#define MAX_TEXT_WEIGHTS		(1 << 20)
+
+// number of patterns of the generated training set
+#define NUM_PATTERNS			1024
+
+// temporary files
+#define MODEL_TEXT		"bpbench_model.tmp"
+#define MODEL_BINARY	"bpbench_model.bin.tmp"
+#define PATTERN_TEXT	"bpbench_patterns.tmp"
+
+
+// network topology of the benchmark matrix
+struct Topology
+{
+	const char*	name;
+	int			layers[5];	// node count of each layer, 0 terminated
+};
+
+static const Topology TOPOLOGIES[] =
+{
+	{ "xor",		{ 2, 2, 1 } },
+	{ "small",		{ 16, 32, 4 } },
+	{ "mnist",		{ 784, 128, 10 } },
+	{ "deep",		{ 256, 512, 512, 64 } },
+	{ "wide",		{ 1024, 4096, 1024 } },
+	{ "wide4096",	{ 4096, 4096, 4096 } }
+};
+
+
+// benchmark options
+struct Options
+{
+	bool		useFloat;		// float networks
+	double		minTime;		// minimal measured time
+	size_t		maxWeights;		// skip larger networks
+	const char*	filter;			// topology name (NULL - all)
+	int			threads;		// network threads (1 - single thread)
+	int			batch;			// mini-batch size
+	const char*	output;			// JSON file (NULL - stdout)
+};
+
+
+// one benchmark result
+struct Result
+{
+	string	name;			// benchmark
+	string	topology;		// topology name
+	double	nsPerSample;
+	double	gflops;
+	double	bytesPerSample;
+	double	samples;		// samples (or models) measured
+};
+
+
+//====================================================================
+// Seconds since an arbitrary point
+//====================================================================
+static double now()
+{
+	return chrono::duration<double>( chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+
+//====================================================================
+// Time func(iterations), doubling iterations until minTime is reached.
+// returns seconds per iteration
+//====================================================================
+template <class F>
+static double measure(const F& func, double minTime, size_t& iterations)
+{
+	iterations = 1;
+	for (;;)
+	{
+		double start	= now();
+		func( iterations );
+		double elapsed	= now() - start;
+
+		if ( elapsed >= minTime || iterations >= ((size_t)1 << 40) )
+			return elapsed / iterations;
+
+		// aim slightly above minTime in one more round
+		size_t next = ( elapsed > 0 ) ? (size_t)( iterations * 1.2 * minTime / elapsed ) : iterations * 10;
+		iterations = ( next > iterations * 2 ) ? next : iterations * 2;
+	}
+}
+
+
+//====================================================================
+// Get size of a file in bytes
+//====================================================================
+static double fileSize(const char* fileName)
+{
+	ifstream ist(fileName, ios::in | ios::binary | ios::ate);
+
+	return ist.good() ? (double)ist.tellg() : 0;
+}
+
+
+//====================================================================
+// Benchmarks of one topology
+//====================================================================
+template <class T>
+static void benchTopology(const Topology& topology, const Options& opt, vector<Result>& results)
+{
+	typedef BPNetT<T>			Net;
+	typedef PatternT<T>			Pattern;
+	typedef PatternSetT<T>		PatternSet;
+
+	vector<int> nodeCnt;
+	for (int i = 0; i != 5 && topology.layers[i] != 0; ++i)
+		nodeCnt.push_back( topology.layers[i] );
+
+	int		numLayers	= nodeCnt.size();
+	int		numInputs	= nodeCnt[0];
+	int		numOutputs	= nodeCnt[numLayers-1];
+	double	w			= 0;	// weights
+	double	w2			= 0;	// weights of layers that propagate errors
+	for (int i = 1; i < numLayers; ++i)
+	{
+		w += (double)nodeCnt[i] * nodeCnt[i-1];
+		if ( i > 1 )
+			w2 += (double)nodeCnt[i] * nodeCnt[i-1];
+	}
+
+	if ( opt.maxWeights != 0 && w > opt.maxWeights )
+		return;
+
+	double s = sizeof(T);
+	double b = opt.batch;
+
+	srand(1);
+	Net net;
+	net.setSeed(1);
+	net.createNetwork( 0.01, 0.5, nodeCnt );
+	net.setNumThreads( opt.threads );
+
+	// random patterns
+	PatternSet set;
+	set.create( numInputs, numOutputs, NUM_PATTERNS );
+	for (size_t i = 0; i != (size_t)NUM_PATTERNS * numInputs; ++i)
+		set.inputs()[i] = (T)rand() / RAND_MAX;
+	for (size_t i = 0; i != (size_t)NUM_PATTERNS * numOutputs; ++i)
+		set.outputs()[i] = (T)rand() / RAND_MAX;
+
+	const Pattern* const* patterns = set.patterns();
+
+	size_t	iterations;
+	double	seconds;
+
+	auto add = [&](const char* name, double samples, double flops, double bytes)
+	{
+		Result r;
+		r.name				= name;
+		r.topology			= topology.name;
+		r.nsPerSample		= seconds * 1e9 / samples;
+		r.gflops			= flops * samples / seconds * 1e-9;
+		r.bytesPerSample	= bytes;
+		r.samples			= samples * iterations;
+		results.push_back( r );
+	};
+
+	// forward
+	seconds = measure( [&](size_t n)
+	{
+		for (size_t k = 0; k != n; ++k)
+		{
+			net.setInput( patterns[k % NUM_PATTERNS] );
+			net.run();
+		}
+	}, opt.minTime, iterations );
+	add( "forward", 1, 2 * w, w * s );
+
+	// forward and backward
+	seconds = measure( [&](size_t n)
+	{
+		for (size_t k = 0; k != n; ++k)
+		{
+			const Pattern* p = patterns[k % NUM_PATTERNS];
+			net.setInput( p );
+			net.run();
+			net.setError( p );
+			net.learn();
+		}
+	}, opt.minTime, iterations );
+	add( "learn", 1, 2 * w + 2 * w2 + 4 * w, (w + w2 + 4 * w) * s );
+
+	// batch forward
+	net.setBatchSize( opt.batch );
+	vector<T> outputs( (size_t)opt.batch * numOutputs );
+	seconds = measure( [&](size_t n)
+	{
+		for (size_t k = 0; k != n; ++k)
+		{
+			size_t first = ( k * opt.batch ) % ( NUM_PATTERNS - opt.batch + 1 );
+			net.runBatch( set.inputs() + first * numInputs, opt.batch, &outputs[0] );
+		}
+	}, opt.minTime, iterations );
+	add( "forward_batch", b, 2 * w, w * s / b );
+
+	// batch training
+	seconds = measure( [&](size_t n)
+	{
+		for (size_t k = 0; k != n; ++k)
+		{
+			size_t first = ( k * opt.batch ) % ( NUM_PATTERNS - opt.batch + 1 );
+			net.trainBatch( patterns + first, opt.batch );
+		}
+	}, opt.minTime, iterations );
+	add( "train_batch", b, 2 * w + 2 * w2 + 2 * w, (w + w2 + 2 * w + 5 * w) * s / b );
+
+	// training epoch
+	BPTrainerT<T> trainer( &net );
+	trainer.setData( &set );
+	seconds = measure( [&](size_t n)
+	{
+		for (size_t k = 0; k != n; ++k)
+			trainer.trainEpoch();
+	}, opt.minTime, iterations );
+	add( "epoch", NUM_PATTERNS, 2 * w + 2 * w2 + 4 * w, (w + w2 + 4 * w) * s );
+
+	// weight initialization (the weights are written once)
+	{
+		Net init;
+		init.setNumThreads( opt.threads );
+		init.createNetwork( 0.01, 0.5, nodeCnt );
+
+		seconds = measure( [&](size_t n)
+		{
+			for (size_t k = 0; k != n; ++k)
+				init.initWeights();
+		}, opt.minTime, iterations );
+		add( "init", 1, 0, w * s );
+
+		// weights and deltas are written
+		seconds = measure( [&](size_t n)
+		{
+			for (size_t k = 0; k != n; ++k)
+				init.createNetwork( 0.01, 0.5, nodeCnt );
+		}, opt.minTime, iterations );
+		add( "create", 1, 0, 2 * w * s );
+	}
+
+	// text model
+	if ( w <= MAX_TEXT_WEIGHTS )
+	{
+		seconds = measure( [&](size_t n)
+		{
+			for (size_t k = 0; k != n; ++k)
+			{
+				ofstream ost( MODEL_TEXT );
+				net.save( ost );
+			}
+		}, opt.minTime, iterations );
+		add( "save_text", 1, 0, fileSize(MODEL_TEXT) );
+
+		Net loaded;
+		seconds = measure( [&](size_t n)
+		{
+			for (size_t k = 0; k != n; ++k)
+			{
+				ifstream ist( MODEL_TEXT );
+				loaded.load( ist );
+			}
+		}, opt.minTime, iterations );
+		add( "load_text", 1, 0, fileSize(MODEL_TEXT) );
+
+		remove( MODEL_TEXT );
+	}
+
+	// binary model
+	seconds = measure( [&](size_t n)
+	{
+		for (size_t k = 0; k != n; ++k)
+			net.saveBinary( MODEL_BINARY );
+	}, opt.minTime, iterations );
+	add( "save_binary", 1, 0, fileSize(MODEL_BINARY) );
+
+	{
+		Net loaded;
+		seconds = measure( [&](size_t n)
+		{
+			for (size_t k = 0; k != n; ++k)
+				loaded.loadBinary( MODEL_BINARY );
+		}, opt.minTime, iterations );
+		add( "load_binary", 1, 0, fileSize(MODEL_BINARY) );
+	}
+
+	remove( MODEL_BINARY );
+
+	// pattern parsing
+	if ( set.saveText(PATTERN_TEXT) )
+	{
+		double bytes = fileSize(PATTERN_TEXT) / NUM_PATTERNS;
+
+		Pattern pattern( numInputs, numOutputs );
+		seconds = measure( [&](size_t n)
+		{
+			for (size_t k = 0; k != n; ++k)
+			{
+				ifstream ist( PATTERN_TEXT );
+				for (int i = 0; i != NUM_PATTERNS; ++i)
+					pattern.load( ist );
+			}
+		}, opt.minTime, iterations );
+		add( "parse_pattern", NUM_PATTERNS, 0, bytes );
+
+		PatternSet loaded;
+		seconds = measure( [&](size_t n)
+		{
+			for (size_t k = 0; k != n; ++k)
+				loaded.loadText( PATTERN_TEXT, numInputs, numOutputs );
+		}, opt.minTime, iterations );
+		add( "parse_set", NUM_PATTERNS, 0, bytes );
+
+		remove( PATTERN_TEXT );
+	}
+}
+
+
+//====================================================================
+// Print results as JSON
+//====================================================================
+static void printJSON(FILE* f, const Options& opt, const vector<Result>& results)
+{
+	fprintf( f, "{\n" );
+	fprintf( f, "  \"precision\": \"%s\",\n", opt.useFloat ? "float" : "double" );
+	fprintf( f, "  \"kernels\": \"%s\",\n", BPKernels::levelName( BPKernels::getLevel() ) );
+	fprintf( f, "  \"threads\": %d,\n", opt.threads );
+	fprintf( f, "  \"batch\": %d,\n", opt.batch );
+	fprintf( f, "  \"results\": [\n" );
+
+	for (size_t i = 0; i != results.size(); ++i)
+	{
+		const Result& r = results[i];
+
+		string topology = "[";
+		for (size_t t = 0; t != sizeof(TOPOLOGIES) / sizeof(TOPOLOGIES[0]); ++t)
+		{
+			if ( r.topology != TOPOLOGIES[t].name )
+				continue;
+
+			for (int l = 0; l != 5 && TOPOLOGIES[t].layers[l] != 0; ++l)
+				topology += ( l ? ", " : "" ) + to_string( TOPOLOGIES[t].layers[l] );
+		}
+		topology += "]";
+
+		fprintf( f, "    { \"name\": \"%s\", \"topology\": \"%s\", \"layers\": %s, "
+					"\"ns_per_sample\": %.3f, \"gflops\": %.4f, \"bytes_per_sample\": %.1f, \"samples\": %.0f }%s\n",
+				 r.name.c_str(), r.topology.c_str(), topology.c_str(),
+				 r.nsPerSample, r.gflops, r.bytesPerSample, r.samples,
+				 ( i + 1 != results.size() ) ? "," : "" );
+	}
+
+	fprintf( f, "  ]\n}\n" );
+}
+
+
+//====================================================================
+// Main
+//====================================================================
+int main(int argc, char* argv[])
+{
+	Options opt;
+	opt.useFloat	= false;
+	opt.minTime		= DEFAULT_MIN_TIME;
+	opt.maxWeights	= DEFAULT_MAX_WEIGHTS;
+	opt.filter		= NULL;
+	opt.threads		= 1;
+	opt.batch		= 32;
+	opt.output		= NULL;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		bool more = ( i + 1 < argc );
+
+		if		( strcmp(argv[i], "--float") == 0 )				opt.useFloat	= true;
+		else if ( strcmp(argv[i], "--min-time") == 0 && more )	opt.minTime		= atof( argv[++i] );
+		else if ( strcmp(argv[i], "--max-weights") == 0 && more )	opt.maxWeights	= (size_t)atof( argv[++i] );
+		else if ( strcmp(argv[i], "--filter") == 0 && more )	opt.filter		= argv[++i];
+		else if ( strcmp(argv[i], "--threads") == 0 && more )	opt.threads		= atoi( argv[++i] );
+		else if ( strcmp(argv[i], "--batch") == 0 && more )		opt.batch		= atoi( argv[++i] );
+		else if ( strcmp(argv[i], "--output") == 0 && more )	opt.output		= argv[++i];
+		else
+		{
+			fprintf( stderr, "usage: %s [--float] [--min-time seconds] [--max-weights n] [--filter topology]\n"
+							 "       [--threads n] [--batch n] [--output file]\n", argv[0] );
+			return 1;
+		}
+	}
+
+	if ( opt.batch < 1 || opt.batch > NUM_PATTERNS || opt.threads < 0 )
+	{
+		fprintf( stderr, "invalid batch size or thread count\n" );
+		return 1;
+	}
+
+	vector<Result> results;
+	for (size_t t = 0; t != sizeof(TOPOLOGIES) / sizeof(TOPOLOGIES[0]); ++t)
+	{
+		if ( opt.filter != NULL && strcmp(opt.filter, TOPOLOGIES[t].name) != 0 )
+			continue;
+
+		if ( opt.useFloat )
+			benchTopology<float>( TOPOLOGIES[t], opt, results );
+		else
+			benchTopology<double>( TOPOLOGIES[t], opt, results );
+	}
+
+	FILE* f = ( opt.output != NULL ) ? fopen(opt.output, "w") : stdout;
+	if ( f == NULL )
+	{
+		fprintf( stderr, "can't write %s\n", opt.output );
+		return 1;
+	}
+
+	printJSON( f, opt, results );
+
+	if ( f != stdout )
+		fclose( f );
+
+	return 0;
+}
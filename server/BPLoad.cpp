@@ -0,0 +1,240 @@
+// BPLoad.cpp: load generator for the inference server.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+//
+// Sends requests of random inputs from concurrent clients (one
+// connection and thread each) and reports throughput and request
+// latencies seen by the clients. With --layers a server with a random
+// network of that topology is run in the process (loopback TCP) and
+// its own counters are reported too.
+//
+// Usage: bpload (--unix path | --tcp port | --layers n,n,...) [--float]
+//				 [--clients n] [--requests n] [--samples n]
+//				 [--max-batch n] [--latency us]
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <iostream>
+#include "BPNet.h"
+#include "BPServer.h"
+#include "BPClient.h"
+#include "BPStats.h"
+using namespace std;
+
+
+// load options
+struct Options
+{
+	const char*	unixPath;		// server Unix socket (NULL - none)
+	int			tcpPort;		// server TCP port (-1 - none)
+	vector<int>	layers;			// topology of in-process server (empty - none)
+	bool		useFloat;		// float values
+	int			clients;		// concurrent connections
+	int			requests;		// requests per client
+	int			samples;		// samples per request
+	int			maxBatch;		// in-process server batch size
+	int			maxLatency;		// in-process server batch window (microseconds)
+};
+
+
+//====================================================================
+// Parse a comma separated node count list
+//====================================================================
+static bool parseLayers(const char* str, vector<int>& layers)
+{
+	layers.clear();
+	while ( *str != '\0' )
+	{
+		char* end;
+		long n = strtol( str, &end, 10 );
+		if ( end == str || n < 1 )
+			return false;
+
+		layers.push_back( (int)n );
+
+		str = end;
+		if ( *str == ',' )
+			++str;
+	}
+
+	return layers.size() >= 2;
+}
+
+
+//====================================================================
+// Run the clients against a server, returns false if a request failed
+//====================================================================
+template <class T>
+static bool runClients(const Options& opt, int port)
+{
+	vector< vector<double> >	latency( opt.clients );
+	vector<int>					failed( opt.clients, 0 );
+	vector<thread>				threads;
+
+	uint64_t start = BPStats::now();
+
+	for (int c = 0; c != opt.clients; ++c)
+	{
+		threads.push_back( thread( [&, c]
+		{
+			BPClientT<T> client;
+			bool connected = ( opt.unixPath != NULL ) ? client.connectUnix( opt.unixPath ) : client.connectTcp( port );
+			if ( !connected )
+			{
+				failed[c] = opt.requests;
+				return;
+			}
+
+			vector<T> in( (size_t)opt.samples * client.numInputs() );
+			vector<T> out( (size_t)opt.samples * client.numOutputs() );
+
+			// inputs differ between clients and requests
+			uint64_t state = c + 1;
+			latency[c].reserve( opt.requests );
+
+			for (int r = 0; r != opt.requests; ++r)
+			{
+				for (size_t i = 0; i != in.size(); ++i)
+				{
+					state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+					in[i] = (T)( (state >> 11) * (1.0 / 9007199254740992.0) );
+				}
+
+				uint64_t sent = BPStats::now();
+				if ( !client.predict( &in[0], &out[0], opt.samples ) )
+				{
+					failed[c] = opt.requests - r;
+					return;
+				}
+
+				latency[c].push_back( ( BPStats::now() - sent ) * 1e-3 );
+			}
+		} ) );
+	}
+
+	for (size_t t = 0; t != threads.size(); ++t)
+		threads[t].join();
+
+	double seconds = ( BPStats::now() - start ) * 1e-9;
+
+	// client side latencies of all requests
+	vector<double> all;
+	int errors = 0;
+	for (int c = 0; c != opt.clients; ++c)
+	{
+		all.insert( all.end(), latency[c].begin(), latency[c].end() );
+		errors += failed[c];
+	}
+
+	sort( all.begin(), all.end() );
+
+	double p50 = all.empty() ? 0 : all[ (size_t)ceil( 0.50 * all.size() ) - 1 ];
+	double p99 = all.empty() ? 0 : all[ (size_t)ceil( 0.99 * all.size() ) - 1 ];
+
+	printf( "clients %d requests %d samples_per_request %d failed %d seconds %.3f\n",
+			opt.clients, (int)all.size(), opt.samples, errors, seconds );
+	printf( "client latency_us p50 %.1f p99 %.1f max %.1f requests_per_s %.1f samples_per_s %.1f\n",
+			p50, p99, all.empty() ? 0 : all.back(),
+			all.size() / seconds, all.size() * (double)opt.samples / seconds );
+
+	return errors == 0;
+}
+
+
+//====================================================================
+// Run the load, with an in-process server if a topology was given
+//====================================================================
+template <class T>
+static int runLoad(const Options& opt)
+{
+	if ( opt.layers.empty() )
+		return runClients<T>( opt, opt.tcpPort ) ? 0 : 1;
+
+	BPNetT<T> net;
+	net.setSeed(1);
+	net.createNetwork( 0.1, 0.5, opt.layers );
+
+	BPServerT<T> server( &net );
+	server.setMaxBatch( opt.maxBatch );
+	server.setMaxLatency( opt.maxLatency );
+	server.setMaxRequest( max( opt.samples, BPSERVER_MAX_REQUEST ) );
+
+	if ( !server.listenTcp(0) || !server.start() )
+	{
+		fprintf( stderr, "can't start server\n" );
+		return 1;
+	}
+
+	bool ok = runClients<T>( opt, server.getPort() );
+
+	printf( "server " );
+	fflush( stdout );
+	BPServerT<T>::print( cout, server.stats() );
+
+	return ok ? 0 : 1;
+}
+
+
+//====================================================================
+// Main
+//====================================================================
+int main(int argc, char* argv[])
+{
+	Options opt;
+	opt.unixPath	= NULL;
+	opt.tcpPort		= -1;
+	opt.useFloat	= false;
+	opt.clients		= 4;
+	opt.requests	= 1000;
+	opt.samples		= 1;
+	opt.maxBatch	= BPSERVER_MAX_BATCH;
+	opt.maxLatency	= BPSERVER_MAX_LATENCY;
+
+	bool valid = true;
+	for (int i = 1; i < argc && valid; ++i)
+	{
+		bool more = ( i + 1 < argc );
+
+		if		( strcmp(argv[i], "--unix") == 0 && more )		opt.unixPath	= argv[++i];
+		else if ( strcmp(argv[i], "--tcp") == 0 && more )		opt.tcpPort		= atoi( argv[++i] );
+		else if ( strcmp(argv[i], "--layers") == 0 && more )	valid			= parseLayers( argv[++i], opt.layers );
+		else if ( strcmp(argv[i], "--float") == 0 )				opt.useFloat	= true;
+		else if ( strcmp(argv[i], "--clients") == 0 && more )	opt.clients		= atoi( argv[++i] );
+		else if ( strcmp(argv[i], "--requests") == 0 && more )	opt.requests	= atoi( argv[++i] );
+		else if ( strcmp(argv[i], "--samples") == 0 && more )	opt.samples		= atoi( argv[++i] );
+		else if ( strcmp(argv[i], "--max-batch") == 0 && more )	opt.maxBatch	= atoi( argv[++i] );
+		else if ( strcmp(argv[i], "--latency") == 0 && more )	opt.maxLatency	= atoi( argv[++i] );
+		else
+			valid = false;
+	}
+
+	int targets = ( opt.unixPath != NULL ) + ( opt.tcpPort > 0 ) + !opt.layers.empty();
+	if ( !valid || targets != 1 )
+	{
+		fprintf( stderr, "usage: %s (--unix path | --tcp port | --layers n,n,...) [--float]\n"
+						 "       [--clients n] [--requests n] [--samples n] [--max-batch n] [--latency us]\n", argv[0] );
+		return 1;
+	}
+
+	if ( opt.clients < 1 || opt.requests < 1 || opt.samples < 1 || opt.maxBatch < 1 || opt.maxLatency < 0 )
+	{
+		fprintf( stderr, "invalid client, request, sample or batch count\n" );
+		return 1;
+	}
+
+	return opt.useFloat ? runLoad<float>( opt ) : runLoad<double>( opt );
+}
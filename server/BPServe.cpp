@@ -0,0 +1,207 @@
+// BPServe.cpp: inference daemon serving one network.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+//
+// Loads a model (binary model file or text format) and serves it with
+// BPServer until interrupted (SIGINT/SIGTERM). On SIGHUP the model file
+// is loaded again and replaces the served network without interrupting
+// requests (see BPModelHandle). Counters are printed to stderr every
+// --stats seconds and on exit.
+//
+// Usage: bpserve --model file [--float] [--map] [--unix path] [--tcp port]
+//				  [--max-batch n] [--latency us] [--max-request n] [--stats seconds]
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <csignal>
+#include <chrono>
+#include <thread>
+#include <iostream>
+#include "BPNet.h"
+#include "BPModelHandle.h"
+#include "BPServer.h"
+using namespace std;
+
+
+// daemon options
+struct Options
+{
+	const char*	model;			// model file
+	bool		useFloat;		// float network
+	bool		map;			// map binary model instead of loading it
+	const char*	unixPath;		// Unix socket (NULL - none)
+	int			tcpPort;		// TCP port (-1 - none)
+	int			maxBatch;		// samples per micro-batch
+	int			maxLatency;		// batch window (microseconds)
+	int			maxRequest;		// samples per request
+	double		statsInterval;	// seconds between counter reports (0 - on exit only)
+};
+
+
+// set by signal handlers
+static volatile sig_atomic_t g_stop = 0;
+static volatile sig_atomic_t g_reload = 0;
+
+
+//====================================================================
+// Stop on SIGINT/SIGTERM
+//====================================================================
+static void onSignal(int)
+{
+	g_stop = 1;
+}
+
+
+//====================================================================
+// Reload model on SIGHUP
+//====================================================================
+static void onReload(int)
+{
+	g_reload = 1;
+}
+
+
+//====================================================================
+// Serve a network until stopped
+//====================================================================
+template <class T>
+static int serve(const Options& opt)
+{
+	BPModelHandleT<T> model;
+	if ( !model.load( opt.model, opt.map ) )
+	{
+		fprintf( stderr, "can't load model %s\n", opt.model );
+		return 1;
+	}
+
+	BPServerT<T> server( &model );
+	server.setMaxBatch( opt.maxBatch );
+	server.setMaxLatency( opt.maxLatency );
+	server.setMaxRequest( opt.maxRequest );
+
+	if ( opt.unixPath != NULL && !server.listenUnix( opt.unixPath ) )
+	{
+		fprintf( stderr, "can't listen on %s\n", opt.unixPath );
+		return 1;
+	}
+
+	if ( opt.tcpPort >= 0 && !server.listenTcp( opt.tcpPort ) )
+	{
+		fprintf( stderr, "can't listen on port %d\n", opt.tcpPort );
+		return 1;
+	}
+
+	if ( !server.start() )
+	{
+		fprintf( stderr, "can't start server\n" );
+		return 1;
+	}
+
+	shared_ptr<const BPNetT<T> > net = model.get();
+	fprintf( stderr, "serving %s (%d inputs, %d outputs)", opt.model,
+			 net->getNumNodes(0), net->getNumNodes( net->getNumLayers() - 1 ) );
+	net.reset();
+
+	if ( opt.unixPath != NULL )
+		fprintf( stderr, " on %s", opt.unixPath );
+	if ( opt.tcpPort >= 0 )
+		fprintf( stderr, " on port %d", server.getPort() );
+	fprintf( stderr, "\n" );
+
+	chrono::steady_clock::time_point report = chrono::steady_clock::now();
+	while ( !g_stop )
+	{
+		this_thread::sleep_for( chrono::milliseconds(100) );
+
+		// loaded on this thread, requests are served by the
+		// previous version until the new one is published
+		if ( g_reload )
+		{
+			g_reload = 0;
+
+			if ( model.load( opt.model, opt.map ) )
+				fprintf( stderr, "reloaded %s (version %llu)\n", opt.model, (unsigned long long)model.version() );
+			else
+				fprintf( stderr, "can't reload model %s, keeping version %llu\n", opt.model, (unsigned long long)model.version() );
+		}
+
+		if ( opt.statsInterval > 0 &&
+			 chrono::duration<double>( chrono::steady_clock::now() - report ).count() >= opt.statsInterval )
+		{
+			BPServerT<T>::print( cerr, server.stats() );
+			server.resetStats();
+			report = chrono::steady_clock::now();
+		}
+	}
+
+	typename BPServerT<T>::Stats stats = server.stats();
+	server.stop();
+
+	BPServerT<T>::print( cerr, stats );
+	return 0;
+}
+
+
+//====================================================================
+// Main
+//====================================================================
+int main(int argc, char* argv[])
+{
+	Options opt;
+	opt.model			= NULL;
+	opt.useFloat		= false;
+	opt.map				= false;
+	opt.unixPath		= NULL;
+	opt.tcpPort			= -1;
+	opt.maxBatch		= BPSERVER_MAX_BATCH;
+	opt.maxLatency		= BPSERVER_MAX_LATENCY;
+	opt.maxRequest		= BPSERVER_MAX_REQUEST;
+	opt.statsInterval	= 0;
+
+	bool valid = true;
+	for (int i = 1; i < argc && valid; ++i)
+	{
+		bool more = ( i + 1 < argc );
+
+		if		( strcmp(argv[i], "--model") == 0 && more )			opt.model			= argv[++i];
+		else if ( strcmp(argv[i], "--float") == 0 )					opt.useFloat		= true;
+		else if ( strcmp(argv[i], "--map") == 0 )					opt.map				= true;
+		else if ( strcmp(argv[i], "--unix") == 0 && more )			opt.unixPath		= argv[++i];
+		else if ( strcmp(argv[i], "--tcp") == 0 && more )			opt.tcpPort			= atoi( argv[++i] );
+		else if ( strcmp(argv[i], "--max-batch") == 0 && more )		opt.maxBatch		= atoi( argv[++i] );
+		else if ( strcmp(argv[i], "--latency") == 0 && more )		opt.maxLatency		= atoi( argv[++i] );
+		else if ( strcmp(argv[i], "--max-request") == 0 && more )	opt.maxRequest		= atoi( argv[++i] );
+		else if ( strcmp(argv[i], "--stats") == 0 && more )			opt.statsInterval	= atof( argv[++i] );
+		else
+			valid = false;
+	}
+
+	if ( !valid || opt.model == NULL || ( opt.unixPath == NULL && opt.tcpPort < 0 ) )
+	{
+		fprintf( stderr, "usage: %s --model file [--float] [--map] [--unix path] [--tcp port]\n"
+						 "       [--max-batch n] [--latency us] [--max-request n] [--stats seconds]\n", argv[0] );
+		return 1;
+	}
+
+	if ( opt.maxBatch < 1 || opt.maxLatency < 0 || opt.maxRequest < 1 || opt.tcpPort > 65535 )
+	{
+		fprintf( stderr, "invalid batch size, latency, request size or port\n" );
+		return 1;
+	}
+
+	signal( SIGINT, onSignal );
+	signal( SIGTERM, onSignal );
+	signal( SIGHUP, onReload );
+
+	return opt.useFloat ? serve<float>( opt ) : serve<double>( opt );
+}
@@ -0,0 +1,48 @@
+// BPTest.h: minimal checks shared by the tests.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+
+#ifndef _BPTEST_H
+#define _BPTEST_H
+
+#include <cstdio>
+#include <cmath>
+
+// number of failed checks of the test program
+static int g_failures = 0;
+
+// report a failed check, the test continues
+#define CHECK(cond)														\
+	do {																\
+		if ( !(cond) )													\
+		{																\
+			fprintf( stderr, "%s:%d: CHECK(%s) failed\n",				\
+					 __FILE__, __LINE__, #cond );						\
+			++g_failures;												\
+		}																\
+	} while (0)
+
+// check |a - b| <= tol
+#define CHECK_NEAR(a, b, tol)											\
+	do {																\
+		double _a = (double)(a), _b = (double)(b);						\
+		if ( !(fabs(_a - _b) <= (tol)) )								\
+		{																\
+			fprintf( stderr, "%s:%d: CHECK_NEAR(%s, %s) failed: %g != %g\n",	\
+					 __FILE__, __LINE__, #a, #b, _a, _b );				\
+			++g_failures;												\
+		}																\
+	} while (0)
+
+// exit code of the test program
+#define TEST_RESULT()	( g_failures == 0 ? 0 : 1 )
+
+
+#endif // _BPTEST_H
@@ -0,0 +1,62 @@
+# KernelsStartup.cmake: code run before main() uses no instruction
+# set above the one of the build target.
+#
+# Copyright Gideon Pertzov, 2003
+#
+# This software is provided "as is" without express or implied
+# warranties. You may freely copy and compile this source into
+# applications you distribute provided that credit is given to
+# the original author.
+#
+######################################################################
+#
+# Run by ctest (cmake -P) with BPNET_SIMD=scalar and:
+#	LIBRARY		the bpnet library
+#	PROGRAM		a test program linked with it (KernelsTest)
+#	NM			nm of the toolchain
+#	OBJDUMP		objdump of the toolchain
+#
+# The static initializers of the library select the kernels and look
+# up the tables of the levels the CPU supports. Their code, and the
+# table getters of every level, are disassembled and must not use
+# AVX or AVX-512 registers (ymm, zmm or mask registers): on a CPU
+# without them the program would be killed (SIGILL) before main().
+#
+######################################################################
+
+# the kernels selected at startup follow BPNET_SIMD
+execute_process(COMMAND ${PROGRAM} RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+	message(FATAL_ERROR "${PROGRAM} failed with BPNET_SIMD=$ENV{BPNET_SIMD}: ${result}")
+endif()
+
+# startup code: static initializers, kernel selection and table getters
+execute_process(COMMAND ${NM} ${LIBRARY} OUTPUT_VARIABLE symbols ERROR_QUIET RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+	message(FATAL_ERROR "${NM} failed on ${LIBRARY}")
+endif()
+
+string(REGEX MATCHALL "[ \t][Tt] (_GLOBAL__sub_I_[A-Za-z0-9_.]*|_Z[0-9]+bpKernels[A-Za-z0-9_]*|_ZN9BPKernels(9initLevel|9initTable|10initTableF|11initTableI8|11detectLevel)Ev)\n"
+	   entries "${symbols}")
+
+set(count 0)
+foreach(entry ${entries})
+	string(REGEX REPLACE "^[ \t][Tt] ([^\n]*)\n$" "\\1" symbol "${entry}")
+
+	execute_process(COMMAND ${OBJDUMP} -d --no-show-raw-insn --disassemble=${symbol} ${LIBRARY}
+					OUTPUT_VARIABLE code ERROR_QUIET)
+
+	string(REGEX MATCH "[^\n]*%([yz]mm[0-9]+|k[1-7])[^\n]*" wide "${code}")
+	if(wide)
+		message(FATAL_ERROR "${symbol} runs at startup and uses wide vector registers:\n${wide}")
+	endif()
+
+	math(EXPR count "${count} + 1")
+endforeach()
+
+# the getters of all levels and the kernel selection
+if(count LESS 10)
+	message(FATAL_ERROR "only ${count} startup functions found in ${LIBRARY}")
+endif()
+
+message(STATUS "${count} startup functions use no wide vector registers")
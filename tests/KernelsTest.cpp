@@ -0,0 +1,184 @@
+// KernelsTest.cpp: SIMD kernels of every supported level against
+// the scalar kernels.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "BPKernels.h"
+#include "BPTest.h"
+using namespace std;
+
+// odd sizes exercise the remainder loops
+#define ROWS	13
+#define COLS	37
+#define SAMPLES	5
+
+
+//====================================================================
+// Deterministic test values in [-1, 1]
+//====================================================================
+template <class T>
+static void fill(vector<T>& v, size_t size, int seed)
+{
+	v.resize(size);
+	for (size_t i = 0; i != size; ++i)
+		v[i] = (T)sin( 0.37 * (i + 1) * (seed + 1) );
+}
+
+
+//====================================================================
+// Outputs of all kernels at the current level
+//====================================================================
+template <class T>
+static vector<T> runKernels()
+{
+	vector<T> w, bias, in, err, batchIn, batchErr;
+	fill( w, ROWS * COLS, 1 );
+	fill( bias, ROWS, 2 );
+	fill( in, COLS, 3 );
+	fill( err, ROWS, 4 );
+	fill( batchIn, SAMPLES * COLS, 5 );
+	fill( batchErr, SAMPLES * ROWS, 6 );
+
+	vector<T> result;
+
+	vector<T> out(ROWS);
+	BPKernels::matVec( &w[0], &bias[0], &in[0], &out[0], ROWS, COLS );
+	result.insert( result.end(), out.begin(), out.end() );
+
+	vector<T> back(COLS);
+	BPKernels::matTVec( &w[0], &err[0], &back[0], ROWS, COLS );
+	result.insert( result.end(), back.begin(), back.end() );
+
+	vector<T> batchOut(SAMPLES * ROWS);
+	BPKernels::batchMatVec( &w[0], &bias[0], &batchIn[0], &batchOut[0], ROWS, COLS, SAMPLES );
+	result.insert( result.end(), batchOut.begin(), batchOut.end() );
+
+	vector<T> batchBack(SAMPLES * COLS);
+	BPKernels::batchMatTVec( &w[0], &batchErr[0], &batchBack[0], ROWS, COLS, SAMPLES );
+	result.insert( result.end(), batchBack.begin(), batchBack.end() );
+
+	vector<T> g(ROWS * COLS, 0);
+	BPKernels::gradient( &g[0], &batchIn[0], &batchErr[0], ROWS, COLS, SAMPLES );
+	result.insert( result.end(), g.begin(), g.end() );
+
+	// weight updates with every rule, a few steps each
+	int size = ROWS * COLS;
+	vector<T> u = w, d(size, 0), s(size, 0);
+	for (int step = 0; step != 3; ++step)
+	{
+		BPKernels::update( &u[0], &d[0], &in[0], &err[0], 0.1, 0.9, ROWS, COLS );
+		BPKernels::apply( &u[0], &d[0], &g[0], 0.1, 0.9, size );
+		BPKernels::nesterov( &u[0], &d[0], &g[0], 0.1, 0.9, size );
+		BPKernels::rmsprop( &u[0], &d[0], &s[0], &g[0], 0.01, 0.5, 0.9, 1e-8, size );
+		BPKernels::adam( &u[0], &d[0], &s[0], &g[0], 0.01, 0.9, 0.999, 1e-8, size );
+	}
+	result.insert( result.end(), u.begin(), u.end() );
+
+	vector<T> x = batchOut;
+	BPKernels::sigmoid( &x[0], (int)x.size(), BPKernels::SIGMOID_RATIONAL );
+	result.insert( result.end(), x.begin(), x.end() );
+
+	return result;
+}
+
+
+//====================================================================
+// Compare every supported level with the scalar kernels
+//====================================================================
+template <class T>
+static void testLevels(double tol)
+{
+	BPKernels::setLevel( BPKernels::LEVEL_SCALAR );
+	vector<T> expected = runKernels<T>();
+
+	for (int level = BPKernels::LEVEL_SCALAR + 1; level <= BPKernels::detectLevel(); ++level)
+	{
+		CHECK( BPKernels::setLevel( (BPKernels::Level)level ) );
+
+		vector<T> result = runKernels<T>();
+		CHECK( result.size() == expected.size() );
+
+		double worst = 0;
+		for (size_t i = 0; i != result.size(); ++i)
+			worst = fmax( worst, fabs( (double)result[i] - expected[i] ) / fmax( 1.0, fabs((double)expected[i]) ) );
+
+		printf( "%-6s %-6s max relative difference %.2e\n", BPKernels::levelName( (BPKernels::Level)level ),
+				sizeof(T) == sizeof(double) ? "double" : "float", worst );
+
+		CHECK( worst <= tol );
+	}
+
+	BPKernels::setLevel( BPKernels::detectLevel() );
+}
+
+
+//====================================================================
+// Largest error of each sigmoid mode over [-40, 40] at every level
+//====================================================================
+template <class T>
+static void testSigmoid()
+{
+	// bounds documented in BPKernels.h, plus rounding of the result
+	// for float
+	bool	single		= ( sizeof(T) == sizeof(float) );
+	double	rounding	= single ? 6e-8 : 0;
+	double	bounds[3]	= { single ? 6e-8 : 1e-15, 1e-6 + rounding, single ? 3e-7 : 2e-8 };
+
+	// steps of 2^-10 plus an offset, so points fall between table entries
+	vector<T> x0;
+	for (int i = 0; i <= 80 * 1024; ++i)
+		x0.push_back( (T)( -40.0 + i / 1024.0 + 0.000123 ) );
+
+	for (int level = BPKernels::LEVEL_SCALAR; level <= BPKernels::detectLevel(); ++level)
+	{
+		CHECK( BPKernels::setLevel( (BPKernels::Level)level ) );
+
+		for (int mode = BPKernels::SIGMOID_EXACT; mode <= BPKernels::SIGMOID_RATIONAL; ++mode)
+		{
+			vector<T> x = x0;
+			BPKernels::sigmoid( &x[0], (int)x.size(), (BPKernels::Sigmoid)mode );
+
+			double worst = 0;
+			for (size_t i = 0; i != x.size(); ++i)
+				worst = fmax( worst, fabs( (double)x[i] - 1.0 / ( 1.0 + exp( -(double)x0[i] ) ) ) );
+
+			printf( "%-6s %-6s sigmoid %-8s max error %.2e\n", BPKernels::levelName( (BPKernels::Level)level ),
+					single ? "float" : "double", BPKernels::sigmoidName( (BPKernels::Sigmoid)mode ), worst );
+
+			CHECK( worst < bounds[mode] );
+		}
+	}
+
+	BPKernels::setLevel( BPKernels::detectLevel() );
+}
+
+
+int main()
+{
+	// the level selected at startup follows BPNET_SIMD (see KernelsStartup.cmake)
+	const char* env = getenv("BPNET_SIMD");
+	if ( env != NULL && strcmp( env, "scalar" ) == 0 )
+		CHECK( BPKernels::getLevel() == BPKernels::LEVEL_SCALAR );
+
+	testLevels<double>( 1e-12 );
+	testLevels<float>( 1e-4 );
+
+	testSigmoid<double>();
+	testSigmoid<float>();
+
+	// levels above the detected one are refused
+	if ( BPKernels::detectLevel() != BPKernels::LEVEL_AVX512 )
+		CHECK( !BPKernels::setLevel( BPKernels::LEVEL_AVX512 ) );
+
+	return TEST_RESULT();
+}
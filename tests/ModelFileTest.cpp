@@ -0,0 +1,248 @@
+// ModelFileTest.cpp: text and binary model round trips.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <cstdlib>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include "BPNet.h"
+#include "BPModelFile.h"
+#include "PatternSet.h"
+#include "BPTest.h"
+using namespace std;
+
+#define TEXT_FILE		"ModelFileTest.txt"
+#define BINARY_FILE		"ModelFileTest.bpm"
+#define PATCHED_FILE	"ModelFileTest.patched.bpm"
+
+
+//====================================================================
+// Largest difference between the weights and biases of two networks
+//====================================================================
+template <class T, class U>
+static double maxDifference(const BPNetT<T>& a, const BPNetT<U>& b)
+{
+	double worst = 0;
+	for (int l = 1; l < a.getNumLayers(); ++l)
+	{
+		const BPLayerT<T>& la = a.getLayer(l);
+		const BPLayerT<U>& lb = b.getLayer(l);
+
+		for (size_t i = 0; i != la.weightCount(); ++i)
+			worst = fmax( worst, fabs( (double)la.weights()[i] - lb.weights()[i] ) );
+
+		if ( la.hasBias() )
+			for (int j = 0; j != la.numNodes(); ++j)
+				worst = fmax( worst, fabs( (double)la.bias()[j] - lb.bias()[j] ) );
+	}
+
+	return worst;
+}
+
+
+//====================================================================
+// Write a copy of a model file with changed bytes
+//====================================================================
+static bool patchFile(size_t offset, const void* data, size_t size)
+{
+	ifstream ist( BINARY_FILE, ios::binary );
+	vector<char> bytes( (istreambuf_iterator<char>(ist)), istreambuf_iterator<char>() );
+
+	if ( bytes.size() < offset + size )
+		return false;
+
+	memcpy( &bytes[offset], data, size );
+
+	ofstream ost( PATCHED_FILE, ios::binary );
+	ost.write( &bytes[0], bytes.size() );
+	return ost.good();
+}
+
+
+//====================================================================
+// Write a copy of a model file with a changed table entry
+// (node counts of all layers, then their activations)
+//====================================================================
+static bool patchTable(int entry, uint32_t value)
+{
+	return patchFile( sizeof(BPModelHeader) + entry * sizeof(uint32_t), &value, sizeof(value) );
+}
+
+
+int main()
+{
+	srand(5);
+
+	PatternSet set;
+	set.create( 8, 2, 256 );
+	for (size_t i = 0; i != set.size() * 8; ++i)
+		set.inputs()[i] = (double)rand() / RAND_MAX;
+	for (size_t i = 0; i != set.size() * 2; ++i)
+		set.outputs()[i] = (double)rand() / RAND_MAX;
+
+	// trained network with every optional part of the formats
+	BPNet net;
+	net.setSeed(5);
+	net.setWeightInit( BPRandom::XAVIER );
+	net.createNetwork( 0.005, 0.5, vector<int>{8, 16, 2} );
+	net.setActivation( 1, BPActivation::TANH );
+	net.enableBias(true);
+	net.setOptimizer( BPOptimizer::ADAM );
+	net.setBatchSize(32);
+
+	for (int epoch = 0; epoch != 5; ++epoch)
+		net.trainBatch( set.patterns(), set.size() );
+
+	{
+		ofstream ost( TEXT_FILE );
+		CHECK( net.save(ost) );
+	}
+	CHECK( net.saveBinary( BINARY_FILE ) );
+
+	// the mapping is released before the file is changed below
+	{
+		BPNet text, binary, mapped;
+		{
+			ifstream ist( TEXT_FILE );
+			CHECK( text.load(ist) );
+		}
+		CHECK( binary.loadBinary( BINARY_FILE ) );
+		CHECK( mapped.mapBinary( BINARY_FILE ) );
+
+		BPNet* loaded[3] = { &text, &binary, &mapped };
+		for (int k = 0; k != 3; ++k)
+		{
+			CHECK( loaded[k]->getActivation(1) == BPActivation::TANH );
+			CHECK( loaded[k]->hasBias() );
+			CHECK( loaded[k]->getOptimizer().getType() == BPOptimizer::ADAM );
+			CHECK( loaded[k]->getOptimizer().getSteps() == net.getOptimizer().getSteps() );
+			CHECK( loaded[k]->hasSeed() && loaded[k]->getSeed() == 5 );
+			CHECK( loaded[k]->getWeightInit() == BPRandom::XAVIER );
+			CHECK( maxDifference( net, *loaded[k] ) <= 1e-15 );
+		}
+
+		// double model loads into a float network
+		BPNetF single;
+		CHECK( single.loadBinary( BINARY_FILE ) );
+		CHECK( maxDifference( binary, single ) <= 1e-6 );
+
+		// training continues where it stopped
+		double expected = net.trainBatch( set.patterns(), set.size() );
+		for (int k = 0; k != 3; ++k)
+		{
+			loaded[k]->setBatchSize(32);
+
+			double sumSquared = loaded[k]->trainBatch( set.patterns(), set.size() );
+			CHECK_NEAR( sumSquared, expected, 1e-12 );
+			CHECK( maxDifference( net, *loaded[k] ) <= 1e-12 );
+		}
+	}
+
+	// node counts of zero or beyond an int are refused, also unverified
+	uint32_t badCounts[3] = { 0, 0x80000010u, 0xffffffffu };
+	for (int k = 0; k != 3; ++k)
+	{
+		BPNet patched;
+		CHECK( patchTable( 1, badCounts[k] ) );
+		CHECK( !patched.loadBinary( PATCHED_FILE, false ) );
+		CHECK( !patched.mapBinary( PATCHED_FILE, false ) );
+	}
+
+	CHECK( patchTable( 1, 16 ) );
+	{
+		BPNet patched;
+		CHECK( patched.loadBinary( PATCHED_FILE, false ) );
+	}
+
+	// softmax is refused on a hidden layer, the output layer may use it
+	CHECK( patchTable( 3 + 1, BPActivation::SOFTMAX ) );
+	{
+		BPNet patched;
+		CHECK( !patched.loadBinary( PATCHED_FILE, false ) );
+		CHECK( !patched.mapBinary( PATCHED_FILE, false ) );
+	}
+
+	CHECK( patchTable( 3 + 2, BPActivation::SOFTMAX ) );
+	{
+		BPNet patched;
+		CHECK( patched.loadBinary( PATCHED_FILE, false ) );
+		CHECK( patched.getActivation(2) == BPActivation::SOFTMAX );
+	}
+	remove( PATCHED_FILE );
+
+	{
+		ifstream ist( TEXT_FILE );
+		string text( (istreambuf_iterator<char>(ist)), istreambuf_iterator<char>() );
+
+		string tanh = BPActivation::name( BPActivation::TANH );
+		size_t pos	= text.find( "activations" );
+		pos			= ( pos != string::npos ) ? text.find( tanh, pos ) : pos;
+		CHECK( pos != string::npos );
+
+		if ( pos != string::npos )
+		{
+			text.replace( pos, tanh.size(), BPActivation::name( BPActivation::SOFTMAX ) );
+
+			{
+				ofstream ost( PATCHED_FILE );
+				ost << text;
+			}
+
+			ifstream patched( PATCHED_FILE );
+			BPNet hidden;
+			CHECK( !hidden.load( patched ) );
+		}
+		remove( PATCHED_FILE );
+	}
+
+	// header fields are covered by the checksum
+	double learningRate = 0.5;
+	CHECK( patchFile( offsetof(BPModelHeader, learningRate), &learningRate, sizeof(learningRate) ) );
+	{
+		BPNet patched;
+		CHECK( !patched.loadBinary( PATCHED_FILE ) );
+		CHECK( patched.loadBinary( PATCHED_FILE, false ) && patched.getLearningRate() == 0.5 );
+	}
+
+	uint64_t steps = 1;
+	CHECK( patchFile( offsetof(BPModelHeader, steps), &steps, sizeof(steps) ) );
+	{
+		BPNet patched;
+		CHECK( !patched.mapBinary( PATCHED_FILE ) );
+	}
+	remove( PATCHED_FILE );
+
+	// a corrupted file fails the checksum
+	{
+		fstream file( BINARY_FILE, ios::in | ios::out | ios::binary );
+		file.seekg( 0, ios::end );
+		streamoff size = file.tellg();
+
+		char ch = 0;
+		file.seekg( size - 1 );
+		file.read( &ch, 1 );
+		ch ^= 0x55;
+		file.seekp( size - 1 );
+		file.write( &ch, 1 );
+	}
+
+	BPNet corrupted;
+	CHECK( !corrupted.loadBinary( BINARY_FILE ) );
+
+	remove( TEXT_FILE );
+	remove( BINARY_FILE );
+
+	return TEST_RESULT();
+}
@@ -0,0 +1,659 @@
+// NetTest.cpp: training and inference paths of BPNet.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <thread>
+#include "BPNet.h"
+#include "BPNode.h"
+#include "BPLink.h"
+#include "BPThreadPool.h"
+#include "BPParallelTrainer.h"
+#include "PatternSet.h"
+#include "BPTest.h"
+using namespace std;
+
+
+//====================================================================
+// Epochs of online training until XOR is learned (-1 - not learned)
+//====================================================================
+static int learnXor(BPNet& net, int maxEpochs)
+{
+	for (int epoch = 0; epoch != maxEpochs; ++epoch)
+	{
+		double sumSquared = 0;
+		for (int p = 0; p != 4; ++p)
+		{
+			int a = p & 1, b = p >> 1;
+
+			net.setInput( a, 0 );
+			net.setInput( b, 1 );
+			net.run();
+			net.setError( a ^ b, 0 );
+			net.learn();
+
+			double diff = (a ^ b) - net.getOutput(0);
+			sumSquared += diff * diff;
+		}
+
+		if ( sumSquared < 0.04 )
+			return epoch;
+	}
+
+	return -1;
+}
+
+
+//====================================================================
+// Every update rule learns XOR
+//====================================================================
+static void testXor()
+{
+	const double lr[BPOptimizer::NUM_TYPES] = { 0.5, 0.5, 0.02, 0.02 };
+
+	for (int type = 0; type != BPOptimizer::NUM_TYPES; ++type)
+	{
+		BPNet net;
+		net.setSeed(1);
+		net.createNetwork( lr[type], (type == BPOptimizer::ADAM) ? 0 : 0.9, vector<int>{2, 4, 1} );
+		net.enableBias(true);
+		net.setOptimizer( (BPOptimizer::Type)type );
+
+		int epochs = learnXor( net, 20000 );
+		printf( "xor %-8s epochs %d\n", BPOptimizer::name( (BPOptimizer::Type)type ), epochs );
+
+		CHECK( epochs >= 0 );
+	}
+
+	// and the legacy ordering
+	BPNet legacy;
+	legacy.setSeed(1);
+	legacy.createNetwork( 0.5, 0.9, vector<int>{2, 4, 1} );
+	legacy.enableBias(true);
+	legacy.setLegacyOrder(true);
+
+	CHECK( learnXor( legacy, 20000 ) >= 0 );
+}
+
+
+//====================================================================
+// Other transfer functions learn XOR
+//====================================================================
+static void testActivationsXor()
+{
+	typedef BPActivation A;
+
+	// hidden and output transfer functions
+	const A::Type types[3][2] = { { A::TANH, A::TANH }, { A::RELU, A::SIGMOID }, { A::RELU, A::LINEAR } };
+
+	for (int t = 0; t != 3; ++t)
+	{
+		BPNet net;
+		net.setSeed(2);
+		net.setWeightInit( types[t][0] == A::RELU ? BPRandom::HE : BPRandom::XAVIER );
+		net.createNetwork( 0.05, 0.9, vector<int>{2, 8, 1}, vector<A::Type>{ A::LINEAR, types[t][0], types[t][1] } );
+		net.enableBias(true);
+
+		int epochs = learnXor( net, 20000 );
+		printf( "xor %s/%s epochs %d\n", A::name( types[t][0] ), A::name( types[t][1] ), epochs );
+
+		CHECK( epochs >= 0 );
+	}
+}
+
+
+//====================================================================
+// Softmax outputs sum to 1 and train with cross-entropy gradients
+//====================================================================
+static double crossEntropy(BPNet& net, const vector<double>& in, const vector<double>& desired, int n)
+{
+	vector<double> out( desired.size() );
+	net.runBatch( &in[0], n, &out[0] );
+
+	double loss = 0;
+	for (size_t i = 0; i != out.size(); ++i)
+		loss -= desired[i] * log( out[i] );
+
+	return loss;
+}
+
+
+static void testSoftmax()
+{
+	typedef BPActivation A;
+
+	const int n = 200, numInputs = 4, numOutputs = 3;
+
+	// one-hot class of the largest of three input combinations
+	vector<double> in( n * numInputs ), desired( n * numOutputs, 0.0 );
+	for (int s = 0; s != n; ++s)
+	{
+		double* x = &in[s * numInputs];
+		for (int k = 0; k != numInputs; ++k)
+			x[k] = sin( 1.7 * s + 0.9 * k ) * 0.5 + 0.5;
+
+		double score[3] = { x[0] + x[1], x[2] + x[3], 1.0 - x[0] + x[3] };
+		int best = ( score[1] > score[0] ) ? 1 : 0;
+		best = ( score[2] > score[best] ) ? 2 : best;
+		desired[s * numOutputs + best] = 1.0;
+	}
+
+	BPNet net;
+	net.setSeed(3);
+	net.setWeightInit( BPRandom::XAVIER );
+	net.createNetwork( 0.05, 0.5, vector<int>{numInputs, 10, numOutputs},
+					   vector<A::Type>{ A::LINEAR, A::TANH, A::SOFTMAX } );
+	net.enableBias(true);
+
+	// rows of probabilities, also from the node by node pass
+	vector<double> out( n * numOutputs );
+	net.runBatch( &in[0], n, &out[0] );
+
+	double worstSum = 0;
+	bool positive = true;
+	for (int s = 0; s != n; ++s)
+	{
+		double sum = 0;
+		for (int j = 0; j != numOutputs; ++j)
+		{
+			sum += out[s * numOutputs + j];
+			positive = positive && out[s * numOutputs + j] > 0;
+		}
+		worstSum = fmax( worstSum, fabs( sum - 1.0 ) );
+	}
+
+	for (int k = 0; k != numInputs; ++k)
+		net.setInput( in[k], k );
+	net.run();
+
+	CHECK( positive && worstSum <= 1e-12 );
+	CHECK_NEAR( net.getOutput(0) + net.getOutput(1) + net.getOutput(2), 1.0, 1e-12 );
+	CHECK_NEAR( net.getOutput(0), out[0], 1e-12 );
+
+	// the summed gradients are the negative gradients of the cross-entropy
+	// loss: output errors are (desired - value), hidden errors go through
+	// the tanh derivative
+	BPNet::Workspace ws;
+	ws.create( net.getNodeCount(), n, true );
+
+	net.forward( ws, &in[0], n );
+	memcpy( ws.errors(2), &desired[0], desired.size() * sizeof(double) );
+	net.backward( ws, &in[0], n );
+
+	const double h = 1e-6;
+	double worstGrad = 0;
+	for (int l = 1; l != 3; ++l)
+	{
+		for (int node = 0; node != 3; ++node)
+		{
+			BPNet::Layer& layer = net.getLayer(l);
+			double w = layer.getWeight( node, 1 );
+
+			layer.setWeight( node, 1, w + h );
+			double up = crossEntropy( net, in, desired, n );
+			layer.setWeight( node, 1, w - h );
+			double down = crossEntropy( net, in, desired, n );
+			layer.setWeight( node, 1, w );
+
+			double numeric	= ( up - down ) / ( 2 * h );
+			double summed	= ws.gradient(l)[ node * layer.numInputs() + 1 ];
+
+			worstGrad = fmax( worstGrad, fabs( numeric + summed ) / fmax( 1.0, fabs(numeric) ) );
+		}
+	}
+
+	printf( "softmax max row sum error %.1e, gradient error %.1e\n", worstSum, worstGrad );
+	CHECK( worstGrad <= 1e-5 );
+
+	// and the loss goes down with training (gradients are summed over
+	// all samples)
+	net.setLearningRate( 0.002 );
+
+	double before = crossEntropy( net, in, desired, n );
+	for (int epoch = 0; epoch != 300; ++epoch)
+	{
+		net.forward( ws, &in[0], n );
+		memcpy( ws.errors(2), &desired[0], desired.size() * sizeof(double) );
+		net.backward( ws, &in[0], n );
+		net.applyGradients( ws );
+	}
+	double after = crossEntropy( net, in, desired, n );
+
+	printf( "softmax cross-entropy %.2f -> %.2f\n", before, after );
+	CHECK( after < 0.5 * before );
+}
+
+
+//====================================================================
+// run, runBatch and predict give the same outputs
+//====================================================================
+static void testInference()
+{
+	srand(2);
+
+	BPNet net;
+	net.setSeed(2);
+	net.createNetwork( 0.3, 0.5, vector<int>{19, 33, 7} );
+	net.enableBias(true);
+
+	const int n = 50;
+	vector<double> in(n * 19), ref(n * 7), batch(n * 7);
+	for (size_t i = 0; i != in.size(); ++i)
+		in[i] = (double)rand() / RAND_MAX;
+
+	for (int s = 0; s != n; ++s)
+	{
+		for (int i = 0; i != 19; ++i)
+			net.setInput( in[s * 19 + i], i );
+
+		net.run();
+
+		for (int i = 0; i != 7; ++i)
+			ref[s * 7 + i] = net.getOutput(i);
+	}
+
+	net.runBatch( &in[0], n, &batch[0] );
+	for (int i = 0; i != n * 7; ++i)
+		CHECK_NEAR( batch[i], ref[i], 1e-12 );
+
+	// concurrent predict() on a const network
+	const BPNet& shared = net;
+	vector<double> worst(4, 0);
+	vector<thread> threads;
+
+	for (int t = 0; t != 4; ++t)
+	{
+		threads.push_back( thread( [&, t]
+		{
+			BPNet::Workspace ws;
+			shared.createWorkspace(ws);
+
+			double out[7];
+			for (int s = 0; s != n; ++s)
+			{
+				shared.predict( &in[s * 19], out, ws );
+				for (int i = 0; i != 7; ++i)
+					worst[t] = fmax( worst[t], fabs( out[i] - ref[s * 7 + i] ) );
+			}
+		} ) );
+	}
+
+	for (size_t t = 0; t != threads.size(); ++t)
+		threads[t].join();
+
+	for (int t = 0; t != 4; ++t)
+		CHECK( worst[t] <= 1e-12 );
+}
+
+
+//====================================================================
+// Data-parallel trainer matches trainBatch
+//====================================================================
+static void testParallel()
+{
+	srand(3);
+
+	PatternSet set;
+	set.create( 29, 3, 500 );
+	for (size_t i = 0; i != 500; ++i)
+	{
+		Pattern* pattern = set.getPattern(i);
+
+		for (int k = 0; k != 29; ++k)
+			pattern->setInput( (double)rand() / RAND_MAX, k );
+		for (int k = 0; k != 3; ++k)
+			pattern->setOutput( (double)rand() / RAND_MAX, k );
+	}
+
+	for (int type = 0; type != BPOptimizer::NUM_TYPES; ++type)
+	{
+		BPNet a;
+		a.setSeed(3);
+		a.createNetwork( 0.01, 0.5, vector<int>{29, 23, 17, 3} );
+		a.enableBias(true);
+		a.setOptimizer( (BPOptimizer::Type)type );
+		a.setBatchSize(64);
+
+		BPNet b = a;
+
+		BPThreadPool pool(4);
+		BPParallelTrainer trainer( &b, &pool );
+		trainer.setBatchSize(64);
+
+		double ea = 0, eb = 0;
+		for (int epoch = 0; epoch != 5; ++epoch)
+		{
+			ea = a.trainBatch( set.patterns(), set.size() );
+			eb = trainer.train( set.patterns(), set.size() );
+		}
+
+		double worst = 0;
+		for (int l = 1; l != a.getNumLayers(); ++l)
+			for (size_t i = 0; i != a.getLayer(l).weightCount(); ++i)
+				worst = fmax( worst, fabs( a.getLayer(l).weights()[i] - b.getLayer(l).weights()[i] ) );
+
+		printf( "parallel %-8s sse %g %g max weight difference %g\n",
+				BPOptimizer::name( (BPOptimizer::Type)type ), ea, eb, worst );
+
+		CHECK_NEAR( ea, eb, 1e-9 * fmax( 1.0, ea ) );
+		CHECK( worst <= 1e-9 );
+	}
+}
+
+
+//====================================================================
+// Weight initialization depends on the seed only
+//====================================================================
+static void testSeed()
+{
+	vector<int> layers{64, 300, 200, 10};
+
+	BPNet a, b, c;
+	a.setSeed(42);
+	a.createNetwork( 0.1, 0.5, layers );
+
+	// same seed on several threads
+	b.setNumThreads(4);
+	b.setParallelThreshold(1);
+	b.setSeed(42);
+	b.createNetwork( 0.1, 0.5, layers );
+
+	c.setSeed(43);
+	c.createNetwork( 0.1, 0.5, layers );
+
+	bool same = true, differ = false;
+	for (int l = 1; l != a.getNumLayers(); ++l)
+	{
+		for (size_t i = 0; i != a.getLayer(l).weightCount(); ++i)
+		{
+			same	= same && ( a.getLayer(l).weights()[i] == b.getLayer(l).weights()[i] );
+			differ	= differ || ( a.getLayer(l).weights()[i] != c.getLayer(l).weights()[i] );
+		}
+	}
+
+	CHECK( same );
+	CHECK( differ );
+
+	// networks without a seed draw different ones
+	BPNet d, e;
+	d.createNetwork( 0.1, 0.5, layers );
+	e.createNetwork( 0.1, 0.5, layers );
+	CHECK( !d.hasSeed() && d.getSeed() != e.getSeed() );
+
+	// scaled schemes stay inside their range
+	const BPRandom::Init init[2] = { BPRandom::XAVIER, BPRandom::HE };
+	for (int s = 0; s != 2; ++s)
+	{
+		a.setWeightInit( init[s] );
+		a.initWeights();
+
+		for (int l = 1; l != a.getNumLayers(); ++l)
+		{
+			const BPNet::Layer& layer = a.getLayer(l);
+			double limit = BPRandom::limit( init[s], layer.numInputs(), layer.numNodes() );
+
+			double low = 0, high = 0;
+			for (size_t i = 0; i != layer.weightCount(); ++i)
+			{
+				low		= fmin( low, layer.weights()[i] );
+				high	= fmax( high, layer.weights()[i] );
+			}
+
+			CHECK( low >= -limit && high <= limit );
+			CHECK( high > 0.9 * limit && low < -0.9 * limit );
+		}
+	}
+
+	// initWeights starts over from the same weights
+	a.setWeightInit( BPRandom::UNIFORM );
+	a.initWeights();
+
+	double before = a.getLayer(1).weights()[0];
+	a.setInput( 1.0, 0 );
+	a.run();
+	a.setError( 1.0, 0 );
+	a.learn();
+	CHECK( a.getLayer(1).weights()[0] != before );
+
+	a.initWeights();
+	CHECK( a.getLayer(1).weights()[0] == before && a.getLayer(1).deltas()[0] == 0 );
+}
+
+
+//====================================================================
+// Reset and re-creation reuse the network storage
+//====================================================================
+static void testReset()
+{
+	vector<int> layers{8, 16, 4};
+
+	BPNet a, b;
+	a.setOptimizer( BPOptimizer::ADAM );
+	a.setSeed(3);
+	a.createNetwork( 0.01, 0, layers );
+	a.enableBias(true);
+
+	const double* weights = a.getLayer(1).weights();
+	const double* bias	  = a.getLayer(1).bias();
+	const double* values  = a.getLayer(0).values();
+
+	// train a little
+	for (int n = 0; n != 10; ++n)
+	{
+		for (int i = 0; i != 8; ++i)
+			a.setInput( (i + n) % 3 * 0.5, i );
+
+		a.run();
+		for (int i = 0; i != 4; ++i)
+			a.setError( 1.0, i );
+
+		a.learn();
+	}
+
+	a.reset(3);
+
+	// same as a new network with the seed
+	b.setOptimizer( BPOptimizer::ADAM );
+	b.setSeed(3);
+	b.createNetwork( 0.01, 0, layers );
+	b.enableBias(true);
+
+	bool same = true;
+	for (int l = 1; l != a.getNumLayers(); ++l)
+	{
+		const BPNet::Layer& la = a.getLayer(l);
+		const BPNet::Layer& lb = b.getLayer(l);
+
+		for (size_t i = 0; i != la.weightCount(); ++i)
+			same = same && la.weights()[i] == lb.weights()[i] && la.deltas()[i] == 0 && la.moments()[i] == 0;
+
+		for (int j = 0; j != la.numNodes(); ++j)
+			same = same && la.bias()[j] == 0 && la.getValue(j) == 0 && la.getError(j) == 0;
+	}
+
+	CHECK( same );
+	CHECK( a.getOptimizer().getSteps() == 0 );
+
+	// storage is kept by reset, by enableBias and by networks that fit
+	CHECK( a.getLayer(1).weights() == weights && a.getLayer(1).bias() == bias );
+
+	a.createNetwork( 0.01, 0, vector<int>{4, 8, 2} );
+	CHECK( a.getLayer(0).values() == values );
+}
+
+
+//====================================================================
+// Graph view ids are local to the network
+//====================================================================
+static void testGraphView()
+{
+	vector<int> layers{3, 5, 2};
+
+	// several networks build their views at once
+	BPNet nets[4];
+	vector<thread> threads;
+	for (int t = 0; t != 4; ++t)
+	{
+		threads.push_back( thread( [&nets, &layers, t]()
+		{
+			nets[t].setSeed(t);
+			nets[t].createNetwork( 0.1, 0.5, layers );
+			nets[t].buildGraphView();
+		} ) );
+	}
+
+	for (size_t t = 0; t != threads.size(); ++t)
+		threads[t].join();
+
+	for (int t = 0; t != 4; ++t)
+	{
+		const BPNet& net = nets[t];
+		CHECK( net.getNumGraphNodes() == 10 && net.getNumGraphLinks() == 25 );
+
+		bool ok = true;
+		for (int i = 0; i != net.getNumGraphNodes(); ++i)
+		{
+			const BPNode* node = net.getGraphNode(i);
+			ok = ok && node->id() == i && node->layer() == ( i < 3 ? 0 : i < 8 ? 1 : 2 );
+			ok = ok && node->index() == i - ( i < 3 ? 0 : i < 8 ? 3 : 8 );
+		}
+
+		// link ids and addresses follow the weight matrices
+		for (int i = 0; i != net.getNumGraphLinks(); ++i)
+		{
+			const BPLink*		link	= net.getGraphLink(i);
+			const BPNet::Layer&	layer	= net.getLayer( link->layer() );
+
+			ok = ok && link->id() == i;
+			ok = ok && link->getWeight() == layer.getWeight( link->node(), link->input() );
+		}
+
+		CHECK( ok );
+	}
+}
+
+
+//====================================================================
+// Copies own their storage and don't share the graph view
+//====================================================================
+static void testCopy()
+{
+	BPNet a;
+	a.setSeed(9);
+	a.setOptimizer( BPOptimizer::ADAM );
+	a.createNetwork( 0.01, 0.5, vector<int>{4, 6, 2} );
+	a.enableBias(true);
+	a.setNumThreads(2);
+
+	// some optimizer state and node values to copy
+	double in[4] = { 0.2, 0.4, 0.6, 0.8 };
+	for (int r = 0; r != 3; ++r)
+	{
+		for (int i = 0; i != 4; ++i)
+			a.setInput( in[i], i );
+		a.run();
+		a.setError( 1.0, 0 );
+		a.setError( 0.0, 1 );
+		a.learn();
+	}
+
+	a.buildGraphView();
+
+	BPNet b;
+	b.createNetwork( 0.1, 0.5, vector<int>{3, 3} );
+	b = a;
+
+	{
+		BPNet c = a;
+		CHECK( c.getNumGraphNodes() == 0 && c.getThreadPool() != a.getThreadPool() );
+	}
+
+	CHECK( a.getNumGraphNodes() == 12 && b.getNumGraphNodes() == 0 );
+	CHECK( b.hasBias() && b.getOptimizer().getType() == BPOptimizer::ADAM && b.getSeed() == 9 );
+
+	bool same = true;
+	for (int l = 0; l != 3; ++l)
+	{
+		const BPNet::Layer& la = a.getLayer(l);
+		const BPNet::Layer& lb = b.getLayer(l);
+
+		same = same && memcmp( la.values(), lb.values(), la.numNodes() * sizeof(double) ) == 0;
+		if ( l == 0 )
+			continue;
+
+		same = same && la.weights() != lb.weights();
+		same = same && memcmp( la.weights(), lb.weights(), la.weightCount() * sizeof(double) ) == 0;
+		same = same && memcmp( la.moments(), lb.moments(), la.weightCount() * sizeof(double) ) == 0;
+		same = same && memcmp( la.bias(), lb.bias(), la.numNodes() * sizeof(double) ) == 0;
+		same = same && memcmp( la.biasMoments(), lb.biasMoments(), la.numNodes() * sizeof(double) ) == 0;
+	}
+
+	CHECK( same );
+
+	// networks train apart
+	b.getLayer(1).setWeight( 0, 0, 5.0 );
+	CHECK( a.getLayer(1).getWeight(0, 0) != 5.0 );
+	CHECK( a.getGraphLink(0)->getWeight() == a.getLayer(1).getWeight(0, 0) );
+}
+
+
+//====================================================================
+// Single precision network learns too
+//====================================================================
+static void testFloat()
+{
+	BPNetF net;
+	net.setSeed(4);
+	net.createNetwork( 0.5, 0.9, vector<int>{2, 4, 1} );
+	net.enableBias(true);
+
+	int learned = -1;
+	for (int epoch = 0; epoch != 20000 && learned < 0; ++epoch)
+	{
+		float sumSquared = 0;
+		for (int p = 0; p != 4; ++p)
+		{
+			int a = p & 1, b = p >> 1;
+
+			net.setInput( (float)a, 0 );
+			net.setInput( (float)b, 1 );
+			net.run();
+			net.setError( (float)(a ^ b), 0 );
+			net.learn();
+
+			float diff = (a ^ b) - net.getOutput(0);
+			sumSquared += diff * diff;
+		}
+
+		if ( sumSquared < 0.04f )
+			learned = epoch;
+	}
+
+	CHECK( learned >= 0 );
+}
+
+
+int main()
+{
+	testXor();
+	testActivationsXor();
+	testSoftmax();
+	testInference();
+	testParallel();
+	testSeed();
+	testReset();
+	testGraphView();
+	testCopy();
+	testFloat();
+
+	return TEST_RESULT();
+}
@@ -0,0 +1,177 @@
+// PatternSetTest.cpp: pattern set files and the streaming reader.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "PatternSet.h"
+#include "PatternReader.h"
+#include "BPTest.h"
+using namespace std;
+
+#define TEXT_FILE		"PatternSetTest.txt"
+#define BINARY_FILE		"PatternSetTest.bps"
+#define PATCHED_FILE	"PatternSetTest.patched.bps"
+
+#define IN_SIZE		5
+#define OUT_SIZE	3
+#define COUNT		1000
+
+
+//====================================================================
+// Are two sets equal (values up to tol)
+//====================================================================
+template <class T>
+static bool sameSet(const PatternSet& a, const PatternSetT<T>& b, double tol)
+{
+	if ( a.size() != b.size() || a.inSize() != b.inSize() || a.outSize() != b.outSize() )
+		return false;
+
+	for (size_t i = 0; i != a.size(); ++i)
+	{
+		if ( a.getId(i) != b.getId(i) )
+			return false;
+
+		for (int k = 0; k != IN_SIZE; ++k)
+			if ( fabs( a.inputs()[i * IN_SIZE + k] - b.inputs()[i * IN_SIZE + k] ) > tol )
+				return false;
+
+		for (int k = 0; k != OUT_SIZE; ++k)
+			if ( fabs( a.outputs()[i * OUT_SIZE + k] - b.outputs()[i * OUT_SIZE + k] ) > tol )
+				return false;
+	}
+
+	return true;
+}
+
+
+//====================================================================
+// Read a whole file in chunks
+//====================================================================
+static bool readAll(const char* fileName, size_t chunk, PatternSet& set)
+{
+	PatternReader reader;
+	if ( !reader.open( fileName, IN_SIZE, OUT_SIZE ) )
+		return false;
+
+	set.create( IN_SIZE, OUT_SIZE, 0 );
+	while ( reader.read( set, chunk ) == chunk )
+		;
+
+	return reader.eof() && !reader.fail();
+}
+
+
+//====================================================================
+// Write a copy of a binary file with changed header sizes
+//====================================================================
+static bool patchHeader(const char* from, const char* to, uint32_t inSize, uint64_t count)
+{
+	FILE* fp = fopen( from, "rb" );
+	if ( fp == NULL )
+		return false;
+
+	vector<char> bytes( 1 << 20 );
+	bytes.resize( fread( &bytes[0], 1, bytes.size(), fp ) );
+	fclose( fp );
+
+	PatternSetHeader header;
+	memcpy( &header, &bytes[0], sizeof(header) );
+	header.inSize	= inSize;
+	header.count	= count;
+	memcpy( &bytes[0], &header, sizeof(header) );
+
+	fp = fopen( to, "wb" );
+	if ( fp == NULL )
+		return false;
+
+	bool ok = ( fwrite( &bytes[0], 1, bytes.size(), fp ) == bytes.size() );
+	return ( fclose(fp) == 0 && ok );
+}
+
+
+int main()
+{
+	srand(6);
+
+	PatternSet set;
+	set.create( IN_SIZE, OUT_SIZE, COUNT );
+	for (size_t i = 0; i != COUNT; ++i)
+	{
+		set.setId( i, (int)i + 1 );
+
+		for (int k = 0; k != IN_SIZE; ++k)
+			set.inputs()[i * IN_SIZE + k] = (double)rand() / RAND_MAX - 0.5;
+		for (int k = 0; k != OUT_SIZE; ++k)
+			set.outputs()[i * OUT_SIZE + k] = (double)rand() / RAND_MAX;
+	}
+
+	CHECK( set.saveText( TEXT_FILE ) );
+	CHECK( set.saveBinary( BINARY_FILE ) );
+
+	// whole file round trips
+	PatternSet text, mapped;
+	CHECK( text.loadText( TEXT_FILE, IN_SIZE, OUT_SIZE ) );
+	CHECK( sameSet( set, text, 1e-15 ) );
+
+	CHECK( mapped.mapBinary( BINARY_FILE ) );
+	CHECK( mapped.isMapped() );
+	CHECK( sameSet( set, mapped, 0 ) );
+
+	// streaming reader, chunk size not dividing the count
+	PatternSet streamed;
+	CHECK( readAll( TEXT_FILE, 64, streamed ) );
+	CHECK( sameSet( set, streamed, 1e-15 ) );
+
+	CHECK( readAll( BINARY_FILE, 64, streamed ) );
+	CHECK( sameSet( set, streamed, 0 ) );
+
+	// binary reader seeks
+	PatternReader reader;
+	CHECK( reader.open( BINARY_FILE, IN_SIZE, OUT_SIZE ) );
+	CHECK( reader.isBinary() && reader.size() == COUNT );
+	CHECK( reader.seek( COUNT - 10 ) );
+
+	PatternSet tail;
+	tail.create( IN_SIZE, OUT_SIZE, 0 );
+	CHECK( reader.read( tail, 100 ) == 10 );
+	CHECK( tail.getId(0) == COUNT - 9 );
+	reader.close();
+
+	// single precision set from the same files
+	PatternSetF single;
+	CHECK( single.loadText( TEXT_FILE, IN_SIZE, OUT_SIZE ) );
+	CHECK( sameSet( set, single, 1e-7 ) );
+
+	// missing file
+	PatternSet wrong;
+	CHECK( !wrong.mapBinary( "PatternSetTest.missing" ) );
+
+	// sizes that don't fit an int, or blocks that only fit the file
+	// when their byte size wraps around
+	CHECK( patchHeader( BINARY_FILE, PATCHED_FILE, 0x80000001u, 0 ) );
+	CHECK( !wrong.mapBinary( PATCHED_FILE ) );
+
+	CHECK( patchHeader( BINARY_FILE, PATCHED_FILE, 1u << 25, (uint64_t)1 << 39 ) );
+	CHECK( !wrong.mapBinary( PATCHED_FILE ) );
+
+	CHECK( patchHeader( BINARY_FILE, PATCHED_FILE, IN_SIZE, COUNT ) );
+	CHECK( wrong.mapBinary( PATCHED_FILE ) && sameSet( set, wrong, 0 ) );
+	wrong.clear();
+
+	mapped.clear();
+	remove( TEXT_FILE );
+	remove( BINARY_FILE );
+	remove( PATCHED_FILE );
+
+	return TEST_RESULT();
+}
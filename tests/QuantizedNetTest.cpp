@@ -0,0 +1,238 @@
+// QuantizedNetTest.cpp: int8 kernels and quantized inference against
+// the original network.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "BPNet.h"
+#include "BPKernels.h"
+#include "BPQuantizedNet.h"
+#include "PatternSet.h"
+#include "BPTest.h"
+using namespace std;
+
+// AVX-512 int8 kernels with and without VNNI (see BPKernels.cpp)
+#if defined(__GNUC__) && ( defined(__x86_64__) || defined(__i386__) )
+#define HAVE_AVX512_I8
+const BPKernels::TableI8* bpKernelsAVX512I8(bool vnni);
+#endif
+
+#define ROWS		13
+#define NUM_INPUTS	4
+#define NUM_OUTPUTS	3
+#define COUNT		1000
+
+
+//====================================================================
+// Integer products against a plain loop
+//====================================================================
+static bool sameProducts(BPKernels::TableI8::MatVecI8Func matVec, int cols)
+{
+	vector<int8_t>	w( ROWS * cols );
+	vector<uint8_t>	in( cols );
+	for (size_t i = 0; i != w.size(); ++i)
+		w[i] = (int8_t)( (int)( i * 37 % 255 ) - 127 );
+	for (int k = 0; k != cols; ++k)
+		in[k] = (uint8_t)( k * 53 % ( BPKernels::I8_MAX + 1 ) );
+
+	vector<int32_t> out( ROWS );
+	if ( matVec != NULL )
+		matVec( &w[0], &in[0], &out[0], ROWS, cols );
+	else
+		BPKernels::matVecI8( &w[0], &in[0], &out[0], ROWS, cols );
+
+	for (int j = 0; j != ROWS; ++j)
+	{
+		int32_t expected = 0;
+		for (int k = 0; k != cols; ++k)
+			expected += w[j * cols + k] * in[k];
+
+		if ( out[j] != expected )
+			return false;
+	}
+
+	return true;
+}
+
+
+//====================================================================
+// Every level (and both AVX-512 kernels) sums exactly
+//====================================================================
+static void testMatVecI8()
+{
+	// a full 64 byte block, a partial one and more than one
+	int cols[3] = { 64, 80, 144 };
+
+	for (int level = BPKernels::LEVEL_SCALAR; level <= BPKernels::detectLevel(); ++level)
+	{
+		CHECK( BPKernels::setLevel( (BPKernels::Level)level ) );
+
+		for (int c = 0; c != 3; ++c)
+			CHECK( sameProducts( NULL, cols[c] ) );
+	}
+
+	BPKernels::setLevel( BPKernels::detectLevel() );
+
+#ifdef HAVE_AVX512_I8
+	if ( __builtin_cpu_supports("avx512bw") )
+	{
+		for (int c = 0; c != 3; ++c)
+			CHECK( sameProducts( bpKernelsAVX512I8(false)->_matVec, cols[c] ) );
+
+		if ( __builtin_cpu_supports("avx512vnni") )
+			for (int c = 0; c != 3; ++c)
+				CHECK( sameProducts( bpKernelsAVX512I8(true)->_matVec, cols[c] ) );
+		else
+			printf( "no VNNI, int8 kernel without VNNI only\n" );
+	}
+#endif
+}
+
+
+//====================================================================
+// Points of three classes (one-hot outputs)
+//====================================================================
+template <class T>
+static void makeClasses(PatternSetT<T>& set)
+{
+	srand(11);
+
+	set.create( NUM_INPUTS, NUM_OUTPUTS, COUNT );
+	for (size_t i = 0; i != COUNT; ++i)
+	{
+		T* in	= set.inputs()  + i * NUM_INPUTS;
+		T* out	= set.outputs() + i * NUM_OUTPUTS;
+
+		for (int k = 0; k != NUM_INPUTS; ++k)
+			in[k] = (T)rand() / RAND_MAX;
+
+		double score[NUM_OUTPUTS] = { in[0] + in[1], in[2] + 0.5 * in[3] + 0.25, 1.5 - in[0] - in[2] };
+
+		int best = 0;
+		for (int j = 1; j != NUM_OUTPUTS; ++j)
+			best = ( score[j] > score[best] ) ? j : best;
+
+		for (int j = 0; j != NUM_OUTPUTS; ++j)
+			out[j] = ( j == best ) ? (T)0.9 : (T)0.1;
+	}
+}
+
+
+//====================================================================
+// Quantized outputs stay close to the trained network
+//====================================================================
+template <class T>
+static void testQuantize(bool bias)
+{
+	PatternSetT<T> set;
+	makeClasses( set );
+
+	BPNetT<T> net;
+	net.setSeed(11);
+	net.createNetwork( 0.3, 0.5, vector<int>{NUM_INPUTS, 24, NUM_OUTPUTS} );
+	net.enableBias(bias);
+
+	for (int epoch = 0; epoch != 40; ++epoch)
+		net.trainPatterns( set.patterns(), set.size(), 1 );
+
+	// rows of 4 inputs are padded to 16 bytes, a scale, row sum and
+	// (float) bias is kept per node
+	size_t bytes = 24 * 16 + NUM_OUTPUTS * 32 + ( 24 + NUM_OUTPUTS ) * ( bias ? 12 : 8 );
+
+	BPQuantizedNet::Granularity granularities[2] = { BPQuantizedNet::PER_LAYER, BPQuantizedNet::PER_ROW };
+	double rms[2];
+
+	for (int g = 0; g != 2; ++g)
+	{
+		BPQuantizedNet quantized;
+		CHECK( quantized.quantize( net, granularities[g] ) );
+		CHECK( quantized.getGranularity() == granularities[g] && quantized.getNodeCount() == net.getNodeCount() );
+		CHECK( quantized.weightBytes() == bytes );
+
+		BPQuantizedNet::Report report = quantized.compare( net, set );
+
+		printf( "%-6s %-9s %-7s max %.4f mean %.5f rms %.5f agreement %.4f sse %.2f (%.2f)\n",
+				sizeof(T) == sizeof(double) ? "double" : "float",
+				g == 0 ? "per-layer" : "per-row", bias ? "bias" : "no-bias",
+				report.maxError, report.meanError, report.rmsError, report.agreement,
+				report.sumSquared, report.sumSquaredRef );
+
+		CHECK( report.count == COUNT );
+		CHECK( report.maxError > 0 && report.maxError <= ( g == 0 ? 0.08 : 0.05 ) );
+		CHECK( report.meanError <= report.rmsError && report.rmsError <= report.maxError );
+		CHECK( report.agreement >= 0.97 );
+		CHECK( fabs( report.sumSquared - report.sumSquaredRef ) <= 0.05 * report.sumSquaredRef );
+
+		// all rows at once give the outputs of single rows
+		BPQuantizedNet::Workspace ws;
+		quantized.createWorkspace(ws);
+
+		vector<T> out( COUNT * NUM_OUTPUTS ), ref( COUNT * NUM_OUTPUTS );
+		quantized.predict( set.inputs(), &out[0], COUNT, ws );
+		net.runBatch( set.inputs(), COUNT, &ref[0] );
+
+		double worst = 0;
+		for (size_t i = 0; i != out.size(); ++i)
+			worst = fmax( worst, fabs( (double)out[i] - (double)ref[i] ) );
+
+		CHECK_NEAR( worst, report.maxError, 1e-6 );
+
+		rms[g] = report.rmsError;
+	}
+
+	// a scale per node fits the weights more closely
+	CHECK( rms[1] < rms[0] );
+}
+
+
+//====================================================================
+// Layers too wide for int32 sums are refused, an input layer alone
+// passes its inputs through
+//====================================================================
+static void testLimits()
+{
+	BPQuantizedNet quantized;
+
+	BPNet wide;
+	wide.setSeed(11);
+	wide.createNetwork( 0.3, 0.5, vector<int>{65537, 1} );
+	CHECK( !quantized.quantize( wide ) && quantized.getNodeCount().empty() );
+
+	wide.createNetwork( 0.3, 0.5, vector<int>{65536, 1} );
+	CHECK( quantized.quantize( wide ) );
+
+	BPNet input;
+	input.createNetwork( 0.3, 0.5, vector<int>{NUM_INPUTS} );
+	CHECK( quantized.quantize( input ) );
+
+	BPQuantizedNet::Workspace ws;
+	quantized.createWorkspace(ws);
+
+	double in[2 * NUM_INPUTS] = { 0.5, -1, 2, 0.25, 3, 4, -5, 6 }, out[2 * NUM_INPUTS];
+	quantized.predict( in, out, 2, ws );
+	CHECK( memcmp( in, out, sizeof(in) ) == 0 );
+}
+
+
+int main()
+{
+	testMatVecI8();
+
+	testQuantize<double>( true );
+	testQuantize<double>( false );
+	testQuantize<float>( true );
+	testQuantize<float>( false );
+
+	testLimits();
+
+	return TEST_RESULT();
+}
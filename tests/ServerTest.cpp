@@ -0,0 +1,272 @@
+// ServerTest.cpp: batched inference server, client and model reload.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <cstdlib>
+#include <cstdio>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include "BPNet.h"
+#include "BPModelHandle.h"
+#include "BPServer.h"
+#include "BPClient.h"
+#include "BPTest.h"
+using namespace std;
+
+#define SOCKET_FILE	"ServerTest.sock"
+#define MODEL_FILE	"ServerTest.bpm"
+
+#define NUM_CLIENTS		8
+#define NUM_REQUESTS	50
+
+
+//====================================================================
+// Replace the served network while clients are predicting
+//====================================================================
+static void testReload()
+{
+	// two versions with the same input and output sizes
+	shared_ptr<BPNet> first = make_shared<BPNet>();
+	first->setSeed(5);
+	first->createNetwork( 0.1, 0.5, vector<int>{6, 10, 2} );
+
+	shared_ptr<BPNet> second = make_shared<BPNet>();
+	second->setSeed(6);
+	second->createNetwork( 0.1, 0.5, vector<int>{6, 24, 2} );
+
+	double in[6] = { 0.1, 0.9, 0.3, 0.7, 0.5, 0.2 };
+	double outFirst[2], outSecond[2];
+	first->runBatch( in, 1, outFirst );
+	second->runBatch( in, 1, outSecond );
+
+	BPModelHandle model( first );
+	weak_ptr<const BPNet> released( first );
+	first.reset();
+
+	CHECK( model.version() == 1 );
+
+	BPServer server( &model );
+	server.setMaxLatency(100);
+	CHECK( server.listenTcp(0) && server.start() );
+
+	// every reply comes from one version, once the second version
+	// was seen the first one isn't served anymore
+	atomic<bool>	stop( false );
+	vector<int>		bad( 4, 1 );
+	vector<int>		switched( 4, 0 );
+	vector<thread>	threads;
+
+	for (int c = 0; c != 4; ++c)
+	{
+		threads.push_back( thread( [&, c]
+		{
+			BPClient client;
+			if ( !client.connectTcp( server.getPort() ) )
+				return;
+
+			bad[c] = 0;
+			while ( !stop )
+			{
+				double out[2];
+				if ( !client.predict( in, out, 1 ) )
+				{
+					bad[c]++;
+					return;
+				}
+
+				bool isFirst	= fabs( out[0] - outFirst[0] ) + fabs( out[1] - outFirst[1] ) <= 1e-12;
+				bool isSecond	= fabs( out[0] - outSecond[0] ) + fabs( out[1] - outSecond[1] ) <= 1e-12;
+
+				if ( isSecond )
+					switched[c] = 1;
+				else if ( !isFirst || switched[c] )
+					bad[c]++;
+			}
+		} ) );
+	}
+
+	this_thread::sleep_for( chrono::milliseconds(20) );
+	CHECK( model.publish( second ) );
+	second.reset();
+	this_thread::sleep_for( chrono::milliseconds(20) );
+
+	// other input or output sizes are refused, the current version stays
+	shared_ptr<BPNet> other = make_shared<BPNet>();
+	other->createNetwork( 0.1, 0.5, vector<int>{7, 10, 2} );
+	CHECK( !model.publish( other ) );
+	CHECK( !model.load( "ServerTest.missing" ) );
+	CHECK( model.version() == 2 );
+
+	stop = true;
+	for (size_t t = 0; t != threads.size(); ++t)
+		threads[t].join();
+
+	for (int c = 0; c != 4; ++c)
+		CHECK( bad[c] == 0 && switched[c] == 1 );
+
+	// the first version was freed by its last reader
+	CHECK( released.expired() );
+
+	// a model file is loaded aside and served from the next request
+	{
+		BPNet third;
+		third.setSeed(7);
+		third.createNetwork( 0.1, 0.5, vector<int>{6, 8, 2} );
+		CHECK( third.saveBinary( MODEL_FILE ) );
+	}
+
+	CHECK( model.load( MODEL_FILE ) && model.version() == 3 );
+
+	double out[2], ref[2];
+	BPClient client;
+	CHECK( client.connectTcp( server.getPort() ) && client.predict( in, out, 1 ) );
+
+	BPNet::Workspace ws;
+	model.get()->predict( in, ref, 1, ws );
+	CHECK( out[0] == ref[0] && out[1] == ref[1] );
+
+	server.stop();
+	remove( MODEL_FILE );
+}
+
+
+//====================================================================
+// Main
+//====================================================================
+int main()
+{
+	BPNet net;
+	net.setSeed(4);
+	net.createNetwork( 0.1, 0.5, vector<int>{12, 20, 3} );
+	net.enableBias(true);
+	for (int i = 0; i != 3; ++i)
+		net.getLayer(2).setBias( i, 0.1 * i );
+
+	BPServer server( &net );
+	server.setMaxBatch(16);
+	server.setMaxLatency(2000);
+	server.setMaxRequest(100);
+
+	CHECK( !server.start() );	// nothing to listen on
+
+	// a file that isn't a socket is never replaced
+	FILE* file = fopen( SOCKET_FILE, "w" );
+	CHECK( file != NULL && fputs( "data", file ) >= 0 && fclose( file ) == 0 );
+	CHECK( !server.listenUnix( SOCKET_FILE ) );
+	file = fopen( SOCKET_FILE, "r" );
+	CHECK( file != NULL && fgetc( file ) == 'd' );
+	if ( file != NULL )
+		fclose( file );
+	remove( SOCKET_FILE );
+
+	CHECK( server.listenUnix( SOCKET_FILE ) );
+	CHECK( server.listenTcp(0) && server.getPort() > 0 );
+	CHECK( server.start() );
+
+	// concurrent clients over both sockets, 1 to 3 samples per request
+	vector<double>	worst( NUM_CLIENTS, 1.0 );
+	vector<thread>	threads;
+
+	for (int c = 0; c != NUM_CLIENTS; ++c)
+	{
+		threads.push_back( thread( [&, c]
+		{
+			BPClient client;
+			bool connected = ( c % 2 == 0 ) ? client.connectUnix( SOCKET_FILE ) : client.connectTcp( server.getPort() );
+			if ( !connected || client.numInputs() != 12 || client.numOutputs() != 3 )
+				return;
+
+			BPNet::Workspace ws;
+			net.createWorkspace( ws, 3 );
+
+			double in[3 * 12], out[3 * 3], ref[3 * 3];
+			worst[c] = 0;
+
+			for (int r = 0; r != NUM_REQUESTS; ++r)
+			{
+				int n = 1 + (c + r) % 3;
+				for (int i = 0; i != n * 12; ++i)
+					in[i] = ( (c * 131 + r * 17 + i * 7) % 100 ) * 0.01;
+
+				if ( !client.predict( in, out, n ) )
+				{
+					worst[c] = 1.0;
+					return;
+				}
+
+				net.predict( in, ref, n, ws );
+				for (int i = 0; i != n * 3; ++i)
+					worst[c] = fmax( worst[c], fabs( out[i] - ref[i] ) );
+			}
+		} ) );
+	}
+
+	for (size_t t = 0; t != threads.size(); ++t)
+		threads[t].join();
+
+	for (int c = 0; c != NUM_CLIENTS; ++c)
+		CHECK( worst[c] <= 1e-12 );
+
+	BPServer::Stats stats = server.stats();
+	printf( "requests %llu samples %llu batches %llu p50 %.1f us p99 %.1f us\n",
+			(unsigned long long)stats.requests, (unsigned long long)stats.samples,
+			(unsigned long long)stats.batches, stats.p50, stats.p99 );
+
+	CHECK( stats.requests == NUM_CLIENTS * NUM_REQUESTS );
+	CHECK( stats.samples == 2 * NUM_CLIENTS * NUM_REQUESTS );
+	CHECK( stats.batches >= 1 && stats.batches <= stats.requests );
+	CHECK( stats.p50 > 0 && stats.p50 <= stats.p99 && stats.p99 <= stats.maxLatency * 1.1 );
+
+	// a request larger than a batch is split, a request larger than
+	// the limit is refused
+	{
+		BPClient client;
+		CHECK( client.connectTcp( server.getPort() ) && client.maxSamples() == 100 );
+
+		vector<double> in( 40 * 12 ), out( 40 * 3 ), ref( 40 * 3 );
+		for (size_t i = 0; i != in.size(); ++i)
+			in[i] = ( i % 13 ) * 0.07;
+
+		CHECK( client.predict( &in[0], &out[0], 40 ) );
+		net.runBatch( &in[0], 40, &ref[0] );
+
+		double diff = 0;
+		for (size_t i = 0; i != out.size(); ++i)
+			diff = fmax( diff, fabs( out[i] - ref[i] ) );
+		CHECK( diff <= 1e-12 );
+
+		CHECK( !client.predict( &in[0], &out[0], 101 ) );
+	}
+
+	// clients of another precision are refused
+	{
+		BPClientF client;
+		CHECK( !client.connectUnix( SOCKET_FILE ) );
+	}
+
+	// stop closes open connections
+	BPClient idle;
+	CHECK( idle.connectUnix( SOCKET_FILE ) );
+
+	server.stop();
+	CHECK( !server.isRunning() );
+
+	double in[12] = { 0 }, out[3];
+	CHECK( !idle.predict( in, out, 1 ) );
+
+	BPClient late;
+	CHECK( !late.connectUnix( SOCKET_FILE ) );
+
+	testReload();
+
+	return TEST_RESULT();
+}
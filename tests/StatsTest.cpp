@@ -0,0 +1,168 @@
+// StatsTest.cpp: per-layer counters of BPNet (built with BPNET_STATS)
+// and the counter dump of BPTrainer.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <sstream>
+#include <string>
+#include <vector>
+#include "BPNet.h"
+#include "BPStats.h"
+#include "BPTrainer.h"
+#include "PatternSet.h"
+#include "BPTest.h"
+using namespace std;
+
+#define NUM_LAYERS	3
+#define COUNT		8
+
+
+//====================================================================
+// Number of times a text occurs in a string
+//====================================================================
+static int occurrences(const string& str, const string& text)
+{
+	int count = 0;
+	for (size_t pos = str.find(text); pos != string::npos; pos = str.find(text, pos + 1))
+		++count;
+
+	return count;
+}
+
+
+//====================================================================
+// Samples and updates of run()/learn() and runBatch()
+//====================================================================
+static void testCounters()
+{
+	BPNet net;
+	net.setSeed(3);
+	net.createNetwork( 0.3, 0.5, vector<int>{2, 4, 1} );
+
+	BPStats::Snapshot stats = net.stats();
+	CHECK( stats.layers.size() == NUM_LAYERS && stats.updates == 0 );
+
+	const int steps = 25;
+	for (int k = 0; k != steps; ++k)
+	{
+		net.setInput( k & 1, 0 );
+		net.setInput( ( k >> 1 ) & 1, 1 );
+		net.run();
+		net.setError( ( k ^ ( k >> 1 ) ) & 1, 0 );
+		net.learn();
+	}
+
+	stats = net.stats();
+	CHECK( stats.updates == (uint64_t)steps );
+
+	// the input layer isn't evaluated
+	CHECK( stats.layers[0].samples == 0 );
+	for (int i = 1; i != NUM_LAYERS; ++i)
+	{
+		CHECK( stats.layers[i].samples == (uint64_t)steps );
+		CHECK( stats.layers[i].time[BPStats::FORWARD] > 0 );
+		CHECK( stats.layers[i].time[BPStats::BACKWARD] > 0 );
+		CHECK( stats.layers[i].time[BPStats::UPDATE] > 0 );
+	}
+
+	// rows of a batch are samples, no update is made
+	double in[COUNT * 2] = { 0 }, out[COUNT];
+	net.runBatch( in, COUNT, out );
+
+	stats = net.stats();
+	CHECK( stats.updates == (uint64_t)steps );
+	for (int i = 1; i != NUM_LAYERS; ++i)
+		CHECK( stats.layers[i].samples == (uint64_t)( steps + COUNT ) );
+
+	// one row per layer (the input layer is left out) and the totals
+	ostringstream ost;
+	BPStats::print( ost, stats );
+
+	ostringstream totals;
+	totals << "updates " << steps << " ";
+
+	CHECK( occurrences( ost.str(), "\n" ) == NUM_LAYERS + 1 );
+	CHECK( occurrences( ost.str(), totals.str() ) == 1 );
+
+	net.resetStats();
+	stats = net.stats();
+	CHECK( stats.updates == 0 && stats.ioWait == 0 );
+	for (int i = 0; i != NUM_LAYERS; ++i)
+		CHECK( stats.layers[i].samples == 0 && stats.layers[i].time[BPStats::FORWARD] == 0 );
+}
+
+
+//====================================================================
+// The trainer writes the counters every N epochs
+//====================================================================
+static void testDump(int batchSize)
+{
+	PatternSet set;
+	set.create( 2, 1, COUNT );
+	for (int i = 0; i != COUNT; ++i)
+	{
+		set.inputs()[i * 2]		= i & 1;
+		set.inputs()[i * 2 + 1]	= ( i >> 1 ) & 1;
+		set.outputs()[i]		= ( i ^ ( i >> 1 ) ) & 1;
+	}
+
+	BPNet net;
+	net.setSeed(3);
+	net.createNetwork( 0.3, 0.5, vector<int>{2, 4, 1} );
+
+	ostringstream ost;
+
+	BPTrainer trainer( &net );
+	trainer.setData( &set );
+	trainer.setBatchSize( batchSize );
+	trainer.setMaxEpochs(7);
+	trainer.setStatsDump( 2, &ost );
+
+	CHECK( trainer.train() == 7 );
+
+	// after epochs 1, 3 and 5 only
+	string dump = ost.str();
+	CHECK( occurrences( dump, "epoch " ) == 3 );
+	CHECK( occurrences( dump, "epoch 1\n" ) == 1 );
+	CHECK( occurrences( dump, "epoch 3\n" ) == 1 );
+	CHECK( occurrences( dump, "epoch 5\n" ) == 1 );
+	CHECK( occurrences( dump, "layer " ) == 3 );
+
+	// the last dump holds the counters of 6 epochs
+	int batches = ( COUNT + batchSize - 1 ) / batchSize;
+
+	ostringstream totals;
+	totals << "updates " << 6 * batches << " ";
+	CHECK( occurrences( dump.substr( dump.find("epoch 5\n") ), totals.str() ) == 1 );
+
+	BPStats::Snapshot stats = net.stats();
+	CHECK( stats.updates == (uint64_t)( 7 * batches ) );
+	for (int i = 1; i != NUM_LAYERS; ++i)
+		CHECK( stats.layers[i].samples == (uint64_t)( 7 * COUNT ) );
+
+	// no dump without a period
+	ostringstream none;
+	trainer.setStatsDump( 0, &none );
+	trainer.trainEpoch();
+	CHECK( none.str().empty() );
+}
+
+
+int main()
+{
+	// counters are recorded only with BPNET_STATS (see tests/CMakeLists.txt)
+	CHECK( BPStats::compiled() );
+
+	testCounters();
+	testDump(1);
+	testDump(4);
+
+	return TEST_RESULT();
+}
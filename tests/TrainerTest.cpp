@@ -0,0 +1,232 @@
+// TrainerTest.cpp: learning rate schedules and early stopping.
+//
+// Copyright Gideon Pertzov, 2003
+//
+// This software is provided "as is" without express or implied
+// warranties. You may freely copy and compile this source into
+// applications you distribute provided that credit is given to
+// the original author.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <cstdlib>
+#include <vector>
+#include "BPNet.h"
+#include "BPTrainer.h"
+#include "BPStreamTrainer.h"
+#include "PatternSet.h"
+#include "BPTest.h"
+using namespace std;
+
+
+//====================================================================
+// Points inside/outside a circle
+//====================================================================
+static void makeCircle(PatternSet& set, size_t count)
+{
+	set.create( 2, 1, count );
+	for (size_t i = 0; i != count; ++i)
+	{
+		double x = (double)rand() / RAND_MAX;
+		double y = (double)rand() / RAND_MAX;
+
+		set.inputs()[i * 2]		= x;
+		set.inputs()[i * 2 + 1]	= y;
+		set.outputs()[i]		= ( x * x + y * y < 0.5 ) ? 0.9 : 0.1;
+	}
+}
+
+
+//====================================================================
+// Learning rate of each schedule
+//====================================================================
+static void testSchedules()
+{
+	BPNet net;
+	net.createNetwork( 0.4, 0.5, vector<int>{2, 2, 1} );
+
+	BPTrainer trainer( &net );
+	trainer.setMaxEpochs(10);
+
+	CHECK_NEAR( trainer.learningRate(7), 0.4, 1e-15 );
+
+	trainer.setSchedule( BPTrainer::STEP, 0.5, 3 );
+	CHECK_NEAR( trainer.learningRate(2), 0.4, 1e-15 );
+	CHECK_NEAR( trainer.learningRate(3), 0.2, 1e-15 );
+	CHECK_NEAR( trainer.learningRate(7), 0.1, 1e-15 );
+
+	trainer.setSchedule( BPTrainer::EXPONENTIAL, 0.9 );
+	CHECK_NEAR( trainer.learningRate(2), 0.4 * 0.81, 1e-15 );
+
+	trainer.setSchedule( BPTrainer::COSINE );
+	trainer.setMinLearningRate( 0.1 );
+	CHECK_NEAR( trainer.learningRate(0), 0.4, 1e-15 );
+	CHECK_NEAR( trainer.learningRate(5), 0.25, 1e-15 );
+	CHECK_NEAR( trainer.learningRate(10), 0.4, 1e-15 );
+}
+
+
+//====================================================================
+// Training reduces the error, early stopping keeps the best epoch
+//====================================================================
+static void testTraining()
+{
+	srand(7);
+
+	PatternSet train, valid;
+	makeCircle( train, 400 );
+	makeCircle( valid, 100 );
+
+	BPNet net;
+	net.setSeed(7);
+	net.createNetwork( 0.3, 0.5, vector<int>{2, 8, 1} );
+	net.enableBias(true);
+
+	BPTrainer trainer( &net );
+	trainer.setData( &train, &valid );
+	trainer.setMaxEpochs(60);
+	trainer.setSchedule( BPTrainer::COSINE );
+	trainer.setMinLearningRate( 0.01 );
+
+	double before = trainer.evaluate( valid );
+	int epochs = trainer.train();
+
+	CHECK( epochs == 60 && trainer.getEpoch() == 60 );
+	CHECK( trainer.history().back().validError < before * 0.5 );
+
+	// a large net on a few patterns overfits and is stopped
+	PatternSet small;
+	small.create( 2, 1, 10 );
+	for (size_t i = 0; i != 10; ++i)
+	{
+		small.inputs()[i * 2]		= train.inputs()[i * 2];
+		small.inputs()[i * 2 + 1]	= train.inputs()[i * 2 + 1];
+		small.outputs()[i]			= train.outputs()[i];
+	}
+
+	BPNet large;
+	large.setSeed(7);
+	large.createNetwork( 0.3, 0.5, vector<int>{2, 30, 1} );
+
+	BPTrainer stopping( &large );
+	stopping.setData( &small, &valid );
+	stopping.setBatchSize(5);
+	stopping.setMaxEpochs(3000);
+	stopping.setEarlyStopping(50);
+
+	int run = stopping.train();
+	printf( "early stopping after %d epochs, best epoch %d error %g\n",
+			run, stopping.getBestEpoch(), stopping.getBestError() );
+
+	CHECK( stopping.stopped() && run < 3000 );
+	CHECK( stopping.getEpoch() - 1 - stopping.getBestEpoch() == 50 );
+
+	// weights of the best epoch were restored
+	CHECK_NEAR( stopping.evaluate( valid ), stopping.getBestError(), 1e-12 );
+
+	// an empty set has nothing to shuffle or train
+	PatternSet empty;
+	empty.create( 2, 1, 0 );
+
+	BPTrainer idle( &large );
+	idle.setData( &empty );
+	idle.setShuffle( true, 3 );
+	CHECK( idle.trainEpoch().trainError == 0 && idle.getEpoch() == 1 );
+}
+
+
+//====================================================================
+// Stream training from a file reduces the error
+//====================================================================
+static void testStream()
+{
+	srand(8);
+
+	PatternSet set;
+	makeCircle( set, 300 );
+	CHECK( set.saveBinary( "TrainerTest.bps" ) );
+
+	BPNet net;
+	net.setSeed(8);
+	net.createNetwork( 0.3, 0.5, vector<int>{2, 6, 1} );
+
+	BPStreamTrainer trainer( &net );
+	CHECK( trainer.open( "TrainerTest.bps" ) );
+
+	double first = trainer.trainEpoch();
+	double last = first;
+	for (int epoch = 0; epoch != 30; ++epoch)
+		last = trainer.trainEpoch();
+
+	CHECK( last < first );
+	CHECK( !trainer.fail() && trainer.getPatternCount() == 300 );
+
+	trainer.close();
+	remove( "TrainerTest.bps" );
+}
+
+
+//====================================================================
+// Small chunks: every pattern of a file is trained once per epoch
+//====================================================================
+static void testStreamChunks()
+{
+	srand(9);
+
+	// the text file is larger than a reader buffer, values are split
+	// between buffer fills
+	PatternSet set;
+	makeCircle( set, 40000 );
+	CHECK( set.saveText( "TrainerTest.txt" ) );
+	CHECK( set.saveBinary( "TrainerTest.bps" ) );
+
+	// without learning the error of an epoch is the error of each
+	// pattern summed once, in any order
+	BPNet net;
+	net.setSeed(9);
+	net.createNetwork( 0.0, 0.0, vector<int>{2, 6, 1} );
+
+	const char* files[2] = { "TrainerTest.txt", "TrainerTest.bps" };
+	for (int f = 0; f != 2; ++f)
+	{
+		PatternSet loaded;
+		CHECK( f == 0 ? loaded.loadText( files[f], 2, 1 ) : loaded.mapBinary( files[f] ) );
+
+		vector<double> out( loaded.size() );
+		net.runBatch( loaded.inputs(), loaded.size(), &out[0] );
+
+		double expected = 0;
+		for (size_t i = 0; i != loaded.size(); ++i)
+			expected += ( loaded.outputs()[i] - out[i] ) * ( loaded.outputs()[i] - out[i] );
+
+		for (int batchSize = 1; batchSize <= 16; batchSize += 15)
+		{
+			BPStreamTrainer trainer( &net );
+			trainer.setChunkSize(64);
+			trainer.setBatchSize(batchSize);
+			CHECK( trainer.open( files[f] ) );
+
+			for (int epoch = 0; epoch != 3; ++epoch)
+			{
+				double sumSquared = trainer.trainEpoch();
+
+				CHECK( !trainer.fail() && trainer.getPatternCount() == 40000 );
+				CHECK_NEAR( sumSquared, expected, 1e-9 * expected );
+			}
+		}
+	}
+
+	remove( "TrainerTest.txt" );
+	remove( "TrainerTest.bps" );
+}
+
+
+int main()
+{
+	testSchedules();
+	testTraining();
+	testStream();
+	testStreamChunks();
+
+	return TEST_RESULT();
+}